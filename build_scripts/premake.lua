@@ -21,9 +21,11 @@ CPP_VERSION          = "C++20"
 SOLUTION_NAME        = "spartan"
 EDITOR_PROJECT_NAME  = "editor"
 RUNTIME_PROJECT_NAME = "runtime"
+TESTS_PROJECT_NAME   = "tests"
 EXECUTABLE_NAME      = "spartan"
 EDITOR_DIR           = "../" .. EDITOR_PROJECT_NAME
 RUNTIME_DIR          = "../" .. RUNTIME_PROJECT_NAME
+TESTS_DIR            = "../" .. TESTS_PROJECT_NAME
 LIBRARY_DIR          = "../third_party/libraries"
 OBJ_DIR              = "../binaries/obj"
 TARGET_DIR           = "../binaries"
@@ -123,6 +125,10 @@ function solution_configuration()
         language "C++"
         configurations { "debug", "release" }
 
+        -- instruction set, the math library picks its simd backend based on this
+        -- avx is the baseline, nothing checks for newer instruction sets at runtime so they can't be assumed
+        vectorextensions "AVX"
+
         -- platforms
         if os.target() == "windows" then
             platforms { "windows" }
@@ -328,7 +334,49 @@ function editor_project_configuration()
             end
 end
 
+function tests_project_configuration()
+    project (TESTS_PROJECT_NAME)
+        location (TESTS_DIR)
+        links (RUNTIME_PROJECT_NAME)
+        dependson (RUNTIME_PROJECT_NAME)
+        objdir (OBJ_DIR)
+        cppdialect (CPP_VERSION)
+        kind "ConsoleApp"
+        staticruntime "On"
+        defines{ API_CPP_DEFINE }
+        if os.target() == "windows" then
+            conformancemode "On"
+        end
+
+        -- Files
+        files
+        {
+            TESTS_DIR .. "/**.h",
+            TESTS_DIR .. "/**.cpp"
+        }
+
+        -- Includes
+        includedirs { RUNTIME_DIR }
+        includedirs { RUNTIME_DIR .. "/Core" } -- This is here because the runtime uses it
+
+        -- Libraries
+        libdirs (LIBRARY_DIR)
+
+        -- "Release"
+        filter "configurations:release"
+            targetname ( TESTS_PROJECT_NAME )
+            targetdir (TARGET_DIR)
+            debugdir (TARGET_DIR)
+
+        -- "Debug"
+        filter "configurations:debug"
+            targetname ( TESTS_PROJECT_NAME .. "_debug" )
+            targetdir (TARGET_DIR)
+            debugdir (TARGET_DIR)
+end
+
 configure_graphics_api()
 solution_configuration()
 runtime_project_configuration()
 editor_project_configuration()
+tests_project_configuration()
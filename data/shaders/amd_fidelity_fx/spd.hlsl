@@ -26,7 +26,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define A_GPU
 #define A_HLSL
 #define SPD_NO_WAVE_OPERATIONS
+#if AVERAGE
 #define SPD_LINEAR_SAMPLER
+#endif
 
 #include "ffx_a.h"
 
@@ -36,8 +38,18 @@ groupshared AU1 spd_counter;
 AF4 SpdLoadSourceImage(ASU2 p, AU1 slice)
 {
     float2 resolution_out = pass_get_f3_value2().xy;
-    float2 uv             = (p + 0.5f) / resolution_out;
-    return tex.SampleLevel(samplers[sampler_bilinear_clamp], uv, 0);
+
+    #if AVERAGE
+        float2 uv = (p + 0.5f) / resolution_out;
+        return tex.SampleLevel(samplers[sampler_bilinear_clamp], uv, 0);
+    #else
+        // min/max can't be filtered, so every texel is loaded, when the source is stretched over a larger
+        // grid (see Renderer::Pass_Downsample()) each of its texels is still loaded at least once
+        float2 resolution_in;
+        tex.GetDimensions(resolution_in.x, resolution_in.y);
+        uint2 texel = min((uint2)((p + 0.5f) * resolution_in / resolution_out), (uint2)resolution_in - 1);
+        return tex.Load(int3(texel, 0));
+    #endif
 }
 
 // Load from mip 5
@@ -67,6 +79,8 @@ AF4 SpdReduce4(AF4 s1, AF4 s2, AF4 s3, AF4 s4)
         return (s1 + s2 + s3 + s4) * 0.25f;
     #elif MAX
         return max(max(s1, s2), max(s3, s4));
+    #elif MIN
+        return min(min(s1, s2), min(s3, s4));
     #endif
     return 0.0f;
 }
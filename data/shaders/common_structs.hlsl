@@ -238,9 +238,9 @@ struct Light
          return tex_light_color.SampleLevel(samplers[sampler_bilinear_clamp_border], uv, 0).rgb;
     }
 
-    void Build(float3 surface_position, float3 surface_normal, float occlusion)
+    void Build(uint index, float3 surface_position, float3 surface_normal, float occlusion)
     {
-        Light_ light = buffer_lights[(uint)pass_get_f3_value2().x];
+        Light_ light = buffer_lights[index];
 
         flags             = light.flags;
         transform         = light.transform;
@@ -261,6 +261,11 @@ struct Light
         radiance = color * intensity * attenuation * n_dot_l * occlusion;
     }
 
+    void Build(float3 surface_position, float3 surface_normal, float occlusion)
+    {
+        Build((uint)pass_get_f3_value2().x, surface_position, surface_normal, occlusion);
+    }
+
     void Build(Surface surface)
     {
         Build(surface.position, surface.normal, surface.occlusion);
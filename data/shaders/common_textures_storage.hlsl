@@ -124,8 +124,51 @@ struct Light_
 };
 
 RWStructuredBuffer<Light_> buffer_lights : register(u1);
+
+// clustered lighting, an (offset, count) pair per cluster followed by the light indices, see LightClusters.h
+RWStructuredBuffer<uint> buffer_light_clusters : register(u23);
 //======================================================
 
+//= GPU DRIVEN RENDERING ====================================================================
+// when updating these, also update Sb_DrawObject and Sb_DrawIndexedIndirectCommand on the cpu
+struct DrawObject
+{
+    matrix transform;
+    matrix transform_previous;
+
+    float3 box_center;
+    uint index_count;
+
+    float3 box_extent;
+    uint index_offset;
+
+    uint vertex_offset;
+    uint material_index;
+    uint bucket_index;
+    uint command_offset;
+
+    float3 cone_apex;
+    float cone_cutoff;
+
+    float3 cone_axis;
+    uint visibility_index_previous;
+};
+
+struct DrawIndexedIndirectCommand
+{
+    uint index_count;
+    uint instance_count;
+    uint index_offset;
+    int vertex_offset;
+    uint instance_offset;
+};
+
+RWStructuredBuffer<DrawObject> buffer_draw_objects                  : register(u20);
+RWStructuredBuffer<DrawIndexedIndirectCommand> buffer_draw_commands : register(u21);
+RWStructuredBuffer<uint> buffer_draw_counts                         : register(u22);
+RWStructuredBuffer<uint> buffer_draw_visibility                     : register(u24); // two frames of occlusion culling results, one per draw object
+//===========================================================================================
+
 // various storage textures/buffers
 RWTexture2D<float4> tex_uav                                : register(u2);
 RWTexture2D<float4> tex_uav2                               : register(u3);
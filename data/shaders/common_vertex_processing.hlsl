@@ -27,6 +27,24 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 // - this is because the calculations have to be exactly the same and therefore produce identical values over time (motion vectors) and space (depth pre-pass vs g-buffer)
 
 // vertex buffer input
+#ifdef VERTEX_PACKED
+// the compact layout of static meshes, the normal is in xy and the tangent in zw, both octahedral encoded
+struct Vertex_PosUvNorTan
+{
+    float4 position           : POSITION0;
+    float2 uv                 : TEXCOORD0;
+    float4 normal_tangent     : NORMAL0;
+    matrix instance_transform : INSTANCE_TRANSFORM0;
+};
+
+float3 decode_octahedral(float2 encoded)
+{
+    float3 n = float3(encoded.x, encoded.y, 1.0f - abs(encoded.x) - abs(encoded.y));
+    float t  = saturate(-n.z);
+    n.xy    += float2(n.x >= 0.0f ? -t : t, n.y >= 0.0f ? -t : t);
+    return normalize(n);
+}
+#else
 struct Vertex_PosUvNorTan
 {
     float4 position           : POSITION0;
@@ -35,6 +53,7 @@ struct Vertex_PosUvNorTan
     float3 tangent            : TANGENT0;
     matrix instance_transform : INSTANCE_TRANSFORM0;
 };
+#endif
 
 // vertex buffer output
 struct gbuffer_vertex
@@ -50,6 +69,9 @@ struct gbuffer_vertex
     uint instance_id              : INSTANCE_ID;
     matrix transform              : TRANSFORM;
     matrix transform_previous     : TRANSFORM_PREVIOUS;
+#ifdef INDIRECT
+    nointerpolation uint material_index : MATERIAL_INDEX;
+#endif
 };
 
 static float3 extract_position(matrix transform)
@@ -402,8 +424,15 @@ gbuffer_vertex transform_to_world_space(Vertex_PosUvNorTan input, uint instance_
     vertex.position_previous = mul(input.position, transform_previous).xyz;
 #endif
 #ifndef TRANSFORM_IGNORE_NORMALS
-    vertex.normal            = normalize(mul(input.normal, (float3x3)transform));
-    vertex.tangent           = normalize(mul(input.tangent, (float3x3)transform));
+#ifdef VERTEX_PACKED
+    float3 input_normal      = decode_octahedral(input.normal_tangent.xy);
+    float3 input_tangent     = decode_octahedral(input.normal_tangent.zw);
+#else
+    float3 input_normal      = input.normal;
+    float3 input_tangent     = input.tangent;
+#endif
+    vertex.normal            = normalize(mul(input_normal, (float3x3)transform));
+    vertex.tangent           = normalize(mul(input_tangent, (float3x3)transform));
 #endif
 
     // save some things into the vertex
@@ -28,7 +28,15 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 gbuffer_vertex main_vs(Vertex_PosUvNorTan input, uint instance_id : SV_InstanceID)
 {
+#ifdef INDIRECT
+    // the culling pass puts the draw object index in the first instance, indirect draws are never instanced
+    DrawObject draw_object  = buffer_draw_objects[instance_id];
+    indirect_material_index = draw_object.material_index;
+    gbuffer_vertex vertex   = transform_to_world_space(input, 0, draw_object.transform);
+    vertex.material_index   = draw_object.material_index;
+#else
     gbuffer_vertex vertex = transform_to_world_space(input, instance_id, buffer_pass.transform);
+#endif
 
     Surface surface;
     surface.flags = GetMaterial().flags;
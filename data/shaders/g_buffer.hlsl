@@ -33,7 +33,16 @@ struct gbuffer
 
 gbuffer_vertex main_vs(Vertex_PosUvNorTan input, uint instance_id : SV_InstanceID)
 {
+#ifdef INDIRECT
+    // the culling pass puts the draw object index in the first instance, indirect draws are never instanced
+    DrawObject draw_object      = buffer_draw_objects[instance_id];
+    indirect_transform_previous = draw_object.transform_previous;
+    indirect_material_index     = draw_object.material_index;
+    gbuffer_vertex vertex       = transform_to_world_space(input, 0, draw_object.transform);
+    vertex.material_index       = draw_object.material_index;
+#else
     gbuffer_vertex vertex = transform_to_world_space(input, instance_id, buffer_pass.transform);
+#endif
 
     // transform world space position to screen space
     Surface surface;
@@ -48,6 +57,10 @@ gbuffer_vertex main_vs(Vertex_PosUvNorTan input, uint instance_id : SV_InstanceI
 
 gbuffer main_ps(gbuffer_vertex vertex)
 {
+#ifdef INDIRECT
+    indirect_material_index = vertex.material_index;
+#endif
+
     float4 albedo   = GetMaterial().color;
     float3 normal   = vertex.normal.xyz;
     float roughness = GetMaterial().roughness;
@@ -0,0 +1,193 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES =========
+#include "common.hlsl"
+//====================
+
+// when changing these, also update renderer_max_draw_objects and renderer_max_draw_buckets in Renderer_Definitions.h
+static const uint max_draw_objects = 16384;
+static const uint max_draw_buckets = 256;
+
+// the six frustum planes (xyz: normal, w: distance) are packed into the pass constants, the rest of the pass data follows them
+float4 get_frustum_plane(uint index)
+{
+    return index < 4 ? buffer_pass.transform[index] : buffer_pass.values[index - 4];
+}
+
+uint get_draw_object_count()
+{
+    return (uint)buffer_pass.values._m20;
+}
+
+uint get_phase()
+{
+    return (uint)buffer_pass.values._m21;
+}
+
+// the visibility buffer has a region for the current frame and one for the previous, they swap every frame
+uint get_visibility_offset_read()
+{
+    return (uint)buffer_pass.values._m22;
+}
+
+uint get_visibility_offset_write()
+{
+    return (uint)buffer_pass.values._m23;
+}
+
+float2 get_hi_z_size()
+{
+    return buffer_pass.values[3].xy;
+}
+
+uint get_hi_z_mip_count()
+{
+    return (uint)buffer_pass.values._m32;
+}
+
+// the phases, see Renderer::Pass_Visibility_Gpu()
+static const uint phase_single = 0; // frustum and cone culling only
+static const uint phase_early  = 1; // what was visible last frame, drawn before the hierarchical depth is built
+static const uint phase_late   = 2; // everything is tested against the hierarchical depth, what the early phase missed is drawn
+
+bool was_visible(DrawObject draw_object)
+{
+    // objects which weren't drawn by the gpu last frame have no result, the late phase tests them
+    if (draw_object.visibility_index_previous == 0xFFFFFFFF)
+        return false;
+
+    return buffer_draw_visibility[get_visibility_offset_read() + draw_object.visibility_index_previous] != 0;
+}
+
+// tex holds the farthest (reverse-z, so min) depth of each texel's footprint, an object is occluded when its nearest point is behind it
+bool is_occluded(DrawObject draw_object)
+{
+    float2 uv_min   = 1.0f;
+    float2 uv_max   = 0.0f;
+    float depth_max = 0.0f;
+    for (uint i = 0; i < 8; i++)
+    {
+        float3 corner = draw_object.box_center + draw_object.box_extent * float3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+        float4 clip   = mul(float4(corner, 1.0f), buffer_frame.view_projection);
+
+        // boxes which reach behind the camera can't be bounded on screen
+        if (clip.w <= 0.0f)
+            return false;
+
+        float3 ndc = clip.xyz / clip.w;
+        float2 uv  = ndc_to_uv(ndc.xy);
+        uv_min     = min(uv_min, uv);
+        uv_max     = max(uv_max, uv);
+        depth_max  = max(depth_max, ndc.z);
+    }
+
+    // when the resolution is scaled, the depth only covers the top left part of the render target, the rectangle is also grown by a pixel,
+    // because the hierarchical depth is stretched, so a pixel which the rectangle touches can end up in a neighbouring texel
+    float2 texel_size = 1.0f / buffer_frame.resolution_render;
+    uv_min            = saturate(saturate(uv_min) * buffer_frame.resolution_scale - texel_size);
+    uv_max            = saturate(saturate(uv_max) * buffer_frame.resolution_scale + texel_size);
+
+    // the mip at which the rectangle spans at most 2x2 texels
+    float2 size_texels = (uv_max - uv_min) * get_hi_z_size();
+    uint mip           = (uint)clamp(ceil(log2(max(max(size_texels.x, size_texels.y), 1.0f))), 0.0f, (float)(get_hi_z_mip_count() - 1));
+    uint2 size_mip     = max((uint2)get_hi_z_size() >> mip, 1);
+    uint2 texel_min    = min((uint2)(uv_min * size_mip), size_mip - 1);
+    uint2 texel_max    = min((uint2)(uv_max * size_mip), size_mip - 1);
+
+    float depth_min = tex.Load(int3(texel_min, mip)).r;
+    depth_min       = min(depth_min, tex.Load(int3(texel_max.x, texel_min.y, mip)).r);
+    depth_min       = min(depth_min, tex.Load(int3(texel_min.x, texel_max.y, mip)).r);
+    depth_min       = min(depth_min, tex.Load(int3(texel_max, mip)).r);
+
+    return depth_max < depth_min;
+}
+
+[numthreads(THREAD_GROUP_COUNT, 1, 1)]
+void main_cs(uint3 thread_id : SV_DispatchThreadID)
+{
+    if (thread_id.x >= get_draw_object_count())
+        return;
+
+    DrawObject draw_object = buffer_draw_objects[thread_id.x];
+    uint phase             = get_phase();
+
+    // the same test as Frustum::IsVisible() on the cpu, so that the results can be compared
+    bool is_visible = true;
+    for (uint i = 0; i < 6; i++)
+    {
+        float4 plane = get_frustum_plane(i);
+        float d      = dot(draw_object.box_center, plane.xyz);
+        float r      = dot(draw_object.box_extent, abs(plane.xyz));
+
+        if (d + r < -plane.w)
+        {
+            is_visible = false;
+            break;
+        }
+    }
+
+    // the normal cone, meshlets which face away from the camera are culled, the same test as visibility::cull_meshlets() on the cpu
+    if (is_visible && dot(normalize(draw_object.cone_apex - buffer_frame.camera_position), draw_object.cone_axis) >= draw_object.cone_cutoff)
+    {
+        is_visible = false;
+    }
+
+    // the early phase trusts last frame's occlusion, the late phase replaces it with this frame's
+    bool is_drawn_early = false;
+    if (phase != phase_single)
+    {
+        is_drawn_early = is_visible && was_visible(draw_object);
+    }
+
+    if (phase == phase_late)
+    {
+        is_visible = is_visible && !is_occluded(draw_object);
+        buffer_draw_visibility[get_visibility_offset_write() + thread_id.x] = is_visible ? 1 : 0;
+    }
+
+    bool is_drawn = is_visible;
+    if (phase == phase_early)
+    {
+        is_drawn = is_drawn_early;
+    }
+    else if (phase == phase_late)
+    {
+        is_drawn = is_visible && !is_drawn_early;
+    }
+
+    if (!is_drawn)
+        return;
+
+    // claim a slot in the bucket's command range of this phase
+    uint region_index   = phase == phase_late ? 1 : 0;
+    uint command_offset = draw_object.command_offset + region_index * max_draw_objects;
+    uint slot;
+    InterlockedAdd(buffer_draw_counts[draw_object.bucket_index + region_index * max_draw_buckets], 1, slot);
+
+    DrawIndexedIndirectCommand command;
+    command.index_count     = draw_object.index_count;
+    command.instance_count  = 1;
+    command.index_offset    = draw_object.index_offset;
+    command.vertex_offset   = (int)draw_object.vertex_offset;
+    command.instance_offset = thread_id.x; // the vertex shader uses it to fetch the draw object
+    buffer_draw_commands[command_offset + slot] = command;
+}
@@ -49,6 +49,112 @@ float3 subsurface_scattering(Surface surface, Light light, AngularInfo angular_i
     return sss_color * F * diffuse_energy;
 }
 
+// when changing these, also update LightClusters.h
+static const uint light_cluster_tile_count_x = 16;
+static const uint light_cluster_tile_count_y = 9;
+static const uint light_cluster_slice_count  = 24;
+static const uint light_cluster_count        = light_cluster_tile_count_x * light_cluster_tile_count_y * light_cluster_slice_count;
+
+// evaluates the brdf for a light whose radiance has already been computed
+void compute_reflectance(Surface surface, Light light, out float3 diffuse, out float3 specular)
+{
+    float3 light_diffuse    = 0.0f;
+    float3 light_specular   = 0.0f;
+    float3 light_subsurface = 0.0f;
+
+    AngularInfo angular_info;
+    angular_info.Build(light, surface);
+
+    // specular
+    if (surface.anisotropic > 0.0f)
+    {
+        light_specular += BRDF_Specular_Anisotropic(surface, angular_info);
+    }
+    else
+    {
+        light_specular += BRDF_Specular_Isotropic(surface, angular_info);
+    }
+
+    // specular clearcoat
+    if (surface.clearcoat > 0.0f)
+    {
+        light_specular += BRDF_Specular_Clearcoat(surface, angular_info);
+    }
+
+    // sheen
+    if (surface.sheen > 0.0f)
+    {
+        light_specular += BRDF_Specular_Sheen(surface, angular_info);
+    }
+
+    // subsurface scattering
+    if (surface.subsurface_scattering > 0.0f)
+    {
+        light_subsurface += subsurface_scattering(surface, light, angular_info);
+    }
+
+    // diffuse
+    light_diffuse += BRDF_Diffuse(surface, angular_info);
+
+    // energy conservation - only non metals have diffuse
+    light_diffuse *= surface.diffuse_energy * surface.alpha;
+
+    diffuse  = light_diffuse * light.radiance + light_subsurface;
+    specular = light_specular * light.radiance;
+}
+
+#ifdef CLUSTERED
+// the same math as LightClusters::GetClusterIndex()
+uint get_light_cluster(float2 uv, float3 position)
+{
+    float near  = buffer_frame.camera_near;
+    float far   = buffer_frame.camera_far;
+    float z     = world_to_view(position).z;
+    uint slice  = z <= near ? 0 : min((uint)(log(z / near) / log(far / near) * light_cluster_slice_count), light_cluster_slice_count - 1);
+    uint tile_x = (uint)clamp(uv.x * light_cluster_tile_count_x, 0.0f, light_cluster_tile_count_x - 1.0f);
+    uint tile_y = (uint)clamp(uv.y * light_cluster_tile_count_y, 0.0f, light_cluster_tile_count_y - 1.0f);
+
+    return (slice * light_cluster_tile_count_y + tile_y) * light_cluster_tile_count_x + tile_x;
+}
+
+// all the lights without shadow maps in a single dispatch, each pixel only walks the lights of its cluster
+[numthreads(THREAD_GROUP_COUNT_X, THREAD_GROUP_COUNT_Y, 1)]
+void main_cs(uint3 thread_id : SV_DispatchThreadID)
+{
+    // create surface
+    float2 resolution_out;
+    tex_uav.GetDimensions(resolution_out.x, resolution_out.y);
+    Surface surface;
+    surface.Build(thread_id.xy, resolution_out, true, true);
+
+    // early exit cases, these lights are not volumetric so there is nothing to do for the sky
+    bool early_exit_1 = pass_is_opaque()      && surface.is_transparent();
+    bool early_exit_2 = pass_is_transparent() && surface.is_opaque();
+    if (early_exit_1 || early_exit_2 || surface.is_sky())
+        return;
+
+    float2 uv              = (thread_id.xy + 0.5f) / resolution_out;
+    uint cluster           = get_light_cluster(uv, surface.position);
+    uint light_offset      = buffer_light_clusters[cluster * 2 + 0] + light_cluster_count * 2;
+    uint light_count       = buffer_light_clusters[cluster * 2 + 1];
+    float3 light_diffuse   = 0.0f;
+    float3 light_specular  = 0.0f;
+
+    for (uint i = 0; i < light_count; i++)
+    {
+        Light light;
+        light.Build(buffer_light_clusters[light_offset + i], surface.position, surface.normal, surface.occlusion);
+
+        float3 diffuse, specular;
+        compute_reflectance(surface, light, diffuse, specular);
+        light_diffuse  += diffuse;
+        light_specular += specular;
+    }
+
+    /* diffuse  */ tex_uav[thread_id.xy]  += float4(saturate_11(light_diffuse), 1.0f);
+    /* specular */ tex_uav2[thread_id.xy] += float4(saturate_11(light_specular), 1.0f);
+}
+#else
 [numthreads(THREAD_GROUP_COUNT_X, THREAD_GROUP_COUNT_Y, 1)]
 void main_cs(uint3 thread_id : SV_DispatchThreadID)
 {
@@ -68,11 +174,10 @@ void main_cs(uint3 thread_id : SV_DispatchThreadID)
     Light light;
     light.Build(surface);
 
-    float4 shadow           = 0.0f;
-    float3 light_diffuse    = 0.0f;
-    float3 light_specular   = 0.0f;
-    float3 volumetric_fog   = 0.0f;
-    float3 light_subsurface = 0.0f;
+    float4 shadow         = light.has_shadows() ? 0.0f : 1.0f; // lights without shadow maps are unoccluded, the rest are lit where their shadow map says so
+    float3 light_diffuse  = 0.0f;
+    float3 light_specular = 0.0f;
+    float3 volumetric_fog = 0.0f;
 
     if (!surface.is_sky())
     {
@@ -105,44 +210,7 @@ void main_cs(uint3 thread_id : SV_DispatchThreadID)
         light.radiance *= shadow.rgb * shadow.a;
 
         // reflectance equation(s)
-        {
-            AngularInfo angular_info;
-            angular_info.Build(light, surface);
-
-            // specular
-            if (surface.anisotropic > 0.0f)
-            {
-                light_specular += BRDF_Specular_Anisotropic(surface, angular_info);
-            }
-            else
-            {
-                light_specular += BRDF_Specular_Isotropic(surface, angular_info);
-            }
-
-            // specular clearcoat
-            if (surface.clearcoat > 0.0f)
-            {
-                light_specular += BRDF_Specular_Clearcoat(surface, angular_info);
-            }
-
-            // sheen
-            if (surface.sheen > 0.0f)
-            {
-                light_specular += BRDF_Specular_Sheen(surface, angular_info);
-            }
-
-            // subsurface scattering
-            if (surface.subsurface_scattering > 0.0f)
-            {
-                light_subsurface += subsurface_scattering(surface, light, angular_info);
-            }
-        
-            // diffuse
-            light_diffuse += BRDF_Diffuse(surface, angular_info);
-
-            // energy conservation - only non metals have diffuse
-            light_diffuse *= surface.diffuse_energy * surface.alpha;
-        }
+        compute_reflectance(surface, light, light_diffuse, light_specular);
     }
     
     // volumetric
@@ -151,8 +219,9 @@ void main_cs(uint3 thread_id : SV_DispatchThreadID)
         volumetric_fog = compute_volumetric_fog(surface, light, thread_id.xy);
     }
     
-    /* diffuse    */ tex_uav[thread_id.xy]  += float4(saturate_11(light_diffuse  * light.radiance + light_subsurface), 1.0f);
-    /* specular   */ tex_uav2[thread_id.xy] += float4(saturate_11(light_specular * light.radiance), 1.0f);
+    /* diffuse    */ tex_uav[thread_id.xy]  += float4(saturate_11(light_diffuse), 1.0f);
+    /* specular   */ tex_uav2[thread_id.xy] += float4(saturate_11(light_specular), 1.0f);
     /* shadow     */ tex_uav3[thread_id.xy]  = saturate(tex_uav3[thread_id.xy] - (1.0f - shadow.a));
     /* volumetric */ tex_uav4[thread_id.xy] += float4(saturate_11(volumetric_fog), 1.0f);
 }
+#endif
@@ -411,7 +411,13 @@ void RenderOptions::OnTickVisible()
             option_check_box("Physics",                 Renderer_Option::Physics);
             option_check_box("AABBs",                   Renderer_Option::Aabb);
             option_check_box("Wireframe",               Renderer_Option::Wireframe);
-            option_check_box("Occlusion Culling (WIP)", Renderer_Option::OcclusionCulling);
+            option_check_box("Occlusion culling",       Renderer_Option::OcclusionCulling, "The biggest renderables on screen are rasterized as low poly hulls on the cpu, renderables which are hidden behind them are culled, with GPU driven rendering, what was visible last frame is drawn first and everything else is tested against its hierarchical depth.");
+            option_check_box("GPU Driven (WIP)",        Renderer_Option::GpuDrivenRendering);
+            option_check_box("Dynamic instancing",      Renderer_Option::DynamicInstancing, "Repeated static renderables which share a mesh and a material are drawn with one instanced draw");
+            option_check_box("Meshlet culling",         Renderer_Option::MeshletCulling, "Large meshes are split into clusters which are frustum and back-face culled individually");
+            option_check_box("Light clustering",        Renderer_Option::LightClustering, "Lights without shadows are assigned to view space clusters and shaded in a single pass, instead of one full screen pass each");
+            option_value("Recording jobs", Renderer_Option::RecordingJobs, "Experimental: the number of threads which record the g-buffer and shadow passes into secondary command lists", 1.0f, 1.0f, 32.0f, "%.0f");
+            option_value("Shadow LOD bias", Renderer_Option::ShadowLodBias, "How many levels of detail coarser shadow casters are drawn compared to what the camera sees", 1.0f, 0.0f, 3.0f, "%.0f");
         }
 
         ImGui::EndTable();
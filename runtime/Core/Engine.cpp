@@ -23,6 +23,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "pch.h"
 #include "Window.h"
 #include "ThreadPool.h"
+#include "TaskGraph.h"
 #include "../Audio/Audio.h"
 #include "../Input/Input.h"
 #include "../World/World.h"
@@ -47,6 +48,49 @@ namespace Spartan
     {
         vector<string> arguments;
         uint32_t flags = 0;
+        TaskGraph task_graph;
+
+        void build_task_graph()
+        {
+            // the window, the world (editor camera, scripts, etc) and the renderer all talk to sdl,
+            // the swapchain or the editor, so they stay on the main thread, the graph will still overlap them with anything they don't conflict with
+            task_graph.AddStage("input", TaskGraphResource::None, TaskGraphResource::Input, true, []()
+            {
+                Window::Tick();
+                Input::Tick();
+            });
+
+            // waits for the gpu to release the command lists of an earlier frame, this is most of the time the main thread would
+            // otherwise spend idle, it touches nothing but the gpu so the physics simulation runs on a worker in the meantime
+            task_graph.AddStage("gpu_sync", TaskGraphResource::None, TaskGraphResource::Gpu, true, []()
+            {
+                Renderer::PreTick();
+            });
+
+            // picking only reads the input state and the camera, bullet itself has no thread affinity
+            task_graph.AddStage("physics", TaskGraphResource::Input, TaskGraphResource::Physics | TaskGraphResource::Transforms | TaskGraphResource::DebugDraw, false, []()
+            {
+                Physics::Tick();
+            });
+
+            task_graph.AddStage("world", TaskGraphResource::Input, TaskGraphResource::World | TaskGraphResource::Physics | TaskGraphResource::Transforms | TaskGraphResource::DebugDraw, true, []()
+            {
+                World::Tick();
+            });
+
+            // only reads the listener's transform, so it can overlap with the renderer
+            task_graph.AddStage("audio", TaskGraphResource::Transforms, TaskGraphResource::Audio, false, []()
+            {
+                Audio::Tick();
+            });
+
+            // visibility and post-process recording are still part of this one stage, overlapping them
+            // needs the renderer's passes to be split into stages of their own with their own resources
+            task_graph.AddStage("renderer", TaskGraphResource::Input | TaskGraphResource::World | TaskGraphResource::Transforms | TaskGraphResource::DebugDraw, TaskGraphResource::Gpu, true, []()
+            {
+                Renderer::Tick();
+            });
+        }
 
         void write_ci_test_file(const uint32_t value)
         {
@@ -89,6 +133,8 @@ namespace Spartan
             Settings::Initialize();
         }
 
+        build_task_graph();
+
         SP_LOG_INFO("Initialization took %.1f sec", timer_initialize.GetElapsedTimeSec());
         SP_SUBSCRIBE_TO_EVENT(EventType::RendererOnFirstFrameCompleted, SP_EVENT_HANDLER_EXPRESSION_STATIC(write_ci_test_file(0);));
     }
@@ -107,21 +153,18 @@ namespace Spartan
         ImageImporterExporter::Shutdown();
         FontImporter::Shutdown();
         Settings::Shutdown();
+        Timer::Shutdown();
     }
 
     void Engine::Tick()
     {
         // pre-tick
+        Timer::PreTick();
         Profiler::PreTick();
         Input::PreTick();
 
         // tick
-        Window::Tick();
-        Input::Tick();
-        Audio::Tick();
-        Physics::Tick();
-        World::Tick();
-        Renderer::Tick();
+        task_graph.Execute();
 
         // post-tick
         Timer::PostTick();
@@ -153,4 +196,9 @@ namespace Spartan
 
         return false;
     }
+
+    const TaskGraph& Engine::GetTaskGraph()
+    {
+        return task_graph;
+    }
 }
@@ -27,6 +27,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 namespace Spartan
 {
+    class TaskGraph;
+
     enum class EngineMode : uint32_t
     {
         EditorVisible = 1 << 0,
@@ -43,5 +45,6 @@ namespace Spartan
         static void SetFlag(const EngineMode flag, const bool enabled);
         static void ToggleFlag(const EngineMode flag);
         static bool HasArgument(const std::string& argument);
+        static const TaskGraph& GetTaskGraph();
     };
 }
@@ -0,0 +1,146 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES ============
+#include "pch.h"
+#include "FrameAllocator.h"
+//=======================
+
+//= NAMESPACES =====
+using namespace std;
+//==================
+
+namespace Spartan
+{
+    namespace
+    {
+        const size_t block_size = 256 * 1024;
+
+        struct Block
+        {
+            unique_ptr<uint8_t[]> data;
+            size_t size = 0;
+        };
+
+        struct Arena
+        {
+            vector<Block> blocks;
+            uint32_t block_index = 0;
+            size_t offset        = 0;
+
+            void Reset()
+            {
+                block_index = 0;
+                offset      = 0;
+            }
+        };
+
+        struct ThreadArenas
+        {
+            array<Arena, 2> arenas;
+            uint64_t epoch = 0;
+        };
+
+        atomic<uint64_t> epoch                 = 0;
+        atomic<uint64_t> allocated_bytes       = 0;
+        atomic<uint32_t> allocation_count      = 0;
+        atomic<uint32_t> heap_allocation_count = 0;
+        thread_local ThreadArenas thread_arenas;
+
+        Arena& get_arena()
+        {
+            // the first allocation after a reset recycles the half that was used two resets ago
+            const uint64_t epoch_current = epoch.load(memory_order_relaxed);
+            Arena& arena                 = thread_arenas.arenas[epoch_current % 2];
+            if (thread_arenas.epoch != epoch_current)
+            {
+                thread_arenas.epoch = epoch_current;
+                arena.Reset();
+            }
+
+            return arena;
+        }
+    }
+
+    void* FrameAllocator::Allocate(const size_t size, const size_t alignment /*= alignof(max_align_t)*/)
+    {
+        SP_ASSERT_MSG((alignment & (alignment - 1)) == 0, "Alignment must be a power of two");
+
+        Arena& arena = get_arena();
+
+        allocation_count.fetch_add(1, memory_order_relaxed);
+        allocated_bytes.fetch_add(size, memory_order_relaxed);
+
+        // find a block with enough space, starting from the current one
+        while (arena.block_index < arena.blocks.size())
+        {
+            Block& block      = arena.blocks[arena.block_index];
+            uintptr_t address = reinterpret_cast<uintptr_t>(block.data.get()) + arena.offset;
+            size_t padding    = (alignment - (address % alignment)) % alignment;
+
+            if (arena.offset + padding + size <= block.size)
+            {
+                arena.offset += padding + size;
+                return reinterpret_cast<void*>(address + padding);
+            }
+
+            arena.block_index++;
+            arena.offset = 0;
+        }
+
+        // out of space, grow (large allocations get a block of their own)
+        Block& block = arena.blocks.emplace_back();
+        block.size   = max(block_size, size + alignment);
+        block.data   = make_unique<uint8_t[]>(block.size);
+        heap_allocation_count.fetch_add(1, memory_order_relaxed);
+
+        uintptr_t address = reinterpret_cast<uintptr_t>(block.data.get());
+        size_t padding    = (alignment - (address % alignment)) % alignment;
+        arena.block_index = static_cast<uint32_t>(arena.blocks.size() - 1);
+        arena.offset      = padding + size;
+
+        return reinterpret_cast<void*>(address + padding);
+    }
+
+    void FrameAllocator::Reset()
+    {
+        epoch.fetch_add(1, memory_order_relaxed);
+
+        allocated_bytes       = 0;
+        allocation_count      = 0;
+        heap_allocation_count = 0;
+    }
+
+    uint64_t FrameAllocator::GetAllocatedBytes()
+    {
+        return allocated_bytes;
+    }
+
+    uint32_t FrameAllocator::GetAllocationCount()
+    {
+        return allocation_count;
+    }
+
+    uint32_t FrameAllocator::GetHeapAllocationCount()
+    {
+        return heap_allocation_count;
+    }
+}
@@ -0,0 +1,71 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+//= INCLUDES ===========
+#include "Definitions.h"
+#include <vector>
+#include <cstddef>
+//======================
+
+namespace Spartan
+{
+    // a thread-local bump allocator for data that only needs to live for a frame or so
+    // memory is handed out linearly and never freed individually, everything is reclaimed in one go
+    // on Reset(), which the renderer calls once the resources of past frames are retired
+    // the arena is double buffered, so allocations made just before a reset remain valid until the next one
+    class SP_CLASS FrameAllocator
+    {
+    public:
+        static void* Allocate(const size_t size, const size_t alignment = alignof(std::max_align_t));
+        static void Reset();
+
+        // stats (across all threads, since the last reset)
+        static uint64_t GetAllocatedBytes();
+        static uint32_t GetAllocationCount();
+        static uint32_t GetHeapAllocationCount(); // times the arena had to grow, ideally zero once warmed up
+    };
+
+    // an stl compatible allocator on top of the frame allocator, deallocation is a no-op
+    template<typename T>
+    class FrameAllocatorStl
+    {
+    public:
+        using value_type = T;
+
+        FrameAllocatorStl() = default;
+        template<typename U> FrameAllocatorStl(const FrameAllocatorStl<U>&) {}
+
+        T* allocate(const size_t count)
+        {
+            return static_cast<T*>(FrameAllocator::Allocate(count * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T*, const size_t) {}
+
+        template<typename U> bool operator==(const FrameAllocatorStl<U>&) const { return true; }
+        template<typename U> bool operator!=(const FrameAllocatorStl<U>&) const { return false; }
+    };
+
+    template<typename T>
+    using FrameVector = std::vector<T, FrameAllocatorStl<T>>;
+}
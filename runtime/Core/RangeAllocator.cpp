@@ -0,0 +1,181 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+//= INCLUDES ============
+#include "pch.h"
+#include "RangeAllocator.h"
+//=======================
+
+//= NAMESPACES =====
+using namespace std;
+//==================
+
+namespace Spartan
+{
+    RangeAllocator::RangeAllocator(const uint64_t capacity)
+    {
+        m_capacity = capacity;
+
+        if (m_capacity != 0)
+        {
+            FreeRangeAdd(0, m_capacity);
+        }
+    }
+
+    uint64_t RangeAllocator::Allocate(const uint64_t size)
+    {
+        SP_ASSERT(size != 0);
+
+        // best fit, the smallest free range which is large enough
+        auto it_size = m_free_by_size.lower_bound(size);
+        if (it_size == m_free_by_size.end())
+            return offset_invalid;
+
+        const uint64_t offset     = it_size->second;
+        const uint64_t size_range = it_size->first;
+        FreeRangeRemove(m_free_by_offset.find(offset));
+
+        // return the remainder
+        if (size_range > size)
+        {
+            FreeRangeAdd(offset + size, size_range - size);
+        }
+
+        m_allocations[offset]  = size;
+        m_allocated_size      += size;
+
+        return offset;
+    }
+
+    void RangeAllocator::Free(const uint64_t offset)
+    {
+        auto it_allocation = m_allocations.find(offset);
+        SP_ASSERT_MSG(it_allocation != m_allocations.end(), "Not an allocation of this allocator");
+
+        uint64_t offset_range  = offset;
+        uint64_t size_range    = it_allocation->second;
+        m_allocated_size      -= size_range;
+        m_allocations.erase(it_allocation);
+
+        // merge with the free range which follows
+        auto it_next = m_free_by_offset.lower_bound(offset);
+        if (it_next != m_free_by_offset.end() && it_next->first == offset_range + size_range)
+        {
+            size_range += it_next->second;
+            FreeRangeRemove(it_next);
+        }
+
+        // merge with the free range which precedes
+        auto it_previous = m_free_by_offset.lower_bound(offset);
+        if (it_previous != m_free_by_offset.begin())
+        {
+            --it_previous;
+            if (it_previous->first + it_previous->second == offset_range)
+            {
+                offset_range  = it_previous->first;
+                size_range   += it_previous->second;
+                FreeRangeRemove(it_previous);
+            }
+        }
+
+        FreeRangeAdd(offset_range, size_range);
+    }
+
+    vector<RangeAllocatorMove> RangeAllocator::Defragment(const uint32_t move_count_max)
+    {
+        vector<RangeAllocatorMove> moves;
+
+        // walk the allocations from the end, each one goes into the first free range which can hold it and lies entirely before it
+        vector<pair<uint64_t, uint64_t>> allocations(m_allocations.rbegin(), m_allocations.rend());
+        for (const auto& [offset, size] : allocations)
+        {
+            if (moves.size() == move_count_max)
+                break;
+
+            auto it_destination = m_free_by_offset.end();
+            for (auto it = m_free_by_offset.begin(); it != m_free_by_offset.end() && it->first + size <= offset; ++it)
+            {
+                if (it->second >= size)
+                {
+                    it_destination = it;
+                    break;
+                }
+            }
+
+            if (it_destination == m_free_by_offset.end())
+                continue;
+
+            // carve the destination out of the start of the free range
+            const uint64_t offset_destination = it_destination->first;
+            const uint64_t size_range         = it_destination->second;
+            FreeRangeRemove(it_destination);
+            if (size_range > size)
+            {
+                FreeRangeAdd(offset_destination + size, size_range - size);
+            }
+            m_allocations[offset_destination]  = size;
+            m_allocated_size                  += size;
+
+            // release the source, this merges it with its neighbours
+            Free(offset);
+
+            moves.push_back({ offset, offset_destination, size });
+        }
+
+        return moves;
+    }
+
+    uint64_t RangeAllocator::GetFreeRangeLargest() const
+    {
+        return m_free_by_size.empty() ? 0 : m_free_by_size.rbegin()->first;
+    }
+
+    float RangeAllocator::GetFragmentation() const
+    {
+        const uint64_t size_free = m_capacity - m_allocated_size;
+        if (size_free == 0)
+            return 0.0f;
+
+        return 1.0f - static_cast<float>(GetFreeRangeLargest()) / static_cast<float>(size_free);
+    }
+
+    void RangeAllocator::FreeRangeAdd(const uint64_t offset, const uint64_t size)
+    {
+        m_free_by_offset[offset] = size;
+        m_free_by_size.emplace(size, offset);
+    }
+
+    void RangeAllocator::FreeRangeRemove(map<uint64_t, uint64_t>::iterator it)
+    {
+        auto [it_begin, it_end] = m_free_by_size.equal_range(it->second);
+        for (auto it_size = it_begin; it_size != it_end; ++it_size)
+        {
+            if (it_size->second == it->first)
+            {
+                m_free_by_size.erase(it_size);
+                break;
+            }
+        }
+
+        m_free_by_offset.erase(it);
+    }
+}
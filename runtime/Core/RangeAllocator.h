@@ -0,0 +1,77 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+//= INCLUDES ===========
+#include "Definitions.h"
+#include <map>
+#include <vector>
+#include <limits>
+//======================
+
+namespace Spartan
+{
+    struct RangeAllocatorMove
+    {
+        uint64_t offset_source      = 0;
+        uint64_t offset_destination = 0;
+        uint64_t size               = 0;
+    };
+
+    // hands out ranges of a fixed capacity, it knows nothing about what lives in them so it works (and can be tested) without a gpu
+    // free ranges are tracked by offset, so that neighbours can be merged, and by size, so that the best fit is found in logarithmic time
+    // offsets and sizes are in whatever unit the caller chooses, the geometry buffer uses vertices and indices
+    class SP_CLASS RangeAllocator
+    {
+    public:
+        static constexpr uint64_t offset_invalid = std::numeric_limits<uint64_t>::max();
+
+        RangeAllocator(const uint64_t capacity = 0);
+
+        // returns offset_invalid when no free range is large enough
+        uint64_t Allocate(const uint64_t size);
+        void Free(const uint64_t offset);
+
+        // moves allocations from the end into free ranges closer to the start, so that the free space ends up in one piece,
+        // a move never overlaps its own source, the caller copies the contents and updates whoever holds the offsets
+        std::vector<RangeAllocatorMove> Defragment(const uint32_t move_count_max = std::numeric_limits<uint32_t>::max());
+
+        // stats
+        uint64_t GetCapacity() const        { return m_capacity; }
+        uint64_t GetAllocatedSize() const   { return m_allocated_size; }
+        uint32_t GetAllocationCount() const { return static_cast<uint32_t>(m_allocations.size()); }
+        uint32_t GetFreeRangeCount() const  { return static_cast<uint32_t>(m_free_by_offset.size()); }
+        uint64_t GetFreeRangeLargest() const;
+        float GetFragmentation() const; // 0 when the free space is in one piece, approaches 1 as it splinters
+
+    private:
+        void FreeRangeAdd(const uint64_t offset, const uint64_t size);
+        void FreeRangeRemove(std::map<uint64_t, uint64_t>::iterator it);
+
+        uint64_t m_capacity       = 0;
+        uint64_t m_allocated_size = 0;
+        std::map<uint64_t, uint64_t> m_allocations;       // offset -> size
+        std::map<uint64_t, uint64_t> m_free_by_offset;    // offset -> size
+        std::multimap<uint64_t, uint64_t> m_free_by_size; // size -> offset
+    };
+}
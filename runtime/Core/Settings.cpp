@@ -82,6 +82,12 @@ namespace Spartan
                 case Renderer_Option::ResolutionScale:             return "ResolutionScale";
                 case Renderer_Option::DynamicResolution:           return "DynamicResolution";
                 case Renderer_Option::OcclusionCulling:            return "OcclusionCulling";
+                case Renderer_Option::GpuDrivenRendering:          return "GpuDrivenRendering";
+                case Renderer_Option::RecordingJobs:               return "RecordingJobs";
+                case Renderer_Option::DynamicInstancing:           return "DynamicInstancing";
+                case Renderer_Option::ShadowLodBias:               return "ShadowLodBias";
+                case Renderer_Option::MeshletCulling:              return "MeshletCulling";
+                case Renderer_Option::LightClustering:             return "LightClustering";
                 default:
                 {
                     SP_ASSERT_MSG(false, "Renderer_Option not handled");
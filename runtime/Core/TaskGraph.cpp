@@ -0,0 +1,218 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES =========
+#include "pch.h"
+#include "TaskGraph.h"
+#include "ThreadPool.h"
+//====================
+
+//= NAMESPACES =====
+using namespace std;
+//==================
+
+namespace Spartan
+{
+    namespace
+    {
+        bool overlaps(TaskGraphResource a, TaskGraphResource b)
+        {
+            return (static_cast<uint32_t>(a) & static_cast<uint32_t>(b)) != 0;
+        }
+    }
+
+    TaskGraph::~TaskGraph()
+    {
+        ThreadPool::Wait(m_tasks);
+    }
+
+    void TaskGraph::AddStage(const char* name, TaskGraphResource reads, TaskGraphResource writes, bool main_thread, function<void()>&& function)
+    {
+        TaskGraphStage& stage = m_stages.emplace_back();
+        stage.name            = name;
+        stage.function        = std::forward<std::function<void()>>(function);
+        stage.reads           = reads;
+        stage.writes          = writes;
+        stage.main_thread     = main_thread;
+
+        m_compiled = false;
+    }
+
+    void TaskGraph::Compile()
+    {
+        const uint32_t stage_count = static_cast<uint32_t>(m_stages.size());
+
+        for (TaskGraphStage& stage : m_stages)
+        {
+            stage.dependencies.clear();
+            stage.dependents.clear();
+        }
+
+        // a stage depends on any earlier stage that it has a read-after-write, write-after-read or write-after-write hazard with
+        for (uint32_t i = 0; i < stage_count; i++)
+        {
+            TaskGraphStage& stage = m_stages[i];
+
+            for (uint32_t j = 0; j < i; j++)
+            {
+                TaskGraphStage& stage_earlier = m_stages[j];
+
+                bool hazard =
+                    overlaps(stage_earlier.writes, stage.reads)  ||
+                    overlaps(stage_earlier.reads,  stage.writes) ||
+                    overlaps(stage_earlier.writes, stage.writes);
+
+                if (hazard)
+                {
+                    stage.dependencies.emplace_back(j);
+                    stage_earlier.dependents.emplace_back(i);
+                }
+            }
+        }
+
+        m_pending_dependencies = make_unique<atomic<uint32_t>[]>(stage_count);
+        m_states               = make_unique<atomic<StageState>[]>(stage_count);
+        m_compiled             = true;
+    }
+
+    void TaskGraph::Execute()
+    {
+        if (!m_compiled)
+        {
+            Compile();
+        }
+
+        const uint32_t stage_count = static_cast<uint32_t>(m_stages.size());
+        m_time_start               = chrono::steady_clock::now();
+        m_stages_done              = 0;
+        m_stages_ready             = 0;
+        m_tasks                    = ThreadPool::CreateJobHandle();
+
+        for (uint32_t i = 0; i < stage_count; i++)
+        {
+            m_pending_dependencies[i] = static_cast<uint32_t>(m_stages[i].dependencies.size());
+            m_states[i]               = StageState::Waiting;
+        }
+
+        for (uint32_t i = 0; i < stage_count; i++)
+        {
+            if (m_stages[i].dependencies.empty())
+            {
+                OnStageReady(i);
+            }
+        }
+
+        // run main thread stages as they become ready, as well as any worker stage that no worker has picked up yet
+        // (a worker could be busy with something long, like loading a world, and we don't want to stall the frame on it)
+        while (m_stages_done < stage_count)
+        {
+            // main thread stages first, they can't run anywhere else
+            bool ran_stage = false;
+            for (uint32_t i = 0; i < stage_count; i++)
+            {
+                if (m_stages[i].main_thread)
+                {
+                    ran_stage |= TryRunStage(i, true);
+                }
+            }
+
+            if (!ran_stage)
+            {
+                for (uint32_t i = 0; i < stage_count && !ran_stage; i++)
+                {
+                    ran_stage = TryRunStage(i, true);
+                }
+            }
+
+            // everything that's ready is running elsewhere, sleep until that changes
+            if (!ran_stage)
+            {
+                unique_lock<mutex> lock(m_mutex);
+                m_condition.wait(lock, [this, stage_count] { return m_stages_ready > 0 || m_stages_done == stage_count; });
+            }
+        }
+
+        // the tasks of stages that the main thread got to first are still queued, and the last stage's task may still be notifying
+        ThreadPool::Wait(m_tasks);
+
+        m_time_ms = static_cast<float>(chrono::duration<double, milli>(chrono::steady_clock::now() - m_time_start).count());
+    }
+
+    void TaskGraph::OnStageReady(const uint32_t index)
+    {
+        m_stages_ready++;
+        m_states[index] = StageState::Ready;
+
+        if (!m_stages[index].main_thread && ThreadPool::GetThreadCount() > 0)
+        {
+            // tracked by m_tasks so that the graph outlives the task, if the main thread gets to the stage first the task does nothing
+            ThreadPool::AddTask([this, index]()
+            {
+                TryRunStage(index, false);
+            }, m_tasks);
+        }
+
+        Notify();
+    }
+
+    void TaskGraph::Notify()
+    {
+        // taking the lock orders this with the predicate check of the sleeping thread, so the wake up can't be missed
+        {
+            lock_guard<mutex> lock(m_mutex);
+        }
+        m_condition.notify_one();
+    }
+
+    bool TaskGraph::TryRunStage(const uint32_t index, const bool is_main_thread)
+    {
+        TaskGraphStage& stage = m_stages[index];
+
+        if (stage.main_thread && !is_main_thread)
+            return false;
+
+        StageState expected = StageState::Ready;
+        if (!m_states[index].compare_exchange_strong(expected, StageState::Running))
+            return false;
+        m_stages_ready--;
+
+        stage.ran_on_main_thread = is_main_thread;
+        stage.time_start_ms      = static_cast<float>(chrono::duration<double, milli>(chrono::steady_clock::now() - m_time_start).count());
+        stage.function();
+        stage.time_end_ms        = static_cast<float>(chrono::duration<double, milli>(chrono::steady_clock::now() - m_time_start).count());
+
+        m_states[index] = StageState::Done;
+
+        for (const uint32_t dependent : stage.dependents)
+        {
+            if (m_pending_dependencies[dependent].fetch_sub(1) == 1)
+            {
+                OnStageReady(dependent);
+            }
+        }
+
+        // last, so that the graph is not considered done while dependents are still being scheduled
+        m_stages_done++;
+        Notify();
+
+        return true;
+    }
+}
@@ -0,0 +1,123 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+//= INCLUDES =================
+#include "Definitions.h"
+#include "ThreadPool.h"
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+//============================
+
+namespace Spartan
+{
+    // engine data that a stage can read or write, two stages that touch the same data
+    // (and at least one of them writes it) are ordered, everything else is free to overlap
+    enum class TaskGraphResource : uint32_t
+    {
+        None       = 0,
+        Input      = 1 << 0,
+        Transforms = 1 << 1,
+        World      = 1 << 2,
+        Physics    = 1 << 3,
+        Audio      = 1 << 4,
+        DebugDraw  = 1 << 5,
+        Gpu        = 1 << 6
+    };
+
+    inline TaskGraphResource operator|(TaskGraphResource a, TaskGraphResource b)
+    {
+        return static_cast<TaskGraphResource>(static_cast<uint32_t>(a) | static_cast<uint32_t>(b));
+    }
+
+    struct TaskGraphStage
+    {
+        std::string name;
+        std::function<void()> function;
+        TaskGraphResource reads  = TaskGraphResource::None;
+        TaskGraphResource writes = TaskGraphResource::None;
+        bool main_thread         = false; // for stages that talk to the window, the swapchain, etc.
+
+        // derived from reads/writes and the order in which stages were added
+        std::vector<uint32_t> dependencies;
+        std::vector<uint32_t> dependents;
+
+        // last execution, in milliseconds since the graph started executing
+        float time_start_ms     = 0.0f;
+        float time_end_ms       = 0.0f;
+        bool ran_on_main_thread = true;
+    };
+
+    class SP_CLASS TaskGraph
+    {
+    public:
+        TaskGraph() = default;
+        ~TaskGraph();
+
+        // stages added earlier come first whenever two stages conflict
+        void AddStage(const char* name, TaskGraphResource reads, TaskGraphResource writes, bool main_thread, std::function<void()>&& function);
+
+        // runs every stage once, returns when all of them are done and none of the pool tasks it queued is still around
+        // main thread stages run on the calling thread, the rest run on the thread pool (or the calling thread, if it's idle),
+        // while nothing is ready for it, the calling thread sleeps until a stage completes or becomes ready
+        void Execute();
+
+        const std::vector<TaskGraphStage>& GetStages() const { return m_stages; }
+        float GetTimeMs() const                              { return m_time_ms; }
+
+    private:
+        void Compile();
+        bool TryRunStage(const uint32_t index, const bool is_main_thread);
+        void OnStageReady(const uint32_t index);
+        void Notify();
+
+        enum class StageState : uint8_t
+        {
+            Waiting,
+            Ready,
+            Running,
+            Done
+        };
+
+        std::vector<TaskGraphStage> m_stages;
+        std::unique_ptr<std::atomic<uint32_t>[]> m_pending_dependencies;
+        std::unique_ptr<std::atomic<StageState>[]> m_states;
+        std::atomic<uint32_t> m_stages_done  = 0;
+        std::atomic<uint32_t> m_stages_ready = 0; // ready but not yet picked up by any thread
+        bool m_compiled                      = false;
+        float m_time_ms                     = 0.0f;
+        std::chrono::steady_clock::time_point m_time_start;
+
+        // the calling thread of Execute() sleeps on this
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+
+        // the pool tasks of the current execution, they reference the graph so it waits for them before returning or being destroyed
+        JobHandle m_tasks;
+    };
+}
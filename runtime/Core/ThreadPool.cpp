@@ -30,53 +30,327 @@ using namespace std;
 
 namespace Spartan
 {
+    struct JobGroup
+    {
+        atomic<uint32_t> pending = 0; // queued or running
+        mutex mutex_tasks;
+        deque<Task> tasks;            // queued, not yet picked up
+        condition_variable condition; // signaled when a task is queued or the last one completes
+    };
+
     namespace
     {
-        // Stats
+        // tasks which belong to a handle live in the handle's group, the job only carries a ticket to run one of them,
+        // whoever gets there first (a worker through the ticket or the waiting thread directly) runs it, the other finds nothing
+        struct Job
+        {
+            Task task;
+            JobHandle handle;
+        };
+
+        // a chase-lev work-stealing deque, the owning thread pushes and pops from the bottom
+        // while any other thread can steal from the top, none of these operations take a lock
+        class WorkStealingDeque
+        {
+        public:
+            bool Push(Job* job)
+            {
+                int64_t bottom = m_bottom.load(memory_order_relaxed);
+                int64_t top    = m_top.load(memory_order_acquire);
+
+                // full, the caller falls back to the shared queue
+                if (bottom - top >= static_cast<int64_t>(capacity))
+                    return false;
+
+                m_jobs[bottom & mask].store(job, memory_order_relaxed);
+                atomic_thread_fence(memory_order_release);
+                m_bottom.store(bottom + 1, memory_order_relaxed);
+
+                return true;
+            }
+
+            Job* Pop()
+            {
+                int64_t bottom = m_bottom.load(memory_order_relaxed) - 1;
+                m_bottom.store(bottom, memory_order_relaxed);
+                atomic_thread_fence(memory_order_seq_cst);
+                int64_t top = m_top.load(memory_order_relaxed);
+
+                if (top > bottom)
+                {
+                    // empty
+                    m_bottom.store(bottom + 1, memory_order_relaxed);
+                    return nullptr;
+                }
+
+                Job* job = m_jobs[bottom & mask].load(memory_order_relaxed);
+                if (top == bottom)
+                {
+                    // last job, race against the thieves for it
+                    if (!m_top.compare_exchange_strong(top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+                    {
+                        job = nullptr;
+                    }
+                    m_bottom.store(bottom + 1, memory_order_relaxed);
+                }
+
+                return job;
+            }
+
+            Job* Steal()
+            {
+                int64_t top = m_top.load(memory_order_acquire);
+                atomic_thread_fence(memory_order_seq_cst);
+                int64_t bottom = m_bottom.load(memory_order_acquire);
+
+                if (top >= bottom)
+                    return nullptr;
+
+                Job* job = m_jobs[top & mask].load(memory_order_relaxed);
+                if (!m_top.compare_exchange_strong(top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+                    return nullptr; // lost the race to another thief or the owner
+
+                return job;
+            }
+
+        private:
+            static const uint32_t capacity = 4096; // must be a power of two
+            static const uint32_t mask     = capacity - 1;
+
+            alignas(64) atomic<int64_t> m_top    = 0;
+            alignas(64) atomic<int64_t> m_bottom = 0;
+            array<atomic<Job*>, capacity> m_jobs = {};
+        };
+
+        // jobs are recycled instead of being heap allocated per task, each thread keeps a small cache and trades
+        // whole batches with the shared free list, so threads that mostly add tasks and threads that mostly run them balance out
+        static const uint32_t job_batch_size = 64;
+        static mutex mutex_job_pool;
+        static vector<Job*> job_pool;                   // free jobs, shared
+        static vector<unique_ptr<Job[]>> job_blocks;    // owns the memory of every job ever created
+        static thread_local vector<Job*> job_cache;     // free jobs, per thread
+
+        // a waiting thread spins this many times before it goes to sleep on the handle
+        static const uint32_t wait_spin_count = 64;
+
+        // stats
         static uint32_t thread_count                 = 0;
         static atomic<uint32_t> working_thread_count = 0;
 
-        // Sync objects
-        static mutex mutex_tasks;
+        // threads
+        static vector<thread> threads;
+        static thread_local int32_t worker_index = -1; // -1 for any thread that is not a worker
+        static thread_local uint32_t task_depth  = 0;  // tasks this thread is running, nested ones included (a task can wait and help)
+
+        // tasks
+        static vector<unique_ptr<WorkStealingDeque>> deques; // one per worker
+        static deque<Job*> tasks_shared;                     // tasks added by non-worker threads
+        static mutex mutex_tasks_shared;
+        static atomic<uint32_t> tasks_queued  = 0;           // queued but not yet picked up
+        static atomic<uint32_t> tasks_pending = 0;           // queued or running
+
+        // sleeping
+        static mutex mutex_sleep;
         static condition_variable condition_var;
+        static atomic<uint32_t> sleeping_thread_count = 0;
 
-        // Threads
-        static vector<thread> threads;
+        // misc
+        static atomic<bool> is_stopping = false;
+    }
 
-        // Tasks
-        static deque<Task> tasks;
+    static Job* job_acquire()
+    {
+        if (job_cache.empty())
+        {
+            lock_guard<mutex> lock(mutex_job_pool);
+
+            if (job_pool.size() < job_batch_size)
+            {
+                job_blocks.emplace_back(make_unique<Job[]>(job_batch_size));
+                for (uint32_t i = 0; i < job_batch_size; i++)
+                {
+                    job_pool.emplace_back(&job_blocks.back()[i]);
+                }
+            }
 
-        // Misc
-        static bool is_stopping;
+            job_cache.insert(job_cache.end(), job_pool.end() - job_batch_size, job_pool.end());
+            job_pool.resize(job_pool.size() - job_batch_size);
+        }
+
+        Job* job = job_cache.back();
+        job_cache.pop_back();
+
+        return job;
     }
 
-    static void thread_loop()
+    static void job_release(Job* job)
     {
-        while (true)
+        // release whatever the task captured right away, the job itself may sit in a cache for a while
+        job->task   = nullptr;
+        job->handle = nullptr;
+
+        job_cache.emplace_back(job);
+        if (job_cache.size() >= job_batch_size * 2)
         {
-            // Lock tasks mutex
-            unique_lock<mutex> lock(mutex_tasks);
+            lock_guard<mutex> lock(mutex_job_pool);
+            job_pool.insert(job_pool.end(), job_cache.end() - job_batch_size, job_cache.end());
+            job_cache.resize(job_cache.size() - job_batch_size);
+        }
+    }
 
-            // Check condition on notification
-            condition_var.wait(lock, [] { return !tasks.empty() || is_stopping; });
+    static Job* job_create(Task&& task, const JobHandle& handle)
+    {
+        Job* job    = job_acquire();
+        job->task   = std::move(task);
+        job->handle = handle;
 
-            // If m_stopping is true, it's time to shut everything down
-            if (is_stopping && tasks.empty())
-                return;
+        return job;
+    }
+
+    static void enqueue(Job* job)
+    {
+        tasks_queued++;
+
+        // workers push to their own deque, everyone else goes through the shared queue
+        if (worker_index == -1 || !deques[worker_index]->Push(job))
+        {
+            lock_guard<mutex> lock(mutex_tasks_shared);
+            tasks_shared.emplace_back(job);
+        }
+
+        // only pay for a wake up when someone is actually sleeping
+        if (sleeping_thread_count > 0)
+        {
+            lock_guard<mutex> lock(mutex_sleep);
+            condition_var.notify_one();
+        }
+    }
+
+    static Job* dequeue()
+    {
+        if (tasks_queued == 0)
+            return nullptr;
+
+        Job* job = nullptr;
+
+        // own deque first, it's the most cache friendly
+        if (worker_index != -1)
+        {
+            job = deques[worker_index]->Pop();
+        }
+
+        // then the shared queue
+        if (!job)
+        {
+            lock_guard<mutex> lock(mutex_tasks_shared);
+            if (!tasks_shared.empty())
+            {
+                job = tasks_shared.front();
+                tasks_shared.pop_front();
+            }
+        }
+
+        // then steal from the other workers, starting from our neighbour so thieves spread out
+        if (!job)
+        {
+            uint32_t start = worker_index != -1 ? static_cast<uint32_t>(worker_index) + 1 : 0;
+            for (uint32_t i = 0; i < thread_count && !job; i++)
+            {
+                uint32_t victim = (start + i) % thread_count;
+                if (victim != static_cast<uint32_t>(worker_index))
+                {
+                    job = deques[victim]->Steal();
+                }
+            }
+        }
+
+        if (job)
+        {
+            tasks_queued--;
+        }
+
+        return job;
+    }
+
+    static bool take_task(const JobHandle& handle, Task& task)
+    {
+        lock_guard<mutex> lock(handle->mutex_tasks);
+        if (handle->tasks.empty())
+            return false;
+
+        task = move(handle->tasks.front());
+        handle->tasks.pop_front();
+
+        return true;
+    }
+
+    static void complete_one(const JobHandle& handle)
+    {
+        tasks_pending--;
+
+        // wake up anyone sleeping on the handle once its last task is done
+        if (handle->pending.fetch_sub(1, memory_order_acq_rel) == 1)
+        {
+            lock_guard<mutex> lock(handle->mutex_tasks);
+            handle->condition.notify_all();
+        }
+    }
+
+    static bool execute_one(const JobHandle& handle)
+    {
+        Task task;
+        if (!take_task(handle, task))
+            return false;
+
+        task_depth++;
+        task();
+        task_depth--;
+        complete_one(handle);
+
+        return true;
+    }
+
+    static void execute(Job* job)
+    {
+        // a ticket whose task was already taken by a waiting thread simply does nothing
+        if (job->handle)
+        {
+            execute_one(job->handle);
+        }
+        else
+        {
+            task_depth++;
+            job->task();
+            task_depth--;
+            tasks_pending--;
+        }
 
-            // Get next task in the queue.
-            Task task = tasks.front();
+        job_release(job);
+    }
+
+    static void thread_loop(const int32_t index)
+    {
+        worker_index = index;
 
-            // Remove it from the queue.
-            tasks.pop_front();
+        while (true)
+        {
+            if (Job* job = dequeue())
+            {
+                working_thread_count++;
+                execute(job);
+                working_thread_count--;
+                continue;
+            }
 
-            // Unlock the mutex
-            lock.unlock();
+            // nothing to do, go to sleep until a task is added
+            unique_lock<mutex> lock(mutex_sleep);
+            sleeping_thread_count++;
+            condition_var.wait(lock, [] { return tasks_queued > 0 || is_stopping; });
+            sleeping_thread_count--;
 
-            // Execute the task.
-            working_thread_count++;
-            task();
-            working_thread_count--;
+            // if is_stopping is true, it's time to shut everything down
+            if (is_stopping && tasks_queued == 0)
+                return;
         }
     }
 
@@ -88,7 +362,12 @@ namespace Spartan
 
         for (uint32_t i = 0; i < thread_count; i++)
         {
-            threads.emplace_back(thread(&thread_loop));
+            deques.emplace_back(make_unique<WorkStealingDeque>());
+        }
+
+        for (uint32_t i = 0; i < thread_count; i++)
+        {
+            threads.emplace_back(thread(&thread_loop, static_cast<int32_t>(i)));
         }
 
         SP_LOG_INFO("%d threads have been created", thread_count);
@@ -98,93 +377,165 @@ namespace Spartan
     {
         Flush(true);
 
-        // Put unique lock on task mutex.
-        unique_lock<mutex> lock(mutex_tasks);
-
-        // Set termination flag to true.
-        is_stopping = true;
-
-        // Unlock the mutex
-        lock.unlock();
+        // set termination flag to true
+        {
+            lock_guard<mutex> lock(mutex_sleep);
+            is_stopping = true;
+        }
 
-        // Wake up all threads.
+        // wake up all threads
         condition_var.notify_all();
 
-        // Join all threads.
+        // join all threads
         for (auto& thread : threads)
         {
             thread.join();
         }
 
-        // Empty worker threads.
+        // empty worker threads
         threads.clear();
+        deques.clear();
     }
 
     void ThreadPool::AddTask(Task&& task)
     {
-        // Lock tasks mutex
-        unique_lock<mutex> lock(mutex_tasks);
+        tasks_pending++;
+        enqueue(job_create(std::forward<Task>(task), nullptr));
+    }
 
-        // Save the task
-        tasks.emplace_back(bind(std::forward<Task>(task)));
+    void ThreadPool::AddTask(Task&& task, const JobHandle& handle)
+    {
+        SP_ASSERT(handle != nullptr);
 
-        // Unlock the mutex
-        lock.unlock();
+        tasks_pending++;
+        handle->pending.fetch_add(1, memory_order_relaxed);
+        {
+            lock_guard<mutex> lock(handle->mutex_tasks);
+            handle->tasks.emplace_back(std::forward<Task>(task));
+            handle->condition.notify_all(); // a thread waiting on the handle can run it
+        }
 
-        // Wake up a thread
-        condition_var.notify_one();
+        enqueue(job_create(nullptr, handle));
     }
 
-    void ThreadPool::ParallelLoop(function<void(uint32_t work_index_start, uint32_t work_index_end)>&& function, const uint32_t work_total)
+    JobHandle ThreadPool::CreateJobHandle()
     {
-        SP_ASSERT_MSG(work_total > 1, "A parallel loop can't have a range of 1 or smaller");
-
-        uint32_t available_threads = GetIdleThreadCount();
-        uint32_t work_per_thread   = work_total / available_threads;
-        uint32_t work_remainder    = work_total % available_threads;
-        uint32_t work_index        = 0;
-        atomic<uint32_t> work_done = 0;
-        condition_variable cv;
-        mutex cv_m;
+        return make_shared<JobGroup>();
+    }
 
-        // split work into multiple tasks
-        while (work_index < work_total)
+    void ThreadPool::Wait(const JobHandle& handle)
+    {
+        // help out with the handle's own tasks instead of sleeping, this also means that waiting from within a task can't deadlock,
+        // foreign tasks are never picked up since they could be long (e.g. a world load) or need a lock that the caller is holding
+        uint32_t spin_count = 0;
+        while (!IsDone(handle))
         {
-            uint32_t work_to_do = work_per_thread;
+            if (execute_one(handle))
+            {
+                spin_count = 0;
+                continue;
+            }
 
-            // if the work doesn't divide evenly across threads, add the remainder work to the first thread.
-            if (work_remainder != 0)
+            // the remaining tasks are already running on other threads, they are usually short so spin for a bit
+            if (spin_count++ < wait_spin_count)
             {
-                work_to_do     += work_remainder;
-                work_remainder = 0;
+                this_thread::yield();
+                continue;
             }
 
-            AddTask([&function, &work_done, &cv, work_index, work_to_do]()
+            // then sleep until they complete or more tasks are added to the handle
+            unique_lock<mutex> lock(handle->mutex_tasks);
+            handle->condition.wait(lock, [&handle] { return handle->pending.load(memory_order_acquire) == 0 || !handle->tasks.empty(); });
+            spin_count = 0;
+        }
+    }
+
+    bool ThreadPool::IsDone(const JobHandle& handle)
+    {
+        return !handle || handle->pending.load(memory_order_acquire) == 0;
+    }
+
+    void ThreadPool::ParallelLoop(function<void(uint32_t work_index_start, uint32_t work_index_end)>&& function, const uint32_t work_total, const uint32_t grain_size /*= 0*/)
+    {
+        if (work_total == 0)
+            return;
+
+        const uint32_t grain       = GetGrainSize(work_total, grain_size);
+        const uint32_t chunk_count = (work_total + grain - 1) / grain;
+
+        // not worth going wide
+        if (chunk_count == 1)
+        {
+            function(0, work_total);
+            return;
+        }
+
+        // every participating thread keeps claiming chunks through the cursor until the work runs out,
+        // so busy workers simply don't show up and the rest of the threads pick up the slack
+        atomic<uint32_t> cursor = 0;
+        auto process_chunks = [&function, &cursor, work_total, grain]()
+        {
+            while (true)
             {
-                function(work_index, work_index + work_to_do);
-                work_done += work_to_do;
+                const uint32_t work_index_start = cursor.fetch_add(grain, memory_order_relaxed);
+                if (work_index_start >= work_total)
+                    break;
 
-                cv.notify_one(); // notify that a thread has finished its work
-            });
+                function(work_index_start, min(work_index_start + grain, work_total));
+            }
+        };
 
-            work_index += work_to_do;
+        // the calling thread takes part too, so one helper less is needed
+        JobHandle handle            = CreateJobHandle();
+        const uint32_t helper_count = min(thread_count, chunk_count - 1);
+        for (uint32_t i = 0; i < helper_count; i++)
+        {
+            AddTask(process_chunks, handle);
         }
 
-        // wait for threads to finish work
-        unique_lock<mutex> lk(cv_m);
-        cv.wait(lk, [&]() { return work_done == work_total; });
+        process_chunks();
+
+        // helpers that started late may still be finishing their last chunk
+        Wait(handle);
+    }
+
+    uint32_t ThreadPool::GetGrainSize(const uint32_t work_total, const uint32_t grain_size /*= 0*/)
+    {
+        if (grain_size != 0)
+            return grain_size;
+
+        // a few chunks per thread so that uneven chunks can be balanced out
+        const uint32_t chunks_per_thread = 4;
+        return max(1u, work_total / ((thread_count + 1) * chunks_per_thread));
     }
 
     void ThreadPool::Flush(bool remove_queued /*= false*/)
     {
-        // Clear any queued tasks
+        // the task making the call is pending too, so waiting for it would never return
+        SP_ASSERT_MSG(task_depth == 0, "Flush() can't be called from within a task");
+
+        // clear any queued tasks
         if (remove_queued)
         {
-            tasks.clear();
+            while (Job* job = dequeue())
+            {
+                // drop the task the job stands for, unless a waiting thread already ran it
+                Task task;
+                if (!job->handle)
+                {
+                    tasks_pending--;
+                }
+                else if (take_task(job->handle, task))
+                {
+                    complete_one(job->handle);
+                }
+
+                job_release(job);
+            }
         }
 
-        // If so, wait for them
-        while (AreTasksRunning())
+        // wait for any running tasks
+        while (tasks_pending > 0)
         {
             this_thread::sleep_for(chrono::milliseconds(16));
         }
@@ -24,12 +24,20 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //= INCLUDES ===========
 #include "Definitions.h"
 #include <functional>
+#include <memory>
+#include <atomic>
+#include <vector>
 //======================
 
 namespace Spartan
 {
     using Task = std::function<void()>;
 
+    // tracks the completion of one or more tasks and owns them until they are picked up,
+    // so that a waiting thread can help with exactly those tasks and nothing else
+    struct JobGroup;
+    using JobHandle = std::shared_ptr<JobGroup>;
+
     class SP_CLASS ThreadPool
     {
     public:
@@ -39,10 +47,60 @@ namespace Spartan
         // add a task
         static void AddTask(Task&& task);
 
-        // spread execution of a given function across all available threads
-        static void ParallelLoop(std::function<void(uint32_t work_index_start, uint32_t work_index_end)>&& function, const uint32_t work_total);
+        // add a task whose completion is tracked by the given handle (a handle can track many tasks)
+        static void AddTask(Task&& task, const JobHandle& handle);
+        static JobHandle CreateJobHandle();
+
+        // wait for a handle to complete, the calling thread executes the handle's own tasks and only sleeps once they are all running elsewhere,
+        // it never runs unrelated ones, so it's safe to wait while holding a lock that another queued task might need
+        static void Wait(const JobHandle& handle);
+        static bool IsDone(const JobHandle& handle);
+
+        // spread execution of a given function across all available threads (including the calling one)
+        // threads claim chunks of grain_size work items until the work runs out, a grain_size of 0 picks one automatically
+        // it's safe to call from within a task, the calling thread helps with its own chunks instead of blocking a worker
+        static void ParallelLoop(std::function<void(uint32_t work_index_start, uint32_t work_index_end)>&& function, const uint32_t work_total, const uint32_t grain_size = 0);
+
+        // like ParallelLoop, but each chunk returns a value and the values are combined (in order) into a single result
+        template<typename T>
+        static T ParallelReduce(
+            const std::function<T(uint32_t work_index_start, uint32_t work_index_end)>& function,
+            const std::function<T(const T& a, const T& b)>& combine,
+            const T& identity,
+            const uint32_t work_total,
+            uint32_t grain_size = 0
+        )
+        {
+            if (work_total == 0)
+                return identity;
+
+            grain_size                 = GetGrainSize(work_total, grain_size);
+            const uint32_t chunk_count = (work_total + grain_size - 1) / grain_size;
+
+            std::vector<T> results(chunk_count, identity);
+            ParallelLoop([&](uint32_t chunk_start, uint32_t chunk_end)
+            {
+                for (uint32_t chunk = chunk_start; chunk < chunk_end; chunk++)
+                {
+                    const uint32_t work_index_start = chunk * grain_size;
+                    const uint32_t work_index_end   = work_index_start + grain_size < work_total ? work_index_start + grain_size : work_total;
+                    results[chunk]                  = function(work_index_start, work_index_end);
+                }
+            }, chunk_count, 1);
+
+            T result = identity;
+            for (const T& chunk_result : results)
+            {
+                result = combine(result, chunk_result);
+            }
+
+            return result;
+        }
+
+        // returns the grain size that a parallel loop would use for the given amount of work
+        static uint32_t GetGrainSize(const uint32_t work_total, const uint32_t grain_size = 0);
 
-        // wait for all threads to finish work
+        // wait for all threads to finish work, not to be called from within a task
         static void Flush(bool remove_queued = false);
 
         // stats
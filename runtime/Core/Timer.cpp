@@ -22,8 +22,15 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //= INCLUDES ==================
 #include "pch.h"
 #include "../Display/Display.h"
+#if defined(_MSC_VER)
+#include <Windows.h>
+#endif
 //=============================
 
+#if defined(_MSC_VER) && !defined(CREATE_WAITABLE_TIMER_HIGH_RESOLUTION)
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
 //= NAMESPACES =====
 using namespace std;
 //==================
@@ -47,29 +54,154 @@ namespace Spartan
         float fps_limit          = fps_min;
         float fps_limit_previous = fps_limit;
 
+        // frame pacing
+        FramePacing frame_pacing            = FramePacing::Sleep;
+        const double spin_threshold_ms      = 0.5; // os sleeps can overshoot, so the last bit is spent spinning
+        const double predictive_margin_ms   = 1.0; // head room for when a frame takes longer than predicted
+        const uint32_t pacing_window_frames = 60;
+        chrono::steady_clock::time_point frame_start;
+        chrono::steady_clock::time_point frame_deadline;
+        double work_time_smoothed_ms        = 0.0;
+        double pacing_error_avg_ms          = 0.0;
+        double pacing_error_max_ms          = 0.0;
+        double pacing_error_max_window_ms   = 0.0;
+        uint32_t pacing_window_frame        = 0;
+        #if defined(_MSC_VER)
+        HANDLE waitable_timer               = nullptr;
+        #endif
+
         // misc
         chrono::steady_clock::time_point last_tick_time;
+
+        double get_ms(const chrono::steady_clock::duration& duration)
+        {
+            return chrono::duration<double, milli>(duration).count();
+        }
+
+        void sleep(const double duration_ms)
+        {
+            #if defined(_MSC_VER)
+            if (waitable_timer)
+            {
+                LARGE_INTEGER due_time;
+                due_time.QuadPart = -static_cast<LONGLONG>(duration_ms * 10000.0); // relative, in 100ns units
+                if (SetWaitableTimerEx(waitable_timer, &due_time, 0, nullptr, nullptr, nullptr, 0))
+                {
+                    WaitForSingleObject(waitable_timer, INFINITE);
+                    return;
+                }
+            }
+            #endif
+
+            this_thread::sleep_for(chrono::duration<double, milli>(duration_ms));
+        }
+
+        void wait_until(const chrono::steady_clock::time_point& deadline)
+        {
+            // sleep through most of the wait, one sleep at a time, since an early wake up is possible
+            while (true)
+            {
+                double remaining_ms = get_ms(deadline - chrono::steady_clock::now());
+                if (remaining_ms <= spin_threshold_ms)
+                    break;
+
+                sleep(remaining_ms - spin_threshold_ms);
+            }
+
+            // spin for the remaining sub-millisecond
+            while (chrono::steady_clock::now() < deadline)
+            {
+                this_thread::yield();
+            }
+        }
+
+        void update_pacing_error(const chrono::steady_clock::time_point& time)
+        {
+            double error_ms     = abs(get_ms(time - frame_deadline));
+            pacing_error_avg_ms = pacing_error_avg_ms * (1.0 - weight_delta) + error_ms * weight_delta;
+
+            pacing_error_max_window_ms = max(pacing_error_max_window_ms, error_ms);
+            if (++pacing_window_frame == pacing_window_frames)
+            {
+                pacing_error_max_ms        = pacing_error_max_window_ms;
+                pacing_error_max_window_ms = 0.0;
+                pacing_window_frame        = 0;
+            }
+        }
+
+        void advance_deadline(const chrono::steady_clock::time_point& time)
+        {
+            auto target = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double, milli>(1000.0 / fps_limit));
+
+            // stay on the grid so that small overruns are paid back by the next frame instead of drifting,
+            // but start over if we fell a frame behind or if the fps limit was raised
+            frame_deadline += target;
+            if (frame_deadline < time || frame_deadline - time > target)
+            {
+                frame_deadline = time + target;
+            }
+        }
     }
 
     void Timer::Initialize()
     {
         fps_limit      = static_cast<float>(Display::GetRefreshRate());
         last_tick_time = chrono::steady_clock::now();
+        frame_start    = last_tick_time;
+        frame_deadline = last_tick_time;
+        advance_deadline(last_tick_time);
+
+        #if defined(_MSC_VER)
+        // high resolution timers are supported from windows 10 1803, if that fails we fall back to std::this_thread::sleep_for
+        waitable_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+        #endif
     }
 
-    void Timer::PostTick()
+    void Timer::Shutdown()
     {
-        // if this is not the first tick, we calculate the delta time
-        if (last_tick_time.time_since_epoch() != chrono::steady_clock::duration::zero())
+        #if defined(_MSC_VER)
+        if (waitable_timer)
+        {
+            CloseHandle(waitable_timer);
+            waitable_timer = nullptr;
+        }
+        #endif
+    }
+
+    void Timer::PreTick()
+    {
+        // start the frame as late as possible, so that it samples input just in time to finish when it's due
+        if (frame_pacing == FramePacing::Predictive)
         {
-            delta_time_ms = static_cast<double>(chrono::duration<double, milli>(chrono::steady_clock::now() - last_tick_time).count());
+            auto lead = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double, milli>(work_time_smoothed_ms + predictive_margin_ms));
+            wait_until(frame_deadline - lead);
         }
 
+        frame_start = chrono::steady_clock::now();
+    }
+
+    void Timer::PostTick()
+    {
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+
+        // track how long a frame takes to do its work, this is what the predictive pacing schedules around
+        double work_time_ms   = get_ms(now - frame_start);
+        work_time_smoothed_ms = work_time_smoothed_ms * (1.0 - weight_delta) + work_time_ms * weight_delta;
+
         // fps limit
-        double target_ms = 1000.0 / fps_limit;
-        while (delta_time_ms < target_ms)
+        if (frame_pacing == FramePacing::Sleep)
+        {
+            wait_until(frame_deadline);
+            now = chrono::steady_clock::now();
+        }
+
+        update_pacing_error(now);
+        advance_deadline(now);
+
+        // if this is not the first tick, we calculate the delta time
+        if (last_tick_time.time_since_epoch() != chrono::steady_clock::duration::zero())
         {
-            delta_time_ms = static_cast<double>(chrono::duration<double, milli>(chrono::steady_clock::now() - last_tick_time).count());
+            delta_time_ms = get_ms(now - last_tick_time);
         }
 
         // compute delta time based timings
@@ -77,7 +209,7 @@ namespace Spartan
         time_ms                += delta_time_ms;
 
         // end
-        last_tick_time = chrono::steady_clock::now();
+        last_tick_time = now;
     }
 
     void Timer::SetFpsLimit(float fps_in)
@@ -126,6 +258,26 @@ namespace Spartan
         }
     }
 
+    void Timer::SetFramePacing(const FramePacing pacing)
+    {
+        frame_pacing = pacing;
+    }
+
+    FramePacing Timer::GetFramePacing()
+    {
+        return frame_pacing;
+    }
+
+    double Timer::GetPacingErrorAvgMs()
+    {
+        return pacing_error_avg_ms;
+    }
+
+    double Timer::GetPacingErrorMaxMs()
+    {
+        return pacing_error_max_ms;
+    }
+
     double Timer::GetTimeMs()
     {
         return time_ms;
@@ -34,10 +34,18 @@ namespace Spartan
         FixedToMonitor
     };
 
+    enum class FramePacing
+    {
+        Sleep,     // the frame limit is enforced once a frame is done, by sleeping until the next frame should start
+        Predictive // the wait happens before the frame starts, timed so the frame ends when it's due, this keeps input fresh
+    };
+
     class SP_CLASS Timer
     {
     public:
         static void Initialize();
+        static void Shutdown();
+        static void PreTick();
         static void PostTick();
 
         // FPS Limit
@@ -46,6 +54,12 @@ namespace Spartan
         static FpsLimitType GetFpsLimitType();
         static void OnVsyncToggled(const bool enabled);
 
+        // frame pacing
+        static void SetFramePacing(const FramePacing pacing);
+        static FramePacing GetFramePacing();
+        static double GetPacingErrorAvgMs(); // how far off the frame boundaries are from when they were due
+        static double GetPacingErrorMaxMs(); // worst error over the last second or so
+
         // Times
         static double GetTimeMs();
         static double GetTimeSec();
@@ -28,6 +28,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../Math/Vector3.h"
 #include "../Math/Vector4.h"
 #include "../Math/Quaternion.h"
+#include "../Math/Matrix.h"
 #include "../Math/BoundingBox.h"
 #include "../Rendering/Color.h"
 //==============================
@@ -48,6 +49,7 @@ namespace Spartan
         ~FileStream();
 
         auto IsOpen() const { return m_is_open; }
+        bool IsGood() const { return (m_flags & FileStream_Write) ? !out.fail() : !in.fail(); } // false once a read ran past the end or a write failed
         void Close();
 
         //= WRITING ==================================================
@@ -72,6 +74,7 @@ namespace Spartan
             std::is_same<T, Math::Vector4>::value       ||
             std::is_same<T, Color>::value               ||
             std::is_same<T, Math::Quaternion>::value    ||
+            std::is_same<T, Math::Matrix>::value        ||
             std::is_same<T, Math::BoundingBox>::value
         >::type>
         void Write(T value)
@@ -112,6 +115,7 @@ namespace Spartan
             std::is_same<T, Math::Vector4>::value       ||
             std::is_same<T, Color>::value               ||
             std::is_same<T, Math::Quaternion>::value    ||
+            std::is_same<T, Math::Matrix>::value        ||
             std::is_same<T, Math::BoundingBox>::value
         >::type>
         void Read(T* value)
@@ -148,7 +152,7 @@ namespace Spartan
         >::type> 
         T ReadAs()
         {
-            T value;
+            T value = T(); // past the end of the file nothing is read
             Read(&value);
             return value;
         }
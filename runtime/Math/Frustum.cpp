@@ -82,6 +82,11 @@ namespace Spartan::Math
         m_planes[5].normal.z = view_projection.m23 + view_projection.m21;
         m_planes[5].d        = view_projection.m33 + view_projection.m31;
         m_planes[5].Normalize();
+
+        for (uint32_t i = 0; i < 6; i++)
+        {
+            m_normals_abs[i] = m_planes[i].normal.Abs();
+        }
     }
 
     bool Frustum::IsVisible(const Vector3& center, const Vector3& extent, bool ignore_depth /*= false*/) const
@@ -99,7 +104,6 @@ namespace Spartan::Math
         SP_ASSERT(!center.IsNaN() && !extent.IsNaN());
 
         Intersection result = Intersection::Inside;
-        Plane plane_abs;
 
         for (size_t i = 0; i < 6; i++)
         {
@@ -107,13 +111,11 @@ namespace Spartan::Math
             if (ignore_depth && (i == 0 || i == 1))
                 continue;
 
-            const Plane& plane = m_planes[i];
-
-            plane_abs.normal = plane.normal.Abs();
-            plane_abs.d      = plane.d;
+            const Plane& plane        = m_planes[i];
+            const Vector3& normal_abs = m_normals_abs[i];
 
             const float d = center.x * plane.normal.x + center.y * plane.normal.y + center.z * plane.normal.z;
-            const float r = extent.x * plane_abs.normal.x + extent.y * plane_abs.normal.y + extent.z * plane_abs.normal.z;
+            const float r = extent.x * normal_abs.x + extent.y * normal_abs.y + extent.z * normal_abs.z;
 
             const float d_p_r = d + r;
             const float d_m_r = d - r;
@@ -133,6 +135,72 @@ namespace Spartan::Math
         return result;
     }
 
+    void Frustum::AreVisible(const BoundingBoxesSoa& boxes, const uint32_t start, const uint32_t end, uint8_t* visible, const bool ignore_depth /*= false*/) const
+    {
+        SP_ASSERT(end <= boxes.GetCount());
+
+        const uint32_t plane_start = ignore_depth ? 2 : 0;
+        uint32_t i                 = start;
+
+    #if defined(__AVX__)
+        // a box is outside if it's fully behind any of the planes, d + r < -plane.d
+        for (; i + 8 <= end; i += 8)
+        {
+            const __m256 center_x = _mm256_loadu_ps(&boxes.center_x[i]);
+            const __m256 center_y = _mm256_loadu_ps(&boxes.center_y[i]);
+            const __m256 center_z = _mm256_loadu_ps(&boxes.center_z[i]);
+            const __m256 extent_x = _mm256_loadu_ps(&boxes.extent_x[i]);
+            const __m256 extent_y = _mm256_loadu_ps(&boxes.extent_y[i]);
+            const __m256 extent_z = _mm256_loadu_ps(&boxes.extent_z[i]);
+
+            __m256 outside = _mm256_setzero_ps();
+            for (uint32_t p = plane_start; p < 6; p++)
+            {
+                const Plane& plane        = m_planes[p];
+                const Vector3& normal_abs = m_normals_abs[p];
+
+                __m256 d = _mm256_mul_ps(center_x, _mm256_set1_ps(plane.normal.x));
+                d        = _mm256_add_ps(d, _mm256_mul_ps(center_y, _mm256_set1_ps(plane.normal.y)));
+                d        = _mm256_add_ps(d, _mm256_mul_ps(center_z, _mm256_set1_ps(plane.normal.z)));
+
+                __m256 r = _mm256_mul_ps(extent_x, _mm256_set1_ps(normal_abs.x));
+                r        = _mm256_add_ps(r, _mm256_mul_ps(extent_y, _mm256_set1_ps(normal_abs.y)));
+                r        = _mm256_add_ps(r, _mm256_mul_ps(extent_z, _mm256_set1_ps(normal_abs.z)));
+
+                outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(d, r), _mm256_set1_ps(-plane.d), _CMP_LT_OQ));
+            }
+
+            const int mask = _mm256_movemask_ps(outside);
+            for (uint32_t j = 0; j < 8; j++)
+            {
+                visible[i + j] = ((mask >> j) & 1) ? 0 : 1;
+            }
+        }
+    #endif
+
+        // whatever doesn't fill a full batch
+        for (; i < end; i++)
+        {
+            uint8_t is_visible = 1;
+            for (uint32_t p = plane_start; p < 6; p++)
+            {
+                const Plane& plane        = m_planes[p];
+                const Vector3& normal_abs = m_normals_abs[p];
+
+                const float d = boxes.center_x[i] * plane.normal.x + boxes.center_y[i] * plane.normal.y + boxes.center_z[i] * plane.normal.z;
+                const float r = boxes.extent_x[i] * normal_abs.x + boxes.extent_y[i] * normal_abs.y + boxes.extent_z[i] * normal_abs.z;
+
+                if (d + r < -plane.d)
+                {
+                    is_visible = 0;
+                    break;
+                }
+            }
+
+            visible[i] = is_visible;
+        }
+    }
+
     Intersection Frustum::CheckSphere(const Vector3& center, float radius, float ignore_depth) const
     {
         SP_ASSERT(!center.IsNaN() && radius > 0.0f);
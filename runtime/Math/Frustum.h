@@ -22,6 +22,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #pragma once
 
 //= INCLUDES =============
+#include <vector>
 #include "../Math/Plane.h"
 #include "Matrix.h"
 #include "Vector3.h"
@@ -29,6 +30,27 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 namespace Spartan::Math
 {
+    // boxes as a structure of arrays, so that a plane can be tested against several of them at once
+    struct BoundingBoxesSoa
+    {
+        void Resize(const uint32_t count)
+        {
+            center_x.resize(count); center_y.resize(count); center_z.resize(count);
+            extent_x.resize(count); extent_y.resize(count); extent_z.resize(count);
+        }
+
+        void Set(const uint32_t index, const Vector3& center, const Vector3& extent)
+        {
+            center_x[index] = center.x; center_y[index] = center.y; center_z[index] = center.z;
+            extent_x[index] = extent.x; extent_y[index] = extent.y; extent_z[index] = extent.z;
+        }
+
+        uint32_t GetCount() const { return static_cast<uint32_t>(center_x.size()); }
+
+        std::vector<float> center_x, center_y, center_z;
+        std::vector<float> extent_x, extent_y, extent_z;
+    };
+
     class Frustum
     {
     public:
@@ -38,10 +60,16 @@ namespace Spartan::Math
 
         bool IsVisible(const Vector3& center, const Vector3& extent, bool ignore_depth = false) const;
 
+        // same test as IsVisible() but for the boxes in [start, end), visible[i] is set to 1 or 0, 8 boxes are tested at a time when avx is available
+        void AreVisible(const BoundingBoxesSoa& boxes, uint32_t start, uint32_t end, uint8_t* visible, bool ignore_depth = false) const;
+
+        const Plane& GetPlane(const uint32_t index) const { return m_planes[index]; }
+
     private:
         Intersection CheckCube(const Vector3& center, const Vector3& extent, float ignore_depth = false) const;
         Intersection CheckSphere(const Vector3& center, float radius, float ignore_depth = false) const;
 
         Plane m_planes[6];
+        Vector3 m_normals_abs[6]; // computed once, the box tests need them for every box
     };
 }
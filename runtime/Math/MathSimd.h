@@ -0,0 +1,199 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+// the math classes keep their plain float members (and their layout), only the heavy operations
+// are routed through here, the backend is picked at compile time based on the target instruction set
+#if defined(__AVX2__) || defined(__AVX__) || defined(__SSE4_1__)
+    #define SP_MATH_SSE
+    #include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__) || defined(_M_ARM64)
+    #define SP_MATH_NEON
+    #include <arm_neon.h>
+#else
+    #define SP_MATH_SCALAR
+#endif
+
+// all matrices below are 16 floats in the engine's memory layout (m00, m10, m20, m30, m01, ...), so every group of 4 floats is a column,
+// the matrix * vector transforms are left scalar, they'd need horizontal adds or a transpose, both of which measured slower than the compiler's code
+namespace Spartan::Math::Simd
+{
+#if defined(SP_MATH_SSE)
+
+    #define SP_SHUFFLE(v, x, y, z, w) _mm_shuffle_ps(v, v, _MM_SHUFFLE(w, z, y, x))
+
+    inline __m128 load3(const float* v, const float w)  { return _mm_set_ps(w, v[2], v[1], v[0]); }
+    inline void store3(float* out, const __m128 v)
+    {
+        alignas(16) float result[4];
+        _mm_store_ps(result, v);
+        out[0] = result[0]; out[1] = result[1]; out[2] = result[2];
+    }
+
+    inline __m128 cross(const __m128 a, const __m128 b)
+    {
+        return _mm_sub_ps(
+            _mm_mul_ps(SP_SHUFFLE(a, 1, 2, 0, 3), SP_SHUFFLE(b, 2, 0, 1, 3)),
+            _mm_mul_ps(SP_SHUFFLE(a, 2, 0, 1, 3), SP_SHUFFLE(b, 1, 2, 0, 3))
+        );
+    }
+
+    inline void matrix_multiply(const float* a, const float* b, float* out)
+    {
+        const __m128 a0 = _mm_loadu_ps(a + 0);
+        const __m128 a1 = _mm_loadu_ps(a + 4);
+        const __m128 a2 = _mm_loadu_ps(a + 8);
+        const __m128 a3 = _mm_loadu_ps(a + 12);
+
+        for (int column = 0; column < 4; column++)
+        {
+            const float* b_column = b + column * 4;
+
+            __m128 result = _mm_mul_ps(a0, _mm_set1_ps(b_column[0]));
+            result        = _mm_add_ps(result, _mm_mul_ps(a1, _mm_set1_ps(b_column[1])));
+            result        = _mm_add_ps(result, _mm_mul_ps(a2, _mm_set1_ps(b_column[2])));
+            result        = _mm_add_ps(result, _mm_mul_ps(a3, _mm_set1_ps(b_column[3])));
+
+            _mm_storeu_ps(out + column * 4, result);
+        }
+    }
+
+    // block wise inverse (the 4x4 matrix is treated as four 2x2 matrices), inverting the transpose
+    // gives the transposed inverse, so the column layout can be fed in and read out as is
+    inline __m128 mat2_mul(const __m128 a, const __m128 b)
+    {
+        return _mm_add_ps(_mm_mul_ps(a, SP_SHUFFLE(b, 0, 3, 0, 3)), _mm_mul_ps(SP_SHUFFLE(a, 1, 0, 3, 2), SP_SHUFFLE(b, 2, 1, 2, 1)));
+    }
+
+    inline __m128 mat2_adj_mul(const __m128 a, const __m128 b)
+    {
+        return _mm_sub_ps(_mm_mul_ps(SP_SHUFFLE(a, 3, 3, 0, 0), b), _mm_mul_ps(SP_SHUFFLE(a, 1, 1, 2, 2), SP_SHUFFLE(b, 2, 3, 0, 1)));
+    }
+
+    inline __m128 mat2_mul_adj(const __m128 a, const __m128 b)
+    {
+        return _mm_sub_ps(_mm_mul_ps(a, SP_SHUFFLE(b, 3, 0, 3, 0)), _mm_mul_ps(SP_SHUFFLE(a, 1, 0, 3, 2), SP_SHUFFLE(b, 2, 1, 2, 1)));
+    }
+
+    inline void matrix_inverse(const float* m, float* out)
+    {
+        const __m128 r0 = _mm_loadu_ps(m + 0);
+        const __m128 r1 = _mm_loadu_ps(m + 4);
+        const __m128 r2 = _mm_loadu_ps(m + 8);
+        const __m128 r3 = _mm_loadu_ps(m + 12);
+
+        // sub matrices
+        const __m128 a = _mm_movelh_ps(r0, r1);
+        const __m128 b = _mm_movehl_ps(r1, r0);
+        const __m128 c = _mm_movelh_ps(r2, r3);
+        const __m128 d = _mm_movehl_ps(r3, r2);
+
+        // determinants of the sub matrices, as (|a|, |b|, |c|, |d|)
+        const __m128 det_sub = _mm_sub_ps(
+            _mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(3, 1, 3, 1))),
+            _mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(2, 0, 2, 0)))
+        );
+        const __m128 det_a = SP_SHUFFLE(det_sub, 0, 0, 0, 0);
+        const __m128 det_b = SP_SHUFFLE(det_sub, 1, 1, 1, 1);
+        const __m128 det_c = SP_SHUFFLE(det_sub, 2, 2, 2, 2);
+        const __m128 det_d = SP_SHUFFLE(det_sub, 3, 3, 3, 3);
+
+        const __m128 d_c = mat2_adj_mul(d, c);
+        const __m128 a_b = mat2_adj_mul(a, b);
+        __m128 x         = _mm_sub_ps(_mm_mul_ps(det_d, a), mat2_mul(b, d_c));
+        __m128 w         = _mm_sub_ps(_mm_mul_ps(det_a, d), mat2_mul(c, a_b));
+        __m128 y         = _mm_sub_ps(_mm_mul_ps(det_b, c), mat2_mul_adj(d, a_b));
+        __m128 z         = _mm_sub_ps(_mm_mul_ps(det_c, b), mat2_mul_adj(a, d_c));
+
+        // |m| = |a| * |d| + |b| * |c| - trace((a#b)(d#c))
+        __m128 trace = _mm_mul_ps(a_b, SP_SHUFFLE(d_c, 0, 2, 1, 3));
+        trace        = _mm_hadd_ps(trace, trace);
+        trace        = _mm_hadd_ps(trace, trace);
+        __m128 det   = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(det_a, det_d), _mm_mul_ps(det_b, det_c)), trace);
+
+        const __m128 det_inv = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det);
+        x = _mm_mul_ps(x, det_inv);
+        y = _mm_mul_ps(y, det_inv);
+        z = _mm_mul_ps(z, det_inv);
+        w = _mm_mul_ps(w, det_inv);
+
+        _mm_storeu_ps(out + 0,  _mm_shuffle_ps(x, y, _MM_SHUFFLE(1, 3, 1, 3)));
+        _mm_storeu_ps(out + 4,  _mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 2, 0, 2)));
+        _mm_storeu_ps(out + 8,  _mm_shuffle_ps(z, w, _MM_SHUFFLE(1, 3, 1, 3)));
+        _mm_storeu_ps(out + 12, _mm_shuffle_ps(z, w, _MM_SHUFFLE(0, 2, 0, 2)));
+    }
+
+    // quaternions are (x, y, z, w)
+    inline void quaternion_multiply(const float* a, const float* b, float* out)
+    {
+        const __m128 qa        = _mm_loadu_ps(a);
+        const __m128 qb        = _mm_loadu_ps(b);
+        const __m128 sign_w    = _mm_setr_ps(0.0f, 0.0f, 0.0f, -0.0f);
+
+        __m128 result = _mm_mul_ps(SP_SHUFFLE(qa, 3, 3, 3, 3), qb);
+        result        = _mm_add_ps(result, _mm_xor_ps(sign_w, _mm_mul_ps(SP_SHUFFLE(qa, 0, 1, 2, 0), SP_SHUFFLE(qb, 3, 3, 3, 0))));
+        result        = _mm_add_ps(result, _mm_xor_ps(sign_w, _mm_mul_ps(SP_SHUFFLE(qa, 1, 2, 0, 1), SP_SHUFFLE(qb, 2, 0, 1, 1))));
+        result        = _mm_sub_ps(result, _mm_mul_ps(SP_SHUFFLE(qa, 2, 0, 1, 2), SP_SHUFFLE(qb, 1, 2, 0, 2)));
+
+        _mm_storeu_ps(out, result);
+    }
+
+    // v + 2 * (w * (q x v) + q x (q x v))
+    inline void quaternion_rotate(const float* q, const float* v, float* out)
+    {
+        const __m128 quaternion = _mm_loadu_ps(q);
+        const __m128 q_xyz      = _mm_and_ps(quaternion, _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0)));
+        const __m128 vector     = load3(v, 0.0f);
+        const __m128 cross1     = cross(q_xyz, vector);
+        const __m128 cross2     = cross(q_xyz, cross1);
+        const __m128 w          = SP_SHUFFLE(quaternion, 3, 3, 3, 3);
+        const __m128 result     = _mm_add_ps(vector, _mm_mul_ps(_mm_set1_ps(2.0f), _mm_add_ps(_mm_mul_ps(cross1, w), cross2)));
+
+        store3(out, result);
+    }
+
+    #undef SP_SHUFFLE
+
+#elif defined(SP_MATH_NEON)
+
+    inline void matrix_multiply(const float* a, const float* b, float* out)
+    {
+        const float32x4_t a0 = vld1q_f32(a + 0);
+        const float32x4_t a1 = vld1q_f32(a + 4);
+        const float32x4_t a2 = vld1q_f32(a + 8);
+        const float32x4_t a3 = vld1q_f32(a + 12);
+
+        for (int column = 0; column < 4; column++)
+        {
+            const float32x4_t b_column = vld1q_f32(b + column * 4);
+
+            float32x4_t result = vmulq_laneq_f32(a0, b_column, 0);
+            result             = vfmaq_laneq_f32(result, a1, b_column, 1);
+            result             = vfmaq_laneq_f32(result, a2, b_column, 2);
+            result             = vfmaq_laneq_f32(result, a3, b_column, 3);
+
+            vst1q_f32(out + column * 4, result);
+        }
+    }
+
+#endif
+}
@@ -25,11 +25,13 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Quaternion.h"
 #include "Vector3.h"
 #include "Vector4.h"
+#include "MathSimd.h"
 //=====================
 
 namespace Spartan::Math
 {
-    class SP_CLASS Matrix
+    // 16 byte aligned so that the columns can be loaded straight into simd registers
+    class SP_CLASS alignas(16) Matrix
     {
     public:
         Matrix()
@@ -281,6 +283,11 @@ namespace Spartan::Math
         [[nodiscard]] Matrix Inverted() const { return Invert(*this); }
         static inline Matrix Invert(const Matrix& matrix)
         {
+        #if defined(SP_MATH_SSE)
+            Matrix result;
+            Simd::matrix_inverse(matrix.Data(), &result.m00);
+            return result;
+        #else
             float v0 = matrix.m20 * matrix.m31 - matrix.m21 * matrix.m30;
             float v1 = matrix.m20 * matrix.m32 - matrix.m22 * matrix.m30;
             float v2 = matrix.m20 * matrix.m33 - matrix.m23 *matrix.m30;
@@ -334,6 +341,7 @@ namespace Spartan::Math
                 i10, i11, i12, i13,
                 i20, i21, i22, i23,
                 i30, i31, i32, i33);
+        #endif
         }
 
         void Decompose(Vector3& scale, Quaternion& rotation, Vector3& translation) const
@@ -353,6 +361,11 @@ namespace Spartan::Math
 
         Matrix operator*(const Matrix& rhs) const
         {
+        #if !defined(SP_MATH_SCALAR)
+            Matrix result;
+            Simd::matrix_multiply(Data(), rhs.Data(), &result.m00);
+            return result;
+        #else
             return Matrix(
                 m00 * rhs.m00 + m01 * rhs.m10 + m02 * rhs.m20 + m03 * rhs.m30,
                 m00 * rhs.m01 + m01 * rhs.m11 + m02 * rhs.m21 + m03 * rhs.m31,
@@ -371,6 +384,7 @@ namespace Spartan::Math
                 m30 * rhs.m02 + m31 * rhs.m12 + m32 * rhs.m22 + m33 * rhs.m32,
                 m30 * rhs.m03 + m31 * rhs.m13 + m32 * rhs.m23 + m33 * rhs.m33
             );
+        #endif
         }
 
         void operator*=(const Matrix& rhs) { (*this) = (*this) * rhs; }
@@ -23,6 +23,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //= INCLUDES =======
 #include "Vector3.h"
+#include "MathSimd.h"
 //==================
 
 namespace Spartan::Math
@@ -185,6 +186,11 @@ namespace Spartan::Math
 
         static inline Quaternion Multiply(const Quaternion& Qa, const Quaternion& Qb)
         {
+        #if defined(SP_MATH_SSE)
+            Quaternion result;
+            Simd::quaternion_multiply(&Qa.x, &Qb.x, &result.x);
+            return result;
+        #else
             const float x     = Qa.x;
             const float y     = Qa.y;
             const float z     = Qa.z;
@@ -204,6 +210,7 @@ namespace Spartan::Math
                 ((z * num) + (num2 * w)) + num10,
                 (w * num) - num9
             );
+        #endif
         }
 
         auto Conjugate() const      { return Quaternion(-x, -y, -z, w); }
@@ -316,11 +323,17 @@ namespace Spartan::Math
         void operator*=(const Quaternion& rhs)            { *this = Multiply(*this, rhs); }
         Vector3 operator*(const Vector3& rhs) const
         {
+        #if defined(SP_MATH_SSE)
+            Vector3 result;
+            Simd::quaternion_rotate(&x, &rhs.x, &result.x);
+            return result;
+        #else
             const Vector3 qVec(x, y, z);
             const Vector3 cross1(qVec.Cross(rhs));
             const Vector3 cross2(qVec.Cross(cross1));
 
             return rhs + 2.0f * (cross1 * w + cross2);
+        #endif
         }
         Quaternion& operator*=(float rhs)
         {            
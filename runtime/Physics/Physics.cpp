@@ -28,7 +28,10 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../Profiling/Profiler.h"
 #include "../Rendering/Renderer.h"
 #include "../Input/Input.h"
+#include "../World/World.h"
+#include "../World/Entity.h"
 #include "../World/Components/Camera.h"
+#include "../World/Components/PhysicsBody.h"
 SP_WARNINGS_OFF
 #include <btBulletDynamicsCommon.h>
 #include <BulletDynamics/ConstraintSolver/btPoint2PointConstraint.h>
@@ -160,6 +163,15 @@ namespace Spartan
         if (ProgressTracker::IsLoading())
             return;
 
+        // bodies, straight from the dense array of the component store
+        World::ForEach<PhysicsBody>([](Entity* entity, PhysicsBody* body)
+        {
+            if (entity->IsActiveSelf())
+            {
+                body->Tick();
+            }
+        });
+
         if (Engine::IsFlagSet(EngineMode::Playing))
         {
             // Picking
@@ -27,7 +27,10 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../RHI/RHI_Implementation.h"
 #include "../RHI/RHI_SwapChain.h"
 #include "../Core/ThreadPool.h"
+#include "../Core/TaskGraph.h"
+#include "../Core/FrameAllocator.h"
 #include "../Rendering/Renderer.h"
+#include "../Rendering/GeometryBuffer.h"
 #include "../Resource/ResourceCache.h"
 #include "../Display/Display.h"
 //====================================
@@ -41,22 +44,46 @@ namespace Spartan
     ProfilerGranularity granularity = ProfilerGranularity::Light;
 
     // metrics - rhi
-    uint32_t Profiler::m_rhi_draw                       = 0;
-    uint32_t Profiler::m_rhi_timeblock_count            = 0;
-    uint32_t Profiler::m_rhi_pipeline_bindings          = 0;
-    uint32_t Profiler::m_rhi_pipeline_barriers          = 0;
-    uint32_t Profiler::m_rhi_bindings_buffer_index      = 0;
-    uint32_t Profiler::m_rhi_bindings_buffer_vertex     = 0;
-    uint32_t Profiler::m_rhi_bindings_buffer_constant   = 0;
-    uint32_t Profiler::m_rhi_bindings_buffer_structured = 0;
-    uint32_t Profiler::m_rhi_bindings_sampler           = 0;
-    uint32_t Profiler::m_rhi_bindings_texture_sampled   = 0;
-    uint32_t Profiler::m_rhi_bindings_shader_vertex     = 0;
-    uint32_t Profiler::m_rhi_bindings_shader_pixel      = 0;
-    uint32_t Profiler::m_rhi_bindings_shader_compute    = 0;
-    uint32_t Profiler::m_rhi_bindings_render_target     = 0;
-    uint32_t Profiler::m_rhi_bindings_texture_storage   = 0;
-    uint32_t Profiler::m_rhi_bindings_descriptor_set    = 0;
+    atomic<uint32_t> Profiler::m_rhi_draw                       = 0;
+    atomic<uint32_t> Profiler::m_rhi_timeblock_count            = 0;
+    atomic<uint32_t> Profiler::m_rhi_pipeline_bindings          = 0;
+    atomic<uint32_t> Profiler::m_rhi_pipeline_barriers          = 0;
+    atomic<uint32_t> Profiler::m_rhi_bindings_buffer_index      = 0;
+    atomic<uint32_t> Profiler::m_rhi_bindings_buffer_vertex     = 0;
+    atomic<uint32_t> Profiler::m_rhi_bindings_buffer_constant   = 0;
+    atomic<uint32_t> Profiler::m_rhi_bindings_buffer_structured = 0;
+    atomic<uint32_t> Profiler::m_rhi_bindings_sampler           = 0;
+    atomic<uint32_t> Profiler::m_rhi_bindings_texture_sampled   = 0;
+    atomic<uint32_t> Profiler::m_rhi_bindings_shader_vertex     = 0;
+    atomic<uint32_t> Profiler::m_rhi_bindings_shader_pixel      = 0;
+    atomic<uint32_t> Profiler::m_rhi_bindings_shader_compute    = 0;
+    atomic<uint32_t> Profiler::m_rhi_bindings_render_target     = 0;
+    atomic<uint32_t> Profiler::m_rhi_bindings_texture_storage   = 0;
+    atomic<uint32_t> Profiler::m_rhi_bindings_descriptor_set    = 0;
+    atomic<uint32_t> Profiler::m_rhi_push_constants             = 0;
+    atomic<uint32_t> Profiler::m_rhi_dynamic_states             = 0;
+
+    // metrics - rhi elided
+    atomic<uint32_t> Profiler::m_rhi_elided_pipeline_bindings       = 0;
+    atomic<uint32_t> Profiler::m_rhi_elided_bindings_buffer_index   = 0;
+    atomic<uint32_t> Profiler::m_rhi_elided_bindings_buffer_vertex  = 0;
+    atomic<uint32_t> Profiler::m_rhi_elided_bindings_descriptor_set = 0;
+    atomic<uint32_t> Profiler::m_rhi_elided_push_constants          = 0;
+    atomic<uint32_t> Profiler::m_rhi_elided_dynamic_states          = 0;
+
+    // metrics - shadows
+    uint32_t Profiler::m_shadow_slices_rendered = 0;
+    uint32_t Profiler::m_shadow_slices_cached   = 0;
+
+    // metrics - dynamic instancing
+    uint32_t Profiler::m_batches       = 0;
+    uint32_t Profiler::m_batched_draws = 0;
+
+    // metrics - meshlets
+    uint32_t Profiler::m_meshlets        = 0;
+    uint32_t Profiler::m_meshlets_culled = 0;
+    uint32_t Profiler::m_occluders       = 0;
+    uint32_t Profiler::m_occluded        = 0;
 
     // metrics - time
     float Profiler::m_time_frame_avg  = 0.0f;
@@ -97,10 +124,11 @@ namespace Spartan
         const float weight_delta            = 1.0f / static_cast<float>(frames_to_accumulate);
         const float weight_history          = (1.0f - weight_delta);
 
-        // time blocks (double buffered)
+        // time blocks (double buffered), any thread can record cpu blocks so the write side is guarded
         int m_time_block_index = -1;
         vector<TimeBlock> m_time_blocks_write;
         vector<TimeBlock> m_time_blocks_read;
+        mutex mutex_time_blocks;
 
         // fps
         float m_fps = 0.0f;
@@ -117,15 +145,25 @@ namespace Spartan
         bool is_stuttering_cpu = false;
         bool is_stuttering_gpu = false;
 
+        // shadow slices, how many times each slice of each light was re-rendered or reused since the metrics were last drawn
+        struct ShadowSliceCounts
+        {
+            string light_name;
+            vector<uint32_t> rendered;
+            vector<uint32_t> cached;
+        };
+        map<uint64_t, ShadowSliceCounts> shadow_slice_counts; // ordered, so that the lights don't move around in the metrics
+
         // metric drawing
         ostringstream oss_metrics;
         string metrics_str;
         float metrics_time_since_last_update = profiling_interval_sec;
 
         // misc
-        bool poll                 = false;
-        bool increase_capacity    = false;
-        bool allow_time_block_end = true;
+        atomic<bool> poll              = false;
+        atomic<bool> increase_capacity = false;
+        bool allow_time_block_end      = true;
+        thread::id main_thread_id;
 
         string format_float(float value)
         {
@@ -151,6 +189,9 @@ namespace Spartan
   
     void Profiler::Initialize()
     {
+        // gpu time blocks are recorded on the main thread's command lists, and only its cpu time blocks add up to the frame's cpu time
+        main_thread_id = this_thread::get_id();
+
         m_time_blocks_read.reserve(initial_capacity);
         m_time_blocks_read.resize(initial_capacity);
         m_time_blocks_write.reserve(initial_capacity);
@@ -165,6 +206,7 @@ namespace Spartan
     void Profiler::Shutdown()
     {
         ClearRhiMetrics();
+        shadow_slice_counts.clear();
         RenderDoc::Shutdown();
     }
 
@@ -178,6 +220,7 @@ namespace Spartan
             SwapBuffers();
 
             // double the size
+            lock_guard<mutex> lock(mutex_time_blocks);
             const uint32_t size_old = static_cast<uint32_t>(m_time_blocks_write.size());
             const uint32_t size_new = size_old << 1;
 
@@ -209,7 +252,8 @@ namespace Spartan
                 if (!time_block.IsComplete())
                     continue;
 
-                if (!time_block.GetParent() && time_block.GetType() == TimeBlockType::Cpu)
+                // worker threads overlap with the main thread, so their blocks are shown but not added up
+                if (!time_block.GetParent() && time_block.GetType() == TimeBlockType::Cpu && time_block.GetThreadId() == main_thread_id)
                 {
                     m_time_cpu_last += time_block.GetDuration();
                 }
@@ -262,10 +306,16 @@ namespace Spartan
         {
             DrawPerformanceMetrics();
         }
+        else
+        {
+            shadow_slice_counts.clear(); // nothing shows them, so they don't accumulate
+        }
     }
 
     void Profiler::SwapBuffers()
     {
+        lock_guard<mutex> lock(mutex_time_blocks);
+
         // copy completed time blocks write to time blocks read vector (double buffering)
         {
             uint32_t pass_index_gpu = 0;
@@ -282,7 +332,8 @@ namespace Spartan
                         pass_index_gpu += 2;
                     }
                 }
-                else if (time_block.GetType() != TimeBlockType::Undefined) // if undefined, then it wasn't used this frame, nothing wrong with that
+                // if undefined, then it wasn't used this frame, nothing wrong with that, and a thread pool task can still be running past the frame
+                else if (time_block.GetType() != TimeBlockType::Undefined && time_block.GetThreadId() == main_thread_id)
                 {
                     SP_LOG_WARNING("TimeBlockEnd() was not called for time block \"%s\"", time_block.GetName());
                 }
@@ -304,12 +355,14 @@ namespace Spartan
             return;
 
         const bool can_profile_cpu = (type == TimeBlockType::Cpu) && profile_cpu;
-        const bool can_profile_gpu = (type == TimeBlockType::Gpu) && profile_gpu;
+        const bool can_profile_gpu = (type == TimeBlockType::Gpu) && profile_gpu && this_thread::get_id() == main_thread_id;
 
         if (!can_profile_cpu && !can_profile_gpu)
             return;
 
-        // last incomplete block of the same type, is the parent
+        lock_guard<mutex> lock(mutex_time_blocks);
+
+        // last incomplete block of the same type (and thread), is the parent
         TimeBlock* time_block_parent = GetLastIncompleteTimeBlock(type);
 
         if (TimeBlock* time_block = GetNewTimeBlock())
@@ -320,12 +373,35 @@ namespace Spartan
 
     void Profiler::TimeBlockEnd()
     {
+        lock_guard<mutex> lock(mutex_time_blocks);
+
         if (TimeBlock* time_block = GetLastIncompleteTimeBlock())
         {
             time_block->End();
         }
     }
 
+    void Profiler::RecordShadowSlice(const uint64_t light_id, const string& light_name, const uint32_t slice, const bool rendered)
+    {
+        if (rendered)
+        {
+            m_shadow_slices_rendered++;
+        }
+        else
+        {
+            m_shadow_slices_cached++;
+        }
+
+        ShadowSliceCounts& counts = shadow_slice_counts[light_id];
+        counts.light_name         = light_name;
+        if (slice >= counts.rendered.size())
+        {
+            counts.rendered.resize(slice + 1, 0);
+            counts.cached.resize(slice + 1, 0);
+        }
+        (rendered ? counts.rendered : counts.cached)[slice]++;
+    }
+
     void Profiler::ClearMetrics()
     {
         m_time_frame_avg  = 0.0f;
@@ -417,9 +493,13 @@ namespace Spartan
 
     TimeBlock* Profiler::GetLastIncompleteTimeBlock(TimeBlockType type /*= TimeBlock_Undefined*/)
     {
+        const thread::id thread_id = this_thread::get_id();
+
         for (int i = m_time_block_index; i >= 0; i--)
         {
             TimeBlock& time_block = m_time_blocks_write[i];
+            if (time_block.GetThreadId() != thread_id)
+                continue;
 
             if (type == time_block.GetType() || type == TimeBlockType::Undefined)
             {
@@ -475,7 +555,8 @@ namespace Spartan
         oss_metrics
             << "FPS:\t\t\t" << m_fps << endl
             << "Time:\t\t\t"  << m_time_frame_avg << " ms" << endl
-            << "Frame:\t\t"   << Renderer::GetFrameNum() << endl;
+            << "Frame:\t\t"   << Renderer::GetFrameNum() << endl
+            << "Pacing:\t\t"  << format_float(static_cast<float>(Timer::GetPacingErrorAvgMs())) << " avg, " << format_float(static_cast<float>(Timer::GetPacingErrorMaxMs())) << " max ms" << endl;
 
         // detailed times
         oss_metrics
@@ -502,20 +583,87 @@ namespace Spartan
 
         // cpu
         oss_metrics << endl << "CPU" << endl
-            << "Worker threads: " << ThreadPool::GetWorkingThreadCount() << "/" << ThreadPool::GetThreadCount() << endl;
+            << "Worker threads: " << ThreadPool::GetWorkingThreadCount() << "/" << ThreadPool::GetThreadCount() << endl
+            << "Frame allocator: " << FrameAllocator::GetAllocatedBytes() / 1024 << " KB, " << FrameAllocator::GetAllocationCount() << " allocations, " << FrameAllocator::GetHeapAllocationCount() << " from the heap" << endl;
 
-        // api calls
+        // frame graph
+        {
+            const TaskGraph& task_graph = Engine::GetTaskGraph();
+            oss_metrics << "\nFrame graph:\t" << format_float(task_graph.GetTimeMs()) << " ms" << endl;
+            for (const TaskGraphStage& stage : task_graph.GetStages())
+            {
+                oss_metrics << stage.name << ":\t\t" << format_float(stage.time_start_ms) << " - " << format_float(stage.time_end_ms) << " ms\t"
+                            << (stage.ran_on_main_thread ? "main" : "worker");
+
+                if (!stage.dependencies.empty())
+                {
+                    oss_metrics << "\tafter:";
+                    for (const uint32_t dependency : stage.dependencies)
+                    {
+                        oss_metrics << " " << task_graph.GetStages()[dependency].name;
+                    }
+                }
+
+                oss_metrics << endl;
+            }
+        }
+
+        // api calls (recorded and in parentheses, dropped as redundant)
         oss_metrics << "\nAPI calls" << endl;
         oss_metrics << "Draw:\t\t\t\t\t\t\t\t\t\t\t"  << m_rhi_draw << endl;
-        oss_metrics << "Index buffer bindings:\t\t\t" << m_rhi_bindings_buffer_index   << endl
-                    << "Vertex buffer bindings:\t\t"  << m_rhi_bindings_buffer_vertex  << endl
-                    << "Descriptor set bindings:\t\t" << m_rhi_bindings_descriptor_set << endl;
+        oss_metrics << "Index buffer bindings:\t\t\t" << m_rhi_bindings_buffer_index   << " (" << m_rhi_elided_bindings_buffer_index   << ")" << endl
+                    << "Vertex buffer bindings:\t\t"  << m_rhi_bindings_buffer_vertex  << " (" << m_rhi_elided_bindings_buffer_vertex  << ")" << endl
+                    << "Descriptor set bindings:\t\t" << m_rhi_bindings_descriptor_set << " (" << m_rhi_elided_bindings_descriptor_set << ")" << endl
+                    << "Push constants:\t\t\t\t\t" << m_rhi_push_constants           << " (" << m_rhi_elided_push_constants          << ")" << endl
+                    << "Dynamic states:\t\t\t\t\t" << m_rhi_dynamic_states           << " (" << m_rhi_elided_dynamic_states          << ")" << endl;
 
         // resources
         oss_metrics << "\nPipeline\n"
-            << "Bindings:\t\t\t" << m_rhi_pipeline_bindings << endl
+            << "Bindings:\t\t\t" << m_rhi_pipeline_bindings << " (" << m_rhi_elided_pipeline_bindings << ")" << endl
             << "Barriers:\t\t\t" << m_rhi_pipeline_barriers << endl;
 
+        // shadows
+        oss_metrics << "\nShadow slices (cascades re-render once the camera moves a texel)\n"
+            << "Re-rendered:\t" << m_shadow_slices_rendered << endl
+            << "Cached:\t\t\t" << m_shadow_slices_cached   << endl;
+
+        // per light, the invalidations of each slice out of the frames it was drawn in since the last update
+        if (!shadow_slice_counts.empty())
+        {
+            oss_metrics << "Per light (re-rendered/frames, per slice)" << endl;
+        }
+        for (const auto& [light_id, counts] : shadow_slice_counts)
+        {
+            oss_metrics << counts.light_name << ":";
+            for (uint32_t slice = 0; slice < static_cast<uint32_t>(counts.rendered.size()); slice++)
+            {
+                oss_metrics << (slice == 0 ? "\t" : ", ") << counts.rendered[slice] << "/" << counts.rendered[slice] + counts.cached[slice];
+            }
+            oss_metrics << endl;
+        }
+        shadow_slice_counts.clear();
+
+        // dynamic instancing
+        oss_metrics << "\nDynamic instancing\n"
+            << "Batches:\t\t\t" << m_batches                                                       << endl
+            << "Draws saved:\t" << (m_batched_draws > m_batches ? m_batched_draws - m_batches : 0) << endl;
+
+        // meshlets
+        oss_metrics << "\nMeshlets\n"
+            << "Tested:\t\t\t" << m_meshlets        << endl
+            << "Culled:\t\t\t" << m_meshlets_culled << endl;
+
+        // occlusion culling
+        oss_metrics << "\nOcclusion culling\n"
+            << "Occluders:\t\t" << m_occluders << endl
+            << "Occluded:\t\t" << m_occluded  << endl;
+
+        // geometry buffer
+        oss_metrics << "\nGeometry buffer\n"
+            << "Used:\t\t\t\t" << GeometryBuffer::GetAllocatedBytes() / (1024 * 1024) << "/" << GeometryBuffer::GetCapacityBytes() / (1024 * 1024) << " MB" << endl
+            << "Allocations:\t" << GeometryBuffer::GetAllocationCount() << endl
+            << "Blocks:\t\t\t" << GeometryBuffer::GetBlockCount()      << endl;
+
         // resources
         oss_metrics << "\nResources\n"
             << "Textures:\t\t\t\t\t\t\t\t"  << texture_count          << endl
@@ -24,6 +24,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //= INCLUDES ===================
 #include <string>
 #include <vector>
+#include <atomic>
 #include "TimeBlock.h"
 #include "../Core/Definitions.h"
 //==============================
@@ -66,23 +67,52 @@ namespace Spartan
         static bool IsCpuStuttering();
         static bool IsGpuStuttering();
         
-        // metrics - rhi
-        static uint32_t m_rhi_draw;
-        static uint32_t m_rhi_timeblock_count;
-        static uint32_t m_rhi_pipeline_bindings;
-        static uint32_t m_rhi_pipeline_barriers;
-        static uint32_t m_rhi_bindings_buffer_index;
-        static uint32_t m_rhi_bindings_buffer_vertex;
-        static uint32_t m_rhi_bindings_buffer_constant;
-        static uint32_t m_rhi_bindings_buffer_structured;
-        static uint32_t m_rhi_bindings_sampler;
-        static uint32_t m_rhi_bindings_texture_sampled;
-        static uint32_t m_rhi_bindings_shader_vertex;
-        static uint32_t m_rhi_bindings_shader_pixel;
-        static uint32_t m_rhi_bindings_shader_compute;
-        static uint32_t m_rhi_bindings_render_target;
-        static uint32_t m_rhi_bindings_texture_storage;
-        static uint32_t m_rhi_bindings_descriptor_set;
+        // metrics - rhi (atomic since secondary command lists are recorded on worker threads)
+        static std::atomic<uint32_t> m_rhi_draw;
+        static std::atomic<uint32_t> m_rhi_timeblock_count;
+        static std::atomic<uint32_t> m_rhi_pipeline_bindings;
+        static std::atomic<uint32_t> m_rhi_pipeline_barriers;
+        static std::atomic<uint32_t> m_rhi_bindings_buffer_index;
+        static std::atomic<uint32_t> m_rhi_bindings_buffer_vertex;
+        static std::atomic<uint32_t> m_rhi_bindings_buffer_constant;
+        static std::atomic<uint32_t> m_rhi_bindings_buffer_structured;
+        static std::atomic<uint32_t> m_rhi_bindings_sampler;
+        static std::atomic<uint32_t> m_rhi_bindings_texture_sampled;
+        static std::atomic<uint32_t> m_rhi_bindings_shader_vertex;
+        static std::atomic<uint32_t> m_rhi_bindings_shader_pixel;
+        static std::atomic<uint32_t> m_rhi_bindings_shader_compute;
+        static std::atomic<uint32_t> m_rhi_bindings_render_target;
+        static std::atomic<uint32_t> m_rhi_bindings_texture_storage;
+        static std::atomic<uint32_t> m_rhi_bindings_descriptor_set;
+        static std::atomic<uint32_t> m_rhi_push_constants;
+        static std::atomic<uint32_t> m_rhi_dynamic_states;
+
+        // metrics - rhi commands which the state tracker dropped as redundant
+        static std::atomic<uint32_t> m_rhi_elided_pipeline_bindings;
+        static std::atomic<uint32_t> m_rhi_elided_bindings_buffer_index;
+        static std::atomic<uint32_t> m_rhi_elided_bindings_buffer_vertex;
+        static std::atomic<uint32_t> m_rhi_elided_bindings_descriptor_set;
+        static std::atomic<uint32_t> m_rhi_elided_push_constants;
+        static std::atomic<uint32_t> m_rhi_elided_dynamic_states;
+
+        // metrics - shadows
+        static uint32_t m_shadow_slices_rendered; // cached slices which were invalidated and re-rendered, directional cascades follow the camera
+        static uint32_t m_shadow_slices_cached;   // cached slices which were reused
+
+        // counts a cached slice towards the totals above and towards the light's own, which the metrics break down per slice
+        static void RecordShadowSlice(const uint64_t light_id, const std::string& light_name, const uint32_t slice, const bool rendered);
+
+        // metrics - dynamic instancing
+        static uint32_t m_batches;       // instanced draws emitted by the dynamic instancing stage
+        static uint32_t m_batched_draws; // draws which were folded into them
+
+        // metrics - meshlets
+        static uint32_t m_meshlets;        // meshlets of the renderables which were culled per meshlet
+        static uint32_t m_meshlets_culled; // meshlets which were outside of the view frustum or facing away from the camera
+
+        // metrics - occlusion culling
+        static uint32_t m_occluders; // renderables which were rasterized into the software occlusion buffer
+        static uint32_t m_occluded;  // renderables which were in the view frustum but hidden behind the occluders
 
         // metrics - time
         static float m_time_frame_avg ;
@@ -114,22 +144,38 @@ namespace Spartan
 
         static void ClearRhiMetrics()
         {
-            m_rhi_draw                       = 0;
-            m_rhi_timeblock_count            = 0;
-            m_rhi_pipeline_bindings          = 0;
-            m_rhi_pipeline_barriers          = 0;
-            m_rhi_bindings_buffer_index      = 0;
-            m_rhi_bindings_buffer_vertex     = 0;
-            m_rhi_bindings_buffer_constant   = 0;
-            m_rhi_bindings_buffer_structured = 0;
-            m_rhi_bindings_sampler           = 0;
-            m_rhi_bindings_texture_sampled   = 0;
-            m_rhi_bindings_shader_vertex     = 0;
-            m_rhi_bindings_shader_pixel      = 0;
-            m_rhi_bindings_shader_compute    = 0;
-            m_rhi_bindings_render_target     = 0;
-            m_rhi_bindings_texture_storage   = 0;
-            m_rhi_bindings_descriptor_set    = 0;
+            m_rhi_draw                           = 0;
+            m_rhi_timeblock_count                = 0;
+            m_rhi_pipeline_bindings              = 0;
+            m_rhi_pipeline_barriers              = 0;
+            m_rhi_bindings_buffer_index          = 0;
+            m_rhi_bindings_buffer_vertex         = 0;
+            m_rhi_bindings_buffer_constant       = 0;
+            m_rhi_bindings_buffer_structured     = 0;
+            m_rhi_bindings_sampler               = 0;
+            m_rhi_bindings_texture_sampled       = 0;
+            m_rhi_bindings_shader_vertex         = 0;
+            m_rhi_bindings_shader_pixel          = 0;
+            m_rhi_bindings_shader_compute        = 0;
+            m_rhi_bindings_render_target         = 0;
+            m_rhi_bindings_texture_storage       = 0;
+            m_rhi_bindings_descriptor_set        = 0;
+            m_rhi_push_constants                 = 0;
+            m_rhi_dynamic_states                 = 0;
+            m_rhi_elided_pipeline_bindings       = 0;
+            m_rhi_elided_bindings_buffer_index   = 0;
+            m_rhi_elided_bindings_buffer_vertex  = 0;
+            m_rhi_elided_bindings_descriptor_set = 0;
+            m_rhi_elided_push_constants          = 0;
+            m_rhi_elided_dynamic_states          = 0;
+            m_shadow_slices_rendered             = 0;
+            m_shadow_slices_cached               = 0;
+            m_batches                            = 0;
+            m_batched_draws                      = 0;
+            m_meshlets                           = 0;
+            m_meshlets_culled                    = 0;
+            m_occluders                          = 0;
+            m_occluded                           = 0;
         }
 
         static TimeBlock* GetNewTimeBlock();
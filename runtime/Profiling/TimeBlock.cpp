@@ -47,6 +47,7 @@ namespace Spartan
         m_parent         = parent;
         m_tree_depth     = FindTreeDepth(this);
         m_type           = type;
+        m_thread_id      = this_thread::get_id();
         m_max_tree_depth = Math::Helper::Max(m_max_tree_depth, m_tree_depth);
 
         if (cmd_list)
@@ -101,6 +102,7 @@ namespace Spartan
         m_max_tree_depth = 0;
         m_type           = TimeBlockType::Undefined;
         m_is_complete    = false;
+        m_thread_id      = thread::id();
     }
 
     uint32_t TimeBlock::FindTreeDepth(const TimeBlock* time_block, uint32_t depth /*= 0*/)
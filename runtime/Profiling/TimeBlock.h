@@ -24,6 +24,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //= INCLUDES ======================
 #include <chrono>
 #include <memory>
+#include <thread>
 #include "../RHI/RHI_Definitions.h"
 //=================================
 
@@ -48,14 +49,15 @@ namespace Spartan
         void End();
         void Reset();
 
-        TimeBlockType GetType()      const { return m_type; }
-        const char* GetName()        const { return m_name; }
-        const TimeBlock* GetParent() const { return m_parent; }
-        uint32_t GetTreeDepth()      const { return m_tree_depth; }
-        uint32_t GetTreeDepthMax()   const { return m_max_tree_depth; }
-        float GetDuration()          const { return m_duration; }
-        bool IsComplete()            const { return m_is_complete; }
-        uint32_t GetId()             const { return m_id; }
+        TimeBlockType GetType()       const { return m_type; }
+        const char* GetName()         const { return m_name; }
+        const TimeBlock* GetParent()  const { return m_parent; }
+        uint32_t GetTreeDepth()       const { return m_tree_depth; }
+        uint32_t GetTreeDepthMax()    const { return m_max_tree_depth; }
+        float GetDuration()           const { return m_duration; }
+        bool IsComplete()             const { return m_is_complete; }
+        uint32_t GetId()              const { return m_id; }
+        std::thread::id GetThreadId() const { return m_thread_id; }
 
     private:    
         static uint32_t FindTreeDepth(const TimeBlock* time_block, uint32_t depth = 0);
@@ -69,6 +71,7 @@ namespace Spartan
         bool m_is_complete         = false;
         uint32_t m_id              = 0;
         uint32_t m_timestamp_index = 0;
+        std::thread::id m_thread_id; // blocks nest per thread
 
         // Dependencies
         RHI_CommandList* m_cmd_list = nullptr;
@@ -44,4 +44,14 @@ namespace Spartan
     {
 
     }
+
+    void RHI_Buffer::UpdateRange(const void* data_cpu, const uint64_t offset, const uint64_t size)
+    {
+        SP_ASSERT_MSG(false, "Function is not implemented");
+    }
+
+    void RHI_Buffer::CopyRange(RHI_Buffer* destination, const uint64_t offset_source, const uint64_t offset_destination, const uint64_t size)
+    {
+        SP_ASSERT_MSG(false, "Function is not implemented");
+    }
 }
@@ -40,11 +40,12 @@ using namespace Spartan::Math;
 
 namespace Spartan
 {
-    RHI_CommandList::RHI_CommandList(void* cmd_pool, const char* name)
+    RHI_CommandList::RHI_CommandList(void* cmd_pool, const char* name, const bool is_secondary /*= false*/)
     {
         SP_ASSERT(cmd_pool != nullptr);
 
         m_rhi_cmd_pool_resource = cmd_pool;
+        m_is_secondary          = is_secondary;
 
         // create command list
         SP_ASSERT_MSG(
@@ -86,6 +87,7 @@ namespace Spartan
             "Failed to reset command list");
 
         m_state = RHI_CommandListState::Recording;
+        m_state_tracker.Invalidate();
     }
 
     void RHI_CommandList::Submit(RHI_Queue* queue, const uint64_t swapchain_id)
@@ -105,7 +107,27 @@ namespace Spartan
         SP_ASSERT_MSG(false, "Function is not implemented");
     }
 
-    void RHI_CommandList::RenderPassBegin()
+    void RHI_CommandList::RecordParallel(RHI_PipelineState& pso, const uint32_t job_count, const function<void(RHI_CommandList* cmd_list, const uint32_t job_index)>& record)
+    {
+        // bundles are not implemented, so the jobs are recorded serially, in order, into this command list
+        SetPipelineState(pso);
+        for (uint32_t i = 0; i < job_count; i++)
+        {
+            record(this, i);
+        }
+    }
+
+    void RHI_CommandList::BeginSecondary(RHI_CommandList* primary)
+    {
+        SP_ASSERT_MSG(false, "Function is not implemented");
+    }
+
+    void RHI_CommandList::EndSecondary()
+    {
+        SP_ASSERT_MSG(false, "Function is not implemented");
+    }
+
+    void RHI_CommandList::RenderPassBegin(const bool secondary_contents /*= false*/)
     {
         SP_ASSERT_MSG(false, "Function is not implemented");
     }
@@ -157,6 +179,11 @@ namespace Spartan
 
         Profiler::m_rhi_draw++;
     }
+
+    void RHI_CommandList::DrawIndexedIndirectCount(RHI_Buffer* buffer_arguments, const uint32_t arguments_offset, RHI_Buffer* buffer_count, const uint32_t count_offset, const uint32_t draw_count_max)
+    {
+        SP_ASSERT_MSG(false, "Function is not implemented");
+    }
   
     void RHI_CommandList::Dispatch(uint32_t x, uint32_t y, uint32_t z)
     {
@@ -189,7 +216,7 @@ namespace Spartan
         SP_ASSERT(source->GetHeight() == destination->GetHeight());
     }
 
-    void RHI_CommandList::SetViewport(const RHI_Viewport& viewport) const
+    void RHI_CommandList::SetViewport(const RHI_Viewport& viewport)
     {
         SP_ASSERT(m_state == RHI_CommandListState::Recording);
 
@@ -204,7 +231,7 @@ namespace Spartan
         static_cast<ID3D12GraphicsCommandList*>(m_rhi_resource)->RSSetViewports(1, &d3d12_viewport);
     }
     
-    void RHI_CommandList::SetScissorRectangle(const Math::Rectangle& scissor_rectangle) const
+    void RHI_CommandList::SetScissorRectangle(const Math::Rectangle& scissor_rectangle)
     {
         SP_ASSERT(m_state == RHI_CommandListState::Recording);
 
@@ -228,7 +255,7 @@ namespace Spartan
     {
         SP_ASSERT(m_state == RHI_CommandListState::Recording);
 
-        if (m_buffer_id_vertex == buffer->GetObjectId())
+        if (!m_state_tracker.SetVertexBuffer(binding, buffer->GetObjectId()))
             return;
 
         D3D12_VERTEX_BUFFER_VIEW vertex_buffer_view = {};
@@ -242,8 +269,6 @@ namespace Spartan
             &vertex_buffer_view // pViews
         );
 
-        m_buffer_id_vertex = buffer->GetObjectId();
-
         Profiler::m_rhi_bindings_buffer_vertex++;
     }
     
@@ -251,7 +276,7 @@ namespace Spartan
     {
         SP_ASSERT(m_state == RHI_CommandListState::Recording);
 
-        if (m_buffer_id_index == buffer->GetObjectId())
+        if (!m_state_tracker.SetIndexBuffer(buffer->GetObjectId()))
             return;
 
         bool is_16_bit = buffer->GetStride() == sizeof(uint16_t);
@@ -265,8 +290,6 @@ namespace Spartan
             &index_buffer_view // pView
         );
 
-        m_buffer_id_index = buffer->GetObjectId();
-
         Profiler::m_rhi_bindings_buffer_index++;
     }
     
@@ -311,26 +334,6 @@ namespace Spartan
         return 0.0f;
     }
 
-    void RHI_CommandList::BeginOcclusionQuery(const uint64_t entity_id)
-    {
-        return;
-    }
-
-    void RHI_CommandList::EndOcclusionQuery()
-    {
-
-    }
-
-    bool RHI_CommandList::GetOcclusionQueryResult(const uint64_t entity_id)
-    {
-        return false;
-    }
-
-    void RHI_CommandList::UpdateOcclusionQueries()
-    {
-
-    }
-
     void RHI_CommandList::BeginTimeblock(const char* name, const bool gpu_marker, const bool gpu_timing)
     {
         SP_ASSERT_MSG(false, "Function is not implemented");
@@ -368,4 +371,9 @@ namespace Spartan
     {
 
     }
+
+    void RHI_CommandList::InsertBarrierBufferReadWrite(RHI_Buffer* buffer)
+    {
+
+    }
 }
@@ -71,6 +71,10 @@ namespace Spartan
         void Update(void* data_cpu, const uint32_t size = 0);
         void ResetOffset() { m_offset = 0; first_update = true; }
 
+        // vertex and index buffer updating, for buffers which aren't mappable and are sub-allocated (see GeometryBuffer), offsets and sizes are in bytes
+        void UpdateRange(const void* data_cpu, const uint64_t offset, const uint64_t size);
+        void CopyRange(RHI_Buffer* destination, const uint64_t offset_source, const uint64_t offset_destination, const uint64_t size);
+
         // propeties
         uint32_t GetStrideUnaligned() const { return m_stride_unaligned; }
         uint32_t GetStride() const          { return m_stride; }
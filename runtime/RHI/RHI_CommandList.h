@@ -24,9 +24,11 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //= INCLUDES =================================
 #include <array>
 #include <atomic>
+#include <functional>
 #include "RHI_Definitions.h"
 #include "RHI_PipelineState.h"
 #include "RHI_Descriptor.h"
+#include "RHI_StateTracker.h"
 #include "../Rendering/Renderer_Definitions.h"
 //============================================
 
@@ -57,7 +59,7 @@ namespace Spartan
     class SP_CLASS RHI_CommandList
     {
     public:
-        RHI_CommandList(void* cmd_pool, const char* name);
+        RHI_CommandList(void* cmd_pool, const char* name, const bool is_secondary = false);
         ~RHI_CommandList();
 
         void Begin(const RHI_Queue* queue);
@@ -65,6 +67,11 @@ namespace Spartan
         void WaitForExecution();
         void SetPipelineState(RHI_PipelineState& pso);
 
+        // parallel recording
+        // begins the render pass of the pipeline state and records job_count jobs into secondary command lists, in parallel,
+        // the jobs inherit the render pass, the pipeline and the descriptors, and they are executed in job order
+        void RecordParallel(RHI_PipelineState& pso, const uint32_t job_count, const std::function<void(RHI_CommandList* cmd_list, const uint32_t job_index)>& record);
+
         // clear
         void ClearPipelineStateRenderTargets(RHI_PipelineState& pipeline_state);
         void ClearTexture(
@@ -77,6 +84,8 @@ namespace Spartan
         // draw
         void Draw(const uint32_t vertex_count, const uint32_t vertex_start_index = 0);
         void DrawIndexed(const uint32_t index_count, const uint32_t index_offset = 0, const uint32_t vertex_offset = 0, const uint32_t instance_start_index = 0, const uint32_t instance_count = 1);
+        // draw arguments and the draw count are read from gpu buffers (offsets are in bytes)
+        void DrawIndexedIndirectCount(RHI_Buffer* buffer_arguments, const uint32_t arguments_offset, RHI_Buffer* buffer_count, const uint32_t count_offset, const uint32_t draw_count_max);
 
         // dispatch
         void Dispatch(uint32_t x, uint32_t y, uint32_t z = 1);
@@ -91,10 +100,10 @@ namespace Spartan
         void Copy(RHI_Texture* source, RHI_SwapChain* destination);
 
         // viewport
-        void SetViewport(const RHI_Viewport& viewport) const;
+        void SetViewport(const RHI_Viewport& viewport);
         
         // scissor
-        void SetScissorRectangle(const Math::Rectangle& scissor_rectangle) const;
+        void SetScissorRectangle(const Math::Rectangle& scissor_rectangle);
 
         // cull mode
         void SetCullMode(const RHI_CullMode cull_mode);
@@ -138,12 +147,6 @@ namespace Spartan
         void EndTimestamp();
         float GetTimestampResult(const uint32_t index_timestamp);
 
-        // occlusion queries
-        void BeginOcclusionQuery(const uint64_t entity_id);
-        void EndOcclusionQuery();
-        bool GetOcclusionQueryResult(const uint64_t entity_id);
-        void UpdateOcclusionQueries();
-
         // timeblocks (markers + timestamps)
         void BeginTimeblock(const char* name, const bool gpu_marker = true, const bool gpu_timing = true);
         void EndTimeblock();
@@ -161,6 +164,7 @@ namespace Spartan
         );
         void InsertBarrierTexture(RHI_Texture* texture, const uint32_t mip_start, const uint32_t mip_range, const uint32_t array_length, const RHI_Image_Layout layout_old, const RHI_Image_Layout layout_new);
         void InsertBarrierTextureReadWrite(RHI_Texture* texture);
+        void InsertBarrierBufferReadWrite(RHI_Buffer* buffer);
         void InsertPendingBarrierGroup();
 
         // misc
@@ -169,38 +173,48 @@ namespace Spartan
         void* GetRhiResource() const                              { return m_rhi_resource; }
         const RHI_CommandListState GetState() const               { return m_state; }
         uint64_t GetSwapchainId() const                           { return m_swapchain_id; }
+        bool IsSecondary() const                                  { return m_is_secondary; }
+        void InvalidateState()                                    { m_state_tracker.Invalidate(); } // when anything else records into the command buffer
 
     private:
         void PreDraw();
-        void RenderPassBegin();
+        void RenderPassBegin(const bool secondary_contents = false);
         void RenderPassEnd();
+        void BeginSecondary(RHI_CommandList* primary);
+        void EndSecondary();
 
         // sync
         std::shared_ptr<RHI_Semaphore> m_rendering_complete_semaphore;
         std::shared_ptr<RHI_Semaphore> m_rendering_complete_semaphore_timeline;
 
         // misc
-        uint64_t m_buffer_id_vertex                          = 0;
-        uint64_t m_buffer_id_index                           = 0;
         bool m_ignore_clear_values                           = false;
         uint64_t m_swapchain_id                              = 0;
         uint32_t m_timestamp_index                           = 0;
         RHI_Pipeline* m_pipeline                             = nullptr;
         RHI_DescriptorSetLayout* m_descriptor_layout_current = nullptr;
+        mutable bool m_bind_dynamic                          = false; // the dynamic descriptors changed since they were last bound
         std::atomic<RHI_CommandListState> m_state            = RHI_CommandListState::Idle;
-        RHI_CullMode m_cull_mode                             = RHI_CullMode::Back;
         const char* m_timeblock_active                       = nullptr;
         bool m_render_pass_active                            = false;
         static bool m_memory_query_support;
         std::mutex m_mutex_reset;
         RHI_PipelineState m_pso;
         std::vector<ImageBarrierInfo> m_image_barriers;
+        RHI_StateTracker m_state_tracker;
+
+        // secondary command lists, one command pool per job since a pool can't be recorded into from multiple threads
+        bool m_is_secondary                       = false;
+        uint32_t m_secondary_index                = 0;
+        const RHI_CommandList* m_cmd_list_primary = nullptr;
+        std::vector<RHI_Descriptor> m_descriptors_inherited; // the descriptors the primary had bound when the secondaries began
+        std::vector<void*> m_rhi_cmd_pools_secondary;
+        std::vector<std::vector<std::shared_ptr<RHI_CommandList>>> m_cmd_lists_secondary;
 
         // rhi resources
         void* m_rhi_resource                       = nullptr;
         void* m_rhi_cmd_pool_resource              = nullptr;
         void* m_rhi_query_pool_timestamps          = nullptr;
         void* m_rhi_query_pool_pipeline_statistics = nullptr;
-        void* m_rhi_query_pool_occlusion           = nullptr;
     };
 }
@@ -228,6 +228,8 @@ namespace Spartan
         PosCol,
         PosUv,
         PosUvNorTan,
+        PosUvNorTanPacked,
+        PosUvNorTanPackedHalf,
         Pos2dUvCol8,
         Max
     };
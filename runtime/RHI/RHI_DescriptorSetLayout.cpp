@@ -118,6 +118,30 @@ namespace Spartan
         }
     }
 
+    void RHI_DescriptorSetLayout::SetDescriptors(const vector<RHI_Descriptor>& descriptors)
+    {
+        for (const RHI_Descriptor& descriptor_source : descriptors)
+        {
+            if (!descriptor_source.data)
+                continue;
+
+            for (RHI_Descriptor& descriptor : m_descriptors)
+            {
+                if (descriptor.slot == descriptor_source.slot && descriptor.type == descriptor_source.type)
+                {
+                    descriptor.data           = descriptor_source.data;
+                    descriptor.layout         = descriptor_source.layout;
+                    descriptor.mip            = descriptor_source.mip;
+                    descriptor.mip_range      = descriptor_source.mip_range;
+                    descriptor.range          = descriptor_source.range;
+                    descriptor.dynamic_offset = descriptor_source.dynamic_offset;
+
+                    break;
+                }
+            }
+        }
+    }
+
     void RHI_DescriptorSetLayout::ClearDescriptorData()
     {
         for (RHI_Descriptor& descriptor : m_descriptors)
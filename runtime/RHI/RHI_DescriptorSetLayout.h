@@ -50,6 +50,9 @@ namespace Spartan
         void SetSampler(const uint32_t slot, RHI_Sampler* sampler);
         void SetTexture(const uint32_t slot, RHI_Texture* texture, const uint32_t mip_index, const uint32_t mip_range);
 
+        // copies the resources of the given descriptors into the descriptors of this layout that share their slot and type
+        void SetDescriptors(const std::vector<RHI_Descriptor>& descriptors);
+
         // dynamic offsets
         void GetDynamicOffsets(std::array<uint32_t, 10>* offsets, uint32_t* count);
 
@@ -45,6 +45,7 @@ namespace Spartan
     uint32_t RHI_Device::m_max_shading_rate_texel_size_y        = 0;
     uint64_t RHI_Device::m_optimal_buffer_copy_offset_alignment = 0;
     bool RHI_Device::m_is_shading_rate_supported                = false;
+    bool RHI_Device::m_is_draw_indirect_count_supported         = false;
 
     // misc
     bool RHI_Device::m_wide_lines                 = false;
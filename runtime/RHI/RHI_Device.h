@@ -91,6 +91,7 @@ namespace Spartan
         static uint32_t PropertyGetMaxShadingRateTexelSizeY()         { return m_max_shading_rate_texel_size_y; }
         static uint64_t PropertyGetOptimalBufferCopyOffsetAlignment() { return m_optimal_buffer_copy_offset_alignment; }
         static bool PropertyIsShadingRateSupported()                  { return m_is_shading_rate_supported; }
+        static bool PropertyIsDrawIndirectCountSupported()            { return m_is_draw_indirect_count_supported; }
 
         // markers
         static void MarkerBegin(RHI_CommandList* cmd_list, const char* name, const Math::Vector4& color);
@@ -125,6 +126,7 @@ namespace Spartan
         static uint32_t m_max_shading_rate_texel_size_y;
         static uint64_t m_optimal_buffer_copy_offset_alignment;
         static bool m_is_shading_rate_supported;
+        static bool m_is_draw_indirect_count_supported;
 
         // misc
         static bool m_wide_lines;
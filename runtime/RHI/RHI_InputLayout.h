@@ -118,6 +118,28 @@ namespace Spartan
 
                 m_vertex_size = sizeof(RHI_Vertex_PosTexNorTan);
             }
+            else if (vertex_type == RHI_Vertex_Type::PosUvNorTanPacked)
+            {
+                m_vertex_attributes =
+                {
+                    { "POSITION", 0, binding, RHI_Format::R32G32B32_Float,    offsetof(RHI_Vertex_PosTexNorTanPacked, pos) },
+                    { "TEXCOORD", 1, binding, RHI_Format::R16G16_Float,       offsetof(RHI_Vertex_PosTexNorTanPacked, tex) },
+                    { "NORMAL",   2, binding, RHI_Format::R16G16B16A16_Snorm, offsetof(RHI_Vertex_PosTexNorTanPacked, nor_tan) }
+                };
+
+                m_vertex_size = sizeof(RHI_Vertex_PosTexNorTanPacked);
+            }
+            else if (vertex_type == RHI_Vertex_Type::PosUvNorTanPackedHalf)
+            {
+                m_vertex_attributes =
+                {
+                    { "POSITION", 0, binding, RHI_Format::R16G16B16A16_Float, offsetof(RHI_Vertex_PosTexNorTanPackedHalf, pos) },
+                    { "TEXCOORD", 1, binding, RHI_Format::R16G16_Float,       offsetof(RHI_Vertex_PosTexNorTanPackedHalf, tex) },
+                    { "NORMAL",   2, binding, RHI_Format::R16G16B16A16_Snorm, offsetof(RHI_Vertex_PosTexNorTanPackedHalf, nor_tan) }
+                };
+
+                m_vertex_size = sizeof(RHI_Vertex_PosTexNorTanPackedHalf);
+            }
         }
 
         RHI_Vertex_Type GetVertexType()                                const { return m_vertex_type; }
@@ -0,0 +1,150 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+//= INCLUDES ==============
+#include <array>
+#include <cstring>
+#include "RHI_Definitions.h"
+//=========================
+
+namespace Spartan
+{
+    // shadows the state which has been recorded into a command list so that redundant commands can be dropped
+    // before they reach the graphics api, every setter returns true if the command changes the state and has to be recorded
+    // it's backend agnostic and it doesn't touch any gpu objects, so it can be driven by a mock backend without a gpu
+    class RHI_StateTracker
+    {
+    public:
+        // everything is undefined at the start of a command buffer and after executing secondary command buffers
+        void Invalidate()
+        {
+            *this = RHI_StateTracker();
+        }
+
+        bool SetPipeline(const void* pipeline, const void* pipeline_layout)
+        {
+            // descriptor sets and push constants only survive pipelines which share the layout
+            if (pipeline_layout != m_pipeline_layout)
+            {
+                m_descriptor_sets.fill(nullptr);
+                m_push_constants_size = 0;
+                m_pipeline_layout     = pipeline_layout;
+            }
+
+            return set(m_pipeline, pipeline);
+        }
+
+        bool SetCullMode(const RHI_CullMode cull_mode)
+        {
+            return set(m_cull_mode, cull_mode);
+        }
+
+        bool SetViewport(const float x, const float y, const float width, const float height, const float depth_min, const float depth_max)
+        {
+            return set(m_viewport, std::array<float, 6>{ x, y, width, height, depth_min, depth_max });
+        }
+
+        bool SetScissor(const float left, const float top, const float right, const float bottom)
+        {
+            return set(m_scissor, std::array<float, 4>{ left, top, right, bottom });
+        }
+
+        bool SetVertexBuffer(const uint32_t binding, const uint64_t buffer_id)
+        {
+            if (binding >= static_cast<uint32_t>(m_buffer_id_vertex.size()))
+                return true;
+
+            return set(m_buffer_id_vertex[binding], buffer_id);
+        }
+
+        bool SetIndexBuffer(const uint64_t buffer_id)
+        {
+            return set(m_buffer_id_index, buffer_id);
+        }
+
+        bool SetDescriptorSet(const uint32_t set_index, const void* descriptor_set, const uint32_t* dynamic_offsets = nullptr, const uint32_t dynamic_offset_count = 0)
+        {
+            if (set_index >= static_cast<uint32_t>(m_descriptor_sets.size()) || dynamic_offset_count > static_cast<uint32_t>(m_dynamic_offsets.size()))
+                return true;
+
+            bool offsets_equal = dynamic_offset_count == m_dynamic_offset_counts[set_index] &&
+                                 (dynamic_offset_count == 0 || memcmp(m_dynamic_offsets[set_index].data(), dynamic_offsets, dynamic_offset_count * sizeof(uint32_t)) == 0);
+
+            if (descriptor_set != nullptr && m_descriptor_sets[set_index] == descriptor_set && offsets_equal)
+                return false;
+
+            m_descriptor_sets[set_index]       = descriptor_set;
+            m_dynamic_offset_counts[set_index] = dynamic_offset_count;
+            if (dynamic_offset_count != 0)
+            {
+                memcpy(m_dynamic_offsets[set_index].data(), dynamic_offsets, dynamic_offset_count * sizeof(uint32_t));
+            }
+
+            return true;
+        }
+
+        bool PushConstants(const uint32_t offset, const uint32_t size, const void* data)
+        {
+            // only whole ranges which are identical to the previous push are dropped
+            if (size > static_cast<uint32_t>(m_push_constants.size()))
+            {
+                m_push_constants_size = 0;
+                return true;
+            }
+
+            if (size == m_push_constants_size && offset == m_push_constants_offset && memcmp(m_push_constants.data(), data, size) == 0)
+                return false;
+
+            memcpy(m_push_constants.data(), data, size);
+            m_push_constants_offset = offset;
+            m_push_constants_size   = size;
+
+            return true;
+        }
+
+    private:
+        template<typename T>
+        static bool set(T& current, const T& requested)
+        {
+            if (current == requested)
+                return false;
+
+            current = requested;
+            return true;
+        }
+
+        const void* m_pipeline                                    = nullptr;
+        const void* m_pipeline_layout                             = nullptr;
+        RHI_CullMode m_cull_mode                                  = RHI_CullMode::Max;
+        uint64_t m_buffer_id_index                                = 0;
+        std::array<uint64_t, 2> m_buffer_id_vertex                = {};                            // vertices and instances
+        std::array<float, 6> m_viewport                           = { 0.0f, 0.0f, -1.0f, -1.0f };  // a negative extent is never requested
+        std::array<float, 4> m_scissor                            = { 0.0f, 0.0f, -1.0f, -1.0f };
+        std::array<const void*, 4> m_descriptor_sets              = {};
+        std::array<uint32_t, 4> m_dynamic_offset_counts           = {};
+        std::array<std::array<uint32_t, 10>, 4> m_dynamic_offsets = {};
+        std::array<uint8_t, 256> m_push_constants                 = {};
+        uint32_t m_push_constants_offset                          = 0;
+        uint32_t m_push_constants_size                            = 0;
+    };
+}
@@ -127,9 +127,28 @@ namespace Spartan
         float tan[3] = { 0, 0, 0 };
     };
 
+    // compact variants of RHI_Vertex_PosTexNorTan which only exist on the gpu, the uv is half precision
+    // and the normal and the tangent are octahedral encoded into two snorm16 components each
+    struct RHI_Vertex_PosTexNorTanPacked
+    {
+        float pos[3] = { 0, 0, 0 };
+        uint16_t tex[2] = { 0, 0 };
+        int16_t nor_tan[4] = { 0, 0, 0, 0 };
+    };
+
+    // same as above but with a half precision position, w is always one
+    struct RHI_Vertex_PosTexNorTanPackedHalf
+    {
+        uint16_t pos[4] = { 0, 0, 0, 0 };
+        uint16_t tex[2] = { 0, 0 };
+        int16_t nor_tan[4] = { 0, 0, 0, 0 };
+    };
+
     SP_ASSERT_STATIC_IS_TRIVIALLY_COPYABLE(RHI_Vertex_Pos);
     SP_ASSERT_STATIC_IS_TRIVIALLY_COPYABLE(RHI_Vertex_PosTex);
     SP_ASSERT_STATIC_IS_TRIVIALLY_COPYABLE(RHI_Vertex_PosCol);
     SP_ASSERT_STATIC_IS_TRIVIALLY_COPYABLE(RHI_Vertex_Pos2dTexCol8);
     SP_ASSERT_STATIC_IS_TRIVIALLY_COPYABLE(RHI_Vertex_PosTexNorTan);
+    SP_ASSERT_STATIC_IS_TRIVIALLY_COPYABLE(RHI_Vertex_PosTexNorTanPacked);
+    SP_ASSERT_STATIC_IS_TRIVIALLY_COPYABLE(RHI_Vertex_PosTexNorTanPackedHalf);
 }
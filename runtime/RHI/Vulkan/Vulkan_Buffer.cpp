@@ -58,22 +58,14 @@ namespace Spartan
             }
             else
             {
-                // create staging buffer, it's slower but we can copy data in and out of it
-                void* staging_buffer = nullptr;
-                RHI_Device::MemoryBufferCreate(staging_buffer, m_object_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, data, m_object_name.c_str());
-
-                // create destination buffer, it's faster but we can only copy data into it
-                RHI_Device::MemoryBufferCreate(m_rhi_resource, m_object_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | type, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, nullptr, m_object_name.c_str());
-
-                // copy staging buffer to destination buffer
-                VkBuffer* buffer_vk         = reinterpret_cast<VkBuffer*>(&m_rhi_resource);
-                VkBuffer* buffer_staging_vk = reinterpret_cast<VkBuffer*>(&staging_buffer);
-                VkBufferCopy copy_region    = {};
-                copy_region.size            = m_object_size;
-                RHI_CommandList* cmd_list   = RHI_Device::CmdImmediateBegin(RHI_Queue_Type::Copy);
-                vkCmdCopyBuffer(static_cast<VkCommandBuffer>(cmd_list->GetRhiResource()), *buffer_staging_vk, *buffer_vk, 1, &copy_region);
-                RHI_Device::CmdImmediateSubmit(cmd_list);
-                RHI_Device::MemoryBufferDestroy(staging_buffer);
+                // create destination buffer, it's faster but we can only copy data into it (and out of it, the geometry buffer moves ranges around)
+                RHI_Device::MemoryBufferCreate(m_rhi_resource, m_object_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | type, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, nullptr, m_object_name.c_str());
+
+                // sub-allocated buffers are created empty and filled with UpdateRange()
+                if (data)
+                {
+                    UpdateRange(data, 0, m_object_size);
+                }
             }
         }
         else if (m_type == RHI_Buffer_Type::Storage)
@@ -92,7 +84,7 @@ namespace Spartan
             {
                 flags_memory = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT; // mappable and flushless
             }
-            VkBufferUsageFlags flags_usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+            VkBufferUsageFlags flags_usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
             RHI_Device::MemoryBufferCreate(m_rhi_resource, m_object_size, flags_usage, flags_memory, nullptr, m_object_name.c_str());
         }
         else if (m_type == RHI_Buffer_Type::Constant)
@@ -115,6 +107,41 @@ namespace Spartan
         RHI_Device::SetResourceName(m_rhi_resource, RHI_Resource_Type::Buffer, m_object_name);
     }
 
+    void RHI_Buffer::UpdateRange(const void* data_cpu, const uint64_t offset, const uint64_t size)
+    {
+        SP_ASSERT_MSG(!m_mappable,                    "Mappable buffers are updated with Update()");
+        SP_ASSERT_MSG(data_cpu != nullptr,            "Invalid cpu data");
+        SP_ASSERT_MSG(offset + size <= m_object_size, "Out of bounds");
+
+        // create staging buffer, it's slower but we can copy data in and out of it
+        void* staging_buffer = nullptr;
+        RHI_Device::MemoryBufferCreate(staging_buffer, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, data_cpu, m_object_name.c_str());
+
+        // copy staging buffer to this buffer
+        VkBufferCopy copy_region  = {};
+        copy_region.dstOffset     = offset;
+        copy_region.size          = size;
+        RHI_CommandList* cmd_list = RHI_Device::CmdImmediateBegin(RHI_Queue_Type::Copy);
+        vkCmdCopyBuffer(static_cast<VkCommandBuffer>(cmd_list->GetRhiResource()), static_cast<VkBuffer>(staging_buffer), static_cast<VkBuffer>(m_rhi_resource), 1, &copy_region);
+        RHI_Device::CmdImmediateSubmit(cmd_list);
+        RHI_Device::MemoryBufferDestroy(staging_buffer);
+    }
+
+    void RHI_Buffer::CopyRange(RHI_Buffer* destination, const uint64_t offset_source, const uint64_t offset_destination, const uint64_t size)
+    {
+        SP_ASSERT(destination != nullptr);
+        SP_ASSERT_MSG(offset_source + size <= m_object_size && offset_destination + size <= destination->GetObjectSize(), "Out of bounds");
+        SP_ASSERT_MSG(destination != this || offset_source + size <= offset_destination || offset_destination + size <= offset_source, "Overlapping ranges");
+
+        VkBufferCopy copy_region  = {};
+        copy_region.srcOffset     = offset_source;
+        copy_region.dstOffset     = offset_destination;
+        copy_region.size          = size;
+        RHI_CommandList* cmd_list = RHI_Device::CmdImmediateBegin(RHI_Queue_Type::Copy);
+        vkCmdCopyBuffer(static_cast<VkCommandBuffer>(cmd_list->GetRhiResource()), static_cast<VkBuffer>(m_rhi_resource), static_cast<VkBuffer>(destination->GetRhiResource()), 1, &copy_region);
+        RHI_Device::CmdImmediateSubmit(cmd_list);
+    }
+
     void RHI_Buffer::Update(void* data_cpu, const uint32_t size)
     {
         SP_ASSERT_MSG(m_mappable,                           "Can't update unmappable buffer");
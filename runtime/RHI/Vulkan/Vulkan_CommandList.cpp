@@ -35,6 +35,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../RHI_DepthStencilState.h"
 #include "../Rendering/Renderer.h"
 #include "../../Profiling/Profiler.h"
+#include "../../Core/ThreadPool.h"
 //=====================================
 
 //= NAMESPACES ===============
@@ -371,19 +372,36 @@ namespace Spartan
 
     namespace descriptor_sets
     {
-        bool bind_dynamic = false;
+        // what a layout's current descriptors resolve to, resolving goes through the device's descriptor set cache
+        struct Dynamic
+        {
+            void* descriptor_set        = nullptr;
+            array<uint32_t, 10> offsets = {};
+            uint32_t offset_count       = 0;
+        };
 
-        void set_dynamic(const RHI_PipelineState pso, void* resource, void* pipeline_layout, RHI_DescriptorSetLayout* layout)
+        Dynamic get_dynamic(RHI_DescriptorSetLayout* layout)
+        {
+            Dynamic dynamic;
+            dynamic.descriptor_set = layout->GetDescriptorSet()->GetResource();
+            layout->GetDynamicOffsets(&dynamic.offsets, &dynamic.offset_count);
+
+            return dynamic;
+        }
+
+        void set_dynamic(const RHI_PipelineState& pso, void* resource, void* pipeline_layout, const Dynamic& dynamic, RHI_StateTracker& state_tracker)
         {
             array<void*, 1> resources =
             {
-                layout->GetDescriptorSet()->GetResource()
+                dynamic.descriptor_set
             };
 
-            // get dynamic offsets
-            array<uint32_t, 10> dynamic_offsets;
-            uint32_t dynamic_offset_count = 0;
-            layout->GetDynamicOffsets(&dynamic_offsets, &dynamic_offset_count);
+            // the descriptors changed on the cpu side but they resolved to the set (and offsets) which is already bound
+            if (!state_tracker.SetDescriptorSet(0, resources[0], dynamic.offsets.data(), dynamic.offset_count))
+            {
+                Profiler::m_rhi_elided_bindings_descriptor_set++;
+                return;
+            }
 
             VkPipelineBindPoint bind_point = pso.IsCompute() ? VkPipelineBindPoint::VK_PIPELINE_BIND_POINT_COMPUTE : VkPipelineBindPoint::VK_PIPELINE_BIND_POINT_GRAPHICS;
             vkCmdBindDescriptorSets
@@ -394,15 +412,19 @@ namespace Spartan
                 0,                                                    // firstSet
                 static_cast<uint32_t>(resources.size()),              // descriptorSetCount
                 reinterpret_cast<VkDescriptorSet*>(resources.data()), // pDescriptorSets
-                dynamic_offset_count,                                 // dynamicOffsetCount
-                dynamic_offsets.data()                                // pDynamicOffsets
+                dynamic.offset_count,                                 // dynamicOffsetCount
+                dynamic.offsets.data()                                // pDynamicOffsets
             );
 
-            bind_dynamic = false;
             Profiler::m_rhi_bindings_descriptor_set++;
         }
 
-        void set_bindless(const RHI_PipelineState pso, void* resource, void* pipeline_layout)
+        void set_dynamic(const RHI_PipelineState& pso, void* resource, void* pipeline_layout, RHI_DescriptorSetLayout* layout, RHI_StateTracker& state_tracker)
+        {
+            set_dynamic(pso, resource, pipeline_layout, get_dynamic(layout), state_tracker);
+        }
+
+        void set_bindless(const RHI_PipelineState& pso, void* resource, void* pipeline_layout, RHI_StateTracker& state_tracker)
         {
             array<void*, 3> resources =
             {
@@ -411,6 +433,19 @@ namespace Spartan
                 RHI_Device::GetDescriptorSet(RHI_Device_Resource::sampler_regular)
             };
 
+            // these only need to be bound again if the pipeline layout changed
+            bool changed = false;
+            for (uint32_t i = 0; i < static_cast<uint32_t>(resources.size()); i++)
+            {
+                changed = state_tracker.SetDescriptorSet(1 + i, resources[i]) || changed;
+            }
+
+            if (!changed)
+            {
+                Profiler::m_rhi_elided_bindings_descriptor_set++;
+                return;
+            }
+
             VkPipelineBindPoint bind_point = pso.IsCompute() ? VkPipelineBindPoint::VK_PIPELINE_BIND_POINT_COMPUTE : VkPipelineBindPoint::VK_PIPELINE_BIND_POINT_GRAPHICS;
             vkCmdBindDescriptorSets
             (
@@ -428,6 +463,13 @@ namespace Spartan
         }
     }
 
+    namespace secondary
+    {
+        // secondary command lists share the pipeline cache, the descriptor set layouts and the descriptor set cache,
+        // so getting a pipeline and resolving descriptors is serialized while they record, binding what was resolved isn't
+        mutex mutex_cache;
+    }
+
     namespace queries
     {
         namespace timestamp
@@ -461,36 +503,7 @@ namespace Spartan
             }
         }
 
-        namespace occlusion
-        {
-            uint32_t index              = 0;
-            uint32_t index_active       = 0;
-            bool occlusion_query_active = false;
-            const uint32_t query_count  = 4096;
-            array<uint64_t, query_count> data;
-            unordered_map<uint64_t, uint32_t> id_to_index;
-
-            void update(void* query_pool)
-            {
-                vkGetQueryPoolResults(
-                    RHI_Context::device,                                 // device
-                    static_cast<VkQueryPool>(query_pool),                // queryPool
-                    0,                                                   // firstQuery
-                    query_count,                                         // queryCount
-                    query_count * sizeof(uint64_t),                      // dataSize
-                    data.data(),                                         // pData
-                    sizeof(uint64_t),                                    // stride
-                    VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_PARTIAL_BIT // flags
-                );
-            }
-
-            void reset(void* cmd_list, void*& query_pool)
-            {
-                vkCmdResetQueryPool(static_cast<VkCommandBuffer>(cmd_list), static_cast<VkQueryPool>(query_pool), 0, query_count);
-            }
-        }
-
-        void initialize(void*& pool_timestamp, void*& pool_occlusion, void*& pool_pipeline_statistics)
+        void initialize(void*& pool_timestamp, void*& pool_pipeline_statistics)
         {
             // timestamps
             if (Profiler::IsGpuTimingEnabled())
@@ -506,39 +519,27 @@ namespace Spartan
 
                 timestamp::data.fill(0);
             }
-
-            // occlusion
-            {
-                VkQueryPoolCreateInfo query_pool_info = {};
-                query_pool_info.sType                 = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
-                query_pool_info.queryType             = VK_QUERY_TYPE_OCCLUSION;
-                query_pool_info.queryCount            = occlusion::query_count;
-
-                auto query_pool = reinterpret_cast<VkQueryPool*>(&pool_occlusion);
-                SP_ASSERT_VK_MSG(vkCreateQueryPool(RHI_Context::device, &query_pool_info, nullptr, query_pool), "Failed to created occlusion query pool");
-                RHI_Device::SetResourceName(pool_occlusion, RHI_Resource_Type::QueryPool, "query_pool_occlusion");
-
-                occlusion::data.fill(0);
-            }
         }
 
-        void shutdown(void*& pool_timestamp, void*& pool_occlusion, void*& pool_pipeline_statistics)
+        void shutdown(void*& pool_timestamp, void*& pool_pipeline_statistics)
         {
             RHI_Device::DeletionQueueAdd(RHI_Resource_Type::QueryPool, pool_timestamp);
-            RHI_Device::DeletionQueueAdd(RHI_Resource_Type::QueryPool, pool_occlusion);
             RHI_Device::DeletionQueueAdd(RHI_Resource_Type::QueryPool, pool_pipeline_statistics);
         }
     }
 
-    RHI_CommandList::RHI_CommandList(void* cmd_pool, const char* name)
+    RHI_CommandList::RHI_CommandList(void* cmd_pool, const char* name, const bool is_secondary /*= false*/)
     {
+        m_is_secondary          = is_secondary;
+        m_rhi_cmd_pool_resource = cmd_pool;
+
         // command buffer
         {
             // define
             VkCommandBufferAllocateInfo allocate_info = {};
             allocate_info.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
             allocate_info.commandPool                 = static_cast<VkCommandPool>(cmd_pool);
-            allocate_info.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocate_info.level                       = is_secondary ? VK_COMMAND_BUFFER_LEVEL_SECONDARY : VK_COMMAND_BUFFER_LEVEL_PRIMARY;
             allocate_info.commandBufferCount          = 1;
 
             // allocate
@@ -549,16 +550,30 @@ namespace Spartan
             RHI_Device::SetResourceName(static_cast<void*>(m_rhi_resource), RHI_Resource_Type::CommandList, name);
         }
 
+        // secondary command lists are never submitted and they don't own queries
+        if (is_secondary)
+            return;
+
         // semaphores
         m_rendering_complete_semaphore          = make_shared<RHI_Semaphore>(false, name);
         m_rendering_complete_semaphore_timeline = make_shared<RHI_Semaphore>(true, name);
 
-        queries::initialize(m_rhi_query_pool_timestamps, m_rhi_query_pool_occlusion, m_rhi_query_pool_pipeline_statistics);
+        queries::initialize(m_rhi_query_pool_timestamps, m_rhi_query_pool_pipeline_statistics);
     }
 
     RHI_CommandList::~RHI_CommandList()
     {
-        queries::shutdown(m_rhi_query_pool_timestamps, m_rhi_query_pool_occlusion, m_rhi_query_pool_pipeline_statistics);
+        if (m_is_secondary)
+            return;
+
+        // destroying a pool frees the command buffers which were allocated from it
+        m_cmd_lists_secondary.clear();
+        for (void* cmd_pool : m_rhi_cmd_pools_secondary)
+        {
+            vkDestroyCommandPool(RHI_Context::device, static_cast<VkCommandPool>(cmd_pool), nullptr);
+        }
+
+        queries::shutdown(m_rhi_query_pool_timestamps, m_rhi_query_pool_pipeline_statistics);
     }
 
     void RHI_CommandList::Begin(const RHI_Queue* queue)
@@ -573,10 +588,18 @@ namespace Spartan
         begin_info.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
         SP_ASSERT_MSG(vkBeginCommandBuffer(static_cast<VkCommandBuffer>(m_rhi_resource), &begin_info) == VK_SUCCESS, "Failed to begin command buffer");
 
+        // the previous execution of this command list has completed (the queue waits before handing it out)
+        // so the secondary command lists it executed can be reset as well
+        for (void* cmd_pool : m_rhi_cmd_pools_secondary)
+        {
+            SP_ASSERT_VK_MSG(vkResetCommandPool(RHI_Context::device, static_cast<VkCommandPool>(cmd_pool), 0), "Failed to reset command pool");
+        }
+        m_secondary_index = 0;
+
         // set states
-        m_state        = RHI_CommandListState::Recording;
-        m_pso          = RHI_PipelineState();
-        m_cull_mode    = RHI_CullMode::Max;
+        m_state = RHI_CommandListState::Recording;
+        m_pso   = RHI_PipelineState();
+        m_state_tracker.Invalidate();
 
         // set dynamic states
         if (queue->GetType() == RHI_Queue_Type::Graphics)
@@ -605,7 +628,6 @@ namespace Spartan
             // also need to be reset after every use, so we just reset them always
             m_timestamp_index = 0;
             queries::timestamp::reset(m_rhi_resource, m_rhi_query_pool_timestamps);
-            queries::occlusion::reset(m_rhi_resource, m_rhi_query_pool_occlusion);
         }
     }
 
@@ -644,9 +666,20 @@ namespace Spartan
         if (m_pso.GetHash() == pso.GetHash())
             return;
 
+        // secondary command lists can be recorded in parallel
+        SP_ASSERT_MSG(!m_is_secondary || pso.IsGraphics(), "Secondary command lists can only record draws within the render pass they inherit");
+
         // get (or create) a pipeline which matches the requested pipeline state
         m_pso = pso;
-        RHI_Device::GetOrCreatePipeline(m_pso, m_pipeline, m_descriptor_layout_current);
+        {
+            unique_lock<mutex> lock(secondary::mutex_cache, defer_lock);
+            if (m_is_secondary)
+            {
+                lock.lock();
+            }
+
+            RHI_Device::GetOrCreatePipeline(m_pso, m_pipeline, m_descriptor_layout_current);
+        }
 
         // bind pipeline
         {
@@ -655,12 +688,17 @@ namespace Spartan
             VkPipeline vk_pipeline = static_cast<VkPipeline>(m_pipeline->GetResource_Pipeline());
             SP_ASSERT(vk_pipeline != nullptr);
 
-            // bind
-            VkPipelineBindPoint pipeline_bind_point = m_pso.IsCompute() ? VK_PIPELINE_BIND_POINT_COMPUTE : VK_PIPELINE_BIND_POINT_GRAPHICS;
-            vkCmdBindPipeline(static_cast<VkCommandBuffer>(m_rhi_resource), pipeline_bind_point, vk_pipeline);
-
-            // profile
-            Profiler::m_rhi_pipeline_bindings++;
+            // bind, different pipeline states (e.g. render targets or clear values) can resolve to the same pipeline
+            if (m_state_tracker.SetPipeline(vk_pipeline, m_pipeline->GetResource_PipelineLayout()))
+            {
+                VkPipelineBindPoint pipeline_bind_point = m_pso.IsCompute() ? VK_PIPELINE_BIND_POINT_COMPUTE : VK_PIPELINE_BIND_POINT_GRAPHICS;
+                vkCmdBindPipeline(static_cast<VkCommandBuffer>(m_rhi_resource), pipeline_bind_point, vk_pipeline);
+                Profiler::m_rhi_pipeline_bindings++;
+            }
+            else
+            {
+                Profiler::m_rhi_elided_pipeline_bindings++;
+            }
 
             // set some dynamic states
             if (m_pso.IsGraphics())
@@ -678,27 +716,207 @@ namespace Spartan
                 scissor_rect.right  = static_cast<float>(m_pso.GetWidth());
                 scissor_rect.bottom = static_cast<float>(m_pso.GetHeight());
                 SetScissorRectangle(scissor_rect);
-
-                // vertex and index buffer state
-                m_buffer_id_index  = 0;
-                m_buffer_id_vertex = 0;
             }
         }
 
         // bind descriptors
         {
             // set bindless descriptors
-            descriptor_sets::set_bindless(m_pso, m_rhi_resource, m_pipeline->GetResource_PipelineLayout());
+            descriptor_sets::set_bindless(m_pso, m_rhi_resource, m_pipeline->GetResource_PipelineLayout(), m_state_tracker);
 
-            // set standard resources (dynamic descriptors)
-            Renderer::SetStandardResources(this);
-            descriptor_sets::set_dynamic(m_pso, m_rhi_resource, m_pipeline->GetResource_PipelineLayout(), m_descriptor_layout_current);
+            // set standard resources (dynamic descriptors), secondaries take them from the primary since the renderer state they come from isn't thread safe
+            descriptor_sets::Dynamic dynamic;
+            if (m_is_secondary)
+            {
+                // the layout is shared, so filling it and resolving it to a descriptor set can't be interleaved with another secondary
+                lock_guard<mutex> lock(secondary::mutex_cache);
+                m_descriptor_layout_current->SetDescriptors(m_cmd_list_primary->m_descriptors_inherited);
+                dynamic = descriptor_sets::get_dynamic(m_descriptor_layout_current);
+            }
+            else
+            {
+                Renderer::SetStandardResources(this);
+                dynamic = descriptor_sets::get_dynamic(m_descriptor_layout_current);
+            }
+            descriptor_sets::set_dynamic(m_pso, m_rhi_resource, m_pipeline->GetResource_PipelineLayout(), dynamic, m_state_tracker);
+            m_bind_dynamic = false;
         }
 
-        RenderPassBegin();
+        // secondary command lists draw within the render pass of the primary
+        if (!m_is_secondary)
+        {
+            RenderPassBegin();
+        }
     }
 
-    void RHI_CommandList::RenderPassBegin()
+    void RHI_CommandList::RecordParallel(RHI_PipelineState& pso, const uint32_t job_count, const function<void(RHI_CommandList* cmd_list, const uint32_t job_index)>& record)
+    {
+        SP_ASSERT(m_state == RHI_CommandListState::Recording);
+        SP_ASSERT_MSG(!m_is_secondary, "Secondary command lists can't record in parallel");
+        SP_ASSERT_MSG(pso.IsGraphics() && pso.render_target_swapchain == nullptr, "Parallel recording is only supported for render passes with texture render targets");
+
+        // bind the pipeline, transition the render targets and clear them
+        SetPipelineState(pso);
+
+        // a single job doesn't justify secondary command lists
+        if (job_count <= 1)
+        {
+            record(this, 0);
+            return;
+        }
+
+        // grow the pools and the secondary command lists, a pool per job and a secondary command list per parallel recording
+        while (m_rhi_cmd_pools_secondary.size() < job_count)
+        {
+            VkCommandPoolCreateInfo cmd_pool_info = {};
+            cmd_pool_info.sType                   = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            cmd_pool_info.queueFamilyIndex        = RHI_Device::QueueGetIndex(RHI_Queue_Type::Graphics);
+            cmd_pool_info.flags                   = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+            VkCommandPool cmd_pool = nullptr;
+            SP_ASSERT_VK_MSG(vkCreateCommandPool(RHI_Context::device, &cmd_pool_info, nullptr, &cmd_pool), "Failed to create command pool");
+            RHI_Device::SetResourceName(cmd_pool, RHI_Resource_Type::CommandPool, "cmd_pool_secondary_" + to_string(m_rhi_cmd_pools_secondary.size()));
+
+            m_rhi_cmd_pools_secondary.emplace_back(static_cast<void*>(cmd_pool));
+            m_cmd_lists_secondary.emplace_back();
+        }
+
+        for (uint32_t i = 0; i < job_count; i++)
+        {
+            vector<shared_ptr<RHI_CommandList>>& cmd_lists = m_cmd_lists_secondary[i];
+            while (cmd_lists.size() <= m_secondary_index)
+            {
+                string name = "cmd_list_secondary_" + to_string(i) + "_" + to_string(cmd_lists.size());
+                cmd_lists.emplace_back(make_shared<RHI_CommandList>(m_rhi_cmd_pools_secondary[i], name.c_str(), true));
+            }
+        }
+
+        // restart the render pass so that its contents come from secondary command lists
+        RenderPassBegin(true);
+
+        // snapshot the descriptors bound by the primary, the secondaries inherit them instead of touching renderer state from worker threads
+        m_descriptors_inherited = m_descriptor_layout_current->GetDescriptors();
+
+        // begin the secondary command lists, this is cheap and it touches shared descriptor state, so it's done here
+        for (uint32_t i = 0; i < job_count; i++)
+        {
+            m_cmd_lists_secondary[i][m_secondary_index]->BeginSecondary(this);
+        }
+
+        // record
+        ThreadPool::ParallelLoop([this, &record](uint32_t start, uint32_t end)
+        {
+            for (uint32_t i = start; i < end; i++)
+            {
+                record(m_cmd_lists_secondary[i][m_secondary_index].get(), i);
+            }
+        }, job_count, 1);
+
+        // end the secondary command lists and execute them in order
+        array<VkCommandBuffer, 64> cmd_buffers;
+        SP_ASSERT(job_count <= static_cast<uint32_t>(cmd_buffers.size()));
+        for (uint32_t i = 0; i < job_count; i++)
+        {
+            RHI_CommandList* cmd_list = m_cmd_lists_secondary[i][m_secondary_index].get();
+            cmd_list->EndSecondary();
+            cmd_buffers[i] = static_cast<VkCommandBuffer>(cmd_list->GetRhiResource());
+        }
+        vkCmdExecuteCommands(static_cast<VkCommandBuffer>(m_rhi_resource), job_count, cmd_buffers.data());
+        RenderPassEnd();
+        m_secondary_index++;
+
+        // the state that the secondaries bound is undefined once they have been executed, so force a rebind of everything
+        m_pso = RHI_PipelineState();
+        m_state_tracker.Invalidate();
+    }
+
+    void RHI_CommandList::BeginSecondary(RHI_CommandList* primary)
+    {
+        SP_ASSERT(m_is_secondary);
+
+        // inherit the state of the primary
+        m_cmd_list_primary          = primary;
+        m_pso                       = primary->m_pso;
+        m_pipeline                  = primary->m_pipeline;
+        m_descriptor_layout_current = primary->m_descriptor_layout_current;
+        m_ignore_clear_values       = true;
+        m_state_tracker.Invalidate();
+
+        // attachment formats of the render pass that is continued
+        array<VkFormat, rhi_max_render_target_count> formats_color = {};
+        uint32_t format_color_count = 0;
+        for (uint32_t i = 0; i < rhi_max_render_target_count; i++)
+        {
+            RHI_Texture* rt = m_pso.render_target_color_textures[i];
+            if (rt == nullptr)
+                break;
+
+            formats_color[format_color_count++] = vulkan_format[rhi_format_to_index(rt->GetFormat())];
+        }
+
+        VkFormat format_depth   = VK_FORMAT_UNDEFINED;
+        VkFormat format_stencil = VK_FORMAT_UNDEFINED;
+        if (RHI_Texture* rt = m_pso.render_target_depth_texture)
+        {
+            format_depth   = vulkan_format[rhi_format_to_index(rt->GetFormat())];
+            format_stencil = rt->IsStencilFormat() ? format_depth : VK_FORMAT_UNDEFINED;
+        }
+
+        VkCommandBufferInheritanceRenderingInfo inheritance_rendering = {};
+        inheritance_rendering.sType                                   = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+        inheritance_rendering.colorAttachmentCount                    = format_color_count;
+        inheritance_rendering.pColorAttachmentFormats                 = formats_color.data();
+        inheritance_rendering.depthAttachmentFormat                   = format_depth;
+        inheritance_rendering.stencilAttachmentFormat                 = format_stencil;
+        inheritance_rendering.rasterizationSamples                    = VK_SAMPLE_COUNT_1_BIT;
+
+        VkCommandBufferInheritanceInfo inheritance_info = {};
+        inheritance_info.sType                          = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritance_info.pNext                          = &inheritance_rendering;
+
+        VkCommandBufferBeginInfo begin_info = {};
+        begin_info.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        begin_info.pInheritanceInfo         = &inheritance_info;
+        SP_ASSERT_VK_MSG(vkBeginCommandBuffer(static_cast<VkCommandBuffer>(m_rhi_resource), &begin_info), "Failed to begin secondary command buffer");
+
+        m_state              = RHI_CommandListState::Recording;
+        m_render_pass_active = true;
+
+        // nothing is inherited from the primary on the gpu side, so bind the pipeline, the descriptors and the dynamic states
+        m_state_tracker.SetPipeline(m_pipeline->GetResource_Pipeline(), m_pipeline->GetResource_PipelineLayout());
+        vkCmdBindPipeline(static_cast<VkCommandBuffer>(m_rhi_resource), VK_PIPELINE_BIND_POINT_GRAPHICS, static_cast<VkPipeline>(m_pipeline->GetResource_Pipeline()));
+        Profiler::m_rhi_pipeline_bindings++;
+
+        descriptor_sets::set_bindless(m_pso, m_rhi_resource, m_pipeline->GetResource_PipelineLayout(), m_state_tracker);
+        descriptor_sets::set_dynamic(m_pso, m_rhi_resource, m_pipeline->GetResource_PipelineLayout(), m_descriptor_layout_current, m_state_tracker);
+
+        SetCullMode(m_pso.rasterizer_state->GetPolygonMode() == RHI_PolygonMode::Wireframe ? RHI_CullMode::None : RHI_CullMode::Back);
+
+        Math::Rectangle scissor_rect;
+        scissor_rect.left   = 0.0f;
+        scissor_rect.top    = 0.0f;
+        scissor_rect.right  = static_cast<float>(m_pso.GetWidth());
+        scissor_rect.bottom = static_cast<float>(m_pso.GetHeight());
+        SetScissorRectangle(scissor_rect);
+
+        SetViewport(RHI_Viewport(0.0f, 0.0f, static_cast<float>(m_pso.GetWidth()), static_cast<float>(m_pso.GetHeight())));
+        RHI_Device::SetVariableRateShading(this, m_pso.vrs_input_texture != nullptr);
+    }
+
+    void RHI_CommandList::EndSecondary()
+    {
+        SP_ASSERT(m_is_secondary);
+        SP_ASSERT_MSG(m_image_barriers.empty(), "Secondary command lists can't insert barriers");
+
+        // the render pass belongs to the primary
+        m_render_pass_active = false;
+
+        SP_ASSERT_VK_MSG(vkEndCommandBuffer(static_cast<VkCommandBuffer>(m_rhi_resource)), "Failed to end secondary command buffer");
+        m_state = RHI_CommandListState::Idle;
+    }
+
+    void RHI_CommandList::RenderPassBegin(const bool secondary_contents /*= false*/)
     {
         SP_ASSERT(m_state == RHI_CommandListState::Recording);
         RenderPassEnd();
@@ -708,6 +926,7 @@ namespace Spartan
 
         VkRenderingInfo rendering_info      = {};
         rendering_info.sType                = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+        rendering_info.flags                = secondary_contents ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0;
         rendering_info.renderArea           = { 0, 0, m_pso.GetWidth(), m_pso.GetHeight() };
         rendering_info.layerCount           = 1;
         rendering_info.colorAttachmentCount = 0;
@@ -818,7 +1037,8 @@ namespace Spartan
         InsertPendingBarrierGroup();
         vkCmdBeginRendering(static_cast<VkCommandBuffer>(m_rhi_resource), &rendering_info);
 
-        // set dynamic states
+        // set dynamic states (secondary command lists set their own)
+        if (!secondary_contents)
         {
             // variable rate shading
             RHI_Device::SetVariableRateShading(this, m_pso.vrs_input_texture != nullptr);
@@ -841,6 +1061,8 @@ namespace Spartan
         if (!m_render_pass_active)
             return;
 
+        SP_ASSERT_MSG(!m_is_secondary, "Secondary command lists can't end the render pass they inherit");
+
         vkCmdEndRendering(static_cast<VkCommandBuffer>(m_rhi_resource));
         m_render_pass_active = false;
 
@@ -992,6 +1214,25 @@ namespace Spartan
         Profiler::m_rhi_draw++;
     }
 
+    void RHI_CommandList::DrawIndexedIndirectCount(RHI_Buffer* buffer_arguments, const uint32_t arguments_offset, RHI_Buffer* buffer_count, const uint32_t count_offset, const uint32_t draw_count_max)
+    {
+        SP_ASSERT(m_state == RHI_CommandListState::Recording);
+        SP_ASSERT(buffer_arguments != nullptr && buffer_count != nullptr);
+
+        PreDraw();
+
+        vkCmdDrawIndexedIndirectCount(
+            static_cast<VkCommandBuffer>(m_rhi_resource),               // commandBuffer
+            static_cast<VkBuffer>(buffer_arguments->GetRhiResource()), // buffer
+            arguments_offset,                                          // offset
+            static_cast<VkBuffer>(buffer_count->GetRhiResource()),     // countBuffer
+            count_offset,                                              // countBufferOffset
+            draw_count_max,                                            // maxDrawCount
+            sizeof(VkDrawIndexedIndirectCommand)                       // stride
+        );
+        Profiler::m_rhi_draw++;
+    }
+
     void RHI_CommandList::Dispatch(uint32_t x, uint32_t y, uint32_t z /*= 1*/)
     {
         SP_ASSERT(m_state == RHI_CommandListState::Recording);
@@ -1139,23 +1380,25 @@ namespace Spartan
         SP_ASSERT(source->GetWidth() == destination->GetWidth());
         SP_ASSERT(source->GetHeight() == destination->GetHeight());
         SP_ASSERT(source->GetFormat() == destination->GetFormat());
+        SP_ASSERT(source->GetArrayLength() == destination->GetArrayLength());
         if (blit_mips)
         {
             SP_ASSERT_MSG(source->GetMipCount() == destination->GetMipCount(),
                 "If the mips are blitted, then the mip count between the source and the destination textures must match");
         }
 
+        // all array slices are copied
         array<VkImageCopy, rhi_max_mip_count> copy_regions = {};
         uint32_t copy_region_count                         = blit_mips ? source->GetMipCount() : 1;
         for (uint32_t mip_index = 0; mip_index < copy_region_count; mip_index++)
         {
             VkImageCopy& copy_region              = copy_regions[mip_index];
-            copy_region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            copy_region.srcSubresource.aspectMask = get_aspect_mask(source);
             copy_region.srcSubresource.mipLevel   = mip_index;
-            copy_region.srcSubresource.layerCount = 1;
-            copy_region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            copy_region.srcSubresource.layerCount = source->GetArrayLength();
+            copy_region.dstSubresource.aspectMask = get_aspect_mask(destination);
             copy_region.dstSubresource.mipLevel   = mip_index;
-            copy_region.dstSubresource.layerCount = 1;
+            copy_region.dstSubresource.layerCount = destination->GetArrayLength();
             copy_region.extent.width              = source->GetWidth()  >> mip_index;
             copy_region.extent.height             = source->GetHeight() >> mip_index;
             copy_region.extent.depth              = 1;
@@ -1228,12 +1471,18 @@ namespace Spartan
         destination->SetLayout(RHI_Image_Layout::Present_Source, this);
     }
 
-    void RHI_CommandList::SetViewport(const RHI_Viewport& viewport) const
+    void RHI_CommandList::SetViewport(const RHI_Viewport& viewport)
     {
         SP_ASSERT(m_state == RHI_CommandListState::Recording);
         SP_ASSERT(viewport.width != 0);
         SP_ASSERT(viewport.height != 0);
 
+        if (!m_state_tracker.SetViewport(viewport.x, viewport.y, viewport.width, viewport.height, viewport.depth_min, viewport.depth_max))
+        {
+            Profiler::m_rhi_elided_dynamic_states++;
+            return;
+        }
+
         VkViewport vk_viewport = {};
         vk_viewport.x          = viewport.x;
         vk_viewport.y          = viewport.y;
@@ -1248,12 +1497,19 @@ namespace Spartan
             1,                                            // viewportCount
             &vk_viewport                                  // pViewports
         );
+        Profiler::m_rhi_dynamic_states++;
     }
 
-    void RHI_CommandList::SetScissorRectangle(const Math::Rectangle& scissor_rectangle) const
+    void RHI_CommandList::SetScissorRectangle(const Math::Rectangle& scissor_rectangle)
     {
         SP_ASSERT(m_state == RHI_CommandListState::Recording);
 
+        if (!m_state_tracker.SetScissor(scissor_rectangle.left, scissor_rectangle.top, scissor_rectangle.right, scissor_rectangle.bottom))
+        {
+            Profiler::m_rhi_elided_dynamic_states++;
+            return;
+        }
+
         VkRect2D vk_scissor;
         vk_scissor.offset.x      = static_cast<int32_t>(scissor_rectangle.left);
         vk_scissor.offset.y      = static_cast<int32_t>(scissor_rectangle.top);
@@ -1271,14 +1527,18 @@ namespace Spartan
     void RHI_CommandList::SetCullMode(const RHI_CullMode cull_mode)
     {
         SP_ASSERT(m_state == RHI_CommandListState::Recording);
-        if (m_cull_mode == cull_mode)
+
+        if (!m_state_tracker.SetCullMode(cull_mode))
+        {
+            Profiler::m_rhi_elided_dynamic_states++;
             return;
+        }
 
-        m_cull_mode = cull_mode;
         vkCmdSetCullMode(
             static_cast<VkCommandBuffer>(m_rhi_resource),
-            vulkan_cull_mode[static_cast<uint32_t>(m_cull_mode)]
+            vulkan_cull_mode[static_cast<uint32_t>(cull_mode)]
         );
+        Profiler::m_rhi_dynamic_states++;
     }
 
     void RHI_CommandList::SetBufferVertex(const RHI_Buffer* buffer, const uint32_t binding /*= 0*/)
@@ -1287,8 +1547,11 @@ namespace Spartan
         SP_ASSERT(buffer != nullptr);
         SP_ASSERT(buffer->GetRhiResource() != nullptr);
 
-        if (m_buffer_id_vertex == buffer->GetObjectId())
+        if (!m_state_tracker.SetVertexBuffer(binding, buffer->GetObjectId()))
+        {
+            Profiler::m_rhi_elided_bindings_buffer_vertex++;
             return;
+        }
 
         VkBuffer vertex_buffers[] = { static_cast<VkBuffer>(buffer->GetRhiResource()) };
         VkDeviceSize offsets[]    = { 0 };
@@ -1301,7 +1564,6 @@ namespace Spartan
             offsets                                       // pOffsets
         );
 
-        m_buffer_id_vertex = buffer->GetObjectId();
         Profiler::m_rhi_bindings_buffer_vertex++;
     }
 
@@ -1311,8 +1573,11 @@ namespace Spartan
         SP_ASSERT(buffer != nullptr);
         SP_ASSERT(buffer->GetRhiResource() != nullptr);
 
-        if (m_buffer_id_index == buffer->GetObjectId())
+        if (!m_state_tracker.SetIndexBuffer(buffer->GetObjectId()))
+        {
+            Profiler::m_rhi_elided_bindings_buffer_index++;
             return;
+        }
 
         bool is_16bit = buffer->GetStride() == sizeof(uint16_t);
 
@@ -1323,7 +1588,6 @@ namespace Spartan
             is_16bit ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32 // indexType
         );
 
-        m_buffer_id_index = buffer->GetObjectId();
         Profiler::m_rhi_bindings_buffer_index++;
     }
 
@@ -1332,6 +1596,13 @@ namespace Spartan
         SP_ASSERT(m_state == RHI_CommandListState::Recording);
         SP_ASSERT(size <= RHI_Device::PropertyGetMaxPushConstantSize());
 
+        // consecutive draws often push identical constants (e.g. the same pass constants for every draw of a full screen pass)
+        if (!m_state_tracker.PushConstants(offset, size, data))
+        {
+            Profiler::m_rhi_elided_push_constants++;
+            return;
+        }
+
         uint32_t stages = 0;
 
         if (m_pso.shaders[RHI_Shader_Type::Compute])
@@ -1367,6 +1638,7 @@ namespace Spartan
             size,
             data
         );
+        Profiler::m_rhi_push_constants++;
     }
 
     void RHI_CommandList::SetConstantBuffer(const uint32_t slot, RHI_Buffer* constant_buffer) const
@@ -1383,7 +1655,7 @@ namespace Spartan
         m_descriptor_layout_current->SetConstantBuffer(slot, constant_buffer);
 
         // todo: detect if there are changes, otherwise don't bother binding
-        descriptor_sets::bind_dynamic = true;
+        m_bind_dynamic = true;
     }
 
     void RHI_CommandList::SetSampler(const uint32_t slot, RHI_Sampler* sampler) const
@@ -1475,7 +1747,7 @@ namespace Spartan
         m_descriptor_layout_current->SetTexture(slot, texture, mip_index, mip_range);
 
         // todo: detect if there are changes, otherwise don't bother binding
-        descriptor_sets::bind_dynamic = true;
+        m_bind_dynamic = true;
     }
 
     void RHI_CommandList::SetBuffer(const uint32_t slot, RHI_Buffer* buffer) const
@@ -1491,7 +1763,7 @@ namespace Spartan
         m_descriptor_layout_current->SetBuffer(slot, buffer);
 
         // todo: detect if there are changes, otherwise don't bother binding
-        descriptor_sets::bind_dynamic = true;
+        m_bind_dynamic = true;
     }
 
     void RHI_CommandList::BeginMarker(const char* name)
@@ -1550,62 +1822,6 @@ namespace Spartan
         return Math::Helper::Clamp<float>(duration_ms, 0.0f, numeric_limits<float>::max());
     }
 
-    void RHI_CommandList::BeginOcclusionQuery(const uint64_t entity_id)
-    {
-        SP_ASSERT_MSG(m_pso.IsGraphics(), "Occlusion queries are only supported in graphics pipelines");
-
-        queries::occlusion::index_active = queries::occlusion::id_to_index[entity_id];
-        if (queries::occlusion::index_active == 0)
-        {
-            queries::occlusion::index_active           = ++queries::occlusion::index;
-            queries::occlusion::id_to_index[entity_id] = queries::occlusion::index;
-        }
-
-        if (!m_render_pass_active)
-        {
-            RenderPassBegin();
-        }
-
-        vkCmdBeginQuery(
-            static_cast<VkCommandBuffer>(m_rhi_resource),
-            static_cast<VkQueryPool>(m_rhi_query_pool_occlusion),
-            queries::occlusion::index_active,
-            0
-        );
-
-        queries::occlusion::occlusion_query_active = true;
-    }
-
-    void RHI_CommandList::EndOcclusionQuery()
-    {
-        if (!queries::occlusion::occlusion_query_active)
-            return;
-
-        vkCmdEndQuery(
-            static_cast<VkCommandBuffer>(m_rhi_resource),
-            static_cast<VkQueryPool>(m_rhi_query_pool_occlusion),
-            queries::occlusion::index_active
-        );
-
-        queries::occlusion::occlusion_query_active = false;
-    }
-
-    bool RHI_CommandList::GetOcclusionQueryResult(const uint64_t entity_id)
-    {
-        if (queries::occlusion::id_to_index.find(entity_id) == queries::occlusion::id_to_index.end())
-            return false;
-
-        uint32_t index  = queries::occlusion::id_to_index[entity_id];
-        uint64_t result = queries::occlusion::data[index]; // visible pixel count
-
-        return result == 0;
-    }
-
-    void RHI_CommandList::UpdateOcclusionQueries()
-    {
-        queries::occlusion::update(m_rhi_query_pool_occlusion);
-    }
-
     void RHI_CommandList::BeginTimeblock(const char* name, const bool gpu_marker, const bool gpu_timing)
     {
         SP_ASSERT_MSG(m_timeblock_active == nullptr, "The previous time block is still active");
@@ -1708,6 +1924,35 @@ namespace Spartan
         InsertBarrierTexture(texture->GetRhiResource(), get_aspect_mask(texture), 0, 1, 1, texture->GetLayout(0), texture->GetLayout(0), texture->IsDsv());
     }
 
+    void RHI_CommandList::InsertBarrierBufferReadWrite(RHI_Buffer* buffer)
+    {
+        SP_ASSERT(m_state == RHI_CommandListState::Recording);
+        SP_ASSERT(buffer != nullptr);
+
+        // shader and transfer writes have to be visible to the shaders and the indirect draws that follow,
+        // and previous indirect reads have to complete before the buffer is written again
+        VkBufferMemoryBarrier2 barrier = {};
+        barrier.sType                  = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+        barrier.srcStageMask           = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT;
+        barrier.srcAccessMask          = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        barrier.dstStageMask           = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        barrier.dstAccessMask          = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+        barrier.srcQueueFamilyIndex    = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex    = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer                 = static_cast<VkBuffer>(buffer->GetRhiResource());
+        barrier.offset                 = 0;
+        barrier.size                   = VK_WHOLE_SIZE;
+
+        VkDependencyInfo dependency_info         = {};
+        dependency_info.sType                    = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR;
+        dependency_info.bufferMemoryBarrierCount = 1;
+        dependency_info.pBufferMemoryBarriers    = &barrier;
+
+        RenderPassEnd(); // you can't have a barrier inside a render pass
+        vkCmdPipelineBarrier2(static_cast<VkCommandBuffer>(m_rhi_resource), &dependency_info);
+        Profiler::m_rhi_pipeline_barriers++;
+    }
+
     void RHI_CommandList::InsertPendingBarrierGroup()
     {
         if (!m_image_barriers.empty())
@@ -1752,9 +1997,11 @@ namespace Spartan
             RenderPassBegin();
         }
 
-        if (descriptor_sets::bind_dynamic)
+        // secondary command lists bind their descriptors when they set a pipeline state
+        if (!m_is_secondary && m_bind_dynamic)
         {
-            descriptor_sets::set_dynamic(m_pso, m_rhi_resource, m_pipeline->GetResource_PipelineLayout(), m_descriptor_layout_current);
+            descriptor_sets::set_dynamic(m_pso, m_rhi_resource, m_pipeline->GetResource_PipelineLayout(), m_descriptor_layout_current, m_state_tracker);
+            m_bind_dynamic = false;
         }
     }
 }
@@ -420,18 +420,6 @@ namespace Spartan
                         // check fix progress here: https://github.com/KhronosGroup/Vulkan-ValidationLayers/issues/7600
                         if (p_callback_data->messageIdNumber == 0x29910a35)
                             return VK_FALSE;
-
-                        // occlusion queries
-                        {
-                            if (p_callback_data->messageIdNumber == 0xd39be754)
-                            {
-                                // Validation Warning:
-                                // [BestPractices - QueryPool - Unavailable] Object 0 :
-                                // handle = 0x980b0000000002e, name = query_pool_occlusion, type = VK_OBJECT_TYPE_QUERY_POOL; | MessageID = 0xd39be754 | vkGetQueryPoolResults() :
-                                // QueryPool VkQueryPool 0x980b0000000002e[query_pool_occlusion] and query 0 : vkCmdBeginQuery() was never called.
-                                return VK_FALSE;
-                            }
-                        }
                     }
 
                     // legit but they spam every frame
@@ -1071,7 +1059,7 @@ namespace Spartan
         VkPhysicalDeviceVulkan12Features features_1_2               = {};
         VkPhysicalDeviceFragmentShadingRateFeaturesKHR features_vrs = {};
 
-        void detect(bool* is_shading_rate_supported)
+        void detect(bool* is_shading_rate_supported, bool* is_draw_indirect_count_supported)
         {
             // features that will be enabled
             features_robustness.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ROBUSTNESS_2_FEATURES_EXT;
@@ -1112,6 +1100,14 @@ namespace Spartan
                     features_vrs.attachmentFragmentShadingRate = VK_TRUE;
                 }
 
+                // gpu driven rendering - enabled conditionally, the renderer falls back to cpu submission without it
+                *is_draw_indirect_count_supported = support_1_2.drawIndirectCount == VK_TRUE && support.features.multiDrawIndirect == VK_TRUE;
+                if (*is_draw_indirect_count_supported)
+                {
+                    features_1_2.drawIndirectCount      = VK_TRUE;
+                    features.features.multiDrawIndirect = VK_TRUE;
+                }
+
                 // misc
                 {
                     // tessellation
@@ -1327,7 +1323,7 @@ namespace Spartan
                 }
             }
   
-            device_features::detect(&m_is_shading_rate_supported);
+            device_features::detect(&m_is_shading_rate_supported, &m_is_draw_indirect_count_supported);
 
             // create
             {
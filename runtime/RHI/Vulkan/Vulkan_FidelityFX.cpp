@@ -32,6 +32,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../RHI_Buffer.h"
 #include "../Input/Input.h"
 #include "../Rendering/Renderer_Buffers.h"
+#include "../Rendering/GeometryBuffer.h"
 #include "../World/Components/Renderable.h"
 #include "../World/Components/Camera.h"
 #include "../World/Entity.h"
@@ -210,6 +211,9 @@ namespace Spartan
 
         FfxCommandList to_ffx_cmd_list(RHI_CommandList* cmd_list)
         {
+            // fidelityfx binds its own pipelines and descriptors
+            cmd_list->InvalidateState();
+
             return ffxGetCommandListVK(static_cast<VkCommandBuffer>(cmd_list->GetRhiResource()));
         }
 
@@ -331,6 +335,7 @@ namespace Spartan
 
             // instances
             unordered_set<uint64_t> static_instances;
+            uint32_t geometry_generation = 0;
             vector<pair<const RHI_Buffer*, uint32_t>> instance_buffers;
             unordered_map<uint64_t, shared_ptr<Entity>> entity_map;
             vector<FfxBrixelizerInstanceDescription> instances_to_create;
@@ -402,7 +407,7 @@ namespace Spartan
                desc.vertexStride       = renderable->GetVertexBuffer()->GetStride();
                desc.vertexBufferOffset = renderable->GetVertexOffset() * desc.vertexStride;
                desc.vertexCount        = renderable->GetVertexCount();
-               desc.vertexFormat       = FFX_SURFACE_FORMAT_R32G32B32_FLOAT;
+               desc.vertexFormat       = renderable->GetVertexType() == RHI_Vertex_Type::PosUvNorTanPackedHalf ? FFX_SURFACE_FORMAT_R16G16B16A16_FLOAT : FFX_SURFACE_FORMAT_R32G32B32_FLOAT;
            
                // index buffer
                desc.indexBuffer       = register_geometry_buffer(renderable->GetIndexBuffer());
@@ -943,6 +948,24 @@ namespace Spartan
             brixelizer_gi::instances_to_create.clear();
             brixelizer_gi::instances_to_delete.clear();
             brixelizer_gi::entity_map.clear();
+
+            // static instances point into the geometry buffer, when it has been defragmented they have to be re-created
+            if (brixelizer_gi::geometry_generation != GeometryBuffer::GetGeneration())
+            {
+                for (uint64_t instance_id : brixelizer_gi::static_instances)
+                {
+                    brixelizer_gi::instances_to_delete.push_back(brixelizer_gi::get_or_create_id(instance_id));
+                }
+
+                if (!brixelizer_gi::instances_to_delete.empty())
+                {
+                    SP_ASSERT(ffxBrixelizerDeleteInstances(&brixelizer_gi::context, brixelizer_gi::instances_to_delete.data(), static_cast<uint32_t>(brixelizer_gi::instances_to_delete.size())) == FFX_OK);
+                }
+
+                brixelizer_gi::static_instances.clear();
+                brixelizer_gi::instances_to_delete.clear();
+                brixelizer_gi::geometry_generation = GeometryBuffer::GetGeneration();
+            }
         
             // process entities
             for (int64_t i = index_start; i < index_end; i++)
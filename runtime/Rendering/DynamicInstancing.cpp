@@ -0,0 +1,59 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+//= INCLUDES ==================
+#include "pch.h"
+#include "DynamicInstancing.h"
+//=============================
+
+//= NAMESPACES =====
+using namespace std;
+//==================
+
+namespace Spartan
+{
+    void DynamicInstancing::Group(vector<InstancingCandidate>& candidates, const uint32_t instance_count, const uint32_t instance_count_max, vector<InstancingGroup>& groups)
+    {
+        groups.clear();
+
+        stable_sort(candidates.begin(), candidates.end(), [](const InstancingCandidate& a, const InstancingCandidate& b) { return a.key() < b.key(); });
+
+        uint32_t instance_end = instance_count;
+        for (size_t start = 0; start < candidates.size();)
+        {
+            size_t end = start + 1;
+            while (end < candidates.size() && candidates[end].key() == candidates[start].key())
+            {
+                end++;
+            }
+
+            const uint32_t count = static_cast<uint32_t>(end - start);
+            if (count >= batch_size_min && instance_end + count <= instance_count_max)
+            {
+                groups.push_back({ static_cast<uint32_t>(start), count });
+                instance_end += count;
+            }
+
+            start = end;
+        }
+    }
+}
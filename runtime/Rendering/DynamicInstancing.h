@@ -0,0 +1,71 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+//= INCLUDES ==
+#include <vector>
+#include <tuple>
+//=============
+
+namespace Spartan
+{
+    // renderables with the same key draw the same geometry with the same pipeline (the material decides culling and tessellation)
+    struct InstancingCandidate
+    {
+        uint64_t material_id      = 0;
+        uint64_t vertex_buffer_id = 0;
+        uint64_t index_buffer_id  = 0;
+        uint32_t index_offset     = 0;
+        uint32_t index_count      = 0;
+        uint32_t vertex_offset    = 0;
+        uint32_t renderable_index = 0;
+
+        auto key() const { return std::tie(material_id, vertex_buffer_id, index_buffer_id, index_offset, index_count, vertex_offset); }
+    };
+
+    // a range of the sorted candidates which is drawn as one instanced draw
+    struct InstancingGroup
+    {
+        uint32_t candidate_start = 0;
+        uint32_t candidate_count = 0;
+    };
+
+    // groups the renderables which can be drawn together, so that repeated geometry costs one draw instead of one per copy,
+    // it only decides the grouping, the renderer uploads the transforms and draws the groups (see dynamic_instancing in Renderer_Passes.cpp)
+    class SP_CLASS DynamicInstancing
+    {
+    public:
+        // below this, the transforms to upload cost more than the draws which are saved
+        static constexpr uint32_t batch_size_min = 4;
+
+        // sorts the candidates by key, stable so that the members of a group keep their front-to-back order, and returns the groups,
+        // instance_count is how many instances are already in use and a group is skipped if it would take that past instance_count_max,
+        // the candidates outside of every group are drawn one by one
+        static void Group(
+            std::vector<InstancingCandidate>& candidates,
+            const uint32_t instance_count,
+            const uint32_t instance_count_max,
+            std::vector<InstancingGroup>& groups
+        );
+    };
+}
@@ -110,7 +110,8 @@ namespace Spartan
         float starting_pos_x = cursor.x;
 
         // generate vertices - draw each latter onto a quad
-        vector<RHI_Vertex_PosTex> vertices;
+        FrameVector<RHI_Vertex_PosTex> vertices;
+        vertices.reserve(text.size() * 6);
         for (char character : text)
         {
             Glyph& glyph = m_glyphs[character];
@@ -151,14 +152,15 @@ namespace Spartan
         }
 
         // generate indices
-        vector<uint32_t> indices;
+        FrameVector<uint32_t> indices;
+        indices.reserve(vertices.size());
         for (uint32_t i = 0; i < static_cast<uint32_t>(vertices.size()); i++)
         {
             indices.emplace_back(i);
         }
 
         // store the generated data for this text
-        m_text_data.emplace_back(vertices, indices, position);
+        m_text_data.emplace_back(move(vertices), move(indices), position);
     }
 
     bool Font::HasText() const
@@ -166,6 +168,11 @@ namespace Spartan
         return !m_text_data.empty();
     }
 
+    void Font::ClearText()
+    {
+        m_text_data.clear();
+    }
+
     void Font::SetSize(const uint32_t size)
     {
         m_font_size = Helper::Clamp<uint32_t>(size, 8, 50);
@@ -179,8 +186,21 @@ namespace Spartan
             return;
 
         // combine all vertices/indices into one
-        vector<RHI_Vertex_PosTex> vertices;
-        vector<uint32_t> indices;
+        FrameVector<RHI_Vertex_PosTex> vertices;
+        FrameVector<uint32_t> indices;
+        {
+            size_t vertex_count = 0;
+            size_t index_count  = 0;
+            for (const TextData& text_data : m_text_data)
+            {
+                vertex_count += text_data.vertices.size();
+                index_count  += text_data.indices.size();
+            }
+
+            vertices.reserve(vertex_count);
+            indices.reserve(index_count);
+        }
+
         uint32_t vertex_offset = 0;
         for (const TextData& text_data : m_text_data)
         {
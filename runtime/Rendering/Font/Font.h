@@ -29,6 +29,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../../RHI/RHI_Definitions.h"
 #include "../../Resource/IResource.h"
 #include "../../Core/Definitions.h"
+#include "../../Core/FrameAllocator.h"
 //====================================
 
 namespace Spartan
@@ -53,10 +54,11 @@ namespace Spartan
         Font_Outline_Negative
     };
 
+    // lives in frame memory, so it has to be consumed or cleared every frame, before the frame allocator is reset
     struct TextData
     {
-        std::vector<RHI_Vertex_PosTex> vertices;
-        std::vector<uint32_t> indices;
+        FrameVector<RHI_Vertex_PosTex> vertices;
+        FrameVector<uint32_t> indices;
         Math::Vector2 position;
     };
 
@@ -73,6 +75,7 @@ namespace Spartan
         // text
         void AddText(const std::string& text, const Math::Vector2& position_screen_percentage);
         bool HasText() const;
+        void ClearText();
 
         // color
         const Color& GetColor() const     { return m_color; }
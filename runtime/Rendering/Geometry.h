@@ -111,7 +111,7 @@ namespace Spartan::Geometry
         indices->emplace_back(1);
     }
 
-    void CreateGrid(std::vector<RHI_Vertex_PosTexNorTan>* vertices, std::vector<uint32_t>* indices, uint32_t resolution)
+    static void CreateGrid(std::vector<RHI_Vertex_PosTexNorTan>* vertices, std::vector<uint32_t>* indices, uint32_t resolution)
     {
         using namespace Math;
 
@@ -0,0 +1,288 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+//= INCLUDES =====================
+#include "pch.h"
+#include "GeometryBuffer.h"
+#include "Mesh.h"
+#include "../RHI/RHI_Buffer.h"
+#include "../Core/RangeAllocator.h"
+//================================
+
+//= NAMESPACES =====
+using namespace std;
+//==================
+
+namespace Spartan
+{
+    namespace
+    {
+        const uint32_t block_vertex_count   = 1024 * 1024;     // 44 MB with the full vertex layout
+        const uint32_t block_index_count    = 4 * 1024 * 1024; // 16 MB
+        const float defragment_threshold    = 0.5f;            // fragmentation above which a block gets compacted
+        const uint32_t defragment_move_max  = 32;              // per block and sync point, every move is a gpu copy
+        const uint32_t pool_index_indices   = static_cast<uint32_t>(RHI_Vertex_Type::Max); // the pools after the vertex layouts hold indices
+
+        struct Block
+        {
+            shared_ptr<RHI_Buffer> buffer;
+            RangeAllocator allocator;
+            unordered_map<uint64_t, Mesh*> owners; // by offset, so that moves can be reported
+        };
+
+        struct Pool
+        {
+            vector<unique_ptr<Block>> blocks;
+            uint32_t stride = 0;
+        };
+
+        array<Pool, static_cast<uint32_t>(RHI_Vertex_Type::Max) + 1> pools;
+        vector<GeometryRange> frees_pending;
+        atomic<uint32_t> generation = 0;
+        mutex mutex_pools;
+
+        Block* find_block(const RHI_Buffer* buffer, Pool** pool_out = nullptr)
+        {
+            for (Pool& pool : pools)
+            {
+                for (unique_ptr<Block>& block : pool.blocks)
+                {
+                    if (block->buffer.get() == buffer)
+                    {
+                        if (pool_out)
+                        {
+                            *pool_out = &pool;
+                        }
+
+                        return block.get();
+                    }
+                }
+            }
+
+            return nullptr;
+        }
+
+        GeometryRange allocate(Mesh* owner, const uint32_t pool_index, const uint32_t stride, const void* data, const uint32_t count)
+        {
+            SP_ASSERT(data != nullptr);
+            SP_ASSERT(count != 0);
+
+            lock_guard<mutex> lock(mutex_pools);
+
+            Pool& pool = pools[pool_index];
+            SP_ASSERT_MSG(pool.stride == 0 || pool.stride == stride, "A vertex layout can only have one stride");
+            pool.stride = stride;
+
+            // first block with enough room
+            Block* block    = nullptr;
+            uint64_t offset = RangeAllocator::offset_invalid;
+            for (unique_ptr<Block>& block_existing : pool.blocks)
+            {
+                offset = block_existing->allocator.Allocate(count);
+                if (offset != RangeAllocator::offset_invalid)
+                {
+                    block = block_existing.get();
+                    break;
+                }
+            }
+
+            // or a new one, geometry larger than a block gets a block of its own
+            if (!block)
+            {
+                const bool is_index     = pool_index == pool_index_indices;
+                const uint32_t capacity = max(count, is_index ? block_index_count : block_vertex_count);
+                const string name       = string(is_index ? "geometry_index_buffer_" : "geometry_vertex_buffer_") + to_string(pool_index) + "_" + to_string(pool.blocks.size());
+
+                block            = pool.blocks.emplace_back(make_unique<Block>()).get();
+                block->buffer    = make_shared<RHI_Buffer>(is_index ? RHI_Buffer_Type::Index : RHI_Buffer_Type::Vertex, stride, capacity, nullptr, false, name.c_str());
+                block->allocator = RangeAllocator(capacity);
+                offset           = block->allocator.Allocate(count);
+            }
+
+            block->owners[offset] = owner;
+            block->buffer->UpdateRange(data, offset * stride, static_cast<uint64_t>(count) * stride);
+
+            return { block->buffer.get(), static_cast<uint32_t>(offset), count };
+        }
+
+        void defragment(Block* block, const uint32_t stride)
+        {
+            if (block->allocator.GetFragmentation() < defragment_threshold)
+                return;
+
+            const vector<RangeAllocatorMove> moves = block->allocator.Defragment(defragment_move_max);
+            for (const RangeAllocatorMove& move : moves)
+            {
+                block->buffer->CopyRange(block->buffer.get(), move.offset_source * stride, move.offset_destination * stride, move.size * stride);
+
+                auto it = block->owners.find(move.offset_source);
+                SP_ASSERT(it != block->owners.end());
+                Mesh* owner = it->second;
+                block->owners.erase(it);
+                block->owners[move.offset_destination] = owner;
+
+                owner->OnGeometryMoved(block->buffer.get(), static_cast<uint32_t>(move.offset_source), static_cast<uint32_t>(move.offset_destination));
+            }
+
+            if (!moves.empty())
+            {
+                generation++;
+            }
+        }
+    }
+
+    void GeometryBuffer::Shutdown()
+    {
+        lock_guard<mutex> lock(mutex_pools);
+
+        for (Pool& pool : pools)
+        {
+            pool.blocks.clear();
+            pool.stride = 0;
+        }
+
+        frees_pending.clear();
+    }
+
+    GeometryRange GeometryBuffer::AllocateVertices(Mesh* owner, const RHI_Vertex_Type vertex_type, const uint32_t stride, const void* data, const uint32_t count)
+    {
+        SP_ASSERT(vertex_type != RHI_Vertex_Type::Max);
+        return allocate(owner, static_cast<uint32_t>(vertex_type), stride, data, count);
+    }
+
+    GeometryRange GeometryBuffer::AllocateIndices(Mesh* owner, const uint32_t* data, const uint32_t count)
+    {
+        return allocate(owner, pool_index_indices, sizeof(uint32_t), data, count);
+    }
+
+    void GeometryBuffer::Free(const GeometryRange& range)
+    {
+        if (!range.IsValid())
+            return;
+
+        lock_guard<mutex> lock(mutex_pools);
+
+        // meshes can outlive the renderer, by then the blocks are gone
+        Block* block = find_block(range.buffer);
+        if (!block)
+            return;
+
+        // the owner is going away, so it's forgotten right away, the range itself is retired at the next sync point
+        block->owners.erase(range.offset);
+
+        frees_pending.emplace_back(range);
+    }
+
+    void GeometryBuffer::OnSyncPoint()
+    {
+        lock_guard<mutex> lock(mutex_pools);
+
+        for (const GeometryRange& range : frees_pending)
+        {
+            find_block(range.buffer)->allocator.Free(range.offset);
+        }
+        frees_pending.clear();
+
+        for (Pool& pool : pools)
+        {
+            // the first block is kept even when empty, worlds tend to be reloaded
+            for (size_t i = pool.blocks.size(); i > 1; i--)
+            {
+                if (pool.blocks[i - 1]->allocator.GetAllocationCount() == 0)
+                {
+                    pool.blocks.erase(pool.blocks.begin() + (i - 1));
+                }
+            }
+
+            for (unique_ptr<Block>& block : pool.blocks)
+            {
+                defragment(block.get(), pool.stride);
+            }
+        }
+    }
+
+    uint32_t GeometryBuffer::GetGeneration()
+    {
+        return generation;
+    }
+
+    uint64_t GeometryBuffer::GetAllocatedBytes()
+    {
+        lock_guard<mutex> lock(mutex_pools);
+
+        uint64_t size = 0;
+        for (const Pool& pool : pools)
+        {
+            for (const unique_ptr<Block>& block : pool.blocks)
+            {
+                size += block->allocator.GetAllocatedSize() * pool.stride;
+            }
+        }
+
+        return size;
+    }
+
+    uint64_t GeometryBuffer::GetCapacityBytes()
+    {
+        lock_guard<mutex> lock(mutex_pools);
+
+        uint64_t size = 0;
+        for (const Pool& pool : pools)
+        {
+            for (const unique_ptr<Block>& block : pool.blocks)
+            {
+                size += block->allocator.GetCapacity() * pool.stride;
+            }
+        }
+
+        return size;
+    }
+
+    uint32_t GeometryBuffer::GetAllocationCount()
+    {
+        lock_guard<mutex> lock(mutex_pools);
+
+        uint32_t count = 0;
+        for (const Pool& pool : pools)
+        {
+            for (const unique_ptr<Block>& block : pool.blocks)
+            {
+                count += block->allocator.GetAllocationCount();
+            }
+        }
+
+        return count;
+    }
+
+    uint32_t GeometryBuffer::GetBlockCount()
+    {
+        lock_guard<mutex> lock(mutex_pools);
+
+        uint32_t count = 0;
+        for (const Pool& pool : pools)
+        {
+            count += static_cast<uint32_t>(pool.blocks.size());
+        }
+
+        return count;
+    }
+}
@@ -0,0 +1,70 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+//= INCLUDES ======================
+#include "../RHI/RHI_Definitions.h"
+//=================================
+
+namespace Spartan
+{
+    class Mesh;
+
+    // a piece of the geometry buffer, the offset and the count are in elements (vertices or indices) of the buffer
+    struct GeometryRange
+    {
+        RHI_Buffer* buffer = nullptr;
+        uint32_t offset    = 0;
+        uint32_t count     = 0;
+
+        bool IsValid() const { return buffer != nullptr; }
+    };
+
+    // meshes sub-allocate their vertices and indices from a few large buffers instead of owning a pair each, so that
+    // consecutive draws of different meshes rarely rebind and the gpu driven path can draw all of them in one go,
+    // there is one set of blocks per vertex layout and one for indices, a new block is only added when the others are full
+    class SP_CLASS GeometryBuffer
+    {
+    public:
+        static void Shutdown();
+
+        // the data is copied to the gpu, the range stays valid until it's freed or a defragmentation moves it (the owner is told)
+        static GeometryRange AllocateVertices(Mesh* owner, const RHI_Vertex_Type vertex_type, const uint32_t stride, const void* data, const uint32_t count);
+        static GeometryRange AllocateIndices(Mesh* owner, const uint32_t* data, const uint32_t count);
+
+        // the range is only reused after the next sync point, since frames in flight may still read it
+        static void Free(const GeometryRange& range);
+
+        // called by the renderer when no command list is in flight, retires freed ranges, compacts fragmented blocks and releases empty ones
+        static void OnSyncPoint();
+
+        // incremented whenever a defragmentation moves geometry, for anything that caches offsets
+        static uint32_t GetGeneration();
+
+        // stats
+        static uint64_t GetAllocatedBytes();
+        static uint64_t GetCapacityBytes();
+        static uint32_t GetAllocationCount();
+        static uint32_t GetBlockCount();
+    };
+}
@@ -0,0 +1,136 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+//= INCLUDES ==============
+#include "pch.h"
+#include "IndirectDraws.h"
+#include "Mesh.h"
+#include "../Math/Frustum.h"
+//=========================
+
+//= NAMESPACES ===============
+using namespace std;
+using namespace Spartan::Math;
+//============================
+
+namespace Spartan
+{
+    uint32_t IndirectDraws::GetBucketIndex(
+        vector<IndirectDrawBucket>& buckets,
+        RHI_Buffer* vertex_buffer,
+        RHI_Buffer* index_buffer,
+        const RHI_CullMode cull_mode,
+        const uint32_t bucket_count_max
+    )
+    {
+        // there are only a handful of unique geometry buffers, a linear search is fine
+        for (uint32_t i = 0; i < static_cast<uint32_t>(buckets.size()); i++)
+        {
+            const IndirectDrawBucket& bucket = buckets[i];
+            if (bucket.vertex_buffer == vertex_buffer && bucket.index_buffer == index_buffer && bucket.cull_mode == cull_mode)
+                return i;
+        }
+
+        if (buckets.size() >= bucket_count_max)
+            return bucket_invalid;
+
+        IndirectDrawBucket& bucket = buckets.emplace_back();
+        bucket.vertex_buffer       = vertex_buffer;
+        bucket.index_buffer        = index_buffer;
+        bucket.cull_mode           = cull_mode;
+
+        return static_cast<uint32_t>(buckets.size() - 1);
+    }
+
+    uint32_t IndirectDraws::AssignCommandOffsets(vector<IndirectDrawBucket>& buckets)
+    {
+        uint32_t command_offset = 0;
+        for (IndirectDrawBucket& bucket : buckets)
+        {
+            bucket.command_offset = command_offset;
+            command_offset       += bucket.object_count;
+        }
+
+        return command_offset;
+    }
+
+    uint32_t IndirectDraws::AppendMeshlets(
+        const Sb_DrawObject& draw_object,
+        const vector<Meshlet>& meshlets,
+        const uint32_t index_offset_mesh,
+        const float scale_max,
+        const bool cull_cones,
+        const Frustum& frustum,
+        const Vector3& camera_position,
+        vector<Sb_DrawObject>& draw_objects
+    )
+    {
+        uint32_t visible_count = 0;
+        for (uint32_t meshlet_index = 0; meshlet_index < static_cast<uint32_t>(meshlets.size()); meshlet_index++)
+        {
+            const Meshlet& meshlet             = meshlets[meshlet_index];
+            Sb_DrawObject& draw_object_meshlet = draw_objects.emplace_back(draw_object);
+            draw_object_meshlet.box_center     = meshlet.center * draw_object.transform;
+            draw_object_meshlet.box_extent     = Vector3(meshlet.radius * scale_max);
+            draw_object_meshlet.index_count    = meshlet.index_count;
+            draw_object_meshlet.index_offset   = index_offset_mesh + meshlet.index_offset;
+
+            // last frame's results of the meshlets are laid out the same way, one after the other
+            if (draw_object.visibility_index_previous != numeric_limits<uint32_t>::max())
+            {
+                draw_object_meshlet.visibility_index_previous = draw_object.visibility_index_previous + meshlet_index;
+            }
+
+            if (cull_cones)
+            {
+                draw_object_meshlet.cone_apex   = meshlet.cone_apex * draw_object.transform;
+                draw_object_meshlet.cone_axis   = ((meshlet.cone_apex + meshlet.cone_axis) * draw_object.transform - draw_object_meshlet.cone_apex).Normalized();
+                draw_object_meshlet.cone_cutoff = meshlet.cone_cutoff;
+            }
+
+            if (IsVisible(draw_object_meshlet, frustum, camera_position))
+            {
+                visible_count++;
+            }
+        }
+
+        return visible_count;
+    }
+
+    bool IndirectDraws::IsVisible(const Sb_DrawObject& draw_object, const Frustum& frustum, const Vector3& camera_position)
+    {
+        return
+            frustum.IsVisible(draw_object.box_center, draw_object.box_extent) &&
+            Vector3::Dot((draw_object.cone_apex - camera_position).Normalized(), draw_object.cone_axis) < draw_object.cone_cutoff;
+    }
+
+    uint32_t IndirectDraws::GetVisibleCount(const uint32_t* counts, const uint32_t count)
+    {
+        uint32_t visible_count = 0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            visible_count += counts[i];
+        }
+
+        return visible_count;
+    }
+}
@@ -0,0 +1,86 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+//= INCLUDES ======================
+#include <vector>
+#include <limits>
+#include "Renderer_Buffers.h"
+#include "../RHI/RHI_Definitions.h"
+//=================================
+
+namespace Spartan
+{
+    namespace Math { class Frustum; }
+    struct Meshlet;
+
+    // indirect draws can't switch vertex/index buffers or rasterizer state,
+    // so renderables which share them are grouped into buckets, one indirect draw per bucket
+    struct IndirectDrawBucket
+    {
+        RHI_Buffer* vertex_buffer = nullptr;
+        RHI_Buffer* index_buffer  = nullptr;
+        RHI_CullMode cull_mode    = RHI_CullMode::Back;
+        uint32_t object_count     = 0;
+        uint32_t command_offset   = 0;
+    };
+
+    // the cpu side of gpu driven rendering, it builds the buckets and the draw objects which indirect_cull.hlsl turns into draw commands,
+    // it has no gpu dependencies so that it can be tested, and it runs the same visibility tests so that the gpu counts can be checked against it
+    class SP_CLASS IndirectDraws
+    {
+    public:
+        static constexpr uint32_t bucket_invalid = std::numeric_limits<uint32_t>::max();
+
+        // the bucket which draws the given geometry with the given cull mode, it's created if needed, unless bucket_count_max already exist
+        static uint32_t GetBucketIndex(
+            std::vector<IndirectDrawBucket>& buckets,
+            RHI_Buffer* vertex_buffer,
+            RHI_Buffer* index_buffer,
+            const RHI_CullMode cull_mode,
+            const uint32_t bucket_count_max
+        );
+
+        // each bucket gets a contiguous range of commands, in bucket order, returns how many commands there are in total
+        static uint32_t AssignCommandOffsets(std::vector<IndirectDrawBucket>& buckets);
+
+        // appends one draw object per meshlet, with world space bounds, the rest is inherited from the draw object of the whole renderable,
+        // the cones are only written when they can be culled, scale_max is the largest axis scale of the transform, returns how many are visible
+        static uint32_t AppendMeshlets(
+            const Sb_DrawObject& draw_object,
+            const std::vector<Meshlet>& meshlets,
+            const uint32_t index_offset_mesh,
+            const float scale_max,
+            const bool cull_cones,
+            const Math::Frustum& frustum,
+            const Math::Vector3& camera_position,
+            std::vector<Sb_DrawObject>& draw_objects
+        );
+
+        // the same frustum and normal cone tests the culling pass runs
+        static bool IsVisible(const Sb_DrawObject& draw_object, const Math::Frustum& frustum, const Math::Vector3& camera_position);
+
+        // the visible objects of a frame as the gpu counted them, the sum of the counts of every bucket in every culling phase
+        static uint32_t GetVisibleCount(const uint32_t* counts, const uint32_t count);
+    };
+}
@@ -0,0 +1,198 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+//= INCLUDES ==============
+#include "pch.h"
+#include "LightClusters.h"
+//=========================
+
+//= NAMESPACES ===============
+using namespace std;
+using namespace Spartan::Math;
+//============================
+
+namespace Spartan
+{
+    namespace
+    {
+        // scratch, the lights are binned first and then written out cluster by cluster so that every list is contiguous
+        vector<pair<uint32_t, uint32_t>> cluster_light_pairs;
+        vector<uint32_t> cluster_counts;
+
+        float get_slice_depth(const uint32_t slice, const float near_plane, const float far_plane)
+        {
+            return near_plane * pow(far_plane / near_plane, static_cast<float>(slice) / static_cast<float>(LightClusters::slice_count));
+        }
+
+        uint32_t to_tile(const float uv, const uint32_t tile_count)
+        {
+            return static_cast<uint32_t>(clamp(uv * static_cast<float>(tile_count), 0.0f, static_cast<float>(tile_count - 1)));
+        }
+
+        // the range of the projection of [value_min, value_max] over the depths [z_min, z_max], in ndc
+        void project_range(const float value_min, const float value_max, const float z_min, const float z_max, const float projection, float* ndc_min, float* ndc_max)
+        {
+            *ndc_min = (value_min * projection) / (value_min < 0.0f ? z_min : z_max);
+            *ndc_max = (value_max * projection) / (value_max > 0.0f ? z_min : z_max);
+        }
+
+        float distance_squared_to_box(const Vector3& point, const Vector3& box_min, const Vector3& box_max)
+        {
+            const Vector3 closest = Vector3(
+                clamp(point.x, box_min.x, box_max.x),
+                clamp(point.y, box_min.y, box_max.y),
+                clamp(point.z, box_min.z, box_max.z)
+            );
+
+            return (point - closest).LengthSquared();
+        }
+    }
+
+    uint32_t LightClusters::Build(
+        const vector<LightClusterSphere>& lights,
+        const float projection_x,
+        const float projection_y,
+        const float near_plane,
+        const float far_plane,
+        vector<uint32_t>& data
+    )
+    {
+        SP_ASSERT(projection_x > 0.0f && projection_y > 0.0f);
+        SP_ASSERT(near_plane > 0.0f && far_plane > near_plane);
+
+        cluster_light_pairs.clear();
+        cluster_counts.assign(cluster_count, 0);
+
+        for (const LightClusterSphere& light : lights)
+        {
+            const Vector3& center = light.center;
+            const float radius    = light.radius;
+
+            // depth range
+            const float z_min = max(center.z - radius, near_plane);
+            const float z_max = min(center.z + radius, far_plane);
+            if (z_min > z_max)
+                continue;
+
+            const uint32_t slice_first = GetSlice(z_min, near_plane, far_plane);
+            const uint32_t slice_last  = GetSlice(z_max, near_plane, far_plane);
+            for (uint32_t slice = slice_first; slice <= slice_last; slice++)
+            {
+                const float slice_near = get_slice_depth(slice, near_plane, far_plane);
+                const float slice_far  = get_slice_depth(slice + 1, near_plane, far_plane);
+
+                // conservative tile range of the sphere within this slice
+                const float z_near = max(z_min, slice_near);
+                const float z_far  = min(z_max, slice_far);
+                float ndc_x_min, ndc_x_max, ndc_y_min, ndc_y_max;
+                project_range(center.x - radius, center.x + radius, z_near, z_far, projection_x, &ndc_x_min, &ndc_x_max);
+                project_range(center.y - radius, center.y + radius, z_near, z_far, projection_y, &ndc_y_min, &ndc_y_max);
+                if (ndc_x_min > 1.0f || ndc_x_max < -1.0f || ndc_y_min > 1.0f || ndc_y_max < -1.0f)
+                    continue;
+
+                // ndc y points up while uv y points down
+                const uint32_t tile_x_first = to_tile(ndc_x_min * 0.5f + 0.5f, tile_count_x);
+                const uint32_t tile_x_last  = to_tile(ndc_x_max * 0.5f + 0.5f, tile_count_x);
+                const uint32_t tile_y_first = to_tile(0.5f - ndc_y_max * 0.5f, tile_count_y);
+                const uint32_t tile_y_last  = to_tile(0.5f - ndc_y_min * 0.5f, tile_count_y);
+
+                for (uint32_t tile_y = tile_y_first; tile_y <= tile_y_last; tile_y++)
+                {
+                    for (uint32_t tile_x = tile_x_first; tile_x <= tile_x_last; tile_x++)
+                    {
+                        // view space bounds of the froxel
+                        const float tile_ndc_x_min = static_cast<float>(tile_x)     / tile_count_x * 2.0f - 1.0f;
+                        const float tile_ndc_x_max = static_cast<float>(tile_x + 1) / tile_count_x * 2.0f - 1.0f;
+                        const float tile_ndc_y_min = 1.0f - static_cast<float>(tile_y + 1) / tile_count_y * 2.0f;
+                        const float tile_ndc_y_max = 1.0f - static_cast<float>(tile_y)     / tile_count_y * 2.0f;
+
+                        const Vector3 box_min = Vector3(
+                            min(tile_ndc_x_min * slice_near, tile_ndc_x_min * slice_far) / projection_x,
+                            min(tile_ndc_y_min * slice_near, tile_ndc_y_min * slice_far) / projection_y,
+                            slice_near
+                        );
+
+                        const Vector3 box_max = Vector3(
+                            max(tile_ndc_x_max * slice_near, tile_ndc_x_max * slice_far) / projection_x,
+                            max(tile_ndc_y_max * slice_near, tile_ndc_y_max * slice_far) / projection_y,
+                            slice_far
+                        );
+
+                        if (distance_squared_to_box(center, box_min, box_max) <= radius * radius)
+                        {
+                            const uint32_t cluster = (slice * tile_count_y + tile_y) * tile_count_x + tile_x;
+                            cluster_light_pairs.emplace_back(cluster, light.index);
+                            cluster_counts[cluster]++;
+                        }
+                    }
+                }
+            }
+        }
+
+        // header, the offsets are relative to the start of the indices
+        data.assign(cluster_count * 2, 0);
+        uint32_t offset  = 0;
+        uint32_t dropped = 0;
+        for (uint32_t cluster = 0; cluster < cluster_count; cluster++)
+        {
+            const uint32_t count = min(cluster_counts[cluster], index_count - offset);
+            dropped             += cluster_counts[cluster] - count;
+
+            data[cluster * 2 + 0] = offset;
+            data[cluster * 2 + 1] = count;
+            offset               += count;
+        }
+
+        // indices, the pairs are in light order so every list keeps that order
+        data.resize(cluster_count * 2 + offset);
+        cluster_counts.assign(cluster_count, 0);
+        for (const auto& [cluster, light_index] : cluster_light_pairs)
+        {
+            uint32_t& written = cluster_counts[cluster];
+            if (written < data[cluster * 2 + 1])
+            {
+                data[cluster_count * 2 + data[cluster * 2 + 0] + written] = light_index;
+                written++;
+            }
+        }
+
+        return dropped;
+    }
+
+    uint32_t LightClusters::GetSlice(const float z, const float near_plane, const float far_plane)
+    {
+        if (z <= near_plane)
+            return 0;
+
+        const float slice = log(z / near_plane) / log(far_plane / near_plane) * static_cast<float>(slice_count);
+        return min(static_cast<uint32_t>(slice), slice_count - 1);
+    }
+
+    uint32_t LightClusters::GetClusterIndex(const float uv_x, const float uv_y, const float z, const float near_plane, const float far_plane)
+    {
+        const uint32_t tile_x = to_tile(uv_x, tile_count_x);
+        const uint32_t tile_y = to_tile(uv_y, tile_count_y);
+        const uint32_t slice  = GetSlice(z, near_plane, far_plane);
+
+        return (slice * tile_count_y + tile_y) * tile_count_x + tile_x;
+    }
+}
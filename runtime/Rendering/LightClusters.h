@@ -0,0 +1,70 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+//= INCLUDES ==============
+#include <vector>
+#include "../Math/Vector3.h"
+//=========================
+
+namespace Spartan
+{
+    // a light as seen by the cluster assignment, a sphere in view space
+    struct LightClusterSphere
+    {
+        Math::Vector3 center;
+        float radius    = 0.0f;
+        uint32_t index  = 0; // into the light buffer
+    };
+
+    // splits the view frustum into a grid of froxels (screen tiles by exponential depth slices) and lists the lights which touch
+    // each froxel, so that a single lighting dispatch only evaluates the lights near every pixel instead of all lights everywhere,
+    // this runs on the cpu (the light count is capped by rhi_max_array_size_lights) and has no gpu dependencies so it doubles as the reference
+    class SP_CLASS LightClusters
+    {
+    public:
+        // when changing these, also update the constants in light.hlsl
+        static constexpr uint32_t tile_count_x  = 16;
+        static constexpr uint32_t tile_count_y  = 9;
+        static constexpr uint32_t slice_count   = 24;
+        static constexpr uint32_t cluster_count = tile_count_x * tile_count_y * slice_count;
+        static constexpr uint32_t index_count   = cluster_count * 16; // shared by all clusters, lights which don't fit are dropped
+
+        // the gpu layout, an (offset, count) pair per cluster followed by the light indices the offsets point to
+        static constexpr uint32_t data_count = cluster_count * 2 + index_count;
+
+        // projection_x and projection_y are the m00 and m11 of the (perspective) projection matrix, returns how many lights were dropped
+        static uint32_t Build(
+            const std::vector<LightClusterSphere>& lights,
+            const float projection_x,
+            const float projection_y,
+            const float near_plane,
+            const float far_plane,
+            std::vector<uint32_t>& data
+        );
+
+        // the same math the shader uses to find the cluster of a pixel, uv is top-left based and z is the view space depth
+        static uint32_t GetSlice(const float z, const float near_plane, const float far_plane);
+        static uint32_t GetClusterIndex(const float uv_x, const float uv_y, const float z, const float near_plane, const float far_plane);
+    };
+}
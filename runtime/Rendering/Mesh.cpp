@@ -27,9 +27,12 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../RHI/RHI_Texture2D.h"
 #include "../World/Components/Renderable.h"
 #include "../World/Entity.h"
+#include "../World/World.h"
+#include "../World/Components/PhysicsBody.h"
 #include "../Resource/ResourceCache.h"
 #include "../IO/FileStream.h"
 #include "../Resource/Import/ModelImporter.h"
+#include "../Core/ThreadPool.h"
 SP_WARNINGS_OFF
 #include "meshoptimizer/meshoptimizer.h"
 SP_WARNINGS_ON
@@ -42,6 +45,165 @@ using namespace Spartan::Math;
 
 namespace Spartan
 {
+    namespace
+    {
+        // v1 files start with the resource path, v2 files start with this, so the two can be told apart by the first string
+        const char* file_magic                 = "spartan_mesh";
+        const uint32_t file_version            = 2;
+        const uint32_t file_chunk_vertex_count = 64 * 1024;     // geometry is encoded in chunks, so that it can be decoded in parallel
+        const uint32_t file_chunk_index_count  = 3 * 64 * 1024; // the index codec works on whole triangles
+        const int file_quantization_bits       = 16;            // mantissa bits kept by MeshFlags::SaveQuantized
+
+        uint32_t get_chunk_count(const size_t count, const uint32_t chunk_size)
+        {
+            return static_cast<uint32_t>((count + chunk_size - 1) / chunk_size);
+        }
+
+        // maps a unit vector onto the [-1, 1] square, the shaders decode it with decode_octahedral()
+        void encode_octahedral(const float* v, int16_t* encoded)
+        {
+            float length = fabsf(v[0]) + fabsf(v[1]) + fabsf(v[2]);
+            float x      = length > 0.0f ? v[0] / length : 0.0f;
+            float y      = length > 0.0f ? v[1] / length : 0.0f;
+
+            // fold the lower hemisphere over the diagonals
+            if (v[2] < 0.0f)
+            {
+                const float x_folded = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+                const float y_folded = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+                x = x_folded;
+                y = y_folded;
+            }
+
+            encoded[0] = static_cast<int16_t>(meshopt_quantizeSnorm(x, 16));
+            encoded[1] = static_cast<int16_t>(meshopt_quantizeSnorm(y, 16));
+        }
+
+        template<typename T>
+        void pack_attributes(const RHI_Vertex_PosTexNorTan& vertex, T* packed)
+        {
+            packed->tex[0] = meshopt_quantizeHalf(vertex.tex[0]);
+            packed->tex[1] = meshopt_quantizeHalf(vertex.tex[1]);
+            encode_octahedral(vertex.nor, &packed->nor_tan[0]);
+            encode_octahedral(vertex.tan, &packed->nor_tan[2]);
+        }
+
+        // static batches are baked once per model, the result is cached next to it and reused for as long as the same renderables end up in the same batches
+        const char* static_batches_magic      = "spartan_static_batches";
+        const uint32_t static_batches_version = 1;
+        const char* static_batches_extension  = ".batches";
+
+        // the geometry of a static batch, it's made of indices only and they reference the vertices of its members
+        // the offsets are relative to the start of the batch's indices, the indices are relative to its first vertex
+        struct StaticBatch
+        {
+            vector<uint32_t> indices;             // the full detail geometry, followed by the lods
+            uint32_t index_count = 0;             // of the full detail geometry
+            vector<RenderableLod> lods;
+            vector<Meshlet> meshlets;
+            vector<RenderableIndexRange> members; // in member order
+        };
+
+        bool static_batches_load(const string& file_path, const uint64_t key, const uint32_t batch_count, vector<StaticBatch>* batches)
+        {
+            if (!FileSystem::Exists(file_path))
+                return false;
+
+            auto file = make_unique<FileStream>(file_path, FileStream_Read);
+            if (!file->IsOpen() || file->ReadAs<string>() != static_batches_magic || file->ReadAs<uint32_t>() != static_batches_version)
+                return false;
+
+            if (file->ReadAs<uint64_t>() != key || file->ReadAs<uint32_t>() != batch_count)
+                return false;
+
+            batches->resize(batch_count);
+            for (StaticBatch& batch : *batches)
+            {
+                file->Read(&batch.indices);
+                file->Read(&batch.index_count);
+
+                batch.lods.resize(file->ReadAs<uint32_t>());
+                for (RenderableLod& lod : batch.lods)
+                {
+                    file->Read(&lod.index_offset);
+                    file->Read(&lod.index_count);
+                    file->Read(&lod.error);
+                }
+
+                batch.meshlets.resize(file->ReadAs<uint32_t>());
+                for (Meshlet& meshlet : batch.meshlets)
+                {
+                    file->Read(&meshlet.index_offset);
+                    file->Read(&meshlet.index_count);
+                    file->Read(&meshlet.center);
+                    file->Read(&meshlet.radius);
+                    file->Read(&meshlet.cone_apex);
+                    file->Read(&meshlet.cone_axis);
+                    file->Read(&meshlet.cone_cutoff);
+                }
+
+                batch.members.resize(file->ReadAs<uint32_t>());
+                for (RenderableIndexRange& member : batch.members)
+                {
+                    file->Read(&member.index_offset);
+                    file->Read(&member.index_count);
+                }
+            }
+
+            return true;
+        }
+
+        void static_batches_save(const string& file_path, const uint64_t key, const vector<StaticBatch>& batches)
+        {
+            auto file = make_unique<FileStream>(file_path, FileStream_Write);
+            if (!file->IsOpen())
+            {
+                SP_LOG_WARNING("Failed to cache the static batches to \"%s\"", file_path.c_str());
+                return;
+            }
+
+            file->Write(string(static_batches_magic));
+            file->Write(static_batches_version);
+            file->Write(key);
+            file->Write(static_cast<uint32_t>(batches.size()));
+
+            for (const StaticBatch& batch : batches)
+            {
+                file->Write(batch.indices);
+                file->Write(batch.index_count);
+
+                file->Write(static_cast<uint32_t>(batch.lods.size()));
+                for (const RenderableLod& lod : batch.lods)
+                {
+                    file->Write(lod.index_offset);
+                    file->Write(lod.index_count);
+                    file->Write(lod.error);
+                }
+
+                file->Write(static_cast<uint32_t>(batch.meshlets.size()));
+                for (const Meshlet& meshlet : batch.meshlets)
+                {
+                    file->Write(meshlet.index_offset);
+                    file->Write(meshlet.index_count);
+                    file->Write(meshlet.center);
+                    file->Write(meshlet.radius);
+                    file->Write(meshlet.cone_apex);
+                    file->Write(meshlet.cone_axis);
+                    file->Write(meshlet.cone_cutoff);
+                }
+
+                file->Write(static_cast<uint32_t>(batch.members.size()));
+                for (const RenderableIndexRange& member : batch.members)
+                {
+                    file->Write(member.index_offset);
+                    file->Write(member.index_count);
+                }
+            }
+
+            file->Close();
+        }
+    }
+
     Mesh::Mesh() : IResource(ResourceType::Mesh)
     {
         m_flags = GetDefaultFlags();
@@ -49,8 +211,8 @@ namespace Spartan
 
     Mesh::~Mesh()
     {
-        m_index_buffer  = nullptr;
-        m_vertex_buffer = nullptr;
+        GeometryBuffer::Free(m_index_range);
+        GeometryBuffer::Free(m_vertex_range);
     }
 
     void Mesh::Clear()
@@ -75,15 +237,9 @@ namespace Spartan
         // load engine format
         if (FileSystem::GetExtensionFromFilePath(file_path) == EXTENSION_MODEL)
         {
-            // deserialize
-            auto file = make_unique<FileStream>(file_path, FileStream_Read);
-            if (!file->IsOpen())
+            if (!LoadGeometryFromFile(file_path))
                 return false;
 
-            SetResourceFilePath(file->ReadAs<string>());
-            file->Read(&m_indices);
-            file->Read(&m_vertices);
-
             //Optimize();
             ComputeAabb();
             ComputeNormalizedScale();
@@ -98,15 +254,6 @@ namespace Spartan
                 return false;
         }
 
-        // compute memory usage
-        {
-            if (m_vertex_buffer && m_index_buffer)
-            {
-                m_object_size = m_vertex_buffer->GetObjectSize();
-                m_object_size += m_index_buffer->GetObjectSize();
-            }
-        }
-
         SP_LOG_INFO("Loading \"%s\" took %d ms", FileSystem::GetFileNameFromFilePath(file_path).c_str(), static_cast<int>(timer.GetElapsedTimeMs()));
 
         return true;
@@ -118,15 +265,156 @@ namespace Spartan
         if (!file->IsOpen())
             return false;
 
+        const uint32_t index_count  = static_cast<uint32_t>(m_indices.size());
+        const uint32_t vertex_count = static_cast<uint32_t>(m_vertices.size());
+        const bool is_quantized     = m_flags & static_cast<uint32_t>(MeshFlags::SaveQuantized);
+
+        // header
+        file->Write(string(file_magic));
+        file->Write(file_version);
         file->Write(GetResourceFilePath());
-        file->Write(m_indices);
-        file->Write(m_vertices);
+        file->Write(index_count);
+        file->Write(vertex_count);
+        file->Write(is_quantized);
+
+        // indices
+        vector<unsigned char> buffer;
+        for (uint32_t chunk = 0; chunk < get_chunk_count(index_count, file_chunk_index_count); chunk++)
+        {
+            const uint32_t start = chunk * file_chunk_index_count;
+            const uint32_t count = min(file_chunk_index_count, index_count - start);
+
+            buffer.resize(meshopt_encodeIndexBufferBound(count, vertex_count));
+            buffer.resize(meshopt_encodeIndexBuffer(buffer.data(), buffer.size(), &m_indices[start], count));
+            file->Write(buffer);
+        }
+
+        // vertices
+        vector<RHI_Vertex_PosTexNorTan> vertices_quantized;
+        if (is_quantized)
+        {
+            // every float gets its own exponent, the layout stays the same so decoding is done in place
+            vertices_quantized.resize(vertex_count);
+            meshopt_encodeFilterExp(vertices_quantized.data(), vertex_count, sizeof(RHI_Vertex_PosTexNorTan), file_quantization_bits, &m_vertices[0].pos[0], meshopt_EncodeExpSeparate);
+        }
+        const RHI_Vertex_PosTexNorTan* vertices = is_quantized ? vertices_quantized.data() : m_vertices.data();
+
+        for (uint32_t chunk = 0; chunk < get_chunk_count(vertex_count, file_chunk_vertex_count); chunk++)
+        {
+            const uint32_t start = chunk * file_chunk_vertex_count;
+            const uint32_t count = min(file_chunk_vertex_count, vertex_count - start);
+
+            buffer.resize(meshopt_encodeVertexBufferBound(count, sizeof(RHI_Vertex_PosTexNorTan)));
+            buffer.resize(meshopt_encodeVertexBuffer(buffer.data(), buffer.size(), &vertices[start], count, sizeof(RHI_Vertex_PosTexNorTan)));
+            file->Write(buffer);
+        }
 
         file->Close();
 
         return true;
     }
 
+    bool Mesh::LoadGeometryFromFile(const string& file_path)
+    {
+        Clear();
+
+        auto file = make_unique<FileStream>(file_path, FileStream_Read);
+        if (!file->IsOpen())
+            return false;
+
+        // the geometry is only handed to the mesh once all of it has been read and validated
+        vector<uint32_t> indices;
+        vector<RHI_Vertex_PosTexNorTan> vertices;
+        string header = file->ReadAs<string>();
+        if (header != file_magic)
+        {
+            // v1, raw geometry
+            SetResourceFilePath(header);
+            file->Read(&indices);
+            file->Read(&vertices);
+        }
+        else if (!LoadFromFileCompressed(file.get(), &indices, &vertices))
+        {
+            SP_LOG_ERROR("Failed to decode \"%s\"", file_path.c_str());
+            return false;
+        }
+
+        const uint32_t vertex_count = static_cast<uint32_t>(vertices.size());
+        if (!file->IsGood() || indices.empty() || indices.size() % 3 != 0 || any_of(indices.begin(), indices.end(), [vertex_count](const uint32_t index) { return index >= vertex_count; }))
+        {
+            SP_LOG_ERROR("\"%s\" is truncated or corrupt", file_path.c_str());
+            return false;
+        }
+
+        m_indices  = move(indices);
+        m_vertices = move(vertices);
+
+        return true;
+    }
+
+    bool Mesh::LoadFromFileCompressed(FileStream* file, vector<uint32_t>* indices, vector<RHI_Vertex_PosTexNorTan>* vertices)
+    {
+        if (file->ReadAs<uint32_t>() != file_version)
+            return false;
+
+        SetResourceFilePath(file->ReadAs<string>());
+        const uint32_t index_count  = file->ReadAs<uint32_t>();
+        const uint32_t vertex_count = file->ReadAs<uint32_t>();
+        const bool is_quantized     = file->ReadAs<bool>();
+        if (!file->IsGood() || index_count % 3 != 0)
+            return false;
+
+        // read all the chunks, indices first
+        const uint32_t chunk_count_indices  = get_chunk_count(index_count, file_chunk_index_count);
+        const uint32_t chunk_count_vertices = get_chunk_count(vertex_count, file_chunk_vertex_count);
+        vector<vector<unsigned char>> chunks(chunk_count_indices + chunk_count_vertices);
+        for (vector<unsigned char>& chunk : chunks)
+        {
+            file->Read(&chunk);
+        }
+
+        if (!file->IsGood())
+            return false;
+
+        // decode them in parallel, a corrupt chunk is rejected by the codecs
+        indices->resize(index_count);
+        vertices->resize(vertex_count);
+        atomic<bool> failed = false;
+        ThreadPool::ParallelLoop([indices, vertices, &chunks, &failed, chunk_count_indices, index_count, vertex_count, is_quantized](uint32_t chunk_start, uint32_t chunk_end)
+        {
+            for (uint32_t chunk = chunk_start; chunk < chunk_end; chunk++)
+            {
+                const vector<unsigned char>& buffer = chunks[chunk];
+                int result                          = 0;
+
+                if (chunk < chunk_count_indices)
+                {
+                    const uint32_t start = chunk * file_chunk_index_count;
+                    const uint32_t count = min(file_chunk_index_count, index_count - start);
+                    result               = meshopt_decodeIndexBuffer(&(*indices)[start], count, sizeof(uint32_t), buffer.data(), buffer.size());
+                }
+                else
+                {
+                    const uint32_t start = (chunk - chunk_count_indices) * file_chunk_vertex_count;
+                    const uint32_t count = min(file_chunk_vertex_count, vertex_count - start);
+                    result               = meshopt_decodeVertexBuffer(&(*vertices)[start], count, sizeof(RHI_Vertex_PosTexNorTan), buffer.data(), buffer.size());
+
+                    if (result == 0 && is_quantized)
+                    {
+                        meshopt_decodeFilterExp(&(*vertices)[start], count, sizeof(RHI_Vertex_PosTexNorTan));
+                    }
+                }
+
+                if (result != 0)
+                {
+                    failed = true;
+                }
+            }
+        }, static_cast<uint32_t>(chunks.size()), 1);
+
+        return !failed;
+    }
+
     uint32_t Mesh::GetMemoryUsage() const
     {
         uint32_t size = 0;
@@ -204,7 +492,10 @@ namespace Spartan
     {
         return
             static_cast<uint32_t>(MeshFlags::ImportRemoveRedundantData) |
-            static_cast<uint32_t>(MeshFlags::ImportNormalizeScale);
+            static_cast<uint32_t>(MeshFlags::ImportNormalizeScale)      |
+            static_cast<uint32_t>(MeshFlags::ImportLods)                |
+            static_cast<uint32_t>(MeshFlags::ImportMeshlets)            |
+            static_cast<uint32_t>(MeshFlags::PackVertices);
             //static_cast<uint32_t>(MeshFlags::OptimizeVertexCache) |
             //static_cast<uint32_t>(MeshFlags::OptimizeOverdraw) |
             //static_cast<uint32_t>(MeshFlags::OptimizeVertexFetch);
@@ -251,23 +542,565 @@ namespace Spartan
         m_indices  = move(indices);
         m_vertices = move(vertices);
     }
-    void Mesh::CreateGpuBuffers()
+
+    vector<Meshlet> Mesh::ComputeMeshlets(vector<uint32_t>& indices, const vector<RHI_Vertex_PosTexNorTan>& vertices)
     {
-        m_vertex_buffer = make_shared<RHI_Buffer>(RHI_Buffer_Type::Vertex,
-            sizeof(m_vertices[0]),
-            static_cast<uint32_t>(m_vertices.size()),
-            static_cast<void*>(&m_vertices[0]),
-            false,
-            (string("mesh_vertex_buffer_") + m_object_name).c_str()
-        );
+        vector<Meshlet> meshlets;
+        if (indices.size() < meshlet_index_min || vertices.empty())
+            return meshlets;
 
-        m_index_buffer = make_shared<RHI_Buffer>(RHI_Buffer_Type::Index,
-            sizeof(m_indices[0]),
-            static_cast<uint32_t>(m_indices.size()),
-            static_cast<void*>(&m_indices[0]),
-            false,
-            (string("mesh_index_buffer_") + m_object_name).c_str()
+        const float* positions = &vertices[0].pos[0];
+        const size_t stride    = sizeof(RHI_Vertex_PosTexNorTan);
+        const size_t count_max = meshopt_buildMeshletsBound(indices.size(), meshlet_vertex_max, meshlet_triangle_max);
+        vector<meshopt_Meshlet> clusters(count_max);
+        vector<uint32_t> cluster_vertices(count_max * meshlet_vertex_max);
+        vector<uint8_t> cluster_triangles(count_max * meshlet_triangle_max * 3);
+
+        const size_t count = meshopt_buildMeshlets(
+            clusters.data(),
+            cluster_vertices.data(),
+            cluster_triangles.data(),
+            indices.data(),
+            indices.size(),
+            positions,
+            vertices.size(),
+            stride,
+            meshlet_vertex_max,
+            meshlet_triangle_max,
+            meshlet_cone_weight
         );
+
+        // the clusters index into their own vertex lists, expand them back to regular indices, one cluster after the other
+        vector<uint32_t> indices_clustered;
+        indices_clustered.reserve(indices.size());
+        meshlets.reserve(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            const meshopt_Meshlet& cluster = clusters[i];
+            const meshopt_Bounds bounds    = meshopt_computeMeshletBounds(
+                &cluster_vertices[cluster.vertex_offset],
+                &cluster_triangles[cluster.triangle_offset],
+                cluster.triangle_count,
+                positions,
+                vertices.size(),
+                stride
+            );
+
+            Meshlet& meshlet     = meshlets.emplace_back();
+            meshlet.index_offset = static_cast<uint32_t>(indices_clustered.size());
+            meshlet.index_count  = cluster.triangle_count * 3;
+            meshlet.center       = Vector3(bounds.center[0], bounds.center[1], bounds.center[2]);
+            meshlet.radius       = bounds.radius;
+            meshlet.cone_apex    = Vector3(bounds.cone_apex[0], bounds.cone_apex[1], bounds.cone_apex[2]);
+            meshlet.cone_axis    = Vector3(bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2]);
+            meshlet.cone_cutoff  = bounds.cone_cutoff;
+
+            for (uint32_t j = 0; j < meshlet.index_count; j++)
+            {
+                indices_clustered.emplace_back(cluster_vertices[cluster.vertex_offset + cluster_triangles[cluster.triangle_offset + j]]);
+            }
+        }
+
+        SP_ASSERT(indices_clustered.size() == indices.size());
+        indices = move(indices_clustered);
+
+        return meshlets;
+    }
+
+    vector<MeshLod> Mesh::ComputeLods(const vector<uint32_t>& indices, const vector<RHI_Vertex_PosTexNorTan>& vertices)
+    {
+        vector<MeshLod> lods;
+        if (indices.size() < mesh_lod_index_min || vertices.empty())
+            return lods;
+
+        size_t index_count_previous = indices.size();
+        for (uint32_t level = 1; level < mesh_lod_count; level++)
+        {
+            // every level is simplified from the original geometry, so the errors are relative to it and don't accumulate
+            size_t index_count_target = static_cast<size_t>(static_cast<float>(indices.size()) * pow(mesh_lod_index_ratio, static_cast<float>(level)));
+            index_count_target       -= index_count_target % 3;
+
+            MeshLod& lod = lods.emplace_back();
+            lod.indices.resize(indices.size()); // the simplifier needs room for the worst case
+            size_t index_count = meshopt_simplify(
+                lod.indices.data(),
+                indices.data(),
+                indices.size(),
+                &vertices[0].pos[0],
+                vertices.size(),
+                sizeof(RHI_Vertex_PosTexNorTan),
+                index_count_target,
+                mesh_lod_error_max,
+                0,
+                &lod.error
+            );
+
+            // the error bound (or the topology) stopped the simplifier short, so any further level would be the same
+            if (index_count == 0 || index_count > index_count_previous - index_count_previous / 10)
+            {
+                lods.pop_back();
+                break;
+            }
+
+            lod.indices.resize(index_count);
+            lod.indices.shrink_to_fit();
+            index_count_previous = index_count;
+        }
+
+        return lods;
+    }
+
+    RHI_Vertex_Type Mesh::GetPackedVertexType(const vector<RHI_Vertex_PosTexNorTan>& vertices)
+    {
+        float extent    = 0.0f;
+        float extent_uv = 0.0f;
+        for (const RHI_Vertex_PosTexNorTan& vertex : vertices)
+        {
+            extent    = max(extent, max(fabsf(vertex.pos[0]), max(fabsf(vertex.pos[1]), fabsf(vertex.pos[2]))));
+            extent_uv = max(extent_uv, max(fabsf(vertex.tex[0]), fabsf(vertex.tex[1])));
+        }
+
+        // a half rounds to 11 significant bits, so the error is at most this fraction of the largest coordinate
+        const float half_error_relative = 1.0f / 2048.0f;
+
+        // both packed layouts have a half precision uv
+        if (extent_uv * half_error_relative > mesh_packed_uv_error_max)
+            return RHI_Vertex_Type::PosUvNorTan;
+
+        return extent * half_error_relative <= mesh_packed_position_error_max ? RHI_Vertex_Type::PosUvNorTanPackedHalf : RHI_Vertex_Type::PosUvNorTanPacked;
+    }
+
+    void Mesh::PackVertex(const RHI_Vertex_PosTexNorTan& vertex, RHI_Vertex_PosTexNorTanPacked* packed)
+    {
+        packed->pos[0] = vertex.pos[0];
+        packed->pos[1] = vertex.pos[1];
+        packed->pos[2] = vertex.pos[2];
+        pack_attributes(vertex, packed);
+    }
+
+    void Mesh::PackVertex(const RHI_Vertex_PosTexNorTan& vertex, RHI_Vertex_PosTexNorTanPackedHalf* packed)
+    {
+        packed->pos[0] = meshopt_quantizeHalf(vertex.pos[0]);
+        packed->pos[1] = meshopt_quantizeHalf(vertex.pos[1]);
+        packed->pos[2] = meshopt_quantizeHalf(vertex.pos[2]);
+        packed->pos[3] = meshopt_quantizeHalf(1.0f);
+        pack_attributes(vertex, packed);
+    }
+
+    bool Mesh::ComputeOccluder(const vector<uint32_t>& indices, const vector<RHI_Vertex_PosTexNorTan>& vertices, vector<Vector3>* occluder_vertices, vector<uint32_t>* occluder_indices)
+    {
+        SP_ASSERT(occluder_vertices != nullptr && occluder_indices != nullptr);
+
+        occluder_vertices->clear();
+        occluder_indices->clear();
+        if (indices.size() < 3 || vertices.empty())
+            return false;
+
+        // the simplifier only collapses edges, so the hull keeps a subset of the original vertices and never leaves the bounding box
+        vector<uint32_t> indices_simplified(indices.size());
+        size_t index_count = indices.size();
+        if (index_count > mesh_occluder_triangle_target * 3)
+        {
+            index_count = meshopt_simplify(
+                indices_simplified.data(),
+                indices.data(),
+                indices.size(),
+                &vertices[0].pos[0],
+                vertices.size(),
+                sizeof(RHI_Vertex_PosTexNorTan),
+                mesh_occluder_triangle_target * 3,
+                mesh_occluder_error_max
+            );
+        }
+        else
+        {
+            indices_simplified = indices;
+        }
+
+        if (index_count == 0 || index_count > mesh_occluder_triangle_max * 3)
+            return false;
+
+        // compact the vertices, only the positions are needed
+        vector<uint32_t> remap(vertices.size(), numeric_limits<uint32_t>::max());
+        occluder_indices->reserve(index_count);
+        for (size_t i = 0; i < index_count; i++)
+        {
+            uint32_t& index = remap[indices_simplified[i]];
+            if (index == numeric_limits<uint32_t>::max())
+            {
+                const float* position = vertices[indices_simplified[i]].pos;
+                index                 = static_cast<uint32_t>(occluder_vertices->size());
+                occluder_vertices->emplace_back(position[0], position[1], position[2]);
+            }
+
+            occluder_indices->emplace_back(index);
+        }
+
+        return true;
+    }
+
+    void Mesh::BatchStatic(const float cell_size /*= 16.0f*/)
+    {
+        shared_ptr<Entity> root = m_root_entity.lock();
+        SP_ASSERT_MSG(root != nullptr, "The mesh has no root entity");
+
+        // the batches reference the same (cached) materials as the renderables they are made of
+        map<Material*, shared_ptr<Material>> materials;
+        for (shared_ptr<IResource>& resource : ResourceCache::GetByType(ResourceType::Material))
+        {
+            materials[static_cast<Material*>(resource.get())] = static_pointer_cast<Material>(resource);
+        }
+
+        // the geometry of a renderable, relative to the mesh
+        auto get_index_offset  = [](Renderable* renderable) { return renderable->GetIndexOffset()  - renderable->GetMeshIndexOffset();  };
+        auto get_vertex_offset = [](Renderable* renderable) { return renderable->GetVertexOffset() - renderable->GetMeshVertexOffset(); };
+
+        // group by material, shadow casting, the cell the bounding box center falls in and the transform,
+        // a batch is drawn with a single transform since it shares the vertices of its members instead of copying them
+        struct Group
+        {
+            vector<Entity*> entities;
+            vector<uint32_t> descendant_indices; // stable across imports, unlike pointers and ids
+        };
+        vector<Group> groups;
+        {
+            using BatchKey = tuple<Material*, bool, int32_t, int32_t, int32_t, array<float, 16>>;
+            map<BatchKey, Group> groups_keyed;
+
+            vector<Entity*> descendants;
+            root->GetDescendants(&descendants);
+
+            for (uint32_t descendant_index = 0; descendant_index < static_cast<uint32_t>(descendants.size()); descendant_index++)
+            {
+                Entity* entity         = descendants[descendant_index];
+                Renderable* renderable = entity->GetComponentRaw<Renderable>();
+                if (!entity->IsActive() || !renderable || !materials.contains(renderable->GetMaterial()) || renderable->GetMesh() != this)
+                    continue;
+
+                // already batched, or a batch itself
+                if (renderable->HasFlag(RenderableFlags::StaticBatched) || renderable->HasSubmeshes() || renderable->HasInstancing())
+                    continue;
+
+                // transparent renderables are sorted back-to-front individually
+                if (renderable->GetMaterial()->IsTransparent())
+                    continue;
+
+                // anything that can move
+                if (PhysicsBody* physics_body = entity->GetComponentRaw<PhysicsBody>())
+                {
+                    if (physics_body->GetMass() != 0.0f || physics_body->GetIsKinematic())
+                        continue;
+                }
+
+                const Matrix matrix = entity->GetMatrix();
+                array<float, 16> transform;
+                copy(matrix.Data(), matrix.Data() + 16, transform.begin());
+
+                const Vector3 center = renderable->GetBoundingBox(BoundingBoxType::Transformed).GetCenter() / cell_size;
+                BatchKey key         = BatchKey(
+                    renderable->GetMaterial(),
+                    renderable->HasFlag(RenderableFlags::CastsShadows),
+                    static_cast<int32_t>(floor(center.x)),
+                    static_cast<int32_t>(floor(center.y)),
+                    static_cast<int32_t>(floor(center.z)),
+                    transform
+                );
+
+                Group& group = groups_keyed[key];
+                group.entities.emplace_back(entity);
+                group.descendant_indices.emplace_back(descendant_index);
+            }
+
+            // in the order of the hierarchy, so that the batches (and their cache) don't depend on where the materials landed in memory
+            for (auto& [key, group] : groups_keyed)
+            {
+                if (group.entities.size() >= 2)
+                {
+                    groups.emplace_back(move(group));
+                }
+            }
+            sort(groups.begin(), groups.end(), [](const Group& a, const Group& b) { return a.descendant_indices[0] < b.descendant_indices[0]; });
+        }
+
+        if (groups.empty())
+            return;
+
+        // the cache is only valid for the same geometry, split into the same batches
+        uint64_t key = rhi_hash_combine(m_indices.size(), m_vertices.size());
+        key          = rhi_hash_combine(key, static_cast<uint64_t>(m_flags & (static_cast<uint32_t>(MeshFlags::ImportLods) | static_cast<uint32_t>(MeshFlags::ImportMeshlets))));
+        for (const Group& group : groups)
+        {
+            key = rhi_hash_combine(key, group.entities.size());
+            for (uint32_t i = 0; i < static_cast<uint32_t>(group.entities.size()); i++)
+            {
+                Renderable* renderable = group.entities[i]->GetComponentRaw<Renderable>();
+                key = rhi_hash_combine(key, group.descendant_indices[i]);
+                key = rhi_hash_combine(key, get_index_offset(renderable));
+                key = rhi_hash_combine(key, renderable->GetIndexCount());
+            }
+        }
+
+        // the vertices of a batch are those of its members, the batch starts at the first one
+        auto get_vertex_range = [&get_vertex_offset](const Group& group, uint32_t* vertex_offset, uint32_t* vertex_count)
+        {
+            uint32_t vertex_start = numeric_limits<uint32_t>::max();
+            uint32_t vertex_end   = 0;
+            for (Entity* entity : group.entities)
+            {
+                Renderable* renderable = entity->GetComponentRaw<Renderable>();
+                vertex_start           = min(vertex_start, get_vertex_offset(renderable));
+                vertex_end             = max(vertex_end,   get_vertex_offset(renderable) + renderable->GetVertexCount());
+            }
+
+            *vertex_offset = vertex_start;
+            *vertex_count  = vertex_end - vertex_start;
+        };
+
+        // bake the batches, or load them if that was done before
+        const string file_path_cache = FileSystem::ReplaceExtension(GetResourceFilePath(), static_batches_extension);
+        vector<StaticBatch> batches;
+        if (!static_batches_load(file_path_cache, key, static_cast<uint32_t>(groups.size()), &batches))
+        {
+            batches.clear();
+            batches.resize(groups.size());
+
+            ThreadPool::ParallelLoop([&](uint32_t group_start, uint32_t group_end)
+            {
+                for (uint32_t group_index = group_start; group_index < group_end; group_index++)
+                {
+                    const Group& group = groups[group_index];
+                    StaticBatch& batch = batches[group_index];
+
+                    uint32_t vertex_offset = 0;
+                    uint32_t vertex_count  = 0;
+                    get_vertex_range(group, &vertex_offset, &vertex_count);
+
+                    // the lods and meshlets are computed on a compact copy of the vertices the batch actually uses,
+                    // the members can be far apart in the mesh, the indices are mapped back once done
+                    vector<uint32_t> remap(vertex_count, numeric_limits<uint32_t>::max());
+                    vector<uint32_t> remap_inverse;
+                    vector<RHI_Vertex_PosTexNorTan> vertices;
+                    vector<uint32_t> indices;
+                    for (Entity* entity : group.entities)
+                    {
+                        Renderable* renderable       = entity->GetComponentRaw<Renderable>();
+                        const uint32_t index_offset  = get_index_offset(renderable);
+                        const uint32_t vertex_member = get_vertex_offset(renderable) - vertex_offset;
+
+                        batch.members.push_back({ static_cast<uint32_t>(indices.size()), renderable->GetIndexCount() });
+                        for (uint32_t i = index_offset; i < index_offset + renderable->GetIndexCount(); i++)
+                        {
+                            uint32_t& index = remap[vertex_member + m_indices[i]];
+                            if (index == numeric_limits<uint32_t>::max())
+                            {
+                                index = static_cast<uint32_t>(vertices.size());
+                                remap_inverse.emplace_back(vertex_member + m_indices[i]);
+                                vertices.emplace_back(m_vertices[vertex_offset + vertex_member + m_indices[i]]);
+                            }
+
+                            indices.emplace_back(index);
+                        }
+                    }
+                    batch.index_count = static_cast<uint32_t>(indices.size());
+
+                    // meshlets, built per member so that the members stay contiguous ranges which can still be culled individually
+                    if ((m_flags & static_cast<uint32_t>(MeshFlags::ImportMeshlets)) && batch.index_count >= meshlet_index_min)
+                    {
+                        for (uint32_t member_index = 0; member_index < static_cast<uint32_t>(batch.members.size()); member_index++)
+                        {
+                            const RenderableIndexRange& member = batch.members[member_index];
+                            vector<uint32_t> indices_member(indices.begin() + member.index_offset, indices.begin() + member.index_offset + member.index_count);
+
+                            vector<Meshlet> meshlets = ComputeMeshlets(indices_member, vertices);
+                            if (meshlets.empty())
+                            {
+                                // too small to be split, it becomes a single meshlet without a normal cone
+                                const BoundingBox& bounding_box = group.entities[member_index]->GetComponentRaw<Renderable>()->GetBoundingBox(BoundingBoxType::Mesh);
+                                Meshlet& meshlet                = meshlets.emplace_back();
+                                meshlet.index_count             = member.index_count;
+                                meshlet.center                  = bounding_box.GetCenter();
+                                meshlet.radius                  = bounding_box.GetExtents().Length();
+                            }
+
+                            copy(indices_member.begin(), indices_member.end(), indices.begin() + member.index_offset);
+                            for (Meshlet& meshlet : meshlets)
+                            {
+                                meshlet.index_offset += member.index_offset;
+                                batch.meshlets.emplace_back(meshlet);
+                            }
+                        }
+                    }
+
+                    // lods, simplified across the members, so small pieces which wouldn't get any on their own do here
+                    batch.indices = indices;
+                    if (m_flags & static_cast<uint32_t>(MeshFlags::ImportLods))
+                    {
+                        for (MeshLod& lod : ComputeLods(indices, vertices))
+                        {
+                            RenderableLod& renderable_lod = batch.lods.emplace_back();
+                            renderable_lod.index_offset   = static_cast<uint32_t>(batch.indices.size());
+                            renderable_lod.index_count    = static_cast<uint32_t>(lod.indices.size());
+                            renderable_lod.error          = lod.error;
+
+                            batch.indices.insert(batch.indices.end(), lod.indices.begin(), lod.indices.end());
+                        }
+                    }
+
+                    for (uint32_t& index : batch.indices)
+                    {
+                        index = remap_inverse[index];
+                    }
+                }
+            }, static_cast<uint32_t>(groups.size()), 1);
+
+            static_batches_save(file_path_cache, key, batches);
+        }
+
+        // the batches are parented to the root and take the transform their members share
+        const Matrix root_inverse = root->GetMatrix().Inverted();
+        uint32_t merged_count     = 0;
+        for (uint32_t group_index = 0; group_index < static_cast<uint32_t>(groups.size()); group_index++)
+        {
+            const Group& group       = groups[group_index];
+            const StaticBatch& batch = batches[group_index];
+
+            uint32_t vertex_offset = 0;
+            uint32_t vertex_count  = 0;
+            get_vertex_range(group, &vertex_offset, &vertex_count);
+
+            uint32_t index_offset = 0;
+            AddIndices(batch.indices, &index_offset);
+
+            // create the batch
+            Renderable* renderable_first = group.entities[0]->GetComponentRaw<Renderable>();
+            Material* material           = renderable_first->GetMaterial();
+            shared_ptr<Entity> entity    = World::CreateEntity();
+            entity->SetObjectName(material->GetObjectName() + "_static_batch");
+            entity->SetParent(root);
+            {
+                Vector3 scale;
+                Quaternion rotation;
+                Vector3 position;
+                (group.entities[0]->GetMatrix() * root_inverse).Decompose(scale, rotation, position);
+                entity->SetPositionLocal(position);
+                entity->SetRotationLocal(rotation);
+                entity->SetScaleLocal(scale);
+            }
+
+            // every member becomes a submesh, so that the batch can still be culled per member
+            vector<RenderableSubmesh> submeshes;
+            BoundingBox aabb = BoundingBox::Undefined;
+            for (uint32_t member_index = 0; member_index < static_cast<uint32_t>(group.entities.size()); member_index++)
+            {
+                Entity* member = group.entities[member_index];
+
+                RenderableSubmesh& submesh = submeshes.emplace_back();
+                submesh.index_offset       = index_offset + batch.members[member_index].index_offset;
+                submesh.index_count        = batch.members[member_index].index_count;
+                submesh.bounding_box       = member->GetComponentRaw<Renderable>()->GetBoundingBox(BoundingBoxType::Mesh);
+                submesh.entity_id          = member->GetObjectId();
+                submesh.transform          = Matrix::Identity; // they share the batch's transform
+                aabb.Merge(submesh.bounding_box);
+            }
+
+            Renderable* renderable = entity->AddComponent<Renderable>().get();
+            renderable->SetGeometry(this, aabb, index_offset, batch.index_count, vertex_offset, vertex_count);
+            renderable->SetSubmeshes(submeshes);
+            renderable->SetMaterial(materials[material]);
+            renderable->SetFlag(RenderableFlags::CastsShadows, renderable_first->HasFlag(RenderableFlags::CastsShadows));
+
+            vector<RenderableLod> lods = batch.lods;
+            for (RenderableLod& lod : lods)
+            {
+                lod.index_offset += index_offset;
+            }
+            renderable->SetLods(lods);
+
+            vector<Meshlet> meshlets = batch.meshlets;
+            for (Meshlet& meshlet : meshlets)
+            {
+                meshlet.index_offset += index_offset;
+            }
+            renderable->SetMeshlets(meshlets);
+
+            for (Entity* member : group.entities)
+            {
+                member->GetComponentRaw<Renderable>()->SetStaticBatch(entity->GetObjectId());
+            }
+
+            merged_count += static_cast<uint32_t>(group.entities.size());
+        }
+
+        // the buffers have to include the indices of the batches
+        CreateGpuBuffers();
+
+        World::Resolve();
+
+        SP_LOG_INFO("Merged %d static renderables of \"%s\" into %d batches", merged_count, GetObjectName().c_str(), static_cast<uint32_t>(groups.size()));
+    }
+
+    void Mesh::CreateGpuBuffers()
+    {
+        // the previous ranges are retired at the next sync point, frames in flight may still be reading them
+        GeometryBuffer::Free(m_index_range);
+        GeometryBuffer::Free(m_vertex_range);
+
+        // the standard meshes are drawn by passes which only have shaders for the full layout
+        m_vertex_type = RHI_Vertex_Type::PosUvNorTan;
+        if ((m_flags & static_cast<uint32_t>(MeshFlags::PackVertices)) && m_type == MeshType::Custom)
+        {
+            m_vertex_type = GetPackedVertexType(m_vertices);
+            if (m_vertex_type == RHI_Vertex_Type::PosUvNorTan)
+            {
+                SP_LOG_INFO("The uv range of \"%s\" is too large for a packed layout, keeping the full one", GetObjectName().c_str());
+            }
+        }
+
+        // the cpu copy keeps full precision, it's what gets saved, merged and handed to physics
+        const uint32_t vertex_count = static_cast<uint32_t>(m_vertices.size());
+        uint32_t vertex_stride      = sizeof(m_vertices[0]);
+        if (m_vertex_type == RHI_Vertex_Type::PosUvNorTanPackedHalf)
+        {
+            vector<RHI_Vertex_PosTexNorTanPackedHalf> vertices(m_vertices.size());
+            for (size_t i = 0; i < m_vertices.size(); i++)
+            {
+                PackVertex(m_vertices[i], &vertices[i]);
+            }
+
+            vertex_stride  = sizeof(vertices[0]);
+            m_vertex_range = GeometryBuffer::AllocateVertices(this, m_vertex_type, vertex_stride, &vertices[0], vertex_count);
+        }
+        else if (m_vertex_type == RHI_Vertex_Type::PosUvNorTanPacked)
+        {
+            vector<RHI_Vertex_PosTexNorTanPacked> vertices(m_vertices.size());
+            for (size_t i = 0; i < m_vertices.size(); i++)
+            {
+                PackVertex(m_vertices[i], &vertices[i]);
+            }
+
+            vertex_stride  = sizeof(vertices[0]);
+            m_vertex_range = GeometryBuffer::AllocateVertices(this, m_vertex_type, vertex_stride, &vertices[0], vertex_count);
+        }
+        else
+        {
+            m_vertex_range = GeometryBuffer::AllocateVertices(this, m_vertex_type, vertex_stride, &m_vertices[0], vertex_count);
+        }
+
+        m_index_range = GeometryBuffer::AllocateIndices(this, &m_indices[0], static_cast<uint32_t>(m_indices.size()));
+
+        m_object_size = static_cast<uint64_t>(vertex_count) * vertex_stride + m_indices.size() * sizeof(m_indices[0]);
+    }
+
+    void Mesh::OnGeometryMoved(const RHI_Buffer* buffer, const uint32_t offset_old, const uint32_t offset_new)
+    {
+        if (m_vertex_range.buffer == buffer && m_vertex_range.offset == offset_old)
+        {
+            m_vertex_range.offset = offset_new;
+        }
+        else if (m_index_range.buffer == buffer && m_index_range.offset == offset_old)
+        {
+            m_index_range.offset = offset_new;
+        }
     }
 
     void Mesh::SetMaterial(shared_ptr<Material>& material, Entity* entity) const
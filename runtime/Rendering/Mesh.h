@@ -27,10 +27,13 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../Resource/IResource.h"
 #include "../Math/BoundingBox.h"
 #include "../RHI/RHI_Vertex.h"
+#include "GeometryBuffer.h"
 //================================
 
 namespace Spartan
 {
+    class FileStream;
+
     enum class MeshFlags : uint32_t
     {
         ImportRemoveRedundantData = 1 << 0,
@@ -40,6 +43,54 @@ namespace Spartan
         OptimizeVertexCache       = 1 << 4,
         OptimizeVertexFetch       = 1 << 5,
         OptimizeOverdraw          = 1 << 6,
+        ImportLods                = 1 << 7,
+        ImportMeshlets            = 1 << 8,
+        SaveQuantized             = 1 << 9, // lossy, the vertex attributes are saved with fewer mantissa bits so that they compress better
+        PackVertices              = 1 << 10 // lossy, the gpu copy of custom meshes uses a compact vertex layout when their bounds allow it (see RHI_Vertex_PosTexNorTanPacked)
+    };
+
+    // packed vertices get a half precision position when the worst case rounding error of the mesh's bounds stays below this, a float one otherwise
+    constexpr float mesh_packed_position_error_max = 0.001f; // in local units
+
+    // packed vertices have a half precision uv, meshes whose uv range is too large for that (tiling, atlases) keep the full layout
+    constexpr float mesh_packed_uv_error_max = 1.0f / 1024.0f; // in uv units, [-2, 2] fits
+
+    // lod chain generated at import, every level targets a fraction of the previous level's indices while staying within an error bound
+    constexpr uint32_t mesh_lod_count     = 4;     // including the original geometry
+    constexpr float mesh_lod_index_ratio  = 0.5f;
+    constexpr float mesh_lod_error_max    = 0.05f; // relative to the extents of the geometry
+    constexpr uint32_t mesh_lod_index_min = 1024;  // geometry with fewer indices isn't worth simplifying
+
+    // occluder hulls, coarse versions of the geometry which are rasterized by the software occlusion culling (see OcclusionBuffer)
+    constexpr uint32_t mesh_occluder_triangle_target = 128;
+    constexpr uint32_t mesh_occluder_triangle_max    = 512;   // geometry which can't get below this within the error bound doesn't occlude
+    constexpr float mesh_occluder_error_max          = 0.02f; // relative to the extents of the geometry, the hull is not conservative so this stays tight
+
+    struct MeshLod
+    {
+        std::vector<uint32_t> indices;
+        float error = 0.0f; // relative to the extents of the geometry
+    };
+
+    // clusters built at import for large geometry, so that it can be culled piece by piece instead of all-or-nothing
+    constexpr uint32_t meshlet_vertex_max   = 64;
+    constexpr uint32_t meshlet_triangle_max = 124;
+    constexpr float meshlet_cone_weight     = 0.25f; // favours clusters with tight normal cones, so that more of them can be back-face culled
+    constexpr uint32_t meshlet_index_min    = 3 * 8192; // geometry with fewer indices is cheaper to draw than to cull
+
+    struct Meshlet
+    {
+        uint32_t index_offset = 0;
+        uint32_t index_count  = 0;
+
+        // bounding sphere
+        Math::Vector3 center = Math::Vector3::Zero;
+        float radius         = 0.0f;
+
+        // normal cone, the cluster faces away from any point p for which dot(normalize(cone_apex - p), cone_axis) >= cone_cutoff
+        Math::Vector3 cone_apex = Math::Vector3::Zero;
+        Math::Vector3 cone_axis = Math::Vector3::Zero;
+        float cone_cutoff       = 1.0f;
     };
 
     enum class MeshType
@@ -64,6 +115,9 @@ namespace Spartan
         bool LoadFromFile(const std::string& file_path) override;
         bool SaveToFile(const std::string& file_path) override;
 
+        // reads the geometry of an engine file, without the gpu buffers, on failure the mesh is left without geometry
+        bool LoadGeometryFromFile(const std::string& file_path);
+
         // geometry
         void Clear();
         void GetGeometry(
@@ -92,10 +146,16 @@ namespace Spartan
         const Math::BoundingBox& GetAabb() const { return m_aabb; }
         void ComputeAabb();
 
-        // gpu buffers
+        // gpu buffers, the geometry lives in the shared geometry buffer, the offsets locate it there
         void CreateGpuBuffers();
-        RHI_Buffer* GetIndexBuffer()  { return m_index_buffer.get();  }
-        RHI_Buffer* GetVertexBuffer() { return m_vertex_buffer.get(); }
+        RHI_Buffer* GetIndexBuffer()           { return m_index_range.buffer;  }
+        RHI_Buffer* GetVertexBuffer()          { return m_vertex_range.buffer; }
+        uint32_t GetIndexBufferOffset() const  { return m_index_range.offset;  }
+        uint32_t GetVertexBufferOffset() const { return m_vertex_range.offset; }
+        RHI_Vertex_Type GetVertexType() const  { return m_vertex_type; }
+
+        // called by the geometry buffer when a defragmentation moves one of the ranges
+        void OnGeometryMoved(const RHI_Buffer* buffer, const uint32_t offset_old, const uint32_t offset_new);
 
         // root entity
         std::weak_ptr<Entity> GetRootEntity() { return m_root_entity; }
@@ -106,21 +166,53 @@ namespace Spartan
         void SetType(const MeshType type) { m_type = type; }
 
         // misc
-        uint32_t GetFlags() const { return m_flags; }
+        uint32_t GetFlags() const           { return m_flags; }
+        void SetFlags(const uint32_t flags) { m_flags = flags; }
         static uint32_t GetDefaultFlags();
         float ComputeNormalizedScale();
         void Optimize();
+
+        // reorders the indices so that every cluster is a contiguous range, the offsets are relative to the start of the indices
+        static std::vector<Meshlet> ComputeMeshlets(std::vector<uint32_t>& indices, const std::vector<RHI_Vertex_PosTexNorTan>& vertices);
+
+        // returns the levels after the original geometry, coarsest last, they reference the same vertices
+        static std::vector<MeshLod> ComputeLods(const std::vector<uint32_t>& indices, const std::vector<RHI_Vertex_PosTexNorTan>& vertices);
+
+        // the most compact layout which keeps the rounding errors of the position and the uv within bounds, the full one if there is none
+        static RHI_Vertex_Type GetPackedVertexType(const std::vector<RHI_Vertex_PosTexNorTan>& vertices);
+
+        // the uv is half precision, the normal and the tangent are octahedral encoded, the position is kept or halved depending on the layout
+        static void PackVertex(const RHI_Vertex_PosTexNorTan& vertex, RHI_Vertex_PosTexNorTanPacked* packed);
+        static void PackVertex(const RHI_Vertex_PosTexNorTan& vertex, RHI_Vertex_PosTexNorTanPackedHalf* packed);
+
+        // simplifies the geometry into an occluder hull with its own compact vertices, returns false if it can't be simplified enough
+        static bool ComputeOccluder(
+            const std::vector<uint32_t>& indices,
+            const std::vector<RHI_Vertex_PosTexNorTan>& vertices,
+            std::vector<Math::Vector3>* occluder_vertices,
+            std::vector<uint32_t>* occluder_indices
+        );
+
+        // merges the static renderables under the root entity which share a material, a spatial cell and a transform into one renderable each,
+        // a batch is a range of indices which references the vertices of its members, with its own lods and meshlets, and it's drawn in their place
+        // the indices are baked once and cached next to the model, the batches are serialized with the world
+        // a batch is dissolved by the world as soon as one of its members is removed, deactivated or moved
+        void BatchStatic(const float cell_size = 16.0f);
         void SetMaterial(std::shared_ptr<Material>& material, Entity* entity) const;
         void AddTexture(std::shared_ptr<Material>& material, MaterialTexture texture_type, const std::string& file_path, bool is_gltf);
 
     private:
+        // v2 files, the geometry is compressed with the meshoptimizer codecs
+        bool LoadFromFileCompressed(FileStream* file, std::vector<uint32_t>* indices, std::vector<RHI_Vertex_PosTexNorTan>* vertices);
+
         // geometry
         std::vector<RHI_Vertex_PosTexNorTan> m_vertices;
         std::vector<uint32_t> m_indices;
 
         // gpu buffers
-        std::shared_ptr<RHI_Buffer> m_vertex_buffer;
-        std::shared_ptr<RHI_Buffer> m_index_buffer;
+        GeometryRange m_vertex_range;
+        GeometryRange m_index_range;
+        RHI_Vertex_Type m_vertex_type = RHI_Vertex_Type::PosUvNorTan;
 
         // aabb
         Math::BoundingBox m_aabb;
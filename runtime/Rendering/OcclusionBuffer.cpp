@@ -0,0 +1,421 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+//= INCLUDES ==============
+#include "pch.h"
+#include "OcclusionBuffer.h"
+#include "ThreadPool.h"
+//=========================
+
+//= NAMESPACES ===============
+using namespace std;
+using namespace Spartan::Math;
+//============================
+
+namespace Spartan
+{
+    namespace
+    {
+        // triangles which reach further out than this (in pixels) are dropped, the edge functions would lose too much precision
+        const float guard_band = 8192.0f;
+
+        // scratch, the screen space vertices of the occluder a thread is setting up
+        thread_local vector<float> screen_vertices;
+
+        // x, y in pixels (top-left origin) and 1/w, returns false if the point is in front of the near plane
+        bool project(const Matrix& world_view_projection, const Vector3& position, const float near_plane, float* out)
+        {
+            const Vector4 clip = world_view_projection * Vector4(position, 1.0f);
+            if (clip.w < near_plane)
+                return false;
+
+            const float w_inv = 1.0f / clip.w;
+            out[0]            = (clip.x * w_inv * 0.5f + 0.5f) * static_cast<float>(OcclusionBuffer::width);
+            out[1]            = (0.5f - clip.y * w_inv * 0.5f) * static_cast<float>(OcclusionBuffer::height);
+            out[2]            = w_inv;
+
+            return true;
+        }
+    }
+
+    OcclusionBuffer::OcclusionBuffer()
+    {
+        m_depth.resize(width * height, 0.0f);
+        m_tile_min.resize(tile_count_x * tile_count_y, 0.0f);
+        m_tile_max.resize(tile_count_x * tile_count_y, 0.0f);
+    }
+
+    void OcclusionBuffer::Begin(const Matrix& view_projection, const float near_plane)
+    {
+        m_view_projection = view_projection;
+        m_near_plane      = near_plane;
+        m_triangle_count  = 0;
+        m_occluders.clear();
+    }
+
+    void OcclusionBuffer::AddOccluder(const Matrix& transform, const vector<Vector3>* vertices, const vector<uint32_t>* indices)
+    {
+        SP_ASSERT(vertices != nullptr && indices != nullptr);
+
+        if (vertices->empty() || indices->size() < 3)
+            return;
+
+        Occluder& occluder = m_occluders.emplace_back();
+        occluder.transform = transform;
+        occluder.vertices  = vertices;
+        occluder.indices   = indices;
+    }
+
+    void OcclusionBuffer::Rasterize()
+    {
+        if (m_occluders.empty())
+            return;
+
+        // 1. set up the triangles, every occluder owns a contiguous range of them
+        uint32_t triangle_count = 0;
+        for (Occluder& occluder : m_occluders)
+        {
+            occluder.triangle_offset  = triangle_count;
+            triangle_count           += static_cast<uint32_t>(occluder.indices->size() / 3);
+        }
+        m_triangles.resize(triangle_count);
+
+        atomic<uint32_t> triangle_count_visible = 0;
+        ThreadPool::ParallelLoop([this, &triangle_count_visible](uint32_t index_start, uint32_t index_end)
+        {
+            uint32_t count = 0;
+            for (uint32_t i = index_start; i < index_end; i++)
+            {
+                count += SetupTriangles(m_occluders[i], screen_vertices);
+            }
+
+            triangle_count_visible += count;
+        }, static_cast<uint32_t>(m_occluders.size()), 1);
+        m_triangle_count = triangle_count_visible;
+
+        // 2. rasterize them, band by band, so that no two threads ever write the same pixel
+        ThreadPool::ParallelLoop([this](uint32_t band_start, uint32_t band_end)
+        {
+            for (uint32_t band = band_start; band < band_end; band++)
+            {
+                RasterizeBand(band);
+            }
+        }, height / band_height, 1);
+    }
+
+    uint32_t OcclusionBuffer::SetupTriangles(const Occluder& occluder, vector<float>& screen)
+    {
+        const Matrix world_view_projection = occluder.transform * m_view_projection;
+        const vector<Vector3>& vertices    = *occluder.vertices;
+        const vector<uint32_t>& indices    = *occluder.indices;
+        const uint32_t triangle_count      = static_cast<uint32_t>(indices.size() / 3);
+
+        // a negative 1/w marks the vertices which are in front of the near plane
+        screen.resize(vertices.size() * 3);
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            if (!project(world_view_projection, vertices[i], m_near_plane, &screen[i * 3]))
+            {
+                screen[i * 3 + 2] = -1.0f;
+            }
+        }
+
+        uint32_t count = 0;
+        for (uint32_t t = 0; t < triangle_count; t++)
+        {
+            Triangle& triangle = m_triangles[occluder.triangle_offset + t];
+            triangle           = Triangle();
+
+            const float* v[3] =
+            {
+                &screen[indices[t * 3 + 0] * 3],
+                &screen[indices[t * 3 + 1] * 3],
+                &screen[indices[t * 3 + 2] * 3]
+            };
+
+            // triangles which cross the near plane are dropped instead of clipped, an occluder can only lose coverage this way
+            if (v[0][2] <= 0.0f || v[1][2] <= 0.0f || v[2][2] <= 0.0f)
+                continue;
+
+            const float x_min = min(v[0][0], min(v[1][0], v[2][0]));
+            const float x_max = max(v[0][0], max(v[1][0], v[2][0]));
+            const float y_min = min(v[0][1], min(v[1][1], v[2][1]));
+            const float y_max = max(v[0][1], max(v[1][1], v[2][1]));
+            if (x_min < -guard_band || y_min < -guard_band || x_max > guard_band || y_max > guard_band)
+                continue;
+
+            // the pixels whose centers lie within the bounds
+            if (x_max < 0.5f || y_max < 0.5f || x_min > static_cast<float>(width) - 0.5f || y_min > static_cast<float>(height) - 0.5f)
+                continue;
+
+            triangle.x_min = static_cast<int32_t>(ceil(max(x_min - 0.5f, 0.0f)));
+            triangle.x_max = static_cast<int32_t>(floor(min(x_max - 0.5f, static_cast<float>(width - 1))));
+            triangle.y_min = static_cast<int32_t>(ceil(max(y_min - 0.5f, 0.0f)));
+            triangle.y_max = static_cast<int32_t>(floor(min(y_max - 0.5f, static_cast<float>(height - 1))));
+            if (triangle.x_min > triangle.x_max || triangle.y_min > triangle.y_max)
+            {
+                triangle = Triangle();
+                continue;
+            }
+
+            // edge i is opposite of vertex i, so it's zero on the other two vertices and the area on its own one
+            for (uint32_t e = 0; e < 3; e++)
+            {
+                const float* from  = v[(e + 1) % 3];
+                const float* to    = v[(e + 2) % 3];
+                triangle.edge_a[e] = from[1] - to[1];
+                triangle.edge_b[e] = to[0] - from[0];
+                triangle.edge_c[e] = from[0] * to[1] - to[0] * from[1];
+            }
+
+            // both windings are rasterized, so the edges are flipped to make the inside positive
+            float area = triangle.edge_a[0] * v[0][0] + triangle.edge_b[0] * v[0][1] + triangle.edge_c[0];
+            if (abs(area) < 1e-4f)
+            {
+                triangle = Triangle();
+                continue;
+            }
+
+            if (area < 0.0f)
+            {
+                for (uint32_t e = 0; e < 3; e++)
+                {
+                    triangle.edge_a[e] = -triangle.edge_a[e];
+                    triangle.edge_b[e] = -triangle.edge_b[e];
+                    triangle.edge_c[e] = -triangle.edge_c[e];
+                }
+                area = -area;
+            }
+
+            // 1/w is linear in screen space, the edge functions divided by the area are the barycentrics
+            const float area_inv = 1.0f / area;
+            triangle.depth_a     = (triangle.edge_a[0] * v[0][2] + triangle.edge_a[1] * v[1][2] + triangle.edge_a[2] * v[2][2]) * area_inv;
+            triangle.depth_b     = (triangle.edge_b[0] * v[0][2] + triangle.edge_b[1] * v[1][2] + triangle.edge_b[2] * v[2][2]) * area_inv;
+            triangle.depth_c     = (triangle.edge_c[0] * v[0][2] + triangle.edge_c[1] * v[1][2] + triangle.edge_c[2] * v[2][2]) * area_inv;
+            triangle.depth_min   = min(v[0][2], min(v[1][2], v[2][2]));
+            triangle.depth_max   = max(v[0][2], max(v[1][2], v[2][2]));
+
+            // the depth is sampled at the pixel center, push it back to the farthest point of the pixel so that the occluder stays conservative
+            triangle.depth_c -= 0.5f * (abs(triangle.depth_a) + abs(triangle.depth_b));
+
+            count++;
+        }
+
+        return count;
+    }
+
+    void OcclusionBuffer::RasterizeBand(const uint32_t band)
+    {
+        const int32_t row_start = static_cast<int32_t>(band * band_height);
+        const int32_t row_end   = row_start + static_cast<int32_t>(band_height) - 1;
+        float* depth            = m_depth.data();
+
+        fill(depth + row_start * width, depth + (row_end + 1) * width, 0.0f);
+
+        for (const Triangle& triangle : m_triangles)
+        {
+            const int32_t y_min = max(triangle.y_min, row_start);
+            const int32_t y_max = min(triangle.y_max, row_end);
+            if (y_min > y_max)
+                continue;
+
+            for (int32_t y = y_min; y <= y_max; y++)
+            {
+                if (m_simd)
+                {
+                    RasterizeRowSimd(triangle, y, depth + y * width);
+                }
+                else
+                {
+                    RasterizeRow(triangle, y, depth + y * width);
+                }
+            }
+        }
+
+        // the tiles of the band
+        for (uint32_t tile_y = row_start / tile_size; tile_y <= row_end / tile_size; tile_y++)
+        {
+            for (uint32_t tile_x = 0; tile_x < tile_count_x; tile_x++)
+            {
+                float value_min = numeric_limits<float>::max();
+                float value_max = 0.0f;
+                for (uint32_t y = tile_y * tile_size; y < (tile_y + 1) * tile_size; y++)
+                {
+                    const float* row = depth + y * width + tile_x * tile_size;
+                    for (uint32_t x = 0; x < tile_size; x++)
+                    {
+                        value_min = min(value_min, row[x]);
+                        value_max = max(value_max, row[x]);
+                    }
+                }
+
+                m_tile_min[tile_y * tile_count_x + tile_x] = value_min;
+                m_tile_max[tile_y * tile_count_x + tile_x] = value_max;
+            }
+        }
+    }
+
+    void OcclusionBuffer::RasterizeRow(const Triangle& triangle, const int32_t y, float* row)
+    {
+        // the row's part of the edge functions and the depth is constant, the simd path splits them the same way so that both round alike
+        const float pixel_y     = static_cast<float>(y) + 0.5f;
+        const float edge_row[3] =
+        {
+            triangle.edge_b[0] * pixel_y + triangle.edge_c[0],
+            triangle.edge_b[1] * pixel_y + triangle.edge_c[1],
+            triangle.edge_b[2] * pixel_y + triangle.edge_c[2]
+        };
+        const float depth_row = triangle.depth_b * pixel_y + triangle.depth_c;
+
+        for (int32_t x = triangle.x_min; x <= triangle.x_max; x++)
+        {
+            const float pixel_x = static_cast<float>(x) + 0.5f;
+
+            bool inside = true;
+            for (uint32_t e = 0; e < 3; e++)
+            {
+                inside &= triangle.edge_a[e] * pixel_x + edge_row[e] >= 0.0f;
+            }
+
+            if (inside)
+            {
+                const float value = clamp(triangle.depth_a * pixel_x + depth_row, triangle.depth_min, triangle.depth_max);
+                row[x]            = max(row[x], value);
+            }
+        }
+    }
+
+    void OcclusionBuffer::RasterizeRowSimd(const Triangle& triangle, const int32_t y, float* row)
+    {
+    #if defined(__AVX__)
+        // 8 pixels at a time, from an aligned start, the width is a multiple of 8 so the last group never runs past the row
+        const float pixel_y    = static_cast<float>(y) + 0.5f;
+        const __m256 lane      = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+        const __m256 zero      = _mm256_setzero_ps();
+        const __m256 edge_a0   = _mm256_set1_ps(triangle.edge_a[0]);
+        const __m256 edge_a1   = _mm256_set1_ps(triangle.edge_a[1]);
+        const __m256 edge_a2   = _mm256_set1_ps(triangle.edge_a[2]);
+        const __m256 edge_row0 = _mm256_set1_ps(triangle.edge_b[0] * pixel_y + triangle.edge_c[0]);
+        const __m256 edge_row1 = _mm256_set1_ps(triangle.edge_b[1] * pixel_y + triangle.edge_c[1]);
+        const __m256 edge_row2 = _mm256_set1_ps(triangle.edge_b[2] * pixel_y + triangle.edge_c[2]);
+        const __m256 depth_a   = _mm256_set1_ps(triangle.depth_a);
+        const __m256 depth_row = _mm256_set1_ps(triangle.depth_b * pixel_y + triangle.depth_c);
+        const __m256 depth_min = _mm256_set1_ps(triangle.depth_min);
+        const __m256 depth_max = _mm256_set1_ps(triangle.depth_max);
+
+        for (int32_t x = triangle.x_min & ~7; x <= triangle.x_max; x += 8)
+        {
+            const __m256 pixel_x = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), lane);
+
+            __m256 inside = _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(edge_a0, pixel_x), edge_row0), zero, _CMP_GE_OQ);
+            inside        = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(edge_a1, pixel_x), edge_row1), zero, _CMP_GE_OQ));
+            inside        = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(edge_a2, pixel_x), edge_row2), zero, _CMP_GE_OQ));
+            if (_mm256_movemask_ps(inside) == 0)
+                continue;
+
+            __m256 value = _mm256_add_ps(_mm256_mul_ps(depth_a, pixel_x), depth_row);
+            value        = _mm256_min_ps(_mm256_max_ps(value, depth_min), depth_max);
+
+            const __m256 current = _mm256_loadu_ps(row + x);
+            _mm256_storeu_ps(row + x, _mm256_blendv_ps(current, _mm256_max_ps(current, value), inside));
+        }
+    #else
+        RasterizeRow(triangle, y, row);
+    #endif
+    }
+
+    bool OcclusionBuffer::IsVisible(const BoundingBox& box) const
+    {
+        if (m_occluders.empty())
+            return true;
+
+        // the screen space rectangle of the box and the 1/w of its nearest point, which is always one of the corners
+        const Vector3& box_min = box.GetMin();
+        const Vector3& box_max = box.GetMax();
+        float x_min            = numeric_limits<float>::max();
+        float y_min            = numeric_limits<float>::max();
+        float x_max            = numeric_limits<float>::lowest();
+        float y_max            = numeric_limits<float>::lowest();
+        float depth            = 0.0f;
+        for (uint32_t i = 0; i < 8; i++)
+        {
+            const Vector3 corner = Vector3(
+                (i & 1) ? box_max.x : box_min.x,
+                (i & 2) ? box_max.y : box_min.y,
+                (i & 4) ? box_max.z : box_min.z
+            );
+
+            // the box reaches in front of the near plane, the camera is (almost) inside of it
+            float screen[3];
+            if (!project(m_view_projection, corner, m_near_plane, screen))
+                return true;
+
+            x_min = min(x_min, screen[0]);
+            x_max = max(x_max, screen[0]);
+            y_min = min(y_min, screen[1]);
+            y_max = max(y_max, screen[1]);
+            depth = max(depth, screen[2]);
+        }
+
+        // off screen, that's for the frustum to decide
+        if (x_max < 0.0f || y_max < 0.0f || x_min >= static_cast<float>(width) || y_min >= static_cast<float>(height))
+            return true;
+
+        // every pixel the rectangle touches
+        const uint32_t pixel_x_min = static_cast<uint32_t>(max(x_min, 0.0f));
+        const uint32_t pixel_y_min = static_cast<uint32_t>(max(y_min, 0.0f));
+        const uint32_t pixel_x_max = static_cast<uint32_t>(min(x_max, static_cast<float>(width - 1)));
+        const uint32_t pixel_y_max = static_cast<uint32_t>(min(y_max, static_cast<float>(height - 1)));
+
+        for (uint32_t tile_y = pixel_y_min / tile_size; tile_y <= pixel_y_max / tile_size; tile_y++)
+        {
+            for (uint32_t tile_x = pixel_x_min / tile_size; tile_x <= pixel_x_max / tile_size; tile_x++)
+            {
+                const uint32_t tile = tile_y * tile_count_x + tile_x;
+
+                // every pixel of the tile is in front of the box
+                if (m_tile_min[tile] > depth)
+                    continue;
+
+                // every pixel of the tile is behind the box
+                if (m_tile_max[tile] <= depth)
+                    return true;
+
+                // mixed, test the pixels of the tile which the rectangle touches
+                const uint32_t y_start = max(tile_y * tile_size, pixel_y_min);
+                const uint32_t y_end   = min((tile_y + 1) * tile_size - 1, pixel_y_max);
+                const uint32_t x_start = max(tile_x * tile_size, pixel_x_min);
+                const uint32_t x_end   = min((tile_x + 1) * tile_size - 1, pixel_x_max);
+                for (uint32_t y = y_start; y <= y_end; y++)
+                {
+                    for (uint32_t x = x_start; x <= x_end; x++)
+                    {
+                        if (m_depth[y * width + x] <= depth)
+                            return true;
+                    }
+                }
+            }
+        }
+
+        return false;
+    }
+}
@@ -0,0 +1,108 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+//= INCLUDES ===================
+#include <vector>
+#include "../Math/Matrix.h"
+#include "../Math/BoundingBox.h"
+//==============================
+
+namespace Spartan
+{
+    // a small software depth buffer for occlusion culling, low poly occluder hulls are rasterized into it on the cpu
+    // and the bounding boxes of the occludees are tested against it in the same frame, so there is no readback latency,
+    // it stores 1/w (larger is nearer) and every 8x8 tile keeps its min and max so that most tests never touch the pixels
+    class SP_CLASS OcclusionBuffer
+    {
+    public:
+        static constexpr uint32_t width        = 512;
+        static constexpr uint32_t height       = 256;
+        static constexpr uint32_t tile_size    = 8;
+        static constexpr uint32_t tile_count_x = width / tile_size;
+        static constexpr uint32_t tile_count_y = height / tile_size;
+        static constexpr uint32_t band_height  = 32; // the rows a worker rasterizes, every band is written by a single thread
+
+        OcclusionBuffer();
+
+        // starts a new frame, the occluders of the previous one are forgotten
+        void Begin(const Math::Matrix& view_projection, const float near_plane);
+
+        // the geometry is referenced, not copied, so it has to stay alive until Rasterize() returns
+        void AddOccluder(const Math::Matrix& transform, const std::vector<Math::Vector3>* vertices, const std::vector<uint32_t>* indices);
+
+        // sets up the triangles of all the occluders and rasterizes them, in parallel
+        void Rasterize();
+
+        // conservative, a box is only reported as hidden if every pixel it covers has an occluder in front of it
+        bool IsVisible(const Math::BoundingBox& box) const;
+
+        // the rows are rasterized with avx when it's compiled in, the scalar path is the reference it's tested against
+        void SetSimd(const bool enabled) { m_simd = enabled; }
+
+        uint32_t GetOccluderCount() const          { return static_cast<uint32_t>(m_occluders.size()); }
+        uint32_t GetTriangleCount() const          { return m_triangle_count; }
+        const std::vector<float>& GetDepth() const { return m_depth; }
+
+    private:
+        struct Occluder
+        {
+            Math::Matrix transform;
+            const std::vector<Math::Vector3>* vertices = nullptr;
+            const std::vector<uint32_t>* indices       = nullptr;
+            uint32_t triangle_offset                   = 0;
+        };
+
+        // edge functions and the depth plane in screen space, evaluated at pixel centers
+        struct Triangle
+        {
+            float edge_a[3]  = {};
+            float edge_b[3]  = {};
+            float edge_c[3]  = {};
+            float depth_a    = 0.0f;
+            float depth_b    = 0.0f;
+            float depth_c    = 0.0f;
+            float depth_min  = 0.0f;
+            float depth_max  = 0.0f;
+            int32_t x_min    = 0;
+            int32_t x_max    = -1; // empty until set up
+            int32_t y_min    = 0;
+            int32_t y_max    = -1;
+        };
+
+        uint32_t SetupTriangles(const Occluder& occluder, std::vector<float>& screen);
+        void RasterizeBand(const uint32_t band);
+        static void RasterizeRow(const Triangle& triangle, const int32_t y, float* row);
+        static void RasterizeRowSimd(const Triangle& triangle, const int32_t y, float* row);
+
+        Math::Matrix m_view_projection = Math::Matrix::Identity;
+        float m_near_plane             = 0.0f;
+        uint32_t m_triangle_count      = 0;
+        bool m_simd                    = true;
+        std::vector<Occluder> m_occluders;
+        std::vector<Triangle> m_triangles;
+        std::vector<float> m_depth;
+        std::vector<float> m_tile_min;
+        std::vector<float> m_tile_max;
+    };
+}
@@ -23,7 +23,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "pch.h"
 #include "Renderer.h"
 #include "ThreadPool.h"
+#include "FrameAllocator.h"
 #include "ProgressTracker.h"
+#include "GeometryBuffer.h"
 #include "../Profiling/Profiler.h"
 #include "../Core/Window.h"
 #include "../Input/Input.h"
@@ -90,13 +92,14 @@ namespace Spartan
         float near_plane                     = 0.0f;
         float far_plane                      = 1.0f;
         bool dirty_orthographic_projection   = true;
+        bool gpu_synced                      = false;
 
         float get_directional_light_intensity_lumens(const vector<shared_ptr<Entity>>& lights)
         {
             float intensity = 0.0f;
             for (const shared_ptr<Entity>& entity : lights)
             {
-                if (const shared_ptr<Light>& light = entity->GetComponent<Light>())
+                if (Light* light = entity->GetComponentRaw<Light>())
                 {
                     if (light->GetLightType() == LightType::Directional)
                     {
@@ -244,7 +247,13 @@ namespace Spartan
         SetOption(Renderer_Option::Lights,                      1.0f);
         SetOption(Renderer_Option::Physics,                     0.0f);
         SetOption(Renderer_Option::PerformanceMetrics,          1.0f);
-        SetOption(Renderer_Option::OcclusionCulling,            0.0f); // disabled by default as it's a WIP (you can see the query delays)
+        SetOption(Renderer_Option::OcclusionCulling,            1.0f); // the biggest renderables on screen are rasterized on the cpu and hide what's behind them, the gpu driven path also tests against a hierarchical depth
+        SetOption(Renderer_Option::GpuDrivenRendering,          0.0f); // disabled by default as it's a WIP, it also requires draw indirect count support
+        SetOption(Renderer_Option::RecordingJobs,               1.0f); // experimental, more than one job records the g-buffer and shadow passes into secondary command lists in parallel
+        SetOption(Renderer_Option::DynamicInstancing,           1.0f); // repeated static renderables which share a mesh and a material are folded into one instanced draw
+        SetOption(Renderer_Option::ShadowLodBias,               1.0f); // shadow passes draw this many lod levels coarser than the camera does
+        SetOption(Renderer_Option::MeshletCulling,              1.0f); // large meshes are culled per meshlet (frustum and normal cone) instead of all-or-nothing
+        SetOption(Renderer_Option::LightClustering,             1.0f); // lights without shadow maps are binned into view space clusters and shaded in one dispatch, instead of one full screen dispatch each
     }
 
     void Renderer::Shutdown()
@@ -255,6 +264,7 @@ namespace Spartan
         // releases their rhi resources before device destruction
         {
             DestroyResources();
+            GeometryBuffer::Shutdown();
 
             m_renderables.clear();
             swap_chain            = nullptr;
@@ -266,6 +276,17 @@ namespace Spartan
         RHI_Device::Destroy();
     }
 
+    void Renderer::PreTick()
+    {
+        if (Window::IsMinimized() || !m_initialized_resources)
+            return;
+
+        // waits for the gpu to be done with the command lists that are about to be reused, it's
+        // separate from Tick() so that the wait can overlap with the simulation of the new frame
+        RHI_Device::Tick(frame_num);
+        gpu_synced = true;
+    }
+
     void Renderer::Tick()
     {
         // don't waste cpu/gpu time if nothing can be seen
@@ -279,7 +300,12 @@ namespace Spartan
                 SP_FIRE_EVENT(EventType::RendererOnFirstFrameCompleted);
             }
 
-            RHI_Device::Tick(frame_num);
+            if (!gpu_synced)
+            {
+                RHI_Device::Tick(frame_num);
+            }
+            gpu_synced = false;
+
             RHI_FidelityFX::Update(&m_cb_frame_cpu);
             dynamic_resolution();
         }
@@ -479,14 +505,15 @@ namespace Spartan
         // clear previous state
         m_renderables.clear();
 
-        for (auto it : entities)
+        for (auto& it : entities)
         {
             shared_ptr<Entity>& entity = it.second;
 
             if (!entity->IsActive())
                 continue;
 
-            if (shared_ptr<Renderable> renderable = entity->GetComponent<Renderable>())
+            Renderable* renderable = entity->GetComponentRaw<Renderable>();
+            if (renderable && !renderable->HasFlag(RenderableFlags::StaticBatched)) // static batch members are drawn by their batch
             {
                 if (Material* material = renderable->GetMaterial())
                 {
@@ -501,17 +528,17 @@ namespace Spartan
                 }
             }
 
-            if (shared_ptr<Light> light = entity->GetComponent<Light>())
+            if (entity->GetComponentRaw<Light>())
             {
                 m_renderables[Renderer_Entity::Light].emplace_back(entity);
             }
 
-            if (shared_ptr<Camera> camera = entity->GetComponent<Camera>())
+            if (entity->GetComponentRaw<Camera>())
             {
                 m_renderables[Renderer_Entity::Camera].emplace_back(entity);
             }
 
-            if (shared_ptr<AudioSource> audio_source = entity->GetComponent<AudioSource>())
+            if (entity->GetComponentRaw<AudioSource>())
             {
                 m_renderables[Renderer_Entity::AudioSource].emplace_back(entity);
             }
@@ -586,9 +613,19 @@ namespace Spartan
                 SP_LOG_INFO("Parsed deletion queue");
             }
 
+            // retire freed geometry and compact the geometry buffer
+            GeometryBuffer::OnSyncPoint();
+
             // reset dynamic buffer offsets
             GetBuffer(Renderer_Buffer::StorageSpd)->ResetOffset();
             GetBuffer(Renderer_Buffer::ConstantFrame)->ResetOffset();
+            GetBuffer(Renderer_Buffer::StorageDrawObjects)->ResetOffset();
+            GetBuffer(Renderer_Buffer::StorageDrawCounts)->ResetOffset();
+            GetBuffer(Renderer_Buffer::InstancesBatched)->ResetOffset();
+            GetBuffer(Renderer_Buffer::StorageLightClusters)->ResetOffset();
+
+            // reclaim transient cpu memory
+            FrameAllocator::Reset();
 
             if (bindless_materials_dirty)
             {
@@ -608,22 +645,20 @@ namespace Spartan
 
             for (const shared_ptr<Entity>& entity : m_renderables[Renderer_Entity::Light])
             {
-                if (const shared_ptr<Light>& light = entity->GetComponent<Light>())
+                Light* light = entity->GetComponentRaw<Light>();
+                if (!light || light->GetLightType() != LightType::Directional || !entity->IsActive())
+                    continue;
+
+                if (entity->GetRotation() != rotation ||
+                    light->GetIntensityLumens() != intensity ||
+                    light->GetColor() != color
+                    )
                 {
-                    if (light->GetLightType() == LightType::Directional)
-                    {
-                        if (light->GetEntity()->GetRotation() != rotation ||
-                            light->GetIntensityLumens() != intensity ||
-                            light->GetColor() != color
-                            )
-                        {
-                            rotation  = light->GetEntity()->GetRotation();
-                            intensity = light->GetIntensityLumens();
-                            color     = light->GetColor();
+                    rotation  = entity->GetRotation();
+                    intensity = light->GetIntensityLumens();
+                    color     = light->GetColor();
 
-                            m_environment_mips_to_filter_count = GetRenderTarget(Renderer_RenderTarget::skysphere)->GetMipCount() - 1;
-                        }
-                    }
+                    m_environment_mips_to_filter_count = GetRenderTarget(Renderer_RenderTarget::skysphere)->GetMipCount() - 1;
                 }
             }
         }
@@ -685,6 +720,17 @@ namespace Spartan
                     }
                 }
             }
+            else if (option == Renderer_Option::GpuDrivenRendering)
+            {
+                if (value == 1.0f)
+                {
+                    if (!RHI_Device::PropertyIsDrawIndirectCountSupported())
+                    { 
+                        SP_LOG_INFO("This GPU doesn't support draw indirect count");
+                        return;
+                    }
+                }
+            }
         }
 
         // set new value
@@ -744,7 +790,7 @@ namespace Spartan
                 const auto& light_entities = m_renderables[Renderer_Entity::Light];
                 for (const auto& light_entity : light_entities)
                 {
-                    auto light = light_entity->GetComponent<Light>();
+                    Light* light = light_entity->GetComponentRaw<Light>();
                     if (light->IsFlagSet(LightFlags::Shadows))
                     {
                         light->RefreshShadowMap();
@@ -939,11 +985,11 @@ namespace Spartan
 
         auto update_entities = [update_material](vector<shared_ptr<Entity>>& entities)
         {
-            for (shared_ptr<Entity> entity : entities)
+            for (shared_ptr<Entity>& entity : entities)
             {
                 if (entity)
                 {
-                    if (shared_ptr<Renderable> renderable = entity->GetComponent<Renderable>())
+                    if (Renderable* renderable = entity->GetComponentRaw<Renderable>())
                     {
                         if (Material* material = renderable->GetMaterial())
                         {
@@ -999,7 +1045,7 @@ namespace Spartan
             // go through each light
             for (shared_ptr<Entity>& entity : m_renderables[Renderer_Entity::Light])
             {
-                if (Light* light = entity->GetComponent<Light>().get())
+                if (Light* light = entity->GetComponentRaw<Light>())
                 {
                     light->SetIndex(index);
 
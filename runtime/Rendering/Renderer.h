@@ -52,6 +52,7 @@ namespace Spartan
         // core
         static void Initialize();
         static void Shutdown();
+        static void PreTick();
         static void Tick();
 
         // primitive rendering (useful for debugging)
@@ -83,6 +84,7 @@ namespace Spartan
         static void Screenshot(const std::string& file_path);
         static void SetEntities(std::unordered_map<uint64_t, std::shared_ptr<Entity>>& entities);
         static bool CanUseCmdList();
+        static void GetGpuDrivenVisibleCounts(uint32_t* count_gpu, uint32_t* count_cpu);
 
         //= RESOLUTION/SIZE =============================================================================
         // viewport
@@ -144,6 +146,9 @@ namespace Spartan
         static void Pass_VariableRateShading(RHI_CommandList* cmd_list);
         static void Pass_ShadowMaps(RHI_CommandList* cmd_list, const bool is_transparent_pass);
         static void Pass_Visibility(RHI_CommandList* cmd_list);
+        static void Pass_Visibility_Gpu(RHI_CommandList* cmd_list);
+        static void Pass_Visibility_Gpu_Late(RHI_CommandList* cmd_list);
+        static void Pass_Batching(RHI_CommandList* cmd_list);
         static void Pass_Depth_Prepass(RHI_CommandList* cmd_list, const bool is_transparent_pass);
         static void Pass_GBuffer(RHI_CommandList* cmd_list, const bool is_transparent_pass);
         static void Pass_Ssao(RHI_CommandList* cmd_list);
@@ -176,7 +181,7 @@ namespace Spartan
         static void Pass_Upscale(RHI_CommandList* cmd_list);
         // passes - utility
         static void Pass_Blur(RHI_CommandList* cmd_list, RHI_Texture* tex_in, const float radius, const uint32_t mip = rhi_all_mips);
-        static void Pass_Downsample(RHI_CommandList* cmd_list, RHI_Texture* tex, const Renderer_DownsampleFilter filter);
+        static void Pass_Downsample(RHI_CommandList* cmd_list, RHI_Texture* tex, const Renderer_DownsampleFilter filter, RHI_Texture* tex_out = nullptr);
 
         // event handlers
         static void OnClear();
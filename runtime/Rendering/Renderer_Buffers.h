@@ -243,4 +243,39 @@ namespace Spartan
                 flags              == rhs.flags;
         }
     };
+
+    // a renderable as seen by the gpu culling pass, when updating it, also update DrawObject in common_textures_storage.hlsl
+    struct Sb_DrawObject
+    {
+        Math::Matrix transform;
+        Math::Matrix transform_previous;
+
+        Math::Vector3 box_center;
+        uint32_t index_count;
+
+        Math::Vector3 box_extent;
+        uint32_t index_offset;
+
+        uint32_t vertex_offset;
+        uint32_t material_index;
+        uint32_t bucket_index;   // which count the culling pass increments
+        uint32_t command_offset; // where the bucket's draw commands start
+
+        // normal cone of a meshlet, a zero axis with a cutoff of 1 never culls
+        Math::Vector3 cone_apex;
+        float cone_cutoff;
+
+        Math::Vector3 cone_axis;
+        uint32_t visibility_index_previous; // where last frame's occlusion result of the same object is, if any
+    };
+
+    // same layout as VkDrawIndexedIndirectCommand
+    struct Sb_DrawIndexedIndirectCommand
+    {
+        uint32_t index_count;
+        uint32_t instance_count;
+        uint32_t index_offset;
+        int32_t vertex_offset;
+        uint32_t instance_offset;
+    };
 }
@@ -30,6 +30,14 @@ namespace Spartan
     // we are using double buffering so 5 is enough
     constexpr uint8_t resources_frame_lifetime = 5;
 
+    // gpu driven rendering, renderables beyond these limits are drawn the regular way (also update indirect_cull.hlsl)
+    constexpr uint32_t renderer_max_draw_objects    = 16384;
+    constexpr uint32_t renderer_max_draw_buckets    = 256;
+    constexpr uint32_t renderer_culling_phase_count = 2; // what was visible last frame, then what the hierarchical depth reveals
+
+    // dynamic instancing, instances beyond this limit are drawn the regular way
+    constexpr uint32_t renderer_max_batched_instances = 16384;
+
     enum class Renderer_Option : uint32_t
     {
         Aabb,
@@ -66,6 +74,12 @@ namespace Spartan
         ResolutionScale,
         DynamicResolution,
         OcclusionCulling,
+        GpuDrivenRendering,
+        RecordingJobs,
+        DynamicInstancing,
+        ShadowLodBias,
+        MeshletCulling,
+        LightClustering,
         Max
     };
 
@@ -146,15 +160,20 @@ namespace Spartan
 
     enum class Renderer_BindingsUav
     {
-        sb_materials      = 0,
-        sb_lights         = 1,
-        tex               = 2,
-        tex2              = 3,
-        tex3              = 4,
-        tex4              = 5,
-        tex_sss           = 6,
-        sb_spd            = 7,
-        tex_spd           = 8,
+        sb_materials       = 0,
+        sb_lights          = 1,
+        tex                = 2,
+        tex2               = 3,
+        tex3               = 4,
+        tex4               = 5,
+        tex_sss            = 6,
+        sb_spd             = 7,
+        tex_spd            = 8,
+        sb_draw_objects    = 20,
+        sb_draw_commands   = 21,
+        sb_draw_counts     = 22,
+        sb_light_clusters  = 23,
+        sb_draw_visibility = 24
     };
 
     enum class Renderer_Shader : uint8_t
@@ -162,10 +181,19 @@ namespace Spartan
         tessellation_h,
         tessellation_d,
         gbuffer_v,
+        gbuffer_packed_v,
+        gbuffer_packed_half_v,
         gbuffer_p,
+        gbuffer_indirect_v,
+        gbuffer_indirect_p,
         depth_prepass_v,
+        depth_prepass_packed_v,
+        depth_prepass_packed_half_v,
+        depth_prepass_indirect_v,
         depth_prepass_alpha_test_p,
         depth_light_v,
+        depth_light_packed_v,
+        depth_light_packed_half_v,
         depth_light_alpha_color_p,
         quad_v,
         quad_p,
@@ -182,6 +210,7 @@ namespace Spartan
         light_integration_brdf_specular_lut_c,
         light_integration_environment_filter_c,
         light_c,
+        light_clustered_c,
         light_composition_c,
         light_image_based_c,
         line_v,
@@ -189,6 +218,8 @@ namespace Spartan
         grid_v,
         grid_p,
         outline_v,
+        outline_packed_v,
+        outline_packed_half_v,
         outline_p,
         outline_c,
         font_v,
@@ -202,6 +233,8 @@ namespace Spartan
         ffx_cas_c,
         ffx_spd_average_c,
         ffx_spd_max_c,
+        ffx_spd_min_c,
+        indirect_cull_c,
         max
     };
     
@@ -235,6 +268,7 @@ namespace Spartan
         blur,
         outline,
         shading_rate,
+        hi_z,
         max
     };
 
@@ -266,6 +300,12 @@ namespace Spartan
         StorageSpd,
         StorageMaterials,
         StorageLights,
+        StorageDrawObjects,
+        StorageDrawCommands,
+        StorageDrawCounts,
+        StorageDrawVisibility,
+        InstancesBatched,
+        StorageLightClusters,
         Max
     };
 
@@ -315,6 +355,7 @@ namespace Spartan
     enum class Renderer_DownsampleFilter
     {
         Max,
+        Min,
         Average
     };
 }
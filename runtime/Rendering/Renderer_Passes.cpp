@@ -22,10 +22,17 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //= INCLUDES ===========================
 #include "pch.h"
 #include "Renderer.h"
+#include "LightClusters.h"
+#include "IndirectDraws.h"
+#include "DynamicInstancing.h"
+#include "OcclusionBuffer.h"
+#include "ThreadPool.h"
 #include "../Profiling/Profiler.h"
 #include "../World/Entity.h"
 #include "../World/Components/Camera.h"
 #include "../World/Components/Light.h"
+#include "../World/Components/PhysicsBody.h"
+#include "../RHI/RHI_Device.h"
 #include "../RHI/RHI_CommandList.h"
 #include "../RHI/RHI_Buffer.h"
 #include "../RHI/RHI_Shader.h"
@@ -56,231 +63,556 @@ namespace Spartan
 
         namespace visibility
         {
-            unordered_map<uint64_t, float> distances_squared;
-            unordered_map<uint64_t, Rectangle> rectangles;
-            unordered_map<uint64_t, BoundingBox> boxes;
-
-            void clear()
+            BoundingBoxesSoa boxes_soa;
+            vector<uint8_t> boxes_visible;
+            const uint32_t culling_grain_size = 256;
+            vector<uint32_t> visible_indices; // renderables which survived culling, in renderable order (sorted order once sort() has run)
+            vector<uint32_t> visible_counts;  // one per chunk
+
+            // sort key layout, most significant bit first
+            // 63     : transparent, transparent renderables go to the end
+            // 62     : non-instanced, instanced renderables go to the front of each transparency partition
+            // 61     : culled, renderables outside of the view frustum go to the end of their partition
+            // 60 - 0 : opaque      -> 29 bit material id, then 32 bit depth (front-to-back, groups pipeline/material state)
+            //          transparent -> 32 bit inverted depth, then 29 bit material id (back-to-front, needed for correct blending)
+            const uint64_t sort_key_transparent   = 1ull << 63;
+            const uint64_t sort_key_non_instanced = 1ull << 62;
+            const uint64_t sort_key_culled        = 1ull << 61;
+            const uint64_t sort_key_material_mask = (1ull << 29) - 1;
+            const uint32_t sort_grain_size        = 4096;
+            const uint32_t sort_radix_bits        = 8;
+            const uint32_t sort_radix_size        = 1 << sort_radix_bits;
+
+            vector<uint64_t> sort_keys;
+            vector<uint64_t> sort_keys_scratch;
+            vector<uint32_t> sort_indices;
+            vector<uint32_t> sort_indices_scratch;
+            vector<array<uint32_t, sort_radix_size>> sort_histograms; // one per chunk
+            vector<shared_ptr<Entity>> sort_renderables_scratch;
+
+            // software occlusion culling, the renderables which cover the most of the screen are rasterized as low poly hulls
+            // and everything else that survived frustum culling is tested against them, within the same frame
+            const uint32_t occluder_count_max        = 64;
+            const uint32_t occluder_builds_per_frame = 8;    // hulls are simplified on first use, so new occluders are phased in
+            const float occluder_screen_size_min     = 0.1f; // fraction of the vertical half screen size, like the lod selection
+
+            OcclusionBuffer occlusion_buffer;
+            vector<pair<float, uint32_t>> occluder_candidates; // screen size, renderable index
+            vector<Renderable*> occluder_builds;
+
+            uint64_t compute_sort_key(Renderable* renderable, const Vector3& camera_position)
             {
-                distances_squared.clear();
-                rectangles.clear();
-                boxes.clear();
+                Material* material      = renderable->GetMaterial();
+                const bool transparent  = material->IsTransparent();
+                const Vector3 position  = renderable->GetBoundingBox(BoundingBoxType::Transformed).GetCenter();
+                const float distance    = (position - camera_position).LengthSquared();
+
+                // positive floats compare like unsigned integers, so the bit pattern is the quantized depth
+                uint32_t depth = 0;
+                memcpy(&depth, &distance, sizeof(uint32_t));
+                const uint64_t material_id = material->GetObjectId() & sort_key_material_mask;
+
+                uint64_t key  = transparent                       ? sort_key_transparent   : 0;
+                key          |= !renderable->HasInstancing()      ? sort_key_non_instanced : 0;
+                key          |= renderable->HasFlag(OccludedCpu)  ? sort_key_culled        : 0;
+                key          |= transparent ? (static_cast<uint64_t>(~depth) << 29) | material_id : (material_id << 32) | depth;
+
+                return key;
             }
 
-            float get_squared_distance(const shared_ptr<Entity>& entity)
+            // stable least significant digit radix sort of the keys (and the indices that ride along with them)
+            // each pass builds per chunk histograms in parallel, prefix sums them serially and then scatters in parallel
+            void radix_sort(vector<uint64_t>& keys, vector<uint32_t>& indices)
             {
-                Vector3 camera_position = Renderer::GetCamera()->GetEntity()->GetPosition();
-                uint64_t entity_id      = entity->GetObjectId();
+                const uint32_t count       = static_cast<uint32_t>(keys.size());
+                const uint32_t chunk_count = (count + sort_grain_size - 1) / sort_grain_size;
 
-                auto it = distances_squared.find(entity_id);
-                if (it != distances_squared.end())
-                {
-                    return it->second;
-                }
-                else
+                sort_keys_scratch.resize(count);
+                sort_indices_scratch.resize(count);
+                sort_histograms.resize(chunk_count);
+
+                for (uint32_t shift = 0; shift < 64; shift += sort_radix_bits)
                 {
-                    shared_ptr<Renderable> renderable = entity->GetComponent<Renderable>();
-                    Vector3 position                  = renderable->GetBoundingBox(BoundingBoxType::Transformed).GetCenter();
-                    float distance_squared            = (position - camera_position).LengthSquared();
-                    distances_squared[entity_id]      = distance_squared;
+                    // 1. count digits per chunk
+                    ThreadPool::ParallelLoop([&keys, shift](uint32_t index_start, uint32_t index_end)
+                    {
+                        array<uint32_t, sort_radix_size>& histogram = sort_histograms[index_start / sort_grain_size];
+                        histogram.fill(0);
+
+                        for (uint32_t i = index_start; i < index_end; i++)
+                        {
+                            histogram[(keys[i] >> shift) & (sort_radix_size - 1)]++;
+                        }
+                    }, count, sort_grain_size);
+
+                    // 2. turn the counts into scatter offsets, chunks are laid out in order within each digit so the sort stays stable
+                    bool pass_is_trivial = false;
+                    uint32_t offset      = 0;
+                    for (uint32_t digit = 0; digit < sort_radix_size; digit++)
+                    {
+                        const uint32_t digit_start = offset;
+                        for (array<uint32_t, sort_radix_size>& histogram : sort_histograms)
+                        {
+                            const uint32_t digit_count = histogram[digit];
+                            histogram[digit]           = offset;
+                            offset                    += digit_count;
+                        }
+
+                        // all keys share this digit, the order wouldn't change
+                        pass_is_trivial |= (offset - digit_start) == count;
+                    }
+
+                    if (pass_is_trivial)
+                        continue;
+
+                    // 3. scatter
+                    ThreadPool::ParallelLoop([&keys, &indices, shift](uint32_t index_start, uint32_t index_end)
+                    {
+                        array<uint32_t, sort_radix_size>& offsets = sort_histograms[index_start / sort_grain_size];
+
+                        for (uint32_t i = index_start; i < index_end; i++)
+                        {
+                            const uint32_t destination        = offsets[(keys[i] >> shift) & (sort_radix_size - 1)]++;
+                            sort_keys_scratch[destination]    = keys[i];
+                            sort_indices_scratch[destination] = indices[i];
+                        }
+                    }, count, sort_grain_size);
 
-                    return distance_squared;
+                    keys.swap(sort_keys_scratch);
+                    indices.swap(sort_indices_scratch);
                 }
             }
 
             void frustum_culling(vector<shared_ptr<Entity>>& renderables)
             {
-                for (shared_ptr<Entity>& entity : renderables)
-                {
-                    shared_ptr<Renderable> renderable = entity->GetComponent<Renderable>();
-                    renderable->SetFlag(RenderableFlags::OccludedCpu, !Renderer::GetCamera()->IsInViewFrustum(renderable));
-                    renderable->SetFlag(RenderableFlags::Occluder, false);
-                }
-            }
+                const Frustum& frustum = Renderer::GetCamera()->GetFrustum();
+                const uint32_t count   = static_cast<uint32_t>(renderables.size());
 
-            void sort(vector<shared_ptr<Entity>>& renderables)
-            {
-                // 1. sort by depth
-                sort(renderables.begin(), renderables.end(), [](const shared_ptr<Entity>& a, const shared_ptr<Entity>& b)
-                {
-                    // skip entities which are outside of the view frustum
-                    if (a->GetComponent<Renderable>()->HasFlag(OccludedCpu) || b->GetComponent<Renderable>()->HasFlag(OccludedCpu))
-                        return false;
-                    
-                    // front-to-back for opaque (todo, handle inverse sorting for transparents)
-                    return get_squared_distance(a) < get_squared_distance(b);
-                });
+                boxes_soa.Resize(count);
+                boxes_visible.resize(count);
+                visible_indices.resize(count);
+                visible_counts.resize((count + culling_grain_size - 1) / culling_grain_size);
 
-                // 2. sort by instancing, instanced objects go to the front
-                stable_sort(renderables.begin(), renderables.end(), [](const shared_ptr<Entity>& a, const shared_ptr<Entity>& b)
+                // each chunk packs its bounding boxes into the soa arrays, tests them 8 at a time, writes the flags
+                // of its own renderables and lists the visible ones at the start of its own range of the index list
+                ThreadPool::ParallelLoop([&renderables, &frustum](uint32_t index_start, uint32_t index_end)
                 {
-                    return a->GetComponent<Renderable>()->HasInstancing() > b->GetComponent<Renderable>()->HasInstancing();
-                });
+                    for (uint32_t i = index_start; i < index_end; i++)
+                    {
+                        const BoundingBox& box = renderables[i]->GetComponentRaw<Renderable>()->GetBoundingBox(BoundingBoxType::Transformed);
+                        boxes_soa.Set(i, box.GetCenter(), box.GetExtents());
+                    }
+
+                    frustum.AreVisible(boxes_soa, index_start, index_end, boxes_visible.data());
+
+                    uint32_t visible_count = 0;
+                    for (uint32_t i = index_start; i < index_end; i++)
+                    {
+                        Renderable* renderable = renderables[i]->GetComponentRaw<Renderable>();
+
+                        // undefined bounding boxes are treated as outside of the view frustum
+                        const bool visible = boxes_visible[i] != 0 && !(renderable->GetBoundingBox(BoundingBoxType::Transformed) == BoundingBox::Undefined);
+                        renderable->SetFlag(RenderableFlags::OccludedCpu, !visible);
+                        renderable->SetFlag(RenderableFlags::Occluder, false);
+
+                        if (visible)
+                        {
+                            visible_indices[index_start + visible_count++] = i;
+                        }
+                    }
+                    visible_counts[index_start / culling_grain_size] = visible_count;
+                }, count, culling_grain_size);
 
-                // 3. sort by transparency, transparent materials go to the end
-                stable_sort(renderables.begin(), renderables.end(), [](const shared_ptr<Entity>& a, const shared_ptr<Entity>& b)
+                // pack the chunks' lists back to back, a chunk never moves past its own start so this can be done in place
+                uint32_t visible_count = 0;
+                for (uint32_t chunk = 0; chunk < static_cast<uint32_t>(visible_counts.size()); chunk++)
                 {
-                    bool a_transparent = a->GetComponent<Renderable>()->GetMaterial()->IsTransparent();
-                    bool b_transparent = b->GetComponent<Renderable>()->GetMaterial()->IsTransparent();
+                    const uint32_t* first = visible_indices.data() + chunk * culling_grain_size;
+                    copy(first, first + visible_counts[chunk], visible_indices.data() + visible_count);
+                    visible_count += visible_counts[chunk];
+                }
+                visible_indices.resize(visible_count);
+            }
 
-                    // non-transparent objects should come first, so invert the condition
-                    return !a_transparent && b_transparent;
-                });
+            bool can_occlude(Renderable* renderable)
+            {
+                Material* material = renderable->GetMaterial();
+                return
+                    renderable->HasMesh() && !renderable->HasInstancing() &&
+                    material && !material->IsTransparent() && !material->IsAlphaTested() && !material->IsTessellated();
             }
 
-            void frustum_cull_and_sort(vector<shared_ptr<Entity>>& renderables)
+            void occlusion_culling(vector<shared_ptr<Entity>>& renderables)
             {
-                frustum_culling(renderables);
-                sort(renderables);
+                Camera* camera = Renderer::GetCamera().get();
+                if (camera->GetProjectionType() != Projection_Perspective)
+                    return;
 
-                // find transparent index
-                auto transparent_start = find_if(renderables.begin(), renderables.end(), [](const shared_ptr<Entity>& entity)
-                {
-                    Material* material = entity->GetComponent<Renderable>()->GetMaterial();
-                    bool is_transparent = material->IsTransparent();
-                    return is_transparent;
-                });
+                const Vector3 camera_position = camera->GetEntity()->GetPosition();
+                const float tan_half_fov      = tan(camera->GetFovVerticalRad() * 0.5f);
 
-                // check if any transparent object was found
-                if (transparent_start == renderables.end())
+                // 1. pick the occluders, out of what's in the view frustum
+                occluder_candidates.clear();
+                for (const uint32_t i : visible_indices)
                 {
-                    mesh_index_transparent = -1;
+                    Renderable* renderable = renderables[i]->GetComponentRaw<Renderable>();
+                    if (!can_occlude(renderable))
+                        continue;
+
+                    const BoundingBox& box  = renderable->GetBoundingBox(BoundingBoxType::Transformed);
+                    const float radius      = box.GetExtents().Length();
+                    const float distance    = max(Vector3::Distance(camera_position, box.GetCenter()) - radius, 0.0f);
+                    const float screen_size = distance > 0.0f ? radius / (distance * tan_half_fov) : numeric_limits<float>::max();
+                    if (screen_size >= occluder_screen_size_min)
+                    {
+                        occluder_candidates.emplace_back(screen_size, i);
+                    }
                 }
-                else
+
+                const size_t occluder_count = min(occluder_candidates.size(), static_cast<size_t>(occluder_count_max));
+                partial_sort(occluder_candidates.begin(), occluder_candidates.begin() + occluder_count, occluder_candidates.end(), greater<pair<float, uint32_t>>());
+                occluder_candidates.resize(occluder_count);
+
+                // 2. build the hulls they are missing, in parallel
+                occluder_builds.clear();
+                for (const pair<float, uint32_t>& candidate : occluder_candidates)
                 {
-                    mesh_index_transparent = distance(renderables.begin(), transparent_start);
+                    Renderable* renderable = renderables[candidate.second]->GetComponentRaw<Renderable>();
+                    if (!renderable->IsOccluderHullBuilt() && occluder_builds.size() < occluder_builds_per_frame)
+                    {
+                        occluder_builds.emplace_back(renderable);
+                    }
                 }
 
-                // find non-instanced index for opaque objects
-                auto non_instanced_opaque_start = find_if(renderables.begin(), renderables.end(), [&](const shared_ptr<Entity>& entity)
+                ThreadPool::ParallelLoop([](uint32_t index_start, uint32_t index_end)
                 {
-                    shared_ptr<Renderable> renderable = entity->GetComponent<Renderable>();
-                    bool is_transparent               = renderable->GetMaterial()->IsTransparent();
-                    bool is_instanced                 = renderable->HasInstancing();
-                    return !is_transparent && !is_instanced;
-                });
+                    for (uint32_t i = index_start; i < index_end; i++)
+                    {
+                        occluder_builds[i]->BuildOccluderHull();
+                    }
+                }, static_cast<uint32_t>(occluder_builds.size()), 1);
 
-                // find non-instanced index for transparent objects
-                auto non_instanced_transparent_start = find_if(transparent_start, renderables.end(), [&](const shared_ptr<Entity>& entity)
+                // 3. rasterize them
+                occlusion_buffer.Begin(camera->GetViewProjectionMatrix(), camera->GetNearPlane());
+                for (const pair<float, uint32_t>& candidate : occluder_candidates)
                 {
-                    return !entity->GetComponent<Renderable>()->HasInstancing();
-                });
+                    Entity* entity         = renderables[candidate.second].get();
+                    Renderable* renderable = entity->GetComponentRaw<Renderable>();
+                    if (!renderable->HasOccluderHull())
+                        continue;
 
-                // check if any non-instanced transparent object was found
-                if (non_instanced_transparent_start == renderables.end())
-                {
-                    mesh_index_non_instanced_transparent = -1;
+                    occlusion_buffer.AddOccluder(entity->GetMatrix(), &renderable->GetOccluderVertices(), &renderable->GetOccluderIndices());
+                    renderable->SetFlag(RenderableFlags::Occluder, true);
                 }
-                else
+                occlusion_buffer.Rasterize();
+
+                // 4. test everything that's in the view frustum, the occluders too since they can hide each other
+                atomic<uint32_t> occluded_count = 0;
+                ThreadPool::ParallelLoop([&renderables, &occluded_count](uint32_t index_start, uint32_t index_end)
+                {
+                    uint32_t occluded = 0;
+                    for (uint32_t i = index_start; i < index_end; i++)
+                    {
+                        Renderable* renderable = renderables[visible_indices[i]]->GetComponentRaw<Renderable>();
+                        if (!occlusion_buffer.IsVisible(renderable->GetBoundingBox(BoundingBoxType::Transformed)))
+                        {
+                            renderable->SetFlag(RenderableFlags::OccludedCpu, true);
+                            occluded++;
+                        }
+                    }
+
+                    occluded_count += occluded;
+                }, static_cast<uint32_t>(visible_indices.size()), culling_grain_size);
+
+                Profiler::m_occluders = occlusion_buffer.GetOccluderCount();
+                Profiler::m_occluded  = occluded_count;
+            }
+
+            void sort(vector<shared_ptr<Entity>>& renderables)
+            {
+                const uint32_t count          = static_cast<uint32_t>(renderables.size());
+                const Vector3 camera_position = Renderer::GetCamera()->GetEntity()->GetPosition();
+
+                // 1. build the keys
+                sort_keys.resize(count);
+                sort_indices.resize(count);
+                ThreadPool::ParallelLoop([&renderables, &camera_position](uint32_t index_start, uint32_t index_end)
                 {
-                    mesh_index_non_instanced_transparent = distance(renderables.begin(), non_instanced_transparent_start);
+                    for (uint32_t i = index_start; i < index_end; i++)
+                    {
+                        sort_keys[i]    = compute_sort_key(renderables[i]->GetComponentRaw<Renderable>(), camera_position);
+                        sort_indices[i] = i;
+                    }
+                }, count, sort_grain_size);
+
+                // 2. sort them
+                radix_sort(sort_keys, sort_indices);
+
+                // 3. reorder the renderables to match
+                sort_renderables_scratch.resize(count);
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    sort_renderables_scratch[i] = move(renderables[sort_indices[i]]);
                 }
+                renderables.swap(sort_renderables_scratch);
             }
 
-            void determine_occluders(vector<shared_ptr<Entity>>& renderables)
+            void frustum_cull_and_sort(vector<shared_ptr<Entity>>& renderables)
             {
-                uint32_t occluder_count = 0;
-                for (shared_ptr<Entity>& entity : renderables)
+                frustum_culling(renderables);
+
+                if (Renderer::GetOption<bool>(Renderer_Option::OcclusionCulling))
                 {
-                    shared_ptr<Renderable> renderable = entity->GetComponent<Renderable>();
-                    if (!renderable || renderable->HasFlag(RenderableFlags::OccludedCpu))
-                        continue;
+                    occlusion_culling(renderables);
+                }
+
+                sort(renderables);
 
-                    // compute screen space rectangle
-                    BoundingBox box                   = renderable->GetBoundingBox(BoundingBoxType::Transformed);
-                    Rectangle rectangle               = Renderer::GetCamera()->WorldToScreenCoordinates(box);
-                    boxes[entity->GetObjectId()]      = box;
-                    rectangles[entity->GetObjectId()] = rectangle;
+                // the keys are sorted, so the partitions can be found with a binary search
+                auto find_partition = [](const uint64_t key) -> int64_t
+                {
+                    auto it = lower_bound(sort_keys.begin(), sort_keys.end(), key);
+                    return it == sort_keys.end() ? -1 : distance(sort_keys.begin(), it);
+                };
 
-                    bool factor_screen_size = rectangle.Area() >= 65536.0f;
-                    bool factor_inside      = box.Contains(Renderer::GetCamera()->GetEntity()->GetPosition()); // say we are in a building
-                    bool factor_count       = occluder_count < 32;
-                    if (factor_count && factor_screen_size && !factor_inside)
+                mesh_index_transparent               = find_partition(sort_key_transparent);
+                mesh_index_non_instanced_transparent = find_partition(sort_key_transparent | sort_key_non_instanced);
+
+                // the culled renderables were sorted to the end of their partition, so the visible ones are a range at the start of each,
+                // they are listed again by their new position, which is what the passes iterate
+                const uint64_t partitions[] = { 0, sort_key_non_instanced, sort_key_transparent, sort_key_transparent | sort_key_non_instanced };
+                visible_indices.clear();
+                for (const uint64_t partition : partitions)
+                {
+                    const auto first = lower_bound(sort_keys.begin(), sort_keys.end(), partition);
+                    const auto last  = lower_bound(first, sort_keys.end(), partition | sort_key_culled);
+                    for (auto it = first; it != last; it++)
                     {
-                        renderable->SetFlag(RenderableFlags::Occluder, true);
-                        occluder_count++;
+                        visible_indices.emplace_back(static_cast<uint32_t>(distance(sort_keys.begin(), it)));
                     }
                 }
             }
 
-            void remove_false_gpu_occlusion(shared_ptr<Entity>& entity_occludee, vector<shared_ptr<Entity>>& entities)
+            // the visible renderables within [index_start, index_end) of the sorted renderables, as a range of visible_indices
+            void get_visible_range(const int64_t index_start, const int64_t index_end, uint32_t* visible_start, uint32_t* visible_end)
             {
-                // if this entity is outside of the view frustum, don't bother
-                shared_ptr<Renderable> renderable_occludee = entity_occludee->GetComponent<Renderable>();
-                if (!renderable_occludee || renderable_occludee->HasFlag(OccludedCpu))
-                    return;
+                auto first     = lower_bound(visible_indices.begin(), visible_indices.end(), static_cast<uint32_t>(max<int64_t>(index_start, 0)));
+                auto last      = lower_bound(first, visible_indices.end(), static_cast<uint32_t>(max<int64_t>(index_end, 0)));
+                *visible_start = static_cast<uint32_t>(distance(visible_indices.begin(), first));
+                *visible_end   = static_cast<uint32_t>(distance(visible_indices.begin(), last));
+            }
 
-                bool is_visible         = true;
-                uint32_t occluder_count = 0;
-                for (shared_ptr<Entity>& entity_occluder : entities)
+            // lod selection, the simplification error of every level is projected to pixels at the distance of the renderable
+            // and the coarsest level whose error stays under the threshold is picked, the hysteresis keeps renderables
+            // which sit on a threshold from switching back and forth every frame
+            const float lod_error_pixels_max = 1.0f;
+            const float lod_hysteresis       = 0.1f;
+
+            uint32_t compute_lod(const Renderable* renderable, const float error_to_pixels, const float error_pixels_max)
+            {
+                // the error grows with every level, so stop at the first one that's too coarse
+                uint32_t lod = 0;
+                for (uint32_t level = 1; level < renderable->GetLodCount(); level++)
                 {
-                    shared_ptr<Renderable> renderable_occluder = entity_occluder->GetComponent<Renderable>();
-                    if (!renderable_occluder || entity_occludee->GetObjectId() == entity_occluder->GetObjectId())
-                        continue;
+                    if (renderable->GetLodError(level) * error_to_pixels > error_pixels_max)
+                        break;
+
+                    lod = level;
+                }
 
-                    if (renderable_occluder->HasFlag(Occluder))
+                return lod;
+            }
+
+            void select_lods(vector<shared_ptr<Entity>>& renderables)
+            {
+                Camera* camera                = Renderer::GetCamera().get();
+                const Vector3 camera_position = camera->GetEntity()->GetPosition();
+                const bool is_perspective     = camera->GetProjectionType() == Projection_Perspective;
+                const float tan_half_fov      = tan(camera->GetFovVerticalRad() * 0.5f);
+                const float half_height       = Renderer::GetResolutionRender().y * 0.5f;
+
+                // culled renderables keep their level, so they don't pop when they come back into view
+                ThreadPool::ParallelLoop([&renderables, &camera_position, is_perspective, tan_half_fov, half_height](uint32_t index_start, uint32_t index_end)
+                {
+                    for (uint32_t i = index_start; i < index_end; i++)
                     {
-                        // project world space axis-aligned bounding boxes into screen space
-                        Rectangle& rectangle_occludee = rectangles[entity_occludee->GetObjectId()];
-                        Rectangle& rectangle_occluder = rectangles[entity_occluder->GetObjectId()];
+                        Entity* entity           = renderables[visible_indices[i]].get();
+                        Renderable* renderable   = entity->GetComponentRaw<Renderable>();
+                        const uint32_t lod_count = renderable->GetLodCount();
+                        if (lod_count == 1)
+                            continue;
 
-                        // if it's contained by at least one occluder, it's not visible
-                        if (rectangle_occluder.Contains(rectangle_occludee))
+                        // orthographic projections don't shrink with distance
+                        if (!is_perspective || renderable->HasInstancing())
                         {
-                            is_visible = false;
-                            break;
+                            renderable->SetLod(0);
+                            continue;
                         }
 
-                        occluder_count++;
-                    }
+                        const BoundingBox& box = renderable->GetBoundingBox(BoundingBoxType::Transformed);
+                        const float radius     = box.GetExtents().Length();
+                        const float distance   = max(Vector3::Distance(camera_position, box.GetCenter()) - radius, 0.0f);
+                        if (distance == 0.0f)
+                        {
+                            renderable->SetLod(0);
+                            continue;
+                        }
 
-                    // use the 4 first (and front most) occluders
-                    if (occluder_count > 4)
-                        break;
-                }
+                        // the errors are relative to the largest dimension of the geometry, bring them to world space and then to pixels
+                        const Vector3 size_mesh     = renderable->GetBoundingBox(BoundingBoxType::Mesh).GetSize();
+                        const Vector3 scale         = entity->GetMatrix().GetScale().Abs();
+                        const float error_scale     = max(size_mesh.x, max(size_mesh.y, size_mesh.z)) * max(scale.x, max(scale.y, scale.z));
+                        const float error_to_pixels = error_scale * half_height / (distance * tan_half_fov);
 
-                if (is_visible)
-                {
-                    renderable_occludee->SetFlag(RenderableFlags::OccludedGpu, false);
-                }
+                        // only switch when the level would change even with the hysteresis applied
+                        const uint32_t lod_current = renderable->GetLod();
+                        uint32_t lod               = compute_lod(renderable, error_to_pixels, lod_error_pixels_max);
+                        if (lod > lod_current)
+                        {
+                            lod = max(lod_current, compute_lod(renderable, error_to_pixels, lod_error_pixels_max * (1.0f - lod_hysteresis)));
+                        }
+                        else if (lod < lod_current)
+                        {
+                            lod = min(lod_current, compute_lod(renderable, error_to_pixels, lod_error_pixels_max * (1.0f + lod_hysteresis)));
+                        }
+
+                        renderable->SetLod(lod);
+                    }
+                }, static_cast<uint32_t>(visible_indices.size()), 256);
             }
 
-            void get_gpu_occlusion_query_results(RHI_CommandList* cmd_list, unordered_map<Renderer_Entity, vector<shared_ptr<Entity>>>& renderables)
+            // the normal cones are only valid when the back faces are culled and the transform doesn't skew the normals,
+            // subsurface scattering materials are excluded as the depth prepass also draws their back faces
+            bool can_cull_meshlet_cones(Renderable* renderable, const Matrix& transform, const bool is_wireframe, float* scale_max)
             {
-                cmd_list->UpdateOcclusionQueries();
+                const Vector3 scale   = transform.GetScale().Abs();
+                *scale_max            = max(scale.x, max(scale.y, scale.z));
+                const float scale_min = min(scale.x, min(scale.y, scale.z));
+
+                const Material* material = renderable->GetMaterial();
+                return
+                    !is_wireframe && material &&
+                    static_cast<RHI_CullMode>(material->GetProperty(MaterialProperty::CullMode)) == RHI_CullMode::Back &&
+                    material->GetProperty(MaterialProperty::SubsurfaceScattering) == 0.0f &&
+                    *scale_max - scale_min <= *scale_max * 0.01f;
+            }
 
-                bool is_transparent_pass = false;
-                uint32_t start_index     = !is_transparent_pass ? 0 : 2;
-                uint32_t end_index       = !is_transparent_pass ? 2 : 4;
-                for (uint32_t i = start_index; i < end_index; i++)
+            void cull_meshlets(vector<shared_ptr<Entity>>& renderables)
+            {
+                Camera* camera                   = Renderer::GetCamera().get();
+                const Frustum& frustum           = camera->GetFrustum();
+                const Vector3 camera_position    = camera->GetEntity()->GetPosition();
+                const bool is_enabled            = Renderer::GetOption<bool>(Renderer_Option::MeshletCulling);
+                const bool is_wireframe          = Renderer::GetOption<bool>(Renderer_Option::Wireframe);
+                atomic<uint32_t> meshlets_tested = 0;
+                atomic<uint32_t> meshlets_culled = 0;
+
+                ThreadPool::ParallelLoop([&renderables, &frustum, &camera_position, &meshlets_tested, &meshlets_culled, is_enabled, is_wireframe](uint32_t index_start, uint32_t index_end)
                 {
-                    auto& entities = renderables[static_cast<Renderer_Entity>(i)];
-                    if (entities.empty())
-                        continue;
+                    uint32_t tested = 0;
+                    uint32_t culled = 0;
 
-                    for (shared_ptr<Entity>& entity : entities)
+                    for (uint32_t i = index_start; i < index_end; i++)
                     {
-                        shared_ptr<Renderable> renderable = entity->GetComponent<Renderable>();
-                        if (!renderable)
+                        Entity* entity         = renderables[visible_indices[i]].get();
+                        Renderable* renderable = entity->GetComponentRaw<Renderable>();
+
+                        // the meshlets only partition the full detail geometry, the flag of culled renderables is left as is since nothing draws them
+                        bool cull = is_enabled && renderable->HasMeshlets() && !renderable->HasInstancing() && renderable->GetLod() == 0;
+                        renderable->SetFlag(RenderableFlags::MeshletsCulled, cull);
+                        if (!cull)
                             continue;
 
-                        bool occluded = cmd_list->GetOcclusionQueryResult(entity->GetObjectId());
-                        renderable->SetFlag(RenderableFlags::OccludedGpu, occluded);
+                        const Matrix& transform = entity->GetMatrix();
+                        float scale_max         = 1.0f;
+                        const bool cull_cones   = can_cull_meshlet_cones(renderable, transform, is_wireframe, &scale_max);
 
-                        // counter occlusion query latency by removing false gpu occlusions
-                        if (occluded)
+                        // merge neighbouring visible meshlets into one range, they are contiguous in the index buffer
+                        vector<RenderableIndexRange>& ranges = renderable->GetMeshletRangesVisible();
+                        ranges.clear();
+                        const uint32_t index_offset_mesh       = renderable->GetMeshIndexOffset();
+                        for (const Meshlet& meshlet : renderable->GetMeshlets())
                         {
-                            remove_false_gpu_occlusion(entity, entities);
+                            tested++;
+
+                            const Vector3 center = meshlet.center * transform;
+                            const float radius   = meshlet.radius * scale_max;
+                            if (!frustum.IsVisible(center, Vector3(radius)))
+                            {
+                                culled++;
+                                continue;
+                            }
+
+                            if (cull_cones)
+                            {
+                                const Vector3 apex = meshlet.cone_apex * transform;
+                                const Vector3 axis = ((meshlet.cone_apex + meshlet.cone_axis) * transform - apex).Normalized();
+                                if (Vector3::Dot((apex - camera_position).Normalized(), axis) >= meshlet.cone_cutoff)
+                                {
+                                    culled++;
+                                    continue;
+                                }
+                            }
+
+                            if (!ranges.empty() && ranges.back().index_offset + ranges.back().index_count == index_offset_mesh + meshlet.index_offset)
+                            {
+                                ranges.back().index_count += meshlet.index_count;
+                            }
+                            else
+                            {
+                                ranges.push_back({ index_offset_mesh + meshlet.index_offset, meshlet.index_count });
+                            }
                         }
                     }
+
+                    meshlets_tested += tested;
+                    meshlets_culled += culled;
+                }, static_cast<uint32_t>(visible_indices.size()), 64);
+
+                Profiler::m_meshlets        = meshlets_tested;
+                Profiler::m_meshlets_culled = meshlets_culled;
+            }
+        }
+
+        uint32_t get_lod(Renderable* renderable, const bool is_shadow, const bool is_shadow_cached = false)
+        {
+            // shadows are lower frequency than what the camera sees, so they can afford a coarser level,
+            // cached shadows are kept for many frames so they ignore the camera's selection, which changes as it moves
+            uint32_t lod = is_shadow_cached ? 0 : renderable->GetLod();
+            if (is_shadow)
+            {
+                lod += Renderer::GetOption<uint32_t>(Renderer_Option::ShadowLodBias);
+            }
+
+            return min(lod, renderable->GetLodCount() - 1);
+        }
+
+        // returns the variant of a mesh vertex shader which matches the vertex layout of a renderable, or null if it's not compiled yet
+        RHI_Shader* get_vertex_shader(const Renderer_Shader shader, const RHI_Vertex_Type vertex_type)
+        {
+            Renderer_Shader variant = shader;
+            if (vertex_type == RHI_Vertex_Type::PosUvNorTanPacked || vertex_type == RHI_Vertex_Type::PosUvNorTanPackedHalf)
+            {
+                const bool is_half = vertex_type == RHI_Vertex_Type::PosUvNorTanPackedHalf;
+                switch (shader)
+                {
+                    case Renderer_Shader::depth_prepass_v: variant = is_half ? Renderer_Shader::depth_prepass_packed_half_v : Renderer_Shader::depth_prepass_packed_v; break;
+                    case Renderer_Shader::depth_light_v:   variant = is_half ? Renderer_Shader::depth_light_packed_half_v   : Renderer_Shader::depth_light_packed_v;   break;
+                    case Renderer_Shader::gbuffer_v:       variant = is_half ? Renderer_Shader::gbuffer_packed_half_v       : Renderer_Shader::gbuffer_packed_v;       break;
+                    case Renderer_Shader::outline_v:       variant = is_half ? Renderer_Shader::outline_packed_half_v       : Renderer_Shader::outline_packed_v;       break;
+                    default: SP_ASSERT_MSG(false, "The shader has no packed vertex variant"); break;
                 }
             }
+
+            RHI_Shader* shader_variant = Renderer::GetShader(variant).get();
+            return (shader_variant && shader_variant->IsCompiled()) ? shader_variant : nullptr;
         }
 
-        void draw_renderable(RHI_CommandList* cmd_list, RHI_PipelineState& pso, Camera* camera, Renderable* renderable, Light* light = nullptr, uint32_t array_index = 0)
+        void draw_renderable(RHI_CommandList* cmd_list, RHI_PipelineState& pso, Camera* camera, Renderable* renderable, Light* light = nullptr, uint32_t array_index = 0, bool is_shadow_cached = false)
         {
             uint32_t instance_start_index = 0;
             bool draw_instanced           = pso.instancing && renderable->HasInstancing();
+            const uint32_t lod            = get_lod(renderable, light != nullptr, is_shadow_cached);
 
             if (draw_instanced)
             {
@@ -315,8 +647,8 @@ namespace Spartan
                     if (instance_count > 0)
                     {
                         cmd_list->DrawIndexed(
-                            renderable->GetIndexCount(),
-                            renderable->GetIndexOffset(),
+                            renderable->GetLodIndexCount(lod),
+                            renderable->GetLodIndexOffset(lod),
                             renderable->GetVertexOffset(),
                             instance_start_index,
                             instance_count
@@ -326,11 +658,46 @@ namespace Spartan
                     instance_start_index = group_end_index;
                 }
             }
+            else if (!light && renderable->HasFlag(RenderableFlags::MeshletsCulled))
+            {
+                // only the meshlets which survived culling against the camera, lights see the geometry from elsewhere
+                for (const RenderableIndexRange& range : renderable->GetMeshletRangesVisible())
+                {
+                    cmd_list->DrawIndexed(range.index_count, range.index_offset, renderable->GetVertexOffset());
+                }
+            }
+            else if (renderable->HasSubmeshes() && lod == 0)
+            {
+                // static batch, the submeshes are contiguous so neighbouring visible ones are drawn as one range (its lods span all of them)
+                const vector<RenderableSubmesh>& submeshes = renderable->GetSubmeshes();
+                const uint32_t submesh_count               = static_cast<uint32_t>(submeshes.size());
+                uint32_t range_index_offset                = 0;
+                uint32_t range_index_count                 = 0;
+
+                for (uint32_t submesh_index = 0; submesh_index < submesh_count; submesh_index++)
+                {
+                    const BoundingBox& bounding_box_submesh = renderable->GetBoundingBox(BoundingBoxType::TransformedSubmesh, submesh_index);
+                    bool is_visible                         = light ? light->IsInViewFrustum(bounding_box_submesh, array_index) : camera->IsInViewFrustum(bounding_box_submesh);
+
+                    if (is_visible)
+                    {
+                        range_index_offset  = range_index_count == 0 ? renderable->GetMeshIndexOffset() + submeshes[submesh_index].index_offset : range_index_offset;
+                        range_index_count  += submeshes[submesh_index].index_count;
+                    }
+
+                    // flush the range when it's interrupted or when there are no more submeshes
+                    if ((!is_visible || submesh_index == submesh_count - 1) && range_index_count > 0)
+                    {
+                        cmd_list->DrawIndexed(range_index_count, range_index_offset, renderable->GetVertexOffset());
+                        range_index_count = 0;
+                    }
+                }
+            }
             else 
             {
                 cmd_list->DrawIndexed(
-                    renderable->GetIndexCount(),
-                    renderable->GetIndexOffset(),
+                    renderable->GetLodIndexCount(lod),
+                    renderable->GetLodIndexOffset(lod),
                     renderable->GetVertexOffset()
                 );
             }
@@ -360,82 +727,573 @@ namespace Spartan
 
             return get_start ? index_start : index_end;
         }
-    }
 
-    void Renderer::SetStandardResources(RHI_CommandList* cmd_list)
-    {
-        cmd_list->SetConstantBuffer(Renderer_BindingsCb::frame, GetBuffer(Renderer_Buffer::ConstantFrame));
-        cmd_list->SetBuffer(Renderer_BindingsUav::sb_materials, GetBuffer(Renderer_Buffer::StorageMaterials));
-        cmd_list->SetBuffer(Renderer_BindingsUav::sb_lights,    GetBuffer(Renderer_Buffer::StorageLights));
-        cmd_list->SetBuffer(Renderer_BindingsUav::sb_spd,       GetBuffer(Renderer_Buffer::StorageSpd));
-    }
+        namespace shadow_cache
+        {
+            // casters which moved within this many frames are treated as dynamic (animated, scripted etc.)
+            const uint64_t dynamic_settle_frames = 60;
 
-    void Renderer::ProduceFrame(RHI_CommandList* cmd_list_graphics, RHI_CommandList* cmd_list_compute)
-    {
-        SP_PROFILE_CPU();
+            struct Slices
+            {
+                array<Matrix, 2> view_projection = {};
+                array<uint64_t, 2> static_hash   = {};
+                array<float, 2> range            = {};
+                array<bool, 2> valid             = {};
+                uint64_t texture_id              = 0;
+                bool depth_matches_static        = false; // false once dynamic or transparent casters have been drawn on top of the copy
+            };
+
+            unordered_map<uint64_t, Slices> lights;
+            unordered_map<uint64_t, uint64_t> last_moved_frame;
+            vector<uint8_t> is_dynamic; // indexed relative to the start of the opaque range
+            uint64_t static_hash = 0;
+
+            uint64_t mix(uint64_t x)
+            {
+                // splitmix64 finalizer
+                x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+                x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+                x ^= x >> 31;
+                return x;
+            }
 
-        // acquire render targets
-        RHI_Texture* rt_render = GetRenderTarget(Renderer_RenderTarget::frame_render).get();
-        RHI_Texture* rt_output = GetRenderTarget(Renderer_RenderTarget::frame_output).get();
+            // splits the casters into static and dynamic, and hashes the static set so that
+            // additions, removals and static casters becoming dynamic (or vice versa) invalidate the cache
+            void classify(vector<shared_ptr<Entity>>& renderables, const int64_t index_start, const int64_t index_end)
+            {
+                const uint64_t frame = Renderer::GetFrameNum();
+                uint64_t hash_sum    = 0;
+                uint64_t hash_xor    = 0;
+                uint64_t count       = 0;
 
-        Pass_VariableRateShading(cmd_list_graphics);
-        Pass_Skysphere(cmd_list_graphics);
+                is_dynamic.assign(static_cast<size_t>(index_end - index_start), 0);
+                for (int64_t i = index_start; i < index_end; i++)
+                {
+                    Entity* entity         = renderables[i].get();
+                    Renderable* renderable = entity->GetComponentRaw<Renderable>();
+                    if (!renderable || !renderable->HasFlag(RenderableFlags::CastsShadows))
+                        continue;
 
-        // light integration
-        {
-            if (!light_integration_brdf_speculat_lut_completed)
-            {
-                Pass_Light_Integration_BrdfSpecularLut(cmd_list_graphics);
-                light_integration_brdf_speculat_lut_completed = true;
+                    const uint64_t id = entity->GetObjectId();
+                    if (entity->IsMoving())
+                    {
+                        last_moved_frame[id] = frame;
+                    }
+
+                    bool dynamic = false;
+                    if (PhysicsBody* physics_body = entity->GetComponentRaw<PhysicsBody>())
+                    {
+                        dynamic = physics_body->GetMass() != 0.0f;
+                    }
+
+                    auto it = last_moved_frame.find(id);
+                    if (it != last_moved_frame.end() && frame - it->second < dynamic_settle_frames)
+                    {
+                        dynamic = true;
+                    }
+
+                    is_dynamic[i - index_start] = dynamic ? 1 : 0;
+                    if (!dynamic)
+                    {
+                        // order independent, the renderables are re-sorted every frame
+                        const uint64_t hash = mix(id);
+                        hash_sum += hash;
+                        hash_xor ^= hash;
+                        count++;
+                    }
+                }
+
+                // the static casters are drawn at a fixed level (see get_lod()), only the bias can change it
+                const uint64_t lod_bias = Renderer::GetOption<uint32_t>(Renderer_Option::ShadowLodBias);
+                static_hash             = mix(hash_sum ^ mix(hash_xor + count) ^ mix(lod_bias + 1));
+
+                // forget settled casters, this also drops the ones which have been removed from the world
+                erase_if(last_moved_frame, [frame](const auto& entry) { return frame - entry.second >= dynamic_settle_frames; });
             }
 
-            if (m_environment_mips_to_filter_count > 0)
+            // forget the lights which have been removed from the world
+            void prune_lights(const vector<shared_ptr<Entity>>& lights_present)
             {
-                Pass_Light_Integration_EnvironmentPrefilter(cmd_list_graphics);
+                erase_if(lights, [&lights_present](const auto& entry)
+                {
+                    return none_of(lights_present.begin(), lights_present.end(), [&entry](const shared_ptr<Entity>& light)
+                    {
+                        return light->GetObjectId() == entry.first;
+                    });
+                });
             }
         }
 
-        if (shared_ptr<Camera> camera = GetCamera())
-        { 
-            // shadow maps
+        namespace shadow_casters
+        {
+            // per light (in the order of the light renderables) and per slice, the indices of the casters inside the slice
+            vector<array<vector<uint32_t>, 2>> lists;
+            vector<Light*> lights_casting;
+            vector<uint8_t> masks; // one byte per caster and light, one bit per slice
+
+            bool is_in_slice(Light* light, const BoundingBox& box, const Vector3& center, const float radius, const uint32_t slice)
             {
-                Pass_ShadowMaps(cmd_list_graphics, false);
-                if (mesh_index_transparent != -1)
-                {
-                    Pass_ShadowMaps(cmd_list_graphics, true);
-                }
+                // cheap sphere rejection first, then the exact box test
+                return light->IsInViewFrustum(center, radius, slice) && light->IsInViewFrustum(box, slice);
             }
 
-            // render resolution
+            void build(vector<shared_ptr<Entity>>& lights, vector<shared_ptr<Entity>>& renderables, const int64_t index_start, const int64_t index_end, const bool is_transparent_pass)
             {
-                // opaque
+                const uint32_t light_count  = static_cast<uint32_t>(lights.size());
+                const uint32_t caster_count = static_cast<uint32_t>(max(index_end - index_start, int64_t(0)));
+
+                lights_casting.assign(light_count, nullptr);
+                for (uint32_t light_index = 0; light_index < light_count; light_index++)
                 {
-                    bool is_transparent = false;
+                    Light* light = lights[light_index]->GetComponentRaw<Light>();
+                    if (!light || !light->IsFlagSet(LightFlags::Shadows) || light->GetIntensityWatt() == 0.0f || !light->GetDepthTexture())
+                        continue;
 
-                    Pass_Visibility(cmd_list_graphics);
-                    Pass_Depth_Prepass(cmd_list_graphics, is_transparent);
-                    Pass_GBuffer(cmd_list_graphics, is_transparent);
-                    Pass_Ssr(cmd_list_graphics);
-                    Pass_Ssao(cmd_list_graphics);
-                    Pass_Sss(cmd_list_graphics);
-                    Pass_Light(cmd_list_graphics, is_transparent);             // compute diffuse and specular buffers
-                    Pass_Light_GlobalIllumination(cmd_list_graphics);          // compute global illumination
-                    Pass_Light_Composition(cmd_list_graphics, is_transparent); // compose all light (diffuse, specular, etc.)
-                    Pass_Light_ImageBased(cmd_list_graphics, is_transparent);  // apply IBL (skysphere, ssr, global illumination etc.)
-                }
+                    if (is_transparent_pass && !light->IsFlagSet(LightFlags::ShadowsTransparent))
+                        continue;
 
-                // used for refraction and to produce a reactive mask for fsr
-                cmd_list_graphics->BeginTimeblock("frame_opaque");
-                {
-                    RHI_Texture* tex_render_opaque = GetRenderTarget(Renderer_RenderTarget::frame_render_opaque).get();
-                    cmd_list_graphics->Blit(rt_render, tex_render_opaque, false);
-                    // generate mips to simulate roughness
-                    Pass_Downsample(cmd_list_graphics, tex_render_opaque, Renderer_DownsampleFilter::Average);
+                    lights_casting[light_index] = light;
                 }
-                cmd_list_graphics->EndTimeblock();
-                
-                // transparent
-                if (mesh_index_transparent != -1)
+
+                // test every caster against every slice, each caster is owned by one thread so its bounding box can be updated safely
+                masks.assign(static_cast<size_t>(caster_count) * light_count, 0);
+                ThreadPool::ParallelLoop([light_count, index_start, &renderables](uint32_t start, uint32_t end)
+                {
+                    for (uint32_t caster_index = start; caster_index < end; caster_index++)
+                    {
+                        Renderable* renderable = renderables[index_start + caster_index]->GetComponentRaw<Renderable>();
+                        if (!renderable || !renderable->HasFlag(RenderableFlags::CastsShadows))
+                            continue;
+
+                        const BoundingBox& box = renderable->GetBoundingBox(BoundingBoxType::Transformed);
+                        if (box == BoundingBox::Undefined)
+                            continue;
+
+                        const Vector3 center = box.GetCenter();
+                        const float radius   = box.GetExtents().Length();
+
+                        for (uint32_t light_index = 0; light_index < light_count; light_index++)
+                        {
+                            Light* light = lights_casting[light_index];
+                            if (!light)
+                                continue;
+
+                            uint8_t mask = 0;
+                            if (light->GetLightType() == LightType::Directional)
+                            {
+                                // the near cascade is nested inside the far one, a caster outside of the far cascade can be rejected for both
+                                if (is_in_slice(light, box, center, radius, 1))
+                                {
+                                    mask |= 1 << 1;
+                                    mask |= is_in_slice(light, box, center, radius, 0) ? 1 << 0 : 0;
+                                }
+                            }
+                            else
+                            {
+                                for (uint32_t slice = 0; slice < light->GetDepthTexture()->GetArrayLength(); slice++)
+                                {
+                                    mask |= is_in_slice(light, box, center, radius, slice) ? 1 << slice : 0;
+                                }
+                            }
+
+                            masks[static_cast<size_t>(caster_index) * light_count + light_index] = mask;
+                        }
+                    }
+                }, caster_count);
+
+                // compact the masks into lists, in mesh order so that recording sees the same order as before
+                lists.resize(light_count);
+                ThreadPool::ParallelLoop([light_count, caster_count, index_start](uint32_t start, uint32_t end)
+                {
+                    for (uint32_t light_index = start; light_index < end; light_index++)
+                    {
+                        for (vector<uint32_t>& list : lists[light_index])
+                        {
+                            list.clear();
+                        }
+
+                        if (!lights_casting[light_index])
+                            continue;
+
+                        for (uint32_t caster_index = 0; caster_index < caster_count; caster_index++)
+                        {
+                            uint8_t mask = masks[static_cast<size_t>(caster_index) * light_count + light_index];
+                            for (uint32_t slice = 0; slice < 2; slice++)
+                            {
+                                if (mask & (1 << slice))
+                                {
+                                    lists[light_index][slice].emplace_back(static_cast<uint32_t>(index_start) + caster_index);
+                                }
+                            }
+                        }
+                    }
+                }, light_count, 1);
+            }
+        }
+
+        namespace gpu_driven
+        {
+            vector<IndirectDrawBucket> buckets;
+            vector<Sb_DrawObject> draw_objects;
+            array<uint32_t, renderer_max_draw_buckets * renderer_culling_phase_count> counts_zero = {};
+            bool active = false;
+
+            // occlusion culling, the late phase writes which draw objects it found visible and the early phase of the next frame draws them,
+            // the draw objects are rebuilt every frame, so they are matched to last frame's results through their entity
+            struct VisibilityRange
+            {
+                uint32_t offset = 0;
+                uint32_t count  = 0;
+            };
+            unordered_map<uint64_t, VisibilityRange> visibility_ranges;
+            unordered_map<uint64_t, VisibilityRange> visibility_ranges_previous;
+            uint32_t visibility_region = 0; // which half of the visibility buffer the late phase writes, the other half holds last frame's
+            bool is_two_phase          = false;
+
+            // the culling phases, same as in indirect_cull.hlsl
+            const uint32_t phase_single = 0; // frustum and cone culling only
+            const uint32_t phase_early  = 1; // what was visible last frame
+            const uint32_t phase_late   = 2; // everything else, against the hierarchical depth
+
+            // the pass constants of the culling, the late phase runs after the depth prepass has overwritten the shared ones
+            Pcb_Pass pass_constants;
+
+            // the cpu visible count of each frame in flight, so that the gpu count can be compared against it once read back,
+            // only single phase frames are compared, with occlusion the gpu also tests against the hierarchical depth, which the cpu can't
+            array<uint32_t, resources_frame_lifetime> visible_count_cpu_history = {};
+            array<bool, resources_frame_lifetime> visible_count_history_valid   = {};
+            uint32_t visible_count_gpu         = 0;
+            uint32_t visible_count_cpu         = 0;
+            bool visible_count_mismatch_logged = false;
+
+            bool is_eligible(Renderable* renderable)
+            {
+                if (!renderable || renderable->HasInstancing())
+                    return false;
+
+                Material* material = renderable->GetMaterial();
+                if (!material || material->IsTessellated())
+                    return false;
+
+                // the indirect shaders are only compiled for the full vertex layout
+                if (renderable->GetVertexType() != RHI_Vertex_Type::PosUvNorTan)
+                    return false;
+
+                return renderable->GetVertexBuffer() && renderable->GetIndexBuffer() && !(renderable->GetBoundingBox(BoundingBoxType::Transformed) == BoundingBox::Undefined);
+            }
+
+            // renderables with meshlets get one draw object per meshlet, so that the culling pass can reject them individually
+            bool uses_meshlets(Renderable* renderable)
+            {
+                return Renderer::GetOption<bool>(Renderer_Option::MeshletCulling) && renderable->HasMeshlets() && renderable->GetLod() == 0;
+            }
+
+            uint32_t get_draw_object_count(Renderable* renderable)
+            {
+                return uses_meshlets(renderable) ? static_cast<uint32_t>(renderable->GetMeshlets().size()) : 1;
+            }
+
+            uint32_t get_bucket_index(Renderable* renderable)
+            {
+                const RHI_CullMode cull_mode = static_cast<RHI_CullMode>(renderable->GetMaterial()->GetProperty(MaterialProperty::CullMode));
+                return IndirectDraws::GetBucketIndex(buckets, renderable->GetVertexBuffer(), renderable->GetIndexBuffer(), cull_mode, renderer_max_draw_buckets);
+            }
+
+            // each culling phase writes its own region of the commands and the counts
+            void draw(RHI_CommandList* cmd_list, const bool is_wireframe, const uint32_t phase)
+            {
+                RHI_Buffer* buffer_commands = Renderer::GetBuffer(Renderer_Buffer::StorageDrawCommands).get();
+                RHI_Buffer* buffer_counts   = Renderer::GetBuffer(Renderer_Buffer::StorageDrawCounts).get();
+
+                for (uint32_t i = 0; i < static_cast<uint32_t>(buckets.size()); i++)
+                {
+                    const IndirectDrawBucket& bucket = buckets[i];
+                    if (bucket.object_count == 0)
+                        continue;
+
+                    cmd_list->SetCullMode(is_wireframe ? RHI_CullMode::None : bucket.cull_mode);
+                    cmd_list->SetBufferVertex(bucket.vertex_buffer);
+                    cmd_list->SetBufferIndex(bucket.index_buffer);
+                    cmd_list->DrawIndexedIndirectCount(
+                        buffer_commands,
+                        (phase * renderer_max_draw_objects + bucket.command_offset) * sizeof(Sb_DrawIndexedIndirectCommand),
+                        buffer_counts,
+                        buffer_counts->GetOffset() + (phase * renderer_max_draw_buckets + i) * sizeof(uint32_t),
+                        bucket.object_count
+                    );
+                }
+            }
+        }
+
+        namespace parallel_recording
+        {
+            // below this, a secondary command list costs more than the recording it takes off the calling thread
+            const uint32_t items_per_job_min = 64;
+            const uint32_t job_count_max     = 32;
+
+            // splits [0, item_count) into contiguous ranges, each recorded by a job into its own secondary command list,
+            // the secondaries are executed in job order, so the result is the same as recording the items serially
+            void record(RHI_CommandList* cmd_list, RHI_PipelineState& pso, const uint32_t item_count, const function<void(RHI_CommandList* cmd_list, const uint32_t start, const uint32_t end)>& record_range)
+            {
+                uint32_t job_count = Helper::Clamp<uint32_t>(Renderer::GetOption<uint32_t>(Renderer_Option::RecordingJobs), 1, job_count_max);
+                job_count          = Helper::Clamp<uint32_t>(item_count / items_per_job_min, 1, job_count);
+
+                cmd_list->RecordParallel(pso, job_count, [&](RHI_CommandList* cmd_list_job, const uint32_t job_index)
+                {
+                    record_range(cmd_list_job, item_count * job_index / job_count, item_count * (job_index + 1) / job_count);
+                });
+            }
+        }
+
+        namespace dynamic_instancing
+        {
+            // the first member is kept alive and provides the buffers, geometry and material for the whole batch
+            struct Batch
+            {
+                shared_ptr<Entity> entity;
+                uint32_t index_offset   = 0;
+                uint32_t index_count    = 0;
+                uint32_t instance_start = 0;
+                uint32_t instance_count = 0;
+            };
+
+            vector<InstancingCandidate> candidates;
+            vector<InstancingGroup> groups;
+            vector<Batch> batches;
+            vector<Matrix> instances;
+
+            bool is_eligible(Entity* entity, Renderable* renderable)
+            {
+                if (!renderable || renderable->HasInstancing() || !renderable->GetMaterial())
+                    return false;
+
+                if (renderable->HasFlag(RenderableFlags::OccludedCpu) || renderable->HasFlag(RenderableFlags::DrawnIndirect))
+                    return false;
+
+                // drawing only the visible meshlets beats drawing all of them instanced
+                if (renderable->HasFlag(RenderableFlags::MeshletsCulled))
+                    return false;
+
+                if (!renderable->GetVertexBuffer() || !renderable->GetIndexBuffer())
+                    return false;
+
+                // the instance transform is also used as the previous transform, so only renderables which didn't move can be batched
+                return entity->GetMatrix() == entity->GetMatrixPrevious();
+            }
+
+            void build(vector<shared_ptr<Entity>>& renderables, const int64_t index_end)
+            {
+                uint32_t visible_start = 0;
+                uint32_t visible_end   = 0;
+                visibility::get_visible_range(0, index_end, &visible_start, &visible_end);
+
+                candidates.clear();
+                for (uint32_t visible_index = visible_start; visible_index < visible_end; visible_index++)
+                {
+                    const uint32_t i = visibility::visible_indices[visible_index];
+                    if (i >= static_cast<uint32_t>(renderables.size()))
+                        continue;
+
+                    Entity* entity         = renderables[i].get();
+                    Renderable* renderable = entity->GetComponentRaw<Renderable>();
+                    if (!is_eligible(entity, renderable))
+                        continue;
+
+                    InstancingCandidate& candidate = candidates.emplace_back();
+                    candidate.material_id          = renderable->GetMaterial()->GetObjectId();
+                    candidate.vertex_buffer_id     = renderable->GetVertexBuffer()->GetObjectId();
+                    candidate.index_buffer_id      = renderable->GetIndexBuffer()->GetObjectId();
+                    candidate.index_offset         = renderable->GetLodIndexOffset(renderable->GetLod()); // renderables at different lods can't share a draw
+                    candidate.index_count          = renderable->GetLodIndexCount(renderable->GetLod());
+                    candidate.vertex_offset        = renderable->GetVertexOffset();
+                    candidate.renderable_index     = i;
+                }
+
+                // an instance id of 0 reads as non-instanced in the shaders, so the first slot is never used by a batch
+                instances.emplace_back(Matrix::Identity);
+
+                DynamicInstancing::Group(candidates, static_cast<uint32_t>(instances.size()), renderer_max_batched_instances, groups);
+                for (const InstancingGroup& group : groups)
+                {
+                    const InstancingCandidate& first = candidates[group.candidate_start];
+
+                    Batch& batch         = batches.emplace_back();
+                    batch.entity         = renderables[first.renderable_index];
+                    batch.index_offset   = first.index_offset;
+                    batch.index_count    = first.index_count;
+                    batch.instance_start = static_cast<uint32_t>(instances.size());
+                    batch.instance_count = group.candidate_count;
+
+                    for (uint32_t i = group.candidate_start; i < group.candidate_start + group.candidate_count; i++)
+                    {
+                        // the instance buffer is read as row-major, see Renderable::SetInstances()
+                        Entity* entity = renderables[candidates[i].renderable_index].get();
+                        instances.emplace_back(entity->GetMatrix().Transposed());
+                        entity->GetComponentRaw<Renderable>()->SetFlag(RenderableFlags::DrawnBatched, true);
+                    }
+
+                    Profiler::m_batched_draws += group.candidate_count;
+                }
+
+                if (batches.empty())
+                {
+                    instances.clear();
+                }
+
+                Profiler::m_batches = static_cast<uint32_t>(batches.size());
+            }
+
+            // draws every batch with the instancing variant of the given pipeline, the caller sets the material dependent pass constants
+            void draw(RHI_CommandList* cmd_list, RHI_PipelineState& pso, Pcb_Pass& pcb_pass, const Renderer_Shader shader_v, RHI_Shader* shader_h, RHI_Shader* shader_d, const bool is_wireframe, const function<void(Pcb_Pass& pcb_pass, Material* material)>& set_pass_constants)
+            {
+                if (batches.empty())
+                    return;
+
+                RHI_Buffer* buffer_instances = Renderer::GetBuffer(Renderer_Buffer::InstancesBatched).get();
+                bool set_pipeline            = true;
+                pso.instancing               = true;
+
+                for (const Batch& batch : batches)
+                {
+                    Renderable* renderable = batch.entity->GetComponentRaw<Renderable>();
+                    Material* material     = renderable->GetMaterial();
+
+                    // vertex layout, the members of a batch share a vertex buffer so it's the same for all of them
+                    RHI_Shader* shader_vertex = get_vertex_shader(shader_v, renderable->GetVertexType());
+                    if (!shader_vertex)
+                        continue;
+
+                    if (pso.shaders[RHI_Shader_Type::Vertex] != shader_vertex)
+                    {
+                        pso.shaders[RHI_Shader_Type::Vertex] = shader_vertex;
+                        set_pipeline                         = true;
+                    }
+
+                    // culling & tessellation
+                    {
+                        RHI_CullMode cull_mode = static_cast<RHI_CullMode>(material->GetProperty(MaterialProperty::CullMode));
+                        cull_mode              = is_wireframe ? RHI_CullMode::None : cull_mode;
+                        cmd_list->SetCullMode(cull_mode);
+
+                        bool is_tessellated = material->IsTessellated();
+                        if ((is_tessellated && !pso.shaders[RHI_Shader_Type::Hull]) || (!is_tessellated && pso.shaders[RHI_Shader_Type::Hull]))
+                        {
+                            pso.shaders[RHI_Shader_Type::Hull]   = is_tessellated ? shader_h : nullptr;
+                            pso.shaders[RHI_Shader_Type::Domain] = is_tessellated ? shader_d : nullptr;
+                            set_pipeline                         = true;
+                        }
+
+                        if (set_pipeline)
+                        {
+                            cmd_list->SetPipelineState(pso);
+                            set_pipeline = false;
+                        }
+                    }
+
+                    cmd_list->SetBufferVertex(renderable->GetVertexBuffer());
+                    cmd_list->SetBufferVertex(buffer_instances, 1);
+                    cmd_list->SetBufferIndex(renderable->GetIndexBuffer());
+
+                    // the transforms come from the instance buffer
+                    pcb_pass.transform = Matrix::Identity;
+                    set_pass_constants(pcb_pass, material);
+                    cmd_list->PushConstants(pcb_pass);
+
+                    cmd_list->DrawIndexed(
+                        batch.index_count,
+                        batch.index_offset,
+                        renderable->GetVertexOffset(),
+                        batch.instance_start,
+                        batch.instance_count
+                    );
+
+                    cmd_list->SetIgnoreClearValues(true);
+                }
+            }
+        }
+    }
+
+    void Renderer::SetStandardResources(RHI_CommandList* cmd_list)
+    {
+        cmd_list->SetConstantBuffer(Renderer_BindingsCb::frame, GetBuffer(Renderer_Buffer::ConstantFrame));
+        cmd_list->SetBuffer(Renderer_BindingsUav::sb_materials,       GetBuffer(Renderer_Buffer::StorageMaterials));
+        cmd_list->SetBuffer(Renderer_BindingsUav::sb_lights,          GetBuffer(Renderer_Buffer::StorageLights));
+        cmd_list->SetBuffer(Renderer_BindingsUav::sb_spd,             GetBuffer(Renderer_Buffer::StorageSpd));
+        cmd_list->SetBuffer(Renderer_BindingsUav::sb_draw_objects,    GetBuffer(Renderer_Buffer::StorageDrawObjects));
+        cmd_list->SetBuffer(Renderer_BindingsUav::sb_draw_commands,   GetBuffer(Renderer_Buffer::StorageDrawCommands));
+        cmd_list->SetBuffer(Renderer_BindingsUav::sb_draw_counts,     GetBuffer(Renderer_Buffer::StorageDrawCounts));
+        cmd_list->SetBuffer(Renderer_BindingsUav::sb_draw_visibility, GetBuffer(Renderer_Buffer::StorageDrawVisibility));
+        cmd_list->SetBuffer(Renderer_BindingsUav::sb_light_clusters,  GetBuffer(Renderer_Buffer::StorageLightClusters));
+    }
+
+    void Renderer::ProduceFrame(RHI_CommandList* cmd_list_graphics, RHI_CommandList* cmd_list_compute)
+    {
+        SP_PROFILE_CPU();
+
+        // acquire render targets
+        RHI_Texture* rt_render = GetRenderTarget(Renderer_RenderTarget::frame_render).get();
+        RHI_Texture* rt_output = GetRenderTarget(Renderer_RenderTarget::frame_output).get();
+
+        Pass_VariableRateShading(cmd_list_graphics);
+        Pass_Skysphere(cmd_list_graphics);
+
+        // light integration
+        {
+            if (!light_integration_brdf_speculat_lut_completed)
+            {
+                Pass_Light_Integration_BrdfSpecularLut(cmd_list_graphics);
+                light_integration_brdf_speculat_lut_completed = true;
+            }
+
+            if (m_environment_mips_to_filter_count > 0)
+            {
+                Pass_Light_Integration_EnvironmentPrefilter(cmd_list_graphics);
+            }
+        }
+
+        if (shared_ptr<Camera> camera = GetCamera())
+        { 
+            // shadow maps
+            {
+                Pass_ShadowMaps(cmd_list_graphics, false);
+                if (mesh_index_transparent != -1)
+                {
+                    Pass_ShadowMaps(cmd_list_graphics, true);
+                }
+            }
+
+            // render resolution
+            {
+                // opaque
+                {
+                    bool is_transparent = false;
+
+                    Pass_Visibility(cmd_list_graphics);
+                    Pass_Visibility_Gpu(cmd_list_graphics);
+                    Pass_Batching(cmd_list_graphics);
+                    Pass_Depth_Prepass(cmd_list_graphics, is_transparent);
+                    Pass_GBuffer(cmd_list_graphics, is_transparent);
+                    Pass_Ssr(cmd_list_graphics);
+                    Pass_Ssao(cmd_list_graphics);
+                    Pass_Sss(cmd_list_graphics);
+                    Pass_Light(cmd_list_graphics, is_transparent);             // compute diffuse and specular buffers
+                    Pass_Light_GlobalIllumination(cmd_list_graphics);          // compute global illumination
+                    Pass_Light_Composition(cmd_list_graphics, is_transparent); // compose all light (diffuse, specular, etc.)
+                    Pass_Light_ImageBased(cmd_list_graphics, is_transparent);  // apply IBL (skysphere, ssr, global illumination etc.)
+                }
+
+                // used for refraction and to produce a reactive mask for fsr
+                cmd_list_graphics->BeginTimeblock("frame_opaque");
+                {
+                    RHI_Texture* tex_render_opaque = GetRenderTarget(Renderer_RenderTarget::frame_render_opaque).get();
+                    cmd_list_graphics->Blit(rt_render, tex_render_opaque, false);
+                    // generate mips to simulate roughness
+                    Pass_Downsample(cmd_list_graphics, tex_render_opaque, Renderer_DownsampleFilter::Average);
+                }
+                cmd_list_graphics->EndTimeblock();
+                
+                // transparent
+                if (mesh_index_transparent != -1)
                 {
                     bool is_transparent = true;
 
@@ -488,150 +1346,606 @@ namespace Spartan
         pso.shaders[Compute] = shader_c;
         cmd_list->SetPipelineState(pso);
 
-        // set textures
-        cmd_list->SetTexture(Renderer_BindingsSrv::tex, tex_in);
-        cmd_list->SetTexture(Renderer_BindingsUav::tex, tex_out);
+        // set textures
+        cmd_list->SetTexture(Renderer_BindingsSrv::tex, tex_in);
+        cmd_list->SetTexture(Renderer_BindingsUav::tex, tex_out);
+
+        // render
+        cmd_list->Dispatch(tex_out);
+
+        cmd_list->EndTimeblock();
+    }
+
+    void Renderer::Pass_ShadowMaps(RHI_CommandList* cmd_list, const bool is_transparent_pass)
+    {
+        // acquire resources
+        RHI_Shader* shader_v             = GetShader(Renderer_Shader::depth_light_v).get();
+        RHI_Shader* shader_alpha_color_p = GetShader(Renderer_Shader::depth_light_alpha_color_p).get();
+        auto& lights                     = m_renderables[Renderer_Entity::Light];
+        if (!shader_v->IsCompiled() || !shader_alpha_color_p->IsCompiled())
+            return;
+
+        lock_guard lock(m_mutex_renderables);
+        cmd_list->BeginTimeblock(is_transparent_pass ? "shadow_maps_alpha_color" : "shadow_maps_depth");
+
+        vector<shared_ptr<Entity>>& renderables = m_renderables[Renderer_Entity::Mesh];
+        int64_t index_start                     = get_mesh_indices(renderables, is_transparent_pass, true);
+        int64_t index_end                       = get_mesh_indices(renderables, is_transparent_pass, false);
+
+        // gather the casters of every light slice in parallel, before any recording
+        shadow_casters::build(lights, renderables, index_start, index_end, is_transparent_pass);
+
+        // opaque casters are cached, static ones are rendered once into a static copy and dynamic ones on top of it every frame
+        if (!is_transparent_pass)
+        {
+            shadow_cache::classify(renderables, index_start, index_end);
+            shadow_cache::prune_lights(lights);
+        }
+
+        // set pso
+        static RHI_PipelineState pso;
+        pso.shaders[RHI_Shader_Type::Vertex] = shader_v;
+        pso.blend_state                      = is_transparent_pass ? GetBlendState(Renderer_BlendState::Alpha).get() : GetBlendState(Renderer_BlendState::Off).get();
+        pso.depth_stencil_state              = is_transparent_pass ? GetDepthStencilState(Renderer_DepthStencilState::Read).get() : GetDepthStencilState(Renderer_DepthStencilState::ReadWrite).get();
+        pso.name                             = is_transparent_pass ? "shadow_maps_alpha_color" : "shadow_maps_depth";
+
+        Camera* camera = GetCamera().get();
+
+        enum class Casters { All, Static, Dynamic };
+        auto draw_casters = [&](Light* light, const uint32_t light_index, const uint32_t array_index, const Casters casters)
+        {
+            const vector<uint32_t>& list = shadow_casters::lists[light_index][array_index];
+            atomic<uint32_t> draw_count  = 0;
+
+            // static slices are recorded even without casters, the render pass they begin is what clears them
+            if (list.empty() && casters != Casters::Static)
+                return 0u;
+
+            // each job toggles its own copy of the pipeline state and writes its own pass constants
+            parallel_recording::record(cmd_list, pso, static_cast<uint32_t>(list.size()), [&](RHI_CommandList* cmd_list_job, const uint32_t start, const uint32_t end)
+            {
+                RHI_PipelineState pso_job = pso;
+                Pcb_Pass pcb_pass         = m_pcb_pass_cpu;
+                uint32_t draw_count_job   = 0;
+
+                for (uint32_t list_index = start; list_index < end; list_index++)
+                {
+                    const uint32_t i = list[list_index];
+
+                    // this can happen during async loading
+                    if (i >= static_cast<uint32_t>(renderables.size()))
+                        continue;
+
+                    if (casters != Casters::All && (shadow_cache::is_dynamic[i - index_start] != 0) != (casters == Casters::Dynamic))
+                        continue;
+
+                    shared_ptr<Entity>& entity = renderables[i];
+                    Renderable* renderable     = entity->GetComponentRaw<Renderable>();
+                    if (!renderable)
+                        continue;
+
+                    RHI_Shader* shader_vertex = get_vertex_shader(Renderer_Shader::depth_light_v, renderable->GetVertexType());
+                    if (!shader_vertex)
+                        continue;
+
+                    cmd_list_job->SetCullMode(static_cast<RHI_CullMode>(renderable->GetMaterial()->GetProperty(MaterialProperty::CullMode)));
+
+                    // set pipeline
+                    {
+                        pso_job.shaders[RHI_Shader_Type::Vertex] = shader_vertex;
+
+                        bool needs_pixel_shader                 = renderable->GetMaterial()->IsAlphaTested() || is_transparent_pass;
+                        pso_job.shaders[RHI_Shader_Type::Pixel] = needs_pixel_shader ? shader_alpha_color_p : nullptr;
+
+                        pso_job.instancing = renderable->HasInstancing();
+
+                        cmd_list_job->SetPipelineState(pso_job);
+                    }
+
+                    // set vertex, index and instance buffers
+                    {
+                        cmd_list_job->SetBufferVertex(renderable->GetVertexBuffer());
+                        if (pso_job.instancing)
+                        {
+                            cmd_list_job->SetBufferVertex(renderable->GetInstanceBuffer(), 1);
+                        }
+
+                        cmd_list_job->SetBufferIndex(renderable->GetIndexBuffer());
+                    }
+
+                    // set pass constants
+                    {
+                        // for the vertex shader
+                        pcb_pass.set_f3_value2(static_cast<float>(light->GetIndex()), static_cast<float>(array_index), 0.0f);
+                        pcb_pass.transform = entity->GetMatrix();
+
+                        // for the pixel shader
+                        if (Material* material = renderable->GetMaterial())
+                        {
+                            pcb_pass.set_f3_value(
+                                material->HasTexture(MaterialTexture::AlphaMask) ? 1.0f : 0.0f,
+                                material->HasTexture(MaterialTexture::Color)     ? 1.0f : 0.0f
+                            );
+
+                            pcb_pass.set_is_transparent_and_material_index(is_transparent_pass, material->GetIndex());
+                        }
+
+                        cmd_list_job->PushConstants(pcb_pass);
+                    }
+
+                    draw_renderable(cmd_list_job, pso_job, camera, renderable, light, array_index, casters == Casters::Static);
+                    draw_count_job++;
+                }
+
+                draw_count += draw_count_job;
+            });
+
+            return draw_count.load();
+        };
+
+        // iterate over lights
+        for (uint32_t light_index = 0; light_index < static_cast<uint32_t>(lights.size()); light_index++)
+        {
+            // lights that don't cast shadows (or transparent shadows in a transparent pass) have been filtered out
+            Light* light = shadow_casters::lights_casting[light_index];
+            if (!light)
+                continue;
+
+            shared_ptr<Entity>& light_entity = lights[light_index];
+
+            RHI_Texture* tex_depth        = light->GetDepthTexture();
+            RHI_Texture* tex_color        = light->GetColorTexture();
+            RHI_Texture* tex_depth_static = light->GetDepthTextureStatic();
+            RHI_Texture* tex_color_static = light->GetColorTextureStatic();
+
+            // set light pso
+            {
+                if (light->GetLightType() == LightType::Directional)
+                {
+                    // disable depth clipping so that we can capture silhouettes even behind the light
+                    pso.rasterizer_state = GetRasterizerState(Renderer_RasterizerState::Light_directional).get();
+                }
+                else
+                {
+                    pso.rasterizer_state = GetRasterizerState(Renderer_RasterizerState::Light_point_spot).get();
+                }
+            }
+
+            if (is_transparent_pass)
+            {
+                pso.render_target_color_textures[0] = tex_color;
+                pso.render_target_depth_texture     = tex_depth;
+                pso.clear_depth                     = 0.0f;
+                pso.clear_color[0]                  = Color::standard_white;
+
+                // iterate over light cascade/faces
+                // transparent casters blend on top of the live color, so it has to be restored from the static copy next frame
+                bool drew_transparent = false;
+                for (uint32_t array_index = 0; array_index < tex_depth->GetArrayLength(); array_index++)
+                {
+                    pso.render_target_array_index = array_index;
+                    cmd_list->SetIgnoreClearValues(true);
+                    if (draw_casters(light, light_index, array_index, Casters::All) > 0)
+                    {
+                        drew_transparent = true;
+                    }
+                }
+
+                auto it = shadow_cache::lights.find(light_entity->GetObjectId());
+                if (drew_transparent && it != shadow_cache::lights.end())
+                {
+                    it->second.depth_matches_static = false;
+                }
+
+                continue;
+            }
+
+            // the cache is lost whenever the shadow map is re-created (resolution change, light type change etc.)
+            shadow_cache::Slices& cache = shadow_cache::lights[light_entity->GetObjectId()];
+            if (cache.texture_id != tex_depth_static->GetObjectId())
+            {
+                cache            = shadow_cache::Slices();
+                cache.texture_id = tex_depth_static->GetObjectId();
+            }
+
+            // re-render the static casters of the slices whose matrices or static casters changed
+            bool static_updated = false;
+            for (uint32_t array_index = 0; array_index < tex_depth_static->GetArrayLength(); array_index++)
+            {
+                Matrix view_projection = light->GetViewMatrix(array_index) * light->GetProjectionMatrix(array_index);
+                bool is_valid          = cache.valid[array_index] &&
+                                         cache.view_projection[array_index] == view_projection &&
+                                         cache.static_hash[array_index] == shadow_cache::static_hash &&
+                                         cache.range[array_index] == light->GetRange();
+                if (is_valid)
+                {
+                    Profiler::RecordShadowSlice(light_entity->GetObjectId(), light_entity->GetObjectName(), array_index, false);
+                    continue;
+                }
+
+                pso.render_target_color_textures[0] = tex_color_static;
+                pso.render_target_depth_texture     = tex_depth_static;
+                pso.render_target_array_index       = array_index;
+                pso.clear_depth                     = 0.0f;
+                pso.clear_color[0]                  = Color::standard_white;
+
+                // the render pass begins up front, so the slice is cleared even if no static caster lands in it
+                pso.shaders[RHI_Shader_Type::Pixel] = nullptr;
+                pso.instancing                      = false;
+                cmd_list->SetIgnoreClearValues(false);
+                draw_casters(light, light_index, array_index, Casters::Static);
+
+                cache.view_projection[array_index] = view_projection;
+                cache.static_hash[array_index]     = shadow_cache::static_hash;
+                cache.range[array_index]           = light->GetRange();
+                cache.valid[array_index]           = true;
+                static_updated                     = true;
+                Profiler::RecordShadowSlice(light_entity->GetObjectId(), light_entity->GetObjectName(), array_index, true);
+            }
+
+            // restore the static shadow map, unless it's still intact from last frame
+            if (static_updated || !cache.depth_matches_static)
+            {
+                cmd_list->Copy(tex_depth_static, tex_depth, false);
+                if (tex_color)
+                {
+                    cmd_list->Copy(tex_color_static, tex_color, false);
+                }
+                cache.depth_matches_static = true;
+            }
+
+            // dynamic casters on top
+            pso.render_target_color_textures[0] = tex_color;
+            pso.render_target_depth_texture     = tex_depth;
+            pso.clear_depth                     = rhi_depth_load;
+            pso.clear_color[0]                  = rhi_color_load;
+            for (uint32_t array_index = 0; array_index < tex_depth->GetArrayLength(); array_index++)
+            {
+                pso.render_target_array_index = array_index;
+                cmd_list->SetIgnoreClearValues(false);
+                if (draw_casters(light, light_index, array_index, Casters::Dynamic) > 0)
+                {
+                    cache.depth_matches_static = false;
+                }
+            }
+        }
+
+        cmd_list->EndTimeblock();
+    }
+
+    void Renderer::Pass_Visibility(RHI_CommandList* cmd_list)
+    {
+        // cpu pass
+        // forest time: 0.05 ms
+
+        cmd_list->BeginTimeblock("visibility", false, false);
+
+        visibility::frustum_cull_and_sort(m_renderables[Renderer_Entity::Mesh]);
+        visibility::select_lods(m_renderables[Renderer_Entity::Mesh]);
+        visibility::cull_meshlets(m_renderables[Renderer_Entity::Mesh]);
+
+        cmd_list->EndTimeblock();
+    }
+
+    void Renderer::Pass_Visibility_Gpu(RHI_CommandList* cmd_list)
+    {
+        RHI_Shader* shader_c          = GetShader(Renderer_Shader::indirect_cull_c).get();
+        RHI_Buffer* buffer_objects    = GetBuffer(Renderer_Buffer::StorageDrawObjects).get();
+        RHI_Buffer* buffer_commands   = GetBuffer(Renderer_Buffer::StorageDrawCommands).get();
+        RHI_Buffer* buffer_counts     = GetBuffer(Renderer_Buffer::StorageDrawCounts).get();
+        RHI_Buffer* buffer_visibility = GetBuffer(Renderer_Buffer::StorageDrawVisibility).get();
+
+        lock_guard lock(m_mutex_renderables);
+        vector<shared_ptr<Entity>>& renderables = m_renderables[Renderer_Entity::Mesh];
+
+        for (shared_ptr<Entity>& entity : renderables)
+        {
+            if (Renderable* renderable = entity->GetComponentRaw<Renderable>())
+            {
+                renderable->SetFlag(RenderableFlags::DrawnIndirect, false);
+            }
+        }
+
+        gpu_driven::active = GetOption<bool>(Renderer_Option::GpuDrivenRendering) &&
+                             RHI_Device::PropertyIsDrawIndirectCountSupported() &&
+                             shader_c->IsCompiled() &&
+                             GetShader(Renderer_Shader::depth_prepass_indirect_v)->IsCompiled() &&
+                             GetShader(Renderer_Shader::gbuffer_indirect_v)->IsCompiled() &&
+                             GetShader(Renderer_Shader::gbuffer_indirect_p)->IsCompiled();
+
+        // occlusion culling splits the culling in two phases, with the hierarchical depth built in between them (see Pass_Depth_Prepass())
+        const bool was_two_phase = gpu_driven::is_two_phase;
+        gpu_driven::is_two_phase = gpu_driven::active &&
+                                   GetOption<bool>(Renderer_Option::OcclusionCulling) &&
+                                   GetShader(Renderer_Shader::ffx_spd_min_c)->IsCompiled();
+
+        // compare the counts of a frame which has finished executing, its slot is about to be overwritten
+        {
+            uint32_t slot = m_resource_index;
+            if (gpu_driven::visible_count_history_valid[slot])
+            {
+                const uint32_t* counts        = reinterpret_cast<const uint32_t*>(reinterpret_cast<uint8_t*>(buffer_counts->GetMappedData()) + slot * buffer_counts->GetStride());
+                gpu_driven::visible_count_gpu = IndirectDraws::GetVisibleCount(counts, renderer_max_draw_buckets * renderer_culling_phase_count);
+                gpu_driven::visible_count_cpu = gpu_driven::visible_count_cpu_history[slot];
+
+                // the cpu runs the same tests, so any difference is a bug in one of them, this is what a headless run checks for
+                if (gpu_driven::visible_count_gpu != gpu_driven::visible_count_cpu && !gpu_driven::visible_count_mismatch_logged)
+                {
+                    SP_LOG_WARNING("GPU culling found %u visible objects while the CPU found %u", gpu_driven::visible_count_gpu, gpu_driven::visible_count_cpu);
+                    gpu_driven::visible_count_mismatch_logged = true;
+                }
+            }
+        }
+
+        // the buffers are updated every frame, even when inactive, so that their slots stay in sync with the resource index
+        gpu_driven::buckets.clear();
+        gpu_driven::draw_objects.clear();
+        uint32_t visible_count_cpu = 0;
+
+        // last frame's occlusion results only exist if its late phase ran
+        gpu_driven::visibility_ranges_previous.clear();
+        if (was_two_phase)
+        {
+            swap(gpu_driven::visibility_ranges, gpu_driven::visibility_ranges_previous);
+        }
+        gpu_driven::visibility_ranges.clear();
+        if (gpu_driven::is_two_phase)
+        {
+            gpu_driven::visibility_region ^= 1;
+        }
+
+        if (gpu_driven::active)
+        {
+            // assign buckets and count the objects in each of them
+            int64_t index_end               = get_mesh_indices(renderables, false, false);
+            const bool is_occlusion_culling = GetOption<bool>(Renderer_Option::OcclusionCulling);
+            vector<uint32_t> bucket_indices(static_cast<size_t>(index_end), IndirectDraws::bucket_invalid);
+            uint32_t object_count = 0;
+            for (int64_t i = 0; i < index_end && object_count < renderer_max_draw_objects; i++)
+            {
+                Renderable* renderable = renderables[i]->GetComponentRaw<Renderable>();
+                if (!gpu_driven::is_eligible(renderable))
+                    continue;
+
+                // what the software occlusion culling already hid doesn't need to reach the gpu
+                if (is_occlusion_culling && renderable->HasFlag(RenderableFlags::OccludedCpu))
+                    continue;
+
+                const uint32_t renderable_object_count = gpu_driven::get_draw_object_count(renderable);
+                if (object_count + renderable_object_count > renderer_max_draw_objects)
+                    continue;
+
+                uint32_t bucket_index = gpu_driven::get_bucket_index(renderable);
+                if (bucket_index == IndirectDraws::bucket_invalid)
+                    continue;
+
+                bucket_indices[i] = bucket_index;
+                gpu_driven::buckets[bucket_index].object_count += renderable_object_count;
+                object_count                                   += renderable_object_count;
+            }
+
+            // each bucket gets a contiguous range of commands
+            IndirectDraws::AssignCommandOffsets(gpu_driven::buckets);
+
+            const Frustum& frustum        = GetCamera()->GetFrustum();
+            const Vector3 camera_position = GetCamera()->GetEntity()->GetPosition();
+            const bool is_wireframe       = GetOption<bool>(Renderer_Option::Wireframe);
+
+            gpu_driven::draw_objects.reserve(object_count);
+            for (int64_t i = 0; i < index_end; i++)
+            {
+                if (bucket_indices[i] == IndirectDraws::bucket_invalid)
+                    continue;
+
+                Entity* entity         = renderables[i].get();
+                Renderable* renderable = entity->GetComponentRaw<Renderable>();
+                const BoundingBox& box = renderable->GetBoundingBox(BoundingBoxType::Transformed);
+
+                Sb_DrawObject draw_object      = {};
+                draw_object.transform          = entity->GetMatrix();
+                draw_object.transform_previous = entity->GetMatrixPrevious();
+                draw_object.box_center         = box.GetCenter();
+                draw_object.box_extent         = box.GetExtents();
+                draw_object.index_count        = renderable->GetLodIndexCount(renderable->GetLod());
+                draw_object.index_offset       = renderable->GetLodIndexOffset(renderable->GetLod());
+                draw_object.vertex_offset      = renderable->GetVertexOffset();
+                draw_object.material_index     = renderable->GetMaterial()->GetIndex();
+                draw_object.bucket_index       = bucket_indices[i];
+                draw_object.command_offset     = gpu_driven::buckets[bucket_indices[i]].command_offset;
+                draw_object.cone_cutoff        = 1.0f;
+
+                entity->SetMatrixPrevious(draw_object.transform);
+                renderable->SetFlag(RenderableFlags::DrawnIndirect, true);
+
+                // where last frame's results for the same draw objects are, meshlets only match if the entity was split the same way
+                draw_object.visibility_index_previous = numeric_limits<uint32_t>::max();
+                if (gpu_driven::is_two_phase)
+                {
+                    const uint32_t draw_object_index       = static_cast<uint32_t>(gpu_driven::draw_objects.size());
+                    const uint32_t renderable_object_count = gpu_driven::get_draw_object_count(renderable);
+
+                    auto it = gpu_driven::visibility_ranges_previous.find(entity->GetObjectId());
+                    if (it != gpu_driven::visibility_ranges_previous.end() && it->second.count == renderable_object_count)
+                    {
+                        draw_object.visibility_index_previous = it->second.offset;
+                    }
+
+                    gpu_driven::visibility_ranges[entity->GetObjectId()] = { draw_object_index, renderable_object_count };
+                }
+
+                if (!gpu_driven::uses_meshlets(renderable))
+                {
+                    gpu_driven::draw_objects.emplace_back(draw_object);
+
+                    if (!renderable->HasFlag(RenderableFlags::OccludedCpu))
+                    {
+                        visible_count_cpu++;
+                    }
+
+                    continue;
+                }
+
+                // one draw object per meshlet, with world space bounds
+                float scale_max       = 1.0f;
+                const bool cull_cones = visibility::can_cull_meshlet_cones(renderable, draw_object.transform, is_wireframe, &scale_max);
+                visible_count_cpu    += IndirectDraws::AppendMeshlets(
+                    draw_object,
+                    renderable->GetMeshlets(),
+                    renderable->GetMeshIndexOffset(),
+                    scale_max,
+                    cull_cones,
+                    frustum,
+                    camera_position,
+                    gpu_driven::draw_objects
+                );
+            }
+        }
+
+        if (gpu_driven::draw_objects.empty())
+        {
+            gpu_driven::draw_objects.emplace_back();
+        }
 
-        // render
-        cmd_list->Dispatch(tex_out);
+        uint32_t object_count = gpu_driven::active ? static_cast<uint32_t>(gpu_driven::draw_objects.size()) : 0;
+        buffer_objects->Update(gpu_driven::draw_objects.data(), static_cast<uint32_t>(gpu_driven::draw_objects.size() * sizeof(Sb_DrawObject)));
+        buffer_counts->Update(gpu_driven::counts_zero.data());
 
-        cmd_list->EndTimeblock();
-    }
+        uint32_t slot = buffer_counts->GetOffset() / buffer_counts->GetStride();
+        gpu_driven::visible_count_cpu_history[slot]   = visible_count_cpu;
+        gpu_driven::visible_count_history_valid[slot] = gpu_driven::active && !gpu_driven::is_two_phase;
 
-    void Renderer::Pass_ShadowMaps(RHI_CommandList* cmd_list, const bool is_transparent_pass)
-    {
-        // acquire resources
-        RHI_Shader* shader_v             = GetShader(Renderer_Shader::depth_light_v).get();
-        RHI_Shader* shader_alpha_color_p = GetShader(Renderer_Shader::depth_light_alpha_color_p).get();
-        auto& lights                     = m_renderables[Renderer_Entity::Light];
-        if (!shader_v->IsCompiled() || !shader_alpha_color_p->IsCompiled())
+        if (!gpu_driven::active || object_count == 0)
             return;
 
-        lock_guard lock(m_mutex_renderables);
-        cmd_list->BeginTimeblock(is_transparent_pass ? "shadow_maps_alpha_color" : "shadow_maps_depth");
+        cmd_list->BeginTimeblock("visibility_gpu");
 
-        // set pso
+        // the previous frame's indirect draws have to finish reading the commands before they are overwritten,
+        // and its late phase has to finish writing the visibility before it's read
+        cmd_list->InsertBarrierBufferReadWrite(buffer_commands);
+        cmd_list->InsertBarrierBufferReadWrite(buffer_visibility);
+
+        // set pipeline state
         static RHI_PipelineState pso;
-        pso.shaders[RHI_Shader_Type::Vertex] = shader_v;
-        pso.blend_state                      = is_transparent_pass ? GetBlendState(Renderer_BlendState::Alpha).get() : GetBlendState(Renderer_BlendState::Off).get();
-        pso.depth_stencil_state              = is_transparent_pass ? GetDepthStencilState(Renderer_DepthStencilState::Read).get() : GetDepthStencilState(Renderer_DepthStencilState::ReadWrite).get();
-        pso.name                             = is_transparent_pass ? "shadow_maps_alpha_color" : "shadow_maps_depth";
-        pso.clear_depth                      = 0.0f;
-        pso.clear_color[0]                   = Color::standard_white;
+        pso.shaders[Compute] = shader_c;
+        cmd_list->SetPipelineState(pso);
 
-        // iterate over lights
-        for (shared_ptr<Entity>& light_entity : lights)
+        // set pass constants
         {
-            shared_ptr<Light> light = light_entity->GetComponent<Light>();
-            if (!light || !light->IsFlagSet(LightFlags::Shadows) || light->GetIntensityWatt() == 0.0f)
-                continue;
-
-            // skip lights that don't cast transparent shadows (if this is a transparent pass)
-            if (is_transparent_pass && !light->IsFlagSet(LightFlags::ShadowsTransparent))
-                continue;
-
-            // set light pso
+            const Frustum& frustum = GetCamera()->GetFrustum();
+            for (uint32_t i = 0; i < 6; i++)
             {
-                pso.render_target_color_textures[0] = light->GetColorTexture();
-                pso.render_target_depth_texture     = light->GetDepthTexture();
-                if (light->GetLightType() == LightType::Directional)
-                {
-                    // disable depth clipping so that we can capture silhouettes even behind the light
-                    pso.rasterizer_state = GetRasterizerState(Renderer_RasterizerState::Light_directional).get();
-                }
-                else
-                {
-                    pso.rasterizer_state = GetRasterizerState(Renderer_RasterizerState::Light_point_spot).get();
-                }
+                const Plane& plane = frustum.GetPlane(i);
+                float* row         = (i < 4 ? &m_pcb_pass_cpu.transform.m00 : &m_pcb_pass_cpu.m_value.m00) + (i % 4) * 4;
+                row[0]             = plane.normal.x;
+                row[1]             = plane.normal.y;
+                row[2]             = plane.normal.z;
+                row[3]             = plane.d;
             }
+            m_pcb_pass_cpu.m_value.m20 = static_cast<float>(object_count);
+            m_pcb_pass_cpu.m_value.m21 = static_cast<float>(gpu_driven::is_two_phase ? gpu_driven::phase_early : gpu_driven::phase_single);
+            m_pcb_pass_cpu.m_value.m22 = static_cast<float>((gpu_driven::visibility_region ^ 1) * renderer_max_draw_objects);
+            m_pcb_pass_cpu.m_value.m23 = static_cast<float>(gpu_driven::visibility_region * renderer_max_draw_objects);
+            cmd_list->PushConstants(m_pcb_pass_cpu);
 
-            // iterate over light cascade/faces
-            for (uint32_t array_index = 0; array_index < pso.render_target_depth_texture->GetArrayLength(); array_index++)
-            {
-                pso.render_target_array_index = array_index;
-                cmd_list->SetIgnoreClearValues(is_transparent_pass);
+            gpu_driven::pass_constants = m_pcb_pass_cpu;
+        }
 
-                // iterate over entities
-                int64_t index_start = get_mesh_indices(m_renderables[Renderer_Entity::Mesh], is_transparent_pass, true);
-                int64_t index_end   = get_mesh_indices(m_renderables[Renderer_Entity::Mesh], is_transparent_pass, false);
-                for (int64_t i = index_start; i < index_end; i++)
-                {
-                    // this can happen during async loading
-                    if (i >= static_cast<int64_t>(m_renderables[Renderer_Entity::Mesh].size()))
-                        continue;
+        const uint32_t thread_group_count = 64; // THREAD_GROUP_COUNT in common.hlsl
+        cmd_list->Dispatch((object_count + thread_group_count - 1) / thread_group_count, 1, 1);
 
-                    shared_ptr<Entity>& entity        = m_renderables[Renderer_Entity::Mesh][i];
-                    shared_ptr<Renderable> renderable = entity->GetComponent<Renderable>();
-                    if (!renderable || !renderable->HasFlag(RenderableFlags::CastsShadows))
-                        continue;
+        // make the commands and counts visible to the indirect draws
+        cmd_list->InsertBarrierBufferReadWrite(buffer_commands);
+        cmd_list->InsertBarrierBufferReadWrite(buffer_counts);
 
-                    if (!light->IsInViewFrustum(renderable.get(), array_index))
-                        continue;
+        cmd_list->EndTimeblock();
+    }
 
-                    cmd_list->SetCullMode(static_cast<RHI_CullMode>(renderable->GetMaterial()->GetProperty(MaterialProperty::CullMode)));
+    void Renderer::Pass_Visibility_Gpu_Late(RHI_CommandList* cmd_list)
+    {
+        // called from within the depth prepass, once everything visible last frame has been drawn
+        RHI_Shader* shader_c          = GetShader(Renderer_Shader::indirect_cull_c).get();
+        RHI_Buffer* buffer_commands   = GetBuffer(Renderer_Buffer::StorageDrawCommands).get();
+        RHI_Buffer* buffer_counts     = GetBuffer(Renderer_Buffer::StorageDrawCounts).get();
+        RHI_Buffer* buffer_visibility = GetBuffer(Renderer_Buffer::StorageDrawVisibility).get();
+        RHI_Texture* tex_depth        = GetRenderTarget(Renderer_RenderTarget::gbuffer_depth).get();
+        RHI_Texture* tex_hi_z         = GetRenderTarget(Renderer_RenderTarget::hi_z).get();
 
-                    // set pipeline
-                    {
-                        bool needs_pixel_shader             = renderable->GetMaterial()->IsAlphaTested() || is_transparent_pass;
-                        pso.shaders[RHI_Shader_Type::Pixel] = needs_pixel_shader ? shader_alpha_color_p : nullptr;
+        cmd_list->BeginMarker("visibility_gpu_late");
 
-                        pso.instancing = renderable->HasInstancing();
+        // the hierarchical depth, every texel holds the farthest depth of its footprint
+        Pass_Downsample(cmd_list, tex_depth, Renderer_DownsampleFilter::Min, tex_hi_z);
 
-                        cmd_list->SetPipelineState(pso);
-                    }
+        // set pipeline state
+        static RHI_PipelineState pso;
+        pso.shaders[Compute] = shader_c;
+        cmd_list->SetPipelineState(pso);
 
-                    // set vertex, index and instance buffers
-                    {
-                        cmd_list->SetBufferVertex(renderable->GetVertexBuffer());
-                        if (pso.instancing)
-                        {
-                            cmd_list->SetBufferVertex(renderable->GetInstanceBuffer(), 1);
-                        }
+        // set pass constants, the same as the early phase's, plus the hierarchical depth
+        Pcb_Pass& pass_constants   = gpu_driven::pass_constants;
+        pass_constants.m_value.m21 = static_cast<float>(gpu_driven::phase_late);
+        pass_constants.m_value.m30 = static_cast<float>(tex_hi_z->GetWidth());
+        pass_constants.m_value.m31 = static_cast<float>(tex_hi_z->GetHeight());
+        pass_constants.m_value.m32 = static_cast<float>(tex_hi_z->GetMipCount());
+        cmd_list->PushConstants(pass_constants);
 
-                        cmd_list->SetBufferIndex(renderable->GetIndexBuffer());
-                    }
+        cmd_list->SetTexture(Renderer_BindingsSrv::tex, tex_hi_z);
 
-                    // set pass constants
-                    {
-                        // for the vertex shader
-                        m_pcb_pass_cpu.set_f3_value2(static_cast<float>(light->GetIndex()), static_cast<float>(array_index), 0.0f);
-                        m_pcb_pass_cpu.transform = entity->GetMatrix();
+        const uint32_t object_count       = static_cast<uint32_t>(pass_constants.m_value.m20);
+        const uint32_t thread_group_count = 64; // THREAD_GROUP_COUNT in common.hlsl
+        cmd_list->Dispatch((object_count + thread_group_count - 1) / thread_group_count, 1, 1);
 
-                        // for the pixel shader
-                        if (Material* material = renderable->GetMaterial())
-                        {
-                            m_pcb_pass_cpu.set_f3_value(
-                                material->HasTexture(MaterialTexture::AlphaMask) ? 1.0f : 0.0f,
-                                material->HasTexture(MaterialTexture::Color)     ? 1.0f : 0.0f
-                            );
+        // make the commands and counts visible to the indirect draws, and the visibility to the next frame's early phase
+        cmd_list->InsertBarrierBufferReadWrite(buffer_commands);
+        cmd_list->InsertBarrierBufferReadWrite(buffer_counts);
+        cmd_list->InsertBarrierBufferReadWrite(buffer_visibility);
 
-                            m_pcb_pass_cpu.set_is_transparent_and_material_index(is_transparent_pass, material->GetIndex());
-                        }
+        cmd_list->EndMarker();
+    }
 
-                        cmd_list->PushConstants(m_pcb_pass_cpu);
-                    }
+    void Renderer::GetGpuDrivenVisibleCounts(uint32_t* count_gpu, uint32_t* count_cpu)
+    {
+        *count_gpu = gpu_driven::visible_count_gpu;
+        *count_cpu = gpu_driven::visible_count_cpu;
+    }
 
-                    draw_renderable(cmd_list, pso, GetCamera().get(), renderable.get(), light.get(), array_index);
-                }
+    void Renderer::Pass_Batching(RHI_CommandList* cmd_list)
+    {
+        // cpu pass, folds repeated static renderables into instanced draws
+
+        RHI_Buffer* buffer_instances = GetBuffer(Renderer_Buffer::InstancesBatched).get();
+
+        lock_guard lock(m_mutex_renderables);
+        vector<shared_ptr<Entity>>& renderables = m_renderables[Renderer_Entity::Mesh];
+
+        for (shared_ptr<Entity>& entity : renderables)
+        {
+            if (Renderable* renderable = entity->GetComponentRaw<Renderable>())
+            {
+                renderable->SetFlag(RenderableFlags::DrawnBatched, false);
             }
         }
 
-        cmd_list->EndTimeblock();
-    }
+        dynamic_instancing::batches.clear();
+        dynamic_instancing::instances.clear();
 
-    void Renderer::Pass_Visibility(RHI_CommandList* cmd_list)
-    {
-        // cpu pass
-        // forest time: 0.05 ms
+        if (!GetOption<bool>(Renderer_Option::DynamicInstancing))
+            return;
 
-        cmd_list->BeginTimeblock("visibility", false, false);
+        cmd_list->BeginTimeblock("batching", false, false);
 
-        visibility::clear();
-        visibility::frustum_cull_and_sort(m_renderables[Renderer_Entity::Mesh]);
+        // transparent renderables are left out, they have to be drawn back-to-front
+        dynamic_instancing::build(renderables, get_mesh_indices(renderables, false, false));
 
-        if (GetOption<bool>(Renderer_Option::OcclusionCulling))
+        if (!dynamic_instancing::instances.empty())
         {
-            visibility::determine_occluders(m_renderables[Renderer_Entity::Mesh]);
+            buffer_instances->Update(dynamic_instancing::instances.data(), static_cast<uint32_t>(dynamic_instancing::instances.size() * sizeof(Matrix)));
+
+            // the batches index into this frame's slice of the buffer
+            uint32_t instance_offset = buffer_instances->GetOffset() / static_cast<uint32_t>(sizeof(Matrix));
+            for (dynamic_instancing::Batch& batch : dynamic_instancing::batches)
+            {
+                batch.instance_start += instance_offset;
+            }
         }
 
         cmd_list->EndTimeblock();
@@ -653,22 +1967,41 @@ namespace Spartan
 
         auto pass = [cmd_list, shader_h, shader_d, shader_p](RHI_PipelineState& pso, bool is_transparent_pass, bool is_back_face_pass)
         {
-            bool set_pipeline   = true;
-            int64_t index_start = get_mesh_indices(m_renderables[Renderer_Entity::Mesh], is_transparent_pass, true);
-            int64_t index_end   = get_mesh_indices(m_renderables[Renderer_Entity::Mesh], is_transparent_pass, false);
-            for (int64_t i = index_start; i < index_end; i++)
+            bool set_pipeline      = true;
+            int64_t index_start    = get_mesh_indices(m_renderables[Renderer_Entity::Mesh], is_transparent_pass, true);
+            int64_t index_end      = get_mesh_indices(m_renderables[Renderer_Entity::Mesh], is_transparent_pass, false);
+            uint32_t visible_start = 0;
+            uint32_t visible_end   = 0;
+            visibility::get_visible_range(index_start, index_end, &visible_start, &visible_end);
+            for (uint32_t visible_index = visible_start; visible_index < visible_end; visible_index++)
             {
                 // this can happen during async loading
-                if (i >= static_cast<int64_t>(m_renderables[Renderer_Entity::Mesh].size()))
+                const uint32_t i = visibility::visible_indices[visible_index];
+                if (i >= static_cast<uint32_t>(m_renderables[Renderer_Entity::Mesh].size()))
                     continue;
 
                 shared_ptr<Entity>& entity        = m_renderables[Renderer_Entity::Mesh][i];
-                shared_ptr<Renderable> renderable = entity->GetComponent<Renderable>();
+                Renderable* renderable = entity->GetComponentRaw<Renderable>();
                 if (!renderable || renderable->HasFlag(RenderableFlags::OccludedCpu))
                     continue;
 
+                // drawn by the gpu driven path or a batch, the back face pass still needs it for subsurface scattering
+                if (!is_back_face_pass && (renderable->HasFlag(RenderableFlags::DrawnIndirect) || renderable->HasFlag(RenderableFlags::DrawnBatched)))
+                    continue;
+
                 // toggles
                 {
+                    // vertex layout
+                    RHI_Shader* shader_vertex = get_vertex_shader(Renderer_Shader::depth_prepass_v, renderable->GetVertexType());
+                    if (!shader_vertex)
+                        continue;
+
+                    if (pso.shaders[RHI_Shader_Type::Vertex] != shader_vertex)
+                    {
+                        pso.shaders[RHI_Shader_Type::Vertex] = shader_vertex;
+                        set_pipeline                         = true;
+                    }
+
                     // instancing
                     if (pso.instancing != renderable->HasInstancing())
                     {
@@ -733,17 +2066,7 @@ namespace Spartan
                     cmd_list->PushConstants(m_pcb_pass_cpu);
                 }
 
-                if (GetOption<bool>(Renderer_Option::OcclusionCulling) && !is_transparent_pass)
-                {
-                    cmd_list->BeginOcclusionQuery(entity->GetObjectId());
-                }
-
-                draw_renderable(cmd_list, pso, GetCamera().get(), renderable.get());
-
-                if (GetOption<bool>(Renderer_Option::OcclusionCulling) && !is_transparent_pass)
-                {
-                    cmd_list->EndOcclusionQuery();
-                }
+                draw_renderable(cmd_list, pso, GetCamera().get(), renderable);
             }
         };
 
@@ -770,8 +2093,54 @@ namespace Spartan
         if (!is_transparent_pass) // opaque
         {
             cmd_list->SetIgnoreClearValues(false);
+
+            RHI_PipelineState pso_indirect                 = pso;
+            pso_indirect.name                              = "depth_prepass_indirect";
+            pso_indirect.shaders[RHI_Shader_Type::Vertex] = GetShader(Renderer_Shader::depth_prepass_indirect_v).get();
+            pso_indirect.shaders[RHI_Shader_Type::Pixel]  = nullptr;
+            pso_indirect.shaders[RHI_Shader_Type::Hull]   = nullptr;
+            pso_indirect.shaders[RHI_Shader_Type::Domain] = nullptr;
+            pso_indirect.instancing                        = false;
+
+            if (gpu_driven::active)
+            {
+                cmd_list->SetPipelineState(pso_indirect);
+
+                m_pcb_pass_cpu.set_is_transparent_and_material_index(false);
+                cmd_list->PushConstants(m_pcb_pass_cpu);
+
+                gpu_driven::draw(cmd_list, is_wireframe, 0);
+                cmd_list->SetIgnoreClearValues(true);
+            }
+
+            // batches draw the same way as their members would, without alpha testing
+            {
+                RHI_PipelineState pso_batched                = pso;
+                pso_batched.shaders[RHI_Shader_Type::Pixel] = nullptr;
+                Pcb_Pass pcb_pass                            = m_pcb_pass_cpu;
+
+                dynamic_instancing::draw(cmd_list, pso_batched, pcb_pass, Renderer_Shader::depth_prepass_v, shader_h, shader_d, is_wireframe, [](Pcb_Pass& pcb_pass, Material* material)
+                {
+                    pcb_pass.set_is_transparent_and_material_index(false, material->GetIndex());
+                });
+            }
+
             pass(pso, false, false);
-            visibility::get_gpu_occlusion_query_results(cmd_list, m_renderables);
+
+            // occlusion culling, what was drawn so far is the occluder set, of the rest, whatever it doesn't hide gets drawn now
+            if (gpu_driven::is_two_phase)
+            {
+                Pass_Visibility_Gpu_Late(cmd_list);
+
+                cmd_list->SetIgnoreClearValues(true);
+                cmd_list->SetPipelineState(pso_indirect);
+
+                m_pcb_pass_cpu.set_is_transparent_and_material_index(false);
+                cmd_list->PushConstants(m_pcb_pass_cpu);
+
+                gpu_driven::draw(cmd_list, is_wireframe, 1);
+            }
+
             cmd_list->Blit(tex_depth, tex_depth_opaque, false);
         }
         else // transparent
@@ -839,78 +2208,141 @@ namespace Spartan
         pso.clear_color[2]                    = !is_transparent_pass ? Color::standard_transparent : rhi_color_load;
         pso.clear_color[3]                    = !is_transparent_pass ? Color::standard_transparent : rhi_color_load;
         cmd_list->SetIgnoreClearValues(false);
-        cmd_list->SetPipelineState(pso);
 
         lock_guard lock(m_mutex_renderables);
-        int64_t index_start = get_mesh_indices(m_renderables[Renderer_Entity::Mesh], is_transparent_pass, true);
-        int64_t index_end   = get_mesh_indices(m_renderables[Renderer_Entity::Mesh], is_transparent_pass, false);
-        for (int64_t i = index_start; i < index_end; i++)
+
+        if (!is_transparent_pass && gpu_driven::active)
         {
-            // this can happen during async loading
-            if (i >= static_cast<int64_t>(m_renderables[Renderer_Entity::Mesh].size()))
-                continue;
+            RHI_PipelineState pso_indirect                 = pso;
+            pso_indirect.name                              = "g_buffer_indirect";
+            pso_indirect.shaders[RHI_Shader_Type::Vertex] = GetShader(Renderer_Shader::gbuffer_indirect_v).get();
+            pso_indirect.shaders[RHI_Shader_Type::Pixel]  = GetShader(Renderer_Shader::gbuffer_indirect_p).get();
+            pso_indirect.shaders[RHI_Shader_Type::Hull]   = nullptr;
+            pso_indirect.shaders[RHI_Shader_Type::Domain] = nullptr;
+            pso_indirect.instancing                        = false;
+            cmd_list->SetPipelineState(pso_indirect);
+
+            m_pcb_pass_cpu.set_is_transparent_and_material_index(false);
+            cmd_list->PushConstants(m_pcb_pass_cpu);
 
-            shared_ptr<Entity>& entity        = m_renderables[Renderer_Entity::Mesh][i];
-            shared_ptr<Renderable> renderable = entity->GetComponent<Renderable>();
-            if (!renderable || !renderable->IsVisible())
-                continue;
+            // both culling phases
+            gpu_driven::draw(cmd_list, is_wireframe, 0);
+            if (gpu_driven::is_two_phase)
+            {
+                gpu_driven::draw(cmd_list, is_wireframe, 1);
+            }
+            cmd_list->SetIgnoreClearValues(true);
+        }
+
+        if (!is_transparent_pass)
+        {
+            RHI_PipelineState pso_batched = pso;
+            Pcb_Pass pcb_pass             = m_pcb_pass_cpu;
 
-            // toggles
+            // the batched renderables didn't move, so the previous transform is the instance transform as well
+            dynamic_instancing::draw(cmd_list, pso_batched, pcb_pass, Renderer_Shader::gbuffer_v, shader_h, shader_d, is_wireframe, [](Pcb_Pass& pcb_pass, Material* material)
             {
-                bool toggled = false;
+                pcb_pass.set_transform_previous(Matrix::Identity);
+                pcb_pass.set_is_transparent_and_material_index(false, material->GetIndex());
+            });
+        }
 
-                // instancing
-                if (pso.instancing != renderable->HasInstancing())
-                {
-                    pso.instancing = renderable->HasInstancing();
-                    toggled        = true;
-                }
+        vector<shared_ptr<Entity>>& renderables = m_renderables[Renderer_Entity::Mesh];
+        int64_t index_start                     = get_mesh_indices(renderables, is_transparent_pass, true);
+        int64_t index_end                       = get_mesh_indices(renderables, is_transparent_pass, false);
+        Camera* camera                          = GetCamera().get();
+        uint32_t visible_start                  = 0;
+        uint32_t visible_end                    = 0;
+        visibility::get_visible_range(index_start, index_end, &visible_start, &visible_end);
+
+        // each job toggles its own copy of the pipeline state and writes its own pass constants,
+        // the jobs split the visible renderables, so they get an even share of the draws
+        parallel_recording::record(cmd_list, pso, visible_end - visible_start,
+            [&](RHI_CommandList* cmd_list_job, const uint32_t start, const uint32_t end)
+        {
+            RHI_PipelineState pso_job = pso;
+            Pcb_Pass pcb_pass         = m_pcb_pass_cpu;
+
+            for (uint32_t visible_index = visible_start + start; visible_index < visible_start + end; visible_index++)
+            {
+                // this can happen during async loading
+                const uint32_t i = visibility::visible_indices[visible_index];
+                if (i >= static_cast<uint32_t>(renderables.size()))
+                    continue;
+
+                shared_ptr<Entity>& entity = renderables[i];
+                Renderable* renderable     = entity->GetComponentRaw<Renderable>();
+                if (!renderable || !renderable->IsVisible() || renderable->HasFlag(RenderableFlags::DrawnIndirect) || renderable->HasFlag(RenderableFlags::DrawnBatched))
+                    continue;
 
-                // tessellation & culling
-                if (Material* material = renderable->GetMaterial())
+                // toggles
                 {
-                    RHI_CullMode cull_mode = static_cast<RHI_CullMode>(material->GetProperty(MaterialProperty::CullMode));
-                    cull_mode              = is_wireframe ? RHI_CullMode::None : cull_mode;
-                    cmd_list->SetCullMode(cull_mode);
+                    bool toggled = false;
 
-                    bool is_tessellated = material->IsTessellated();
-                    if ((is_tessellated && !pso.shaders[RHI_Shader_Type::Hull]) || (!is_tessellated && pso.shaders[RHI_Shader_Type::Hull]))
+                    // vertex layout
+                    RHI_Shader* shader_vertex = get_vertex_shader(Renderer_Shader::gbuffer_v, renderable->GetVertexType());
+                    if (!shader_vertex)
+                        continue;
+
+                    if (pso_job.shaders[RHI_Shader_Type::Vertex] != shader_vertex)
                     {
-                        pso.shaders[RHI_Shader_Type::Hull]   = is_tessellated ? shader_h : nullptr;
-                        pso.shaders[RHI_Shader_Type::Domain] = is_tessellated ? shader_d : nullptr;
-                        toggled           = true;
+                        pso_job.shaders[RHI_Shader_Type::Vertex] = shader_vertex;
+                        toggled                                  = true;
                     }
-                }
 
-                if (toggled)
-                {
-                    cmd_list->SetPipelineState(pso);
+                    // instancing
+                    if (pso_job.instancing != renderable->HasInstancing())
+                    {
+                        pso_job.instancing = renderable->HasInstancing();
+                        toggled            = true;
+                    }
+
+                    // tessellation & culling
+                    if (Material* material = renderable->GetMaterial())
+                    {
+                        RHI_CullMode cull_mode = static_cast<RHI_CullMode>(material->GetProperty(MaterialProperty::CullMode));
+                        cull_mode              = is_wireframe ? RHI_CullMode::None : cull_mode;
+                        cmd_list_job->SetCullMode(cull_mode);
+
+                        bool is_tessellated = material->IsTessellated();
+                        if ((is_tessellated && !pso_job.shaders[RHI_Shader_Type::Hull]) || (!is_tessellated && pso_job.shaders[RHI_Shader_Type::Hull]))
+                        {
+                            pso_job.shaders[RHI_Shader_Type::Hull]   = is_tessellated ? shader_h : nullptr;
+                            pso_job.shaders[RHI_Shader_Type::Domain] = is_tessellated ? shader_d : nullptr;
+                            toggled                                  = true;
+                        }
+                    }
+
+                    if (toggled)
+                    {
+                        cmd_list_job->SetPipelineState(pso_job);
+                    }
                 }
-            }
 
-            // set vertex, index and instance buffers
-            {
-                cmd_list->SetBufferVertex(renderable->GetVertexBuffer());
-                if (pso.instancing)
+                // set vertex, index and instance buffers
                 {
-                    cmd_list->SetBufferVertex(renderable->GetInstanceBuffer(), 1);
+                    cmd_list_job->SetBufferVertex(renderable->GetVertexBuffer());
+                    if (pso_job.instancing)
+                    {
+                        cmd_list_job->SetBufferVertex(renderable->GetInstanceBuffer(), 1);
+                    }
+
+                    cmd_list_job->SetBufferIndex(renderable->GetIndexBuffer());
                 }
 
-                cmd_list->SetBufferIndex(renderable->GetIndexBuffer());
-            }
+                // set pass constants
+                {
+                    pcb_pass.transform = entity->GetMatrix();
+                    pcb_pass.set_transform_previous(entity->GetMatrixPrevious());
+                    pcb_pass.set_is_transparent_and_material_index(is_transparent_pass, renderable->GetMaterial()->GetIndex());
+                    cmd_list_job->PushConstants(pcb_pass);
 
-            // set pass constants
-            {
-                m_pcb_pass_cpu.transform = entity->GetMatrix();
-                m_pcb_pass_cpu.set_transform_previous(entity->GetMatrixPrevious());
-                m_pcb_pass_cpu.set_is_transparent_and_material_index(is_transparent_pass, renderable->GetMaterial()->GetIndex());
-                cmd_list->PushConstants(m_pcb_pass_cpu);
+                    entity->SetMatrixPrevious(pcb_pass.transform);
+                }
 
-                entity->SetMatrixPrevious(m_pcb_pass_cpu.transform);
+                draw_renderable(cmd_list_job, pso_job, camera, renderable);
             }
-
-            draw_renderable(cmd_list, pso, GetCamera().get(), renderable.get());
-        }
+        });
 
         cmd_list->EndTimeblock();
     }
@@ -1001,7 +2433,7 @@ namespace Spartan
             static float array_slice_index = 0.0f;
             for (shared_ptr<Entity> entity : entities)
             {
-                if (shared_ptr<Light> light = entity->GetComponent<Light>())
+                if (Light* light = entity->GetComponentRaw<Light>())
                 {
                     if (!light->IsFlagSet(LightFlags::ShadowsScreenSpace) || light->GetIntensityWatt() == 0.0f)
                         continue;
@@ -1067,12 +2499,12 @@ namespace Spartan
             return;
 
         // get directional light
-        shared_ptr<Light> light = nullptr;
+        Light* light = nullptr;
         {
             const vector<shared_ptr<Entity>>& entities = m_renderables[Renderer_Entity::Light];
             for (size_t i = 0; i < entities.size(); ++i)
             {
-                if (shared_ptr<Light> light_ = entities[i]->GetComponent<Light>())
+                if (Light* light_ = entities[i]->GetComponentRaw<Light>())
                 {
                     if (light_->GetLightType() == LightType::Directional)
                     {
@@ -1109,12 +2541,14 @@ namespace Spartan
     void Renderer::Pass_Light(RHI_CommandList* cmd_list, const bool is_transparent_pass)
     {
         // get resources
-        RHI_Shader* shader_c        = GetShader(Renderer_Shader::light_c).get();
-        RHI_Texture* tex_diffuse    = GetRenderTarget(Renderer_RenderTarget::light_diffuse).get();
-        RHI_Texture* tex_specular   = GetRenderTarget(Renderer_RenderTarget::light_specular).get();
-        RHI_Texture* tex_shadow     = GetRenderTarget(Renderer_RenderTarget::light_shadow).get();
-        RHI_Texture* tex_volumetric = GetRenderTarget(Renderer_RenderTarget::light_volumetric).get();
-        auto& entities              = m_renderables[Renderer_Entity::Light];
+        RHI_Shader* shader_c           = GetShader(Renderer_Shader::light_c).get();
+        RHI_Shader* shader_clustered_c = GetShader(Renderer_Shader::light_clustered_c).get();
+        RHI_Texture* tex_diffuse       = GetRenderTarget(Renderer_RenderTarget::light_diffuse).get();
+        RHI_Texture* tex_specular      = GetRenderTarget(Renderer_RenderTarget::light_specular).get();
+        RHI_Texture* tex_shadow        = GetRenderTarget(Renderer_RenderTarget::light_shadow).get();
+        RHI_Texture* tex_volumetric    = GetRenderTarget(Renderer_RenderTarget::light_volumetric).get();
+        Camera* camera                 = GetCamera().get();
+        auto& entities                 = m_renderables[Renderer_Entity::Light];
         if (!shader_c->IsCompiled())
             return;
 
@@ -1122,6 +2556,20 @@ namespace Spartan
         if (light_count == 0)
             return;
 
+        // lights which don't need anything bound per light (no shadow maps) can be shaded together, from a per cluster light list
+        const bool is_clustered =
+            GetOption<bool>(Renderer_Option::LightClustering) &&
+            shader_clustered_c->IsCompiled()                  &&
+            camera && camera->GetProjectionType() == Projection_Perspective;
+
+        auto is_light_clustered = [is_clustered](Light* light)
+        {
+            return is_clustered                                   &&
+                light->GetLightType() != LightType::Directional   &&
+                !light->IsFlagSet(LightFlags::Shadows)            &&
+                !(light->IsFlagSet(LightFlags::Volumetric) && GetOption<bool>(Renderer_Option::FogVolumetric));
+        };
+
         cmd_list->BeginTimeblock(is_transparent_pass ? "light_transparent" : "light");
 
         // clear render targets the first time around (opaque pas)
@@ -1133,49 +2581,101 @@ namespace Spartan
             cmd_list->ClearTexture(tex_volumetric, Color::standard_black);
         }
 
-        // set pipeline state
-        static RHI_PipelineState pso;
-        pso.shaders[Compute] = shader_c;
-        cmd_list->SetPipelineState(pso);
-
-        // iterate through all the lights
-        for (uint32_t light_index = 0; light_index < light_count; light_index++)
+        // clustered lights
+        uint32_t light_count_clustered = 0;
         {
-            // read from these
-            SetGbufferTextures(cmd_list);
-            cmd_list->SetTexture(Renderer_BindingsSrv::ssao, GetRenderTarget(Renderer_RenderTarget::ssao));
+            static vector<LightClusterSphere> spheres;
+            static vector<uint32_t> clusters;
+            spheres.clear();
 
-            // write to these
-            cmd_list->SetTexture(Renderer_BindingsUav::tex,  tex_diffuse);
-            cmd_list->SetTexture(Renderer_BindingsUav::tex2, tex_specular);
-            cmd_list->SetTexture(Renderer_BindingsUav::tex3, tex_shadow);
-            cmd_list->SetTexture(Renderer_BindingsUav::tex4, tex_volumetric);
+            const Matrix& view = camera ? camera->GetViewMatrix() : Matrix::Identity;
+            for (shared_ptr<Entity>& entity : entities)
+            {
+                Light* light = entity->GetComponentRaw<Light>();
+                if (light && light->GetIntensityWatt() != 0.0f && is_light_clustered(light))
+                {
+                    spheres.push_back({ entity->GetPosition() * view, light->GetRange(), light->GetIndex() });
+                }
+            }
+            light_count_clustered = static_cast<uint32_t>(spheres.size());
 
-            if (shared_ptr<Light> light = entities[light_index]->GetComponent<Light>())
+            // the lists are built once per frame, the transparent pass reuses them
+            if (!is_transparent_pass && light_count_clustered > 0)
             {
-                if (light->GetIntensityWatt() == 0.0f)
-                    continue;
+                const Matrix& projection = camera->GetProjectionMatrix();
+                LightClusters::Build(spheres, projection.m00, projection.m11, camera->GetNearPlane(), camera->GetFarPlane(), clusters);
+                GetBuffer(Renderer_Buffer::StorageLightClusters)->Update(clusters.data(), static_cast<uint32_t>(clusters.size() * sizeof(uint32_t)));
+            }
 
-                // set shadow maps
-                {
-                    RHI_Texture* tex_depth = light->IsFlagSet(LightFlags::Shadows)            ? light->GetDepthTexture() : nullptr;
-                    RHI_Texture* tex_color = light->IsFlagSet(LightFlags::ShadowsTransparent) ? light->GetColorTexture() : nullptr;
+            if (light_count_clustered > 0)
+            {
+                // set pipeline state
+                static RHI_PipelineState pso_clustered;
+                pso_clustered.shaders[Compute] = shader_clustered_c;
+                cmd_list->SetPipelineState(pso_clustered);
 
-                    cmd_list->SetTexture(Renderer_BindingsSrv::light_depth, tex_depth);
-                    cmd_list->SetTexture(Renderer_BindingsSrv::light_color, tex_color);
-                    cmd_list->SetTexture(Renderer_BindingsSrv::sss,         GetRenderTarget(Renderer_RenderTarget::sss));
-                }
+                // read from these
+                SetGbufferTextures(cmd_list);
+                cmd_list->SetTexture(Renderer_BindingsSrv::ssao, GetRenderTarget(Renderer_RenderTarget::ssao));
+
+                // write to these
+                cmd_list->SetTexture(Renderer_BindingsUav::tex,  tex_diffuse);
+                cmd_list->SetTexture(Renderer_BindingsUav::tex2, tex_specular);
 
                 // push pass constants
                 m_pcb_pass_cpu.set_is_transparent_and_material_index(is_transparent_pass);
-                m_pcb_pass_cpu.set_f3_value2(static_cast<float>(light->GetIndex()), 0.0f, 0.0f);
-                m_pcb_pass_cpu.set_f3_value(GetOption<float>(Renderer_Option::Fog), GetOption<float>(Renderer_Option::ShadowResolution), 0.0f);
                 cmd_list->PushConstants(m_pcb_pass_cpu);
-                
+
                 cmd_list->Dispatch(tex_diffuse);
             }
         }
 
+        // the rest of the lights, one dispatch each
+        if (light_count_clustered < light_count)
+        {
+            // set pipeline state
+            static RHI_PipelineState pso;
+            pso.shaders[Compute] = shader_c;
+            cmd_list->SetPipelineState(pso);
+
+            for (uint32_t light_index = 0; light_index < light_count; light_index++)
+            {
+                // read from these
+                SetGbufferTextures(cmd_list);
+                cmd_list->SetTexture(Renderer_BindingsSrv::ssao, GetRenderTarget(Renderer_RenderTarget::ssao));
+
+                // write to these
+                cmd_list->SetTexture(Renderer_BindingsUav::tex,  tex_diffuse);
+                cmd_list->SetTexture(Renderer_BindingsUav::tex2, tex_specular);
+                cmd_list->SetTexture(Renderer_BindingsUav::tex3, tex_shadow);
+                cmd_list->SetTexture(Renderer_BindingsUav::tex4, tex_volumetric);
+
+                if (Light* light = entities[light_index]->GetComponentRaw<Light>())
+                {
+                    if (light->GetIntensityWatt() == 0.0f || is_light_clustered(light))
+                        continue;
+
+                    // set shadow maps
+                    {
+                        RHI_Texture* tex_depth = light->IsFlagSet(LightFlags::Shadows)            ? light->GetDepthTexture() : nullptr;
+                        RHI_Texture* tex_color = light->IsFlagSet(LightFlags::ShadowsTransparent) ? light->GetColorTexture() : nullptr;
+
+                        cmd_list->SetTexture(Renderer_BindingsSrv::light_depth, tex_depth);
+                        cmd_list->SetTexture(Renderer_BindingsSrv::light_color, tex_color);
+                        cmd_list->SetTexture(Renderer_BindingsSrv::sss,         GetRenderTarget(Renderer_RenderTarget::sss));
+                    }
+
+                    // push pass constants
+                    m_pcb_pass_cpu.set_is_transparent_and_material_index(is_transparent_pass);
+                    m_pcb_pass_cpu.set_f3_value2(static_cast<float>(light->GetIndex()), 0.0f, 0.0f);
+                    m_pcb_pass_cpu.set_f3_value(GetOption<float>(Renderer_Option::Fog), GetOption<float>(Renderer_Option::ShadowResolution), 0.0f);
+                    cmd_list->PushConstants(m_pcb_pass_cpu);
+                    
+                    cmd_list->Dispatch(tex_diffuse);
+                }
+            }
+        }
+
         cmd_list->EndTimeblock();
     }
 
@@ -1354,7 +2854,7 @@ namespace Spartan
         auto& entities = m_renderables[Renderer_Entity::Light];
         for (shared_ptr<Entity> entity : entities)
         {
-            if (shared_ptr<Light> light = entity->GetComponent<Light>())
+            if (Light* light = entity->GetComponentRaw<Light>())
             {
                 if (light->GetLightType() == LightType::Directional)
                 {
@@ -1801,30 +3301,43 @@ namespace Spartan
         cmd_list->EndTimeblock();
     }
 
-    void Renderer::Pass_Downsample(RHI_CommandList* cmd_list, RHI_Texture* tex, const Renderer_DownsampleFilter filter)
+    void Renderer::Pass_Downsample(RHI_CommandList* cmd_list, RHI_Texture* tex, const Renderer_DownsampleFilter filter, RHI_Texture* tex_out /*= nullptr*/)
     {
         // AMD FidelityFX Single Pass Downsampler.
         // Provides an RDNA™-optimized solution for generating up to 12 MIP levels of a texture.
         // GitHub:        https://github.com/GPUOpen-Effects/FidelityFX-SPD
         // Documentation: https://github.com/GPUOpen-Effects/FidelityFX-SPD/blob/master/docs/FidelityFX_SPD.pdf
 
+        // when an output texture is provided, its mips take the place of the source's mips 1 to n, so the source
+        // is only read, and it's stretched over twice the output's size (which the min/max filters can do conservatively)
+        RHI_Texture* tex_mips = tex_out ? tex_out : tex;
+
         // deduce information
         const uint32_t mip_start             = 0;
-        const uint32_t output_mip_count      = tex->GetMipCount() - (mip_start + 1);
-        const uint32_t width                 = tex->GetWidth();
-        const uint32_t height                = tex->GetHeight() >> mip_start;
+        const uint32_t output_mip_count      = tex_out ? tex_out->GetMipCount() : tex->GetMipCount() - (mip_start + 1);
+        const uint32_t width                 = tex_out ? tex_out->GetWidth() * 2 : tex->GetWidth();
+        const uint32_t height                = tex_out ? tex_out->GetHeight() * 2 : tex->GetHeight() >> mip_start;
         const uint32_t thread_group_count_x_ = (width + 63)  >> 6; // as per document documentation (page 22)
         const uint32_t thread_group_count_y_ = (height + 63) >> 6; // as per document documentation (page 22)
 
         // ensure that the input texture meets the requirements
-        SP_ASSERT(tex->HasPerMipViews());
+        SP_ASSERT(tex_mips->HasPerMipViews());
         SP_ASSERT(width <= 4096 && height <= 4096 && output_mip_count <= 12); // as per documentation (page 22)
         SP_ASSERT(mip_start < output_mip_count);
 
         // acquire shader
         RHI_Shader* shader_c = nullptr;
         {
-            Renderer_Shader shader = (filter == Renderer_DownsampleFilter::Average) ? Renderer_Shader::ffx_spd_average_c : Renderer_Shader::ffx_spd_max_c;
+            Renderer_Shader shader = Renderer_Shader::ffx_spd_average_c;
+            if (filter == Renderer_DownsampleFilter::Max)
+            {
+                shader = Renderer_Shader::ffx_spd_max_c;
+            }
+            else if (filter == Renderer_DownsampleFilter::Min)
+            {
+                shader = Renderer_Shader::ffx_spd_min_c;
+            }
+
             shader_c = GetShader(shader).get();
             if (!shader_c->IsCompiled())
                 return;
@@ -1840,12 +3353,20 @@ namespace Spartan
 
             // push pass data
             m_pcb_pass_cpu.set_f3_value(static_cast<float>(output_mip_count), static_cast<float>(thread_group_count_x_ * thread_group_count_y_), 0.0f);
-            m_pcb_pass_cpu.set_f3_value2(static_cast<float>(tex->GetWidth()), static_cast<float>(tex->GetHeight()), 0.0f);
+            m_pcb_pass_cpu.set_f3_value2(static_cast<float>(width), static_cast<float>(height), 0.0f);
             cmd_list->PushConstants(m_pcb_pass_cpu);
 
             // set textures
-            cmd_list->SetTexture(Renderer_BindingsSrv::tex,     tex, mip_start, 1);                    // starting mip
-            cmd_list->SetTexture(Renderer_BindingsUav::tex_spd, tex, mip_start + 1, output_mip_count); // following mips
+            if (tex_out)
+            {
+                cmd_list->SetTexture(Renderer_BindingsSrv::tex,     tex);                          // source
+                cmd_list->SetTexture(Renderer_BindingsUav::tex_spd, tex_out, 0, output_mip_count); // all mips
+            }
+            else
+            {
+                cmd_list->SetTexture(Renderer_BindingsSrv::tex,     tex, mip_start, 1);                    // starting mip
+                cmd_list->SetTexture(Renderer_BindingsUav::tex_spd, tex, mip_start + 1, output_mip_count); // following mips
+            }
 
             // render
             cmd_list->Dispatch(thread_group_count_x_, thread_group_count_y_);
@@ -1993,7 +3514,7 @@ namespace Spartan
             RHI_Texture* texture = nullptr;
 
             // light can be null if it just got removed and our buffer doesn't update till the next frame
-            if (shared_ptr<Light> light = entity->GetComponent<Light>())
+            if (Light* light = entity->GetComponentRaw<Light>())
             {
                 // get the texture
                 if (light->GetLightType() == LightType::Directional) texture = GetStandardTexture(Renderer_StandardTexture::Gizmo_light_directional).get();
@@ -2158,13 +3679,15 @@ namespace Spartan
                 {
                     RHI_Texture* tex_outline = GetRenderTarget(Renderer_RenderTarget::outline).get();
 
-                    if (shared_ptr<Renderable> renderable = entity_selected->GetComponent<Renderable>())
+                    Renderable* renderable    = entity_selected->GetComponentRaw<Renderable>();
+                    RHI_Shader* shader_vertex = renderable ? get_vertex_shader(Renderer_Shader::outline_v, renderable->GetVertexType()) : nullptr;
+                    if (renderable && shader_vertex)
                     {
                         cmd_list->BeginMarker("color_silhouette");
                         {
                             // set pipeline state
                             static RHI_PipelineState pso;
-                            pso.shaders[RHI_Shader_Type::Vertex] = shader_v;
+                            pso.shaders[RHI_Shader_Type::Vertex] = shader_vertex;
                             pso.shaders[RHI_Shader_Type::Pixel]  = shader_p;
                             pso.rasterizer_state                 = GetRasterizerState(Renderer_RasterizerState::Solid).get();
                             pso.blend_state                      = GetBlendState(Renderer_BlendState::Off).get();
@@ -2225,7 +3748,11 @@ namespace Spartan
         const auto& shader_p  = GetShader(Renderer_Shader::font_p);
         shared_ptr<Font> font = GetFont();
         if (!shader_v || !shader_v->IsCompiled() || !shader_p || !shader_p->IsCompiled() || !draw || !font->HasText())
+        {
+            // the text lives in frame memory, so drop it even when it's not drawn
+            font->ClearText();
             return;
+        }
 
         cmd_list->BeginMarker("text");
 
@@ -25,6 +25,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../World/Components/Camera.h"
 #include "../World/Components/Light.h"
 #include "../World/Entity.h"
+#include "../Core/FrameAllocator.h"
 //=====================================
 
 //= NAMESPACES ===============
@@ -129,7 +130,7 @@ namespace Spartan
         // Need at least 4 segments
         segment_count = Helper::Max<uint32_t>(segment_count, 4);
 
-        vector<Vector3> points;
+        FrameVector<Vector3> points;
         points.reserve(segment_count + 1);
         points.resize(segment_count + 1);
 
@@ -24,6 +24,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Window.h"
 #include "Renderer.h"
 #include "Geometry.h"
+#include "LightClusters.h"
 #include "../World/Components/Light.h"
 #include "../Resource/ResourceCache.h"
 #include "../RHI/RHI_Texture2D.h"
@@ -91,6 +92,28 @@ namespace Spartan
 
         stride = static_cast<uint32_t>(sizeof(Sb_Light)) * rhi_max_array_size_lights;
         buffer(Renderer_Buffer::StorageLights) = make_shared<RHI_Buffer>(RHI_Buffer_Type::Storage, stride, 1, nullptr, true, "lights");
+
+        // gpu driven rendering - the cpu writes the draw objects and zeroes the counts every frame, the gpu writes the draw commands,
+        // the commands and the counts have one region per culling phase, the visibility has one region per frame (the current and the previous)
+        stride = static_cast<uint32_t>(sizeof(Sb_DrawObject)) * renderer_max_draw_objects;
+        buffer(Renderer_Buffer::StorageDrawObjects) = make_shared<RHI_Buffer>(RHI_Buffer_Type::Storage, stride, element_count, nullptr, true, "draw_objects");
+
+        stride = static_cast<uint32_t>(sizeof(Sb_DrawIndexedIndirectCommand)) * renderer_max_draw_objects * renderer_culling_phase_count;
+        buffer(Renderer_Buffer::StorageDrawCommands) = make_shared<RHI_Buffer>(RHI_Buffer_Type::Storage, stride, 1, nullptr, false, "draw_commands");
+
+        stride = static_cast<uint32_t>(sizeof(uint32_t)) * renderer_max_draw_buckets * renderer_culling_phase_count;
+        buffer(Renderer_Buffer::StorageDrawCounts) = make_shared<RHI_Buffer>(RHI_Buffer_Type::Storage, stride, element_count, nullptr, true, "draw_counts");
+
+        stride = static_cast<uint32_t>(sizeof(uint32_t)) * renderer_max_draw_objects * 2;
+        buffer(Renderer_Buffer::StorageDrawVisibility) = make_shared<RHI_Buffer>(RHI_Buffer_Type::Storage, stride, 1, nullptr, false, "draw_visibility");
+
+        // dynamic instancing - the cpu writes the transforms of the batched renderables every frame
+        stride = static_cast<uint32_t>(sizeof(Matrix)) * renderer_max_batched_instances;
+        buffer(Renderer_Buffer::InstancesBatched) = make_shared<RHI_Buffer>(RHI_Buffer_Type::Instance, stride, element_count, nullptr, true, "instances_batched");
+
+        // clustered lighting - the cpu assigns the lights to the clusters every frame
+        stride = static_cast<uint32_t>(sizeof(uint32_t)) * LightClusters::data_count;
+        buffer(Renderer_Buffer::StorageLightClusters) = make_shared<RHI_Buffer>(RHI_Buffer_Type::Storage, stride, element_count, nullptr, true, "light_clusters");
     }
 
     void Renderer::CreateDepthStencilStates()
@@ -245,6 +268,15 @@ namespace Spartan
             { 
                 render_target(Renderer_RenderTarget::shading_rate) = make_shared<RHI_Texture2D>(width_render / 4, height_render / 4, 1, RHI_Format::R8_Uint, RHI_Texture_Srv | RHI_Texture_Uav | RHI_Texture_Rtv | RHI_Texture_Vrs, "shading_rate");
             }
+
+            // hierarchical depth (min), the depth is stretched over the next power of two so that every mip is an exact 2x2 reduction
+            // of the previous one, that's what keeps the occlusion test conservative, spd can't read sources larger than 4096
+            {
+                uint32_t width_hi_z     = min<uint32_t>(Helper::PreviousPowerOfTwo(width_render - 1), 2048);
+                uint32_t height_hi_z    = min<uint32_t>(Helper::PreviousPowerOfTwo(height_render - 1), 2048);
+                uint32_t mip_count_hi_z = static_cast<uint32_t>(log2(max(width_hi_z, height_hi_z))) + 1;
+                render_target(Renderer_RenderTarget::hi_z) = make_shared<RHI_Texture2D>(width_hi_z, height_hi_z, mip_count_hi_z, RHI_Format::R32_Float, flags | RHI_Texture_PerMipViews, "hi_z");
+            }
         }
 
         // resolution - output
@@ -301,6 +333,12 @@ namespace Spartan
                 shader(Renderer_Shader::outline_v) = make_shared<RHI_Shader>();
                 shader(Renderer_Shader::outline_v)->Compile(RHI_Shader_Type::Vertex, shader_dir + "outline.hlsl", async, RHI_Vertex_Type::PosUvNorTan);
 
+                shader(Renderer_Shader::outline_packed_v) = make_shared<RHI_Shader>();
+                shader(Renderer_Shader::outline_packed_v)->Compile(RHI_Shader_Type::Vertex, shader_dir + "outline.hlsl", async, RHI_Vertex_Type::PosUvNorTanPacked);
+
+                shader(Renderer_Shader::outline_packed_half_v) = make_shared<RHI_Shader>();
+                shader(Renderer_Shader::outline_packed_half_v)->Compile(RHI_Shader_Type::Vertex, shader_dir + "outline.hlsl", async, RHI_Vertex_Type::PosUvNorTanPackedHalf);
+
                 shader(Renderer_Shader::outline_p) = make_shared<RHI_Shader>();
                 shader(Renderer_Shader::outline_p)->Compile(RHI_Shader_Type::Pixel, shader_dir + "outline.hlsl", async);
 
@@ -314,8 +352,20 @@ namespace Spartan
             shader(Renderer_Shader::depth_prepass_v) = make_shared<RHI_Shader>();
             shader(Renderer_Shader::depth_prepass_v)->Compile(RHI_Shader_Type::Vertex, shader_dir + "depth_prepass.hlsl", async, RHI_Vertex_Type::PosUvNorTan);
 
+            shader(Renderer_Shader::depth_prepass_packed_v) = make_shared<RHI_Shader>();
+            shader(Renderer_Shader::depth_prepass_packed_v)->AddDefine("VERTEX_PACKED");
+            shader(Renderer_Shader::depth_prepass_packed_v)->Compile(RHI_Shader_Type::Vertex, shader_dir + "depth_prepass.hlsl", async, RHI_Vertex_Type::PosUvNorTanPacked);
+
+            shader(Renderer_Shader::depth_prepass_packed_half_v) = make_shared<RHI_Shader>();
+            shader(Renderer_Shader::depth_prepass_packed_half_v)->AddDefine("VERTEX_PACKED");
+            shader(Renderer_Shader::depth_prepass_packed_half_v)->Compile(RHI_Shader_Type::Vertex, shader_dir + "depth_prepass.hlsl", async, RHI_Vertex_Type::PosUvNorTanPackedHalf);
+
             shader(Renderer_Shader::depth_prepass_alpha_test_p) = make_shared<RHI_Shader>();
             shader(Renderer_Shader::depth_prepass_alpha_test_p)->Compile(RHI_Shader_Type::Pixel, shader_dir + "depth_prepass.hlsl", async);
+
+            shader(Renderer_Shader::depth_prepass_indirect_v) = make_shared<RHI_Shader>();
+            shader(Renderer_Shader::depth_prepass_indirect_v)->AddDefine("INDIRECT");
+            shader(Renderer_Shader::depth_prepass_indirect_v)->Compile(RHI_Shader_Type::Vertex, shader_dir + "depth_prepass.hlsl", async, RHI_Vertex_Type::PosUvNorTan);
         }
 
         // light depth
@@ -323,6 +373,14 @@ namespace Spartan
             shader(Renderer_Shader::depth_light_v) = make_shared<RHI_Shader>();
             shader(Renderer_Shader::depth_light_v)->Compile(RHI_Shader_Type::Vertex, shader_dir + "depth_light.hlsl", async, RHI_Vertex_Type::PosUvNorTan);
 
+            shader(Renderer_Shader::depth_light_packed_v) = make_shared<RHI_Shader>();
+            shader(Renderer_Shader::depth_light_packed_v)->AddDefine("VERTEX_PACKED");
+            shader(Renderer_Shader::depth_light_packed_v)->Compile(RHI_Shader_Type::Vertex, shader_dir + "depth_light.hlsl", async, RHI_Vertex_Type::PosUvNorTanPacked);
+
+            shader(Renderer_Shader::depth_light_packed_half_v) = make_shared<RHI_Shader>();
+            shader(Renderer_Shader::depth_light_packed_half_v)->AddDefine("VERTEX_PACKED");
+            shader(Renderer_Shader::depth_light_packed_half_v)->Compile(RHI_Shader_Type::Vertex, shader_dir + "depth_light.hlsl", async, RHI_Vertex_Type::PosUvNorTanPackedHalf);
+
             shader(Renderer_Shader::depth_light_alpha_color_p) = make_shared<RHI_Shader>();
             shader(Renderer_Shader::depth_light_alpha_color_p)->Compile(RHI_Shader_Type::Pixel, shader_dir + "depth_light.hlsl", async);
         }
@@ -332,8 +390,30 @@ namespace Spartan
             shader(Renderer_Shader::gbuffer_v) = make_shared<RHI_Shader>();
             shader(Renderer_Shader::gbuffer_v)->Compile(RHI_Shader_Type::Vertex, shader_dir + "g_buffer.hlsl", async, RHI_Vertex_Type::PosUvNorTan);
 
+            shader(Renderer_Shader::gbuffer_packed_v) = make_shared<RHI_Shader>();
+            shader(Renderer_Shader::gbuffer_packed_v)->AddDefine("VERTEX_PACKED");
+            shader(Renderer_Shader::gbuffer_packed_v)->Compile(RHI_Shader_Type::Vertex, shader_dir + "g_buffer.hlsl", async, RHI_Vertex_Type::PosUvNorTanPacked);
+
+            shader(Renderer_Shader::gbuffer_packed_half_v) = make_shared<RHI_Shader>();
+            shader(Renderer_Shader::gbuffer_packed_half_v)->AddDefine("VERTEX_PACKED");
+            shader(Renderer_Shader::gbuffer_packed_half_v)->Compile(RHI_Shader_Type::Vertex, shader_dir + "g_buffer.hlsl", async, RHI_Vertex_Type::PosUvNorTanPackedHalf);
+
             shader(Renderer_Shader::gbuffer_p) = make_shared<RHI_Shader>();
             shader(Renderer_Shader::gbuffer_p)->Compile(RHI_Shader_Type::Pixel, shader_dir + "g_buffer.hlsl", async);
+
+            shader(Renderer_Shader::gbuffer_indirect_v) = make_shared<RHI_Shader>();
+            shader(Renderer_Shader::gbuffer_indirect_v)->AddDefine("INDIRECT");
+            shader(Renderer_Shader::gbuffer_indirect_v)->Compile(RHI_Shader_Type::Vertex, shader_dir + "g_buffer.hlsl", async, RHI_Vertex_Type::PosUvNorTan);
+
+            shader(Renderer_Shader::gbuffer_indirect_p) = make_shared<RHI_Shader>();
+            shader(Renderer_Shader::gbuffer_indirect_p)->AddDefine("INDIRECT");
+            shader(Renderer_Shader::gbuffer_indirect_p)->Compile(RHI_Shader_Type::Pixel, shader_dir + "g_buffer.hlsl", async);
+        }
+
+        // gpu driven rendering
+        {
+            shader(Renderer_Shader::indirect_cull_c) = make_shared<RHI_Shader>();
+            shader(Renderer_Shader::indirect_cull_c)->Compile(RHI_Shader_Type::Compute, shader_dir + "indirect_cull.hlsl", async);
         }
 
         // tessellation
@@ -361,6 +441,10 @@ namespace Spartan
             shader(Renderer_Shader::light_c) = make_shared<RHI_Shader>();
             shader(Renderer_Shader::light_c)->Compile(RHI_Shader_Type::Compute, shader_dir + "light.hlsl", async);
 
+            shader(Renderer_Shader::light_clustered_c) = make_shared<RHI_Shader>();
+            shader(Renderer_Shader::light_clustered_c)->AddDefine("CLUSTERED");
+            shader(Renderer_Shader::light_clustered_c)->Compile(RHI_Shader_Type::Compute, shader_dir + "light.hlsl", async);
+
             // composition
             shader(Renderer_Shader::light_composition_c) = make_shared<RHI_Shader>();
             shader(Renderer_Shader::light_composition_c)->Compile(RHI_Shader_Type::Compute, shader_dir + "light_composition.hlsl", async);
@@ -424,6 +508,10 @@ namespace Spartan
                 shader(Renderer_Shader::ffx_spd_max_c) = make_shared<RHI_Shader>();
                 shader(Renderer_Shader::ffx_spd_max_c)->AddDefine("MAX");
                 shader(Renderer_Shader::ffx_spd_max_c)->Compile(RHI_Shader_Type::Compute, shader_dir + "amd_fidelity_fx\\spd.hlsl", false);
+
+                shader(Renderer_Shader::ffx_spd_min_c) = make_shared<RHI_Shader>();
+                shader(Renderer_Shader::ffx_spd_min_c)->AddDefine("MIN");
+                shader(Renderer_Shader::ffx_spd_min_c)->Compile(RHI_Shader_Type::Compute, shader_dir + "amd_fidelity_fx\\spd.hlsl", false);
             }
         }
 
@@ -720,6 +720,29 @@ namespace Spartan
         // compute AABB (before doing move operation on vertices)
         const BoundingBox aabb = BoundingBox(vertices.data(), static_cast<uint32_t>(vertices.size()));
 
+        // meshlets, they reorder the original indices into clusters so they have to be built before anything is appended
+        vector<Meshlet> meshlets;
+        if (mesh->GetFlags() & static_cast<uint32_t>(MeshFlags::ImportMeshlets))
+        {
+            meshlets = Mesh::ComputeMeshlets(indices, vertices);
+        }
+
+        // lods, they are appended right after the original indices so that the whole chain of a renderable is contiguous
+        const uint32_t index_count_lod0 = static_cast<uint32_t>(indices.size());
+        vector<RenderableLod> lods;
+        if (mesh->GetFlags() & static_cast<uint32_t>(MeshFlags::ImportLods))
+        {
+            for (MeshLod& lod : Mesh::ComputeLods(indices, vertices))
+            {
+                RenderableLod& renderable_lod = lods.emplace_back();
+                renderable_lod.index_offset   = static_cast<uint32_t>(indices.size()); // relative for now
+                renderable_lod.index_count    = static_cast<uint32_t>(lod.indices.size());
+                renderable_lod.error          = lod.error;
+
+                indices.insert(indices.end(), lod.indices.begin(), lod.indices.end());
+            }
+        }
+
         // add vertex and index data to the mesh
         uint32_t index_offset  = 0;
         uint32_t vertex_offset = 0;
@@ -734,11 +757,25 @@ namespace Spartan
             mesh,
             aabb,
             index_offset,
-            static_cast<uint32_t>(indices.size()),
+            index_count_lod0,
             vertex_offset,
             static_cast<uint32_t>(vertices.size())
         );
 
+        // set the lods
+        for (RenderableLod& lod : lods)
+        {
+            lod.index_offset += index_offset;
+        }
+        renderable->SetLods(lods);
+
+        // set the meshlets
+        for (Meshlet& meshlet : meshlets)
+        {
+            meshlet.index_offset += index_offset;
+        }
+        renderable->SetMeshlets(meshlets);
+
         // material
         if (scene->HasMaterials())
         {
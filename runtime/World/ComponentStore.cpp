@@ -0,0 +1,195 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES ===============
+#include "pch.h"
+#include "ComponentStore.h"
+//==========================
+
+//= NAMESPACES =====
+using namespace std;
+//==================
+
+namespace Spartan
+{
+    namespace
+    {
+        const uint32_t slots_per_chunk = 64;
+
+        struct Store
+        {
+            array<vector<Component*>, static_cast<uint32_t>(ComponentType::Max)> dense;
+            recursive_mutex mutex;
+            uint32_t iteration_depth = 0;
+            bool has_holes           = false;
+        };
+
+        // intentionally never deleted, like the pools, a component held by a static can be destroyed after this file's statics
+        Store& get_store()
+        {
+            static Store* store = new Store();
+            return *store;
+        }
+
+        // every slot has to be able to hold a free list link and respect the requested alignment
+        size_t get_slot_alignment(const size_t alignment)
+        {
+            return max(alignment, alignof(void*));
+        }
+
+        size_t get_slot_size(const size_t size, const size_t alignment)
+        {
+            const size_t slot_alignment = get_slot_alignment(alignment);
+            return (max(size, sizeof(void*)) + slot_alignment - 1) & ~(slot_alignment - 1);
+        }
+    }
+
+    ComponentPool::ComponentPool(const size_t slot_size, const size_t slot_alignment)
+    {
+        m_slot_alignment = get_slot_alignment(slot_alignment);
+        m_slot_size      = get_slot_size(slot_size, slot_alignment);
+    }
+
+    ComponentPool::~ComponentPool()
+    {
+        for (void* chunk : m_chunks)
+        {
+            ::operator delete(chunk, align_val_t(m_slot_alignment));
+        }
+    }
+
+    void* ComponentPool::Allocate()
+    {
+        lock_guard<mutex> lock(m_mutex);
+
+        if (m_slots_free.empty())
+        {
+            uint8_t* chunk = static_cast<uint8_t*>(::operator new(m_slot_size * slots_per_chunk, align_val_t(m_slot_alignment)));
+            m_chunks.emplace_back(chunk);
+
+            // push in reverse so that slots are handed out in address order
+            m_slots_free.reserve(m_slots_free.size() + slots_per_chunk);
+            for (uint32_t i = slots_per_chunk; i > 0; i--)
+            {
+                m_slots_free.emplace_back(chunk + (i - 1) * m_slot_size);
+            }
+        }
+
+        void* slot = m_slots_free.back();
+        m_slots_free.pop_back();
+
+        return slot;
+    }
+
+    void ComponentPool::Free(void* slot)
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_slots_free.emplace_back(slot);
+    }
+
+    void ComponentStore::Register(Component* component)
+    {
+        SP_ASSERT(component != nullptr);
+        SP_ASSERT(component->GetType() != ComponentType::Max);
+
+        Store& store = get_store();
+        lock_guard<recursive_mutex> lock(store.mutex);
+
+        if (component->m_store_index != Component::store_index_invalid)
+            return;
+
+        vector<Component*>& dense = store.dense[static_cast<uint32_t>(component->GetType())];
+        component->m_store_index  = static_cast<uint32_t>(dense.size());
+        dense.emplace_back(component);
+    }
+
+    void ComponentStore::Unregister(Component* component)
+    {
+        Store& store = get_store();
+        lock_guard<recursive_mutex> lock(store.mutex);
+
+        if (component->m_store_index == Component::store_index_invalid)
+            return;
+
+        vector<Component*>& dense = store.dense[static_cast<uint32_t>(component->GetType())];
+        if (store.iteration_depth > 0)
+        {
+            // moving the last element into the hole would make an iteration skip it, so leave a null behind
+            dense[component->m_store_index] = nullptr;
+            store.has_holes                 = true;
+        }
+        else
+        {
+            // swap with the last element so that the array stays dense
+            Component* last                 = dense.back();
+            dense[component->m_store_index] = last;
+            last->m_store_index             = component->m_store_index;
+            dense.pop_back();
+        }
+
+        component->m_store_index = Component::store_index_invalid;
+    }
+
+    void ComponentStore::BeginIteration()
+    {
+        Store& store = get_store();
+        store.mutex.lock();
+        store.iteration_depth++;
+    }
+
+    void ComponentStore::EndIteration()
+    {
+        Store& store = get_store();
+        SP_ASSERT(store.iteration_depth > 0);
+
+        // close the holes that removals left behind, keeping the order of what remains
+        if (--store.iteration_depth == 0 && store.has_holes)
+        {
+            for (vector<Component*>& dense : store.dense)
+            {
+                uint32_t count = 0;
+                for (Component* component : dense)
+                {
+                    if (component)
+                    {
+                        component->m_store_index = count;
+                        dense[count++]           = component;
+                    }
+                }
+                dense.resize(count);
+            }
+
+            store.has_holes = false;
+        }
+
+        store.mutex.unlock();
+    }
+
+    const vector<Component*>& ComponentStore::GetComponents(const ComponentType type)
+    {
+        return get_store().dense[static_cast<uint32_t>(type)];
+    }
+
+    recursive_mutex& ComponentStore::GetMutex()
+    {
+        return get_store().mutex;
+    }
+}
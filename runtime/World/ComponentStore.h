@@ -0,0 +1,113 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+//= INCLUDES ========================
+#include <vector>
+#include <mutex>
+#include "Components/Component.h"
+//===================================
+
+namespace Spartan
+{
+    // a fixed size slot allocator, slots are carved out of large chunks so that
+    // components of the same type end up next to each other in memory and never move
+    class SP_CLASS ComponentPool
+    {
+    public:
+        ComponentPool(size_t slot_size, size_t slot_alignment);
+        ~ComponentPool();
+
+        void* Allocate();
+        void Free(void* slot);
+
+        // returns the pool of the given type, every type gets its own pool (even if another type has the same size)
+        // so that iterating one component type never strides over memory of another
+        template<typename T>
+        static ComponentPool& Get()
+        {
+            // intentionally never deleted, components can outlive the world during static destruction
+            static ComponentPool* pool = new ComponentPool(sizeof(T), alignof(T));
+            return *pool;
+        }
+
+    private:
+        size_t m_slot_size      = 0;
+        size_t m_slot_alignment = 0;
+        std::vector<void*> m_chunks;
+        std::vector<void*> m_slots_free;
+        std::mutex m_mutex;
+    };
+
+    // stl allocator which routes single object allocations (what std::allocate_shared does) to a component pool,
+    // allocate_shared rebinds it to its control block type, which is distinct for every component type
+    template<typename T>
+    class ComponentPoolAllocator
+    {
+    public:
+        using value_type = T;
+
+        ComponentPoolAllocator() = default;
+        template<typename U> ComponentPoolAllocator(const ComponentPoolAllocator<U>&) {}
+
+        T* allocate(size_t count)
+        {
+            if (count != 1)
+                return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(alignof(T))));
+
+            return static_cast<T*>(ComponentPool::Get<T>().Allocate());
+        }
+
+        void deallocate(T* pointer, size_t count)
+        {
+            if (count != 1)
+            {
+                ::operator delete(pointer, std::align_val_t(alignof(T)));
+                return;
+            }
+
+            ComponentPool::Get<T>().Free(pointer);
+        }
+
+        template<typename U> bool operator==(const ComponentPoolAllocator<U>&) const { return true; }
+        template<typename U> bool operator!=(const ComponentPoolAllocator<U>&) const { return false; }
+    };
+
+    // keeps a dense array of component pointers per component type, this is what systems iterate
+    // instead of walking every entity and asking it for a component via a refcounted pointer,
+    // only components of entities which are part of the world are in it (see Entity::SetInWorld())
+    class SP_CLASS ComponentStore
+    {
+    public:
+        static void Register(Component* component);
+        static void Unregister(Component* component);
+
+        // the arrays are only stable while the mutex is held
+        static const std::vector<Component*>& GetComponents(ComponentType type);
+        static std::recursive_mutex& GetMutex();
+
+        // hold the mutex for an iteration that may add or remove components (like ticking them), in between the two calls
+        // a removal leaves a null in its place instead of moving another component, components added go to the end
+        static void BeginIteration();
+        static void EndIteration();
+    };
+}
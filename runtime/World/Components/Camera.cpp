@@ -149,7 +149,7 @@ namespace Spartan
         return m_frustum.IsVisible(center, extents);
     }
 
-    bool Camera::IsInViewFrustum(shared_ptr<Renderable> renderable) const
+    bool Camera::IsInViewFrustum(Renderable* renderable) const
     {
         const BoundingBox& box = renderable->GetBoundingBox(BoundingBoxType::Transformed);
         return IsInViewFrustum(box);
@@ -115,7 +115,8 @@ namespace Spartan
   
         // frustum
         bool IsInViewFrustum(const Math::BoundingBox& bounding_box) const;
-        bool IsInViewFrustum(std::shared_ptr<Renderable> renderable) const;
+        bool IsInViewFrustum(Renderable* renderable) const;
+        const Math::Frustum& GetFrustum() const { return m_frustum; }
 
         // first person control
         bool GetIsControlEnabled()             const { return m_first_person_control_enabled; }
@@ -19,7 +19,7 @@ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
 CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
-//= INCLUDES =============
+//= INCLUDES =====================
 #include "pch.h"
 #include "Component.h"
 #include "Light.h"
@@ -29,7 +29,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "AudioSource.h"
 #include "AudioListener.h"
 #include "Terrain.h"
-//========================
+#include "../ComponentStore.h"
+//================================
 
 //= NAMESPACES =====
 using namespace std;
@@ -43,6 +44,12 @@ namespace Spartan
         m_enabled    = true;
     }
 
+    Component::~Component()
+    {
+        // the entity unregisters its components when they are removed, this only catches strays
+        ComponentStore::Unregister(this);
+    }
+
     template <typename T>
     inline constexpr ComponentType Component::TypeToEnum() { return ComponentType::Max; }
 
@@ -60,7 +60,7 @@ namespace Spartan
     {
     public:
         Component(Entity* entity);
-        virtual ~Component() = default;
+        virtual ~Component();
 
         // runs when the component gets added
         virtual void OnInitialize() {}
@@ -134,7 +134,12 @@ namespace Spartan
         Entity* m_entity_ptr = nullptr;
 
     private:
+        friend class ComponentStore;
+        static const uint32_t store_index_invalid = 0xFFFFFFFF;
+
         // the attributes of the component
         std::vector<Attribute> m_attributes;
+        // the position of the component in the dense array of its type
+        uint32_t m_store_index = store_index_invalid;
     };
 }
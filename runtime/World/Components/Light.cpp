@@ -391,10 +391,28 @@ namespace Spartan
             {
                 target = camera->GetEntity()->GetPosition();
             }
-            Vector3 position = target - GetEntity()->GetForward() * orthographic_depth * 0.8f;
 
-            m_matrix_view[0] = Matrix::CreateLookAtLH(position, target, Vector3::Up); // near
-            m_matrix_view[1] = m_matrix_view[0];                                      // far
+            // the same axes as CreateLookAtLH()
+            const Vector3 axis_z = GetEntity()->GetForward();
+            const Vector3 axis_x = Vector3::Normalize(Vector3::Cross(Vector3::Up, axis_z));
+            const Vector3 axis_y = Vector3::Cross(axis_z, axis_x);
+            auto snap            = [](const float value, const float step) { return step > 0.0f ? floor(value / step) * step : value; };
+
+            for (uint32_t i = 0; i < 2; i++)
+            {
+                // move the target to a whole texel of the cascade (and to coarse depth steps), so that the cascade doesn't shimmer and its
+                // matrices stay the same while the camera moves less than a texel, which is what lets the cached static shadows be reused
+                const float extent     = (i == 0) ? orthographic_extent_near : orthographic_extent_far;
+                const float texel_size = m_texture_depth ? 2.0f * extent / static_cast<float>(m_texture_depth->GetWidth()) : 0.0f;
+                const float depth_step = orthographic_depth / 64.0f;
+                Vector3 target_snapped =
+                    axis_x * snap(Vector3::Dot(target, axis_x), texel_size) +
+                    axis_y * snap(Vector3::Dot(target, axis_y), texel_size) +
+                    axis_z * snap(Vector3::Dot(target, axis_z), depth_step);
+
+                Vector3 position = target_snapped - axis_z * orthographic_depth * 0.8f;
+                m_matrix_view[i] = Matrix::CreateLookAtLH(position, target_snapped, Vector3::Up); // 0: near, 1: far
+            }
         }
         else if (m_light_type == LightType::Spot)
         {
@@ -471,6 +489,35 @@ namespace Spartan
         }
     }
 
+    bool Light::IsInViewFrustum(const Vector3& center, const float radius, const uint32_t index) const
+    {
+        if (m_light_type == LightType::Directional)
+        {
+            // test against the light space bounds of the cascade, depth is ignored like in the box test
+            const Vector3 center_light = m_matrix_view[index] * center;
+            const float extent         = (index == 0) ? orthographic_extent_near : orthographic_extent_far;
+
+            return Helper::Abs(center_light.x) - radius <= extent && Helper::Abs(center_light.y) - radius <= extent;
+        }
+
+        if (m_light_type == LightType::Point)
+        {
+            // the sphere has to reach into the hemisphere of the paraboloid
+            float sign = (index == 0) ? 1.0f : -1.0f;
+            return Vector3::Dot(center - m_entity_ptr->GetPosition(), sign * m_entity_ptr->GetForward()) >= -radius;
+        }
+
+        // spot light
+        for (uint32_t i = 0; i < 6; i++)
+        {
+            const Plane& plane = m_frustums[index].GetPlane(i);
+            if (Vector3::Dot(plane.normal, center) + plane.d < -radius)
+                return false;
+        }
+
+        return true;
+    }
+
     bool Light::IsInViewFrustum(Renderable* renderable, uint32_t index) const
     {
         const BoundingBox& box = renderable->GetBoundingBox(BoundingBoxType::Transformed);
@@ -492,16 +539,20 @@ namespace Spartan
         uint32_t flags          = RHI_Texture_Rtv | RHI_Texture_Srv | RHI_Texture_ClearBlit;
         m_texture_depth         = nullptr;
         m_texture_color         = nullptr;
+        m_texture_depth_static  = nullptr;
+        m_texture_color_static  = nullptr;
         uint32_t array_length   = (GetLightType() == LightType::Spot) ? 1 : 2;
 
         // spot light:        1 slice
         // directional light: 2 slices for cascades
         // point light:       2 slices for front and back paraboloid
 
-        m_texture_depth = make_unique<RHI_Texture2DArray>(resolution, resolution, format_depth, 2, flags, "light_depth");
+        m_texture_depth        = make_unique<RHI_Texture2DArray>(resolution, resolution, format_depth, 2, flags, "light_depth");
+        m_texture_depth_static = make_unique<RHI_Texture2DArray>(resolution, resolution, format_depth, 2, flags, "light_depth_static");
         if (IsFlagSet(LightFlags::ShadowsTransparent))
         {
-            m_texture_color = make_unique<RHI_Texture2DArray>(resolution, resolution, format_color, 2, flags, "light_color");
+            m_texture_color        = make_unique<RHI_Texture2DArray>(resolution, resolution, format_color, 2, flags, "light_color");
+            m_texture_color_static = make_unique<RHI_Texture2DArray>(resolution, resolution, format_color, 2, flags, "light_color_static");
         }
     }
 }  
@@ -119,13 +119,16 @@ namespace Spartan
         const Math::Matrix& GetProjectionMatrix(uint32_t index) const { return m_matrix_projection[index]; }
 
         // textures
-        RHI_Texture* GetDepthTexture() const { return m_texture_depth.get(); }
-        RHI_Texture* GetColorTexture() const { return m_texture_color.get(); }
+        RHI_Texture* GetDepthTexture() const       { return m_texture_depth.get(); }
+        RHI_Texture* GetColorTexture() const       { return m_texture_color.get(); }
+        RHI_Texture* GetDepthTextureStatic() const { return m_texture_depth_static.get(); }
+        RHI_Texture* GetColorTextureStatic() const { return m_texture_color_static.get(); }
         void RefreshShadowMap();
 
         // frustum
         bool IsInViewFrustum(const Math::BoundingBox& bounding_box, const uint32_t index) const;
         bool IsInViewFrustum(Renderable* renderable, const uint32_t index) const;
+        bool IsInViewFrustum(const Math::Vector3& center, const float radius, const uint32_t index) const; // conservative bounding sphere test, cheap enough for early rejection
 
         // index
         void SetIndex(const uint32_t index) { m_index = index; }
@@ -143,6 +146,8 @@ namespace Spartan
         // shadows
         std::shared_ptr<RHI_Texture> m_texture_color;
         std::shared_ptr<RHI_Texture> m_texture_depth;
+        std::shared_ptr<RHI_Texture> m_texture_color_static; // static casters only, copied into the above every frame
+        std::shared_ptr<RHI_Texture> m_texture_depth_static; // static casters only, copied into the above every frame
         std::array<Math::Frustum, 2> m_frustums;
         std::array<Math::Matrix, 2> m_matrix_view;
         std::array<Math::Matrix, 2> m_matrix_projection;
@@ -163,7 +163,7 @@ namespace Spartan
         Activate();
     }
 
-    void PhysicsBody::OnTick()
+    void PhysicsBody::Tick()
     {
         // when the rigid body is inactive or we are in editor mode, allow the user to move/rotate it
         if (!Engine::IsFlagSet(EngineMode::Playing))
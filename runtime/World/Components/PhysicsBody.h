@@ -70,10 +70,12 @@ namespace Spartan
         void OnInitialize() override;
         void OnRemove() override;
         void OnStart() override;
-        void OnTick() override;
         void Serialize(FileStream* stream) override;
         void Deserialize(FileStream* stream) override;
 
+        // keeps the body in sync with its entity, ticked by Physics::Tick() from the component store instead of by the world
+        void Tick();
+
         // mass
         float GetMass() const { return m_mass; }
         void SetMass(float mass);
@@ -28,6 +28,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../../IO/FileStream.h"
 #include "../../Resource/ResourceCache.h"
 #include "../../Rendering/GridPartitioning.h"
+#include "../../Core/ThreadPool.h"
 //===========================================
 
 //= NAMESPACES ===============
@@ -37,6 +38,14 @@ using namespace Spartan::Math;
 
 namespace Spartan
 {
+    namespace
+    {
+        // worlds saved before the submeshes, lods and meshlets were serialized end right after the material,
+        // newer ones set this bit on the serialized flags and follow them with a format version
+        const uint32_t serialized_version_flag = 1U << 31;
+        const uint32_t serialized_version      = 3; // 1: static batch submeshes, 2: lods, 3: meshlets
+    }
+
     Renderable::Renderable(Entity* entity) : Component(entity)
     {
         SP_REGISTER_ATTRIBUTE_VALUE_VALUE(m_material_default,       bool);
@@ -71,12 +80,46 @@ namespace Spartan
         }
 
         // material
-        stream->Write(m_flags);
+        stream->Write(m_flags | serialized_version_flag);
+        stream->Write(serialized_version);
         stream->Write(m_material_default);
         if (!m_material_default)
         {
             stream->Write(m_material ? m_material->GetObjectName() : "");
         }
+
+        // lods
+        stream->Write(static_cast<uint32_t>(m_lods.size()));
+        for (const RenderableLod& lod : m_lods)
+        {
+            stream->Write(lod.index_offset);
+            stream->Write(lod.index_count);
+            stream->Write(lod.error);
+        }
+
+        // meshlets
+        stream->Write(static_cast<uint32_t>(m_meshlets.size()));
+        for (const Meshlet& meshlet : m_meshlets)
+        {
+            stream->Write(meshlet.index_offset);
+            stream->Write(meshlet.index_count);
+            stream->Write(meshlet.center);
+            stream->Write(meshlet.radius);
+            stream->Write(meshlet.cone_apex);
+            stream->Write(meshlet.cone_axis);
+            stream->Write(meshlet.cone_cutoff);
+        }
+
+        // submeshes
+        stream->Write(static_cast<uint32_t>(m_submeshes.size()));
+        for (const RenderableSubmesh& submesh : m_submeshes)
+        {
+            stream->Write(submesh.index_offset);
+            stream->Write(submesh.index_count);
+            stream->Write(submesh.bounding_box);
+            stream->Write(submesh.entity_id);
+            stream->Write(submesh.transform);
+        }
     }
 
     void Renderable::Deserialize(FileStream* stream)
@@ -101,6 +144,12 @@ namespace Spartan
 
         // material
         stream->Read(&m_flags);
+        uint32_t version = 0;
+        if (m_flags & serialized_version_flag)
+        {
+            version  = stream->ReadAs<uint32_t>();
+            m_flags &= ~serialized_version_flag;
+        }
         stream->Read(&m_material_default);
         if (m_material_default)
         {
@@ -112,6 +161,54 @@ namespace Spartan
             stream->Read(&material_name);
             m_material = ResourceCache::GetByName<Material>(material_name).get();
         }
+
+        m_lods.clear();
+        m_lod = 0;
+        m_meshlets.clear();
+        m_submeshes.clear();
+        if (version >= 2)
+        {
+            // lods
+            m_lods.resize(stream->ReadAs<uint32_t>());
+            for (RenderableLod& lod : m_lods)
+            {
+                stream->Read(&lod.index_offset);
+                stream->Read(&lod.index_count);
+                stream->Read(&lod.error);
+            }
+        }
+
+        if (version >= 3)
+        {
+            // meshlets
+            m_meshlets.resize(stream->ReadAs<uint32_t>());
+            for (Meshlet& meshlet : m_meshlets)
+            {
+                stream->Read(&meshlet.index_offset);
+                stream->Read(&meshlet.index_count);
+                stream->Read(&meshlet.center);
+                stream->Read(&meshlet.radius);
+                stream->Read(&meshlet.cone_apex);
+                stream->Read(&meshlet.cone_axis);
+                stream->Read(&meshlet.cone_cutoff);
+            }
+        }
+
+        if (version >= 1)
+        {
+            // submeshes
+            m_submeshes.resize(stream->ReadAs<uint32_t>());
+            for (RenderableSubmesh& submesh : m_submeshes)
+            {
+                stream->Read(&submesh.index_offset);
+                stream->Read(&submesh.index_count);
+                stream->Read(&submesh.bounding_box);
+                stream->Read(&submesh.entity_id);
+                stream->Read(&submesh.transform);
+            }
+        }
+
+        m_bounding_box_dirty = true;
     }
 
     void Renderable::SetGeometry(
@@ -127,6 +224,12 @@ namespace Spartan
         m_geometry_index_count       = index_count;
         m_geometry_vertex_offset     = vertex_offset;
         m_geometry_vertex_count      = vertex_count;
+        m_lods.clear();
+        m_lod                        = 0;
+        m_meshlets.clear();
+        m_occluder_vertices.clear();
+        m_occluder_indices.clear();
+        m_occluder_hull_built        = false;
 
         if (m_geometry_index_count == 0)
         {
@@ -170,19 +273,41 @@ namespace Spartan
             if (m_instances.empty())
             {
                 m_bounding_box_transformed = m_bounding_box.Transform(transform);
+
+                // bounding boxes of submeshes
+                m_bounding_box_submeshes.resize(m_submeshes.size());
+                for (uint32_t i = 0; i < static_cast<uint32_t>(m_submeshes.size()); i++)
+                {
+                    m_bounding_box_submeshes[i] = m_submeshes[i].bounding_box.Transform(transform);
+                }
             }
             else // transformed instances
             {
-                m_bounding_box_transformed = BoundingBox::Undefined;
                 m_bounding_box_instances.clear();
                 m_bounding_box_instances.reserve(m_instances.size());
                 m_bounding_box_instances.resize(m_instances.size());
-                for (uint32_t i = 0; i < static_cast<uint32_t>(m_instances.size()); i++)
-                {
-                    const Matrix& instance_transform = m_instances[i];
-                    m_bounding_box_instances[i]      = m_bounding_box.Transform(transform * instance_transform ); // 1. bounding box of the instance
-                    m_bounding_box_transformed.Merge(m_bounding_box_instances[i]);                                // 2. bounding box of all instances
-                }
+                m_bounding_box_transformed = ThreadPool::ParallelReduce<BoundingBox>(
+                    [this, &transform](uint32_t index_start, uint32_t index_end)
+                    {
+                        BoundingBox bounding_box = BoundingBox::Undefined;
+                        for (uint32_t i = index_start; i < index_end; i++)
+                        {
+                            const Matrix& instance_transform = m_instances[i];
+                            m_bounding_box_instances[i]      = m_bounding_box.Transform(transform * instance_transform); // 1. bounding box of the instance
+                            bounding_box.Merge(m_bounding_box_instances[i]);                                         // 2. bounding box of all instances
+                        }
+                        return bounding_box;
+                    },
+                    [](const BoundingBox& a, const BoundingBox& b)
+                    {
+                        BoundingBox merged = a;
+                        merged.Merge(b);
+                        return merged;
+                    },
+                    BoundingBox::Undefined,
+                    static_cast<uint32_t>(m_instances.size()),
+                    256
+                );
 
                 // 3. bounding boxes of instance groups
                 {
@@ -195,8 +320,7 @@ namespace Spartan
                         BoundingBox bounding_box_group = BoundingBox::Undefined;
                         for (uint32_t i = start_index; i < group_end_index; i++)
                         {
-                            BoundingBox bounding_box_instance = m_bounding_box.Transform(transform * m_instances[i]);
-                            bounding_box_group.Merge(bounding_box_instance);
+                            bounding_box_group.Merge(m_bounding_box_instances[i]);
                         }
 
                         m_bounding_box_instance_group.push_back(bounding_box_group);
@@ -226,6 +350,10 @@ namespace Spartan
         {
             return m_bounding_box_instance_group[index];
         }
+        else if (type == BoundingBoxType::TransformedSubmesh)
+        {
+            return m_bounding_box_submeshes[index];
+        }
 
         return BoundingBox::Undefined;
     }
@@ -286,6 +414,14 @@ namespace Spartan
         return m_mesh->GetVertexBuffer();
     }
 
+    RHI_Vertex_Type Renderable::GetVertexType() const
+    {
+        if (!m_mesh)
+            return RHI_Vertex_Type::PosUvNorTan;
+
+        return m_mesh->GetVertexType();
+    }
+
     const string& Renderable::GetMeshName() const
     {
         static string no_mesh = "N/A";
@@ -322,6 +458,76 @@ namespace Spartan
         m_bounding_box_dirty = true;
     }
 
+    void Renderable::SetLods(const vector<RenderableLod>& lods)
+    {
+        // every level has to be coarser than the one before it
+        for (uint32_t i = 0; i < static_cast<uint32_t>(lods.size()); i++)
+        {
+            SP_ASSERT(lods[i].index_count != 0);
+            SP_ASSERT(lods[i].index_count < (i == 0 ? m_geometry_index_count : lods[i - 1].index_count));
+        }
+
+        m_lods = lods;
+        m_lod  = 0;
+    }
+
+    void Renderable::SetMeshlets(const vector<Meshlet>& meshlets)
+    {
+        // the meshlets partition the geometry (not the lods), in order, so that visible neighbours can be drawn as one range
+        uint32_t index_offset = m_geometry_index_offset;
+        for (const Meshlet& meshlet : meshlets)
+        {
+            SP_ASSERT(meshlet.index_offset == index_offset);
+            index_offset += meshlet.index_count;
+        }
+        SP_ASSERT(meshlets.empty() || index_offset == m_geometry_index_offset + m_geometry_index_count);
+
+        m_meshlets = meshlets;
+        m_meshlet_ranges_visible.clear();
+    }
+
+    void Renderable::BuildOccluderHull()
+    {
+        m_occluder_hull_built = true;
+
+        // the cpu copy of the geometry is needed, meshes which were cleared after the upload can't occlude
+        if (!m_mesh ||
+            m_mesh->GetIndexCount()  < m_geometry_index_offset  + m_geometry_index_count ||
+            m_mesh->GetVertexCount() < m_geometry_vertex_offset + m_geometry_vertex_count)
+            return;
+
+        vector<uint32_t> indices;
+        vector<RHI_Vertex_PosTexNorTan> vertices;
+        GetGeometry(&indices, &vertices);
+        Mesh::ComputeOccluder(indices, vertices, &m_occluder_vertices, &m_occluder_indices);
+    }
+
+    void Renderable::SetSubmeshes(const vector<RenderableSubmesh>& submeshes)
+    {
+        // the submeshes have to lie within the geometry of the renderable, in order, so that visible neighbours can be drawn as one range
+        for (uint32_t i = 0; i < static_cast<uint32_t>(submeshes.size()); i++)
+        {
+            SP_ASSERT(submeshes[i].index_offset >= m_geometry_index_offset);
+            SP_ASSERT(submeshes[i].index_offset + submeshes[i].index_count <= m_geometry_index_offset + m_geometry_index_count);
+            SP_ASSERT(i == 0 || submeshes[i].index_offset == submeshes[i - 1].index_offset + submeshes[i - 1].index_count);
+        }
+
+        m_submeshes          = submeshes;
+        m_bounding_box_dirty = true;
+    }
+
+    void Renderable::SetStaticBatch(const uint64_t batch_id)
+    {
+        // the id lives on the entity, so that its transform updates can check it without looking up this component
+        GetEntity()->SetStaticBatch(batch_id);
+        SetFlag(RenderableFlags::StaticBatched, batch_id != 0);
+    }
+
+    uint64_t Renderable::GetStaticBatch() const
+    {
+        return GetEntity()->GetStaticBatch();
+    }
+
     void Renderable::SetFlag(const RenderableFlags flag, const bool enable /*= true*/)
     {
         bool enabled      = false;
@@ -39,14 +39,45 @@ namespace Spartan
         Transformed,              // includes all instances            - if there no instances it's just the mesh bounding box
         TransformedInstance,      // bounding box of an instance       - instance index is provided in GetBoundingBox()
         TransformedInstanceGroup, // bounding box of an instance group - instance group index is provided in GetBoundingBox()
+        TransformedSubmesh,       // bounding box of a submesh         - submesh index is provided in GetBoundingBox()
     };
 
     enum RenderableFlags : uint32_t
     {
-        OccludedCpu  = 1U << 0, // frustum culling
-        OccludedGpu  = 1U << 1, // occlusion culling (depth culling)
-        Occluder     = 1U << 2,
-        CastsShadows = 1U << 3
+        OccludedCpu    = 1U << 0, // frustum culling and software occlusion culling
+        OccludedGpu    = 1U << 1, // occlusion culling (depth culling)
+        Occluder       = 1U << 2, // rasterized into the software occlusion buffer this frame
+        CastsShadows   = 1U << 3,
+        DrawnIndirect  = 1U << 4, // culled and drawn by the gpu driven path, the cpu draw loops skip it
+        DrawnBatched   = 1U << 5, // folded into a dynamic instancing batch, the cpu draw loops skip it
+        StaticBatched  = 1U << 6, // merged into a static batch (see Mesh::BatchStatic()), it's kept for physics but never drawn
+        MeshletsCulled = 1U << 7  // the meshlets were culled against the camera this frame, only the visible ranges are drawn
+    };
+
+    // a coarser level of the geometry, it references the same vertices
+    struct RenderableLod
+    {
+        uint32_t index_offset = 0;
+        uint32_t index_count  = 0;
+        float error           = 0.0f; // relative to the extents of the geometry
+    };
+
+    // a contiguous range of indices
+    struct RenderableIndexRange
+    {
+        uint32_t index_offset = 0;
+        uint32_t index_count  = 0;
+    };
+
+    // a range of a static batch, it keeps the bounds of the renderable it came from so that the batch can still be culled per range
+    // and it remembers which entity that was and where, so that the batch can be dissolved once the entity moves or goes away
+    struct RenderableSubmesh
+    {
+        uint32_t index_offset          = 0;
+        uint32_t index_count           = 0;
+        Math::BoundingBox bounding_box = Math::BoundingBox::Undefined;
+        uint64_t entity_id             = 0;                      // 0 if it's not tracked
+        Math::Matrix transform         = Math::Matrix::Identity; // relative to the batch
     };
 
     class SP_CLASS Renderable : public Component
@@ -90,7 +121,13 @@ namespace Spartan
         // mesh
         RHI_Buffer* GetIndexBuffer() const;
         RHI_Buffer* GetVertexBuffer() const;
+        RHI_Vertex_Type GetVertexType() const;
         const std::string& GetMeshName() const;
+        Mesh* GetMesh() const { return m_mesh; }
+
+        // where the mesh starts in the geometry buffer, the offsets of lods, meshlets and submeshes are relative to it
+        uint32_t GetMeshIndexOffset() const  { return m_mesh ? m_mesh->GetIndexBufferOffset()  : 0; }
+        uint32_t GetMeshVertexOffset() const { return m_mesh ? m_mesh->GetVertexBufferOffset() : 0; }
 
         // instancing
         bool HasInstancing() const                              { return !m_instances.empty(); }
@@ -99,10 +136,41 @@ namespace Spartan
         uint32_t GetInstanceCount()  const                      { return static_cast<uint32_t>(m_instances.size()); }
         void SetInstances(const std::vector<Math::Matrix>& instances);
 
-        // misc
-        uint32_t GetIndexOffset() const  { return m_geometry_index_offset; }
+        // lods, level 0 is the geometry itself
+        void SetLods(const std::vector<RenderableLod>& lods);
+        uint32_t GetLodCount() const                         { return static_cast<uint32_t>(m_lods.size()) + 1; }
+        uint32_t GetLodIndexOffset(const uint32_t lod) const { return GetMeshIndexOffset() + (lod == 0 ? m_geometry_index_offset : m_lods[lod - 1].index_offset); }
+        uint32_t GetLodIndexCount(const uint32_t lod) const  { return lod == 0 ? m_geometry_index_count  : m_lods[lod - 1].index_count; }
+        float GetLodError(const uint32_t lod) const          { return lod == 0 ? 0.0f : m_lods[lod - 1].error; }
+        uint32_t GetLod() const                              { return m_lod; }
+        void SetLod(const uint32_t lod)                      { m_lod = Math::Helper::Min(lod, GetLodCount() - 1); }
+
+        // meshlets, the culling pass writes the visible ranges every frame
+        void SetMeshlets(const std::vector<Meshlet>& meshlets);
+        bool HasMeshlets() const                                     { return !m_meshlets.empty(); }
+        const std::vector<Meshlet>& GetMeshlets() const              { return m_meshlets; }
+        std::vector<RenderableIndexRange>& GetMeshletRangesVisible() { return m_meshlet_ranges_visible; }
+
+        // occluder hull, built on demand since only the renderables which end up covering a lot of the screen ever need one
+        void BuildOccluderHull();
+        bool IsOccluderHullBuilt() const                              { return m_occluder_hull_built; }
+        bool HasOccluderHull() const                                  { return !m_occluder_indices.empty(); }
+        const std::vector<Math::Vector3>& GetOccluderVertices() const { return m_occluder_vertices; }
+        const std::vector<uint32_t>& GetOccluderIndices() const       { return m_occluder_indices; }
+
+        // submeshes
+        bool HasSubmeshes() const                                  { return !m_submeshes.empty(); }
+        const std::vector<RenderableSubmesh>& GetSubmeshes() const { return m_submeshes; }
+        void SetSubmeshes(const std::vector<RenderableSubmesh>& submeshes);
+
+        // static batching, a member is drawn by its batch and tells the world when it changes (see Mesh::BatchStatic())
+        void SetStaticBatch(const uint64_t batch_id);
+        uint64_t GetStaticBatch() const;
+
+        // misc, the offsets are in the geometry buffer
+        uint32_t GetIndexOffset() const  { return GetMeshIndexOffset() + m_geometry_index_offset; }
         uint32_t GetIndexCount() const   { return m_geometry_index_count; }
-        uint32_t GetVertexOffset() const { return m_geometry_vertex_offset; }
+        uint32_t GetVertexOffset() const { return GetMeshVertexOffset() + m_geometry_vertex_offset; }
         uint32_t GetVertexCount() const  { return m_geometry_vertex_count; }
         bool HasMesh() const             { return m_mesh != nullptr; }
 
@@ -133,6 +201,23 @@ namespace Spartan
         std::vector<uint32_t> m_instance_group_end_indices;
         std::shared_ptr<RHI_Buffer> m_instance_buffer;
 
+        // lods
+        std::vector<RenderableLod> m_lods;
+        uint32_t m_lod = 0;
+
+        // meshlets
+        std::vector<Meshlet> m_meshlets;
+        std::vector<RenderableIndexRange> m_meshlet_ranges_visible;
+
+        // occluder hull
+        std::vector<Math::Vector3> m_occluder_vertices;
+        std::vector<uint32_t> m_occluder_indices;
+        bool m_occluder_hull_built = false;
+
+        // submeshes
+        std::vector<RenderableSubmesh> m_submeshes;
+        std::vector<Math::BoundingBox> m_bounding_box_submeshes;
+
         // misc
         Math::Matrix m_transform_previous = Math::Matrix::Identity;
         uint32_t m_flags                  = RenderableFlags::CastsShadows;
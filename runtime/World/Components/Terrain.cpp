@@ -159,16 +159,23 @@ namespace Spartan
                 // calculate offsets to center the terrain
                 float offset_x   = -static_cast<float>(width) * 0.5f;
                 float offset_z   = -static_cast<float>(height) * 0.5f;
-                float min_height = FLT_MAX;
 
                 // find the minimum height to align the lower part of the terrain at y = 0
-                for (const Vector3& pos : positions)
-                {
-                    if (pos.y < min_height)
+                float min_height = ThreadPool::ParallelReduce<float>(
+                    [&positions](uint32_t index_start, uint32_t index_end)
                     {
-                        min_height = pos.y;
-                    }
-                }
+                        float min_height = FLT_MAX;
+                        for (uint32_t i = index_start; i < index_end; i++)
+                        {
+                            min_height = min(min_height, positions[i].y);
+                        }
+                        return min_height;
+                    },
+                    [](const float& a, const float& b) { return min(a, b); },
+                    FLT_MAX,
+                    static_cast<uint32_t>(positions.size()),
+                    4096
+                );
 
                 offset = Vector3(offset_x, -min_height, offset_z);
             }
@@ -299,7 +306,7 @@ namespace Spartan
             };
 
             uint32_t vertex_count = static_cast<uint32_t>(vertices.size());
-            ThreadPool::ParallelLoop(compute_vertex_normals_tangents, vertex_count);
+            ThreadPool::ParallelLoop(compute_vertex_normals_tangents, vertex_count, 1024);
         }
 
         float get_random_float(float x, float y)
@@ -376,23 +383,35 @@ namespace Spartan
             const vector<RHI_Vertex_PosTexNorTan>& vertices, const vector<uint32_t>& indices,
             vector<vector<RHI_Vertex_PosTexNorTan>>& tiled_vertices, vector<vector<uint32_t>>& tiled_indices)
         {
-            // initialize min and max values for terrain bounds
-            float min_x = numeric_limits<float>::max();
-            float max_x = numeric_limits<float>::lowest();
-            float min_z = numeric_limits<float>::max();
-            float max_z = numeric_limits<float>::lowest();
-
-            // iterate over all vertices to find the minimum and maximum x and z values
-            for (const RHI_Vertex_PosTexNorTan& vertex : vertices)
-            {
-                // compare and store the minimum and maximum x coordinates
-                if (vertex.pos[0] < min_x) min_x = vertex.pos[0];
-                if (vertex.pos[0] > max_x) max_x = vertex.pos[0];
+            // find the minimum and maximum x and z values (stored as x and y) across all vertices
+            Vector4 bounds = ThreadPool::ParallelReduce<Vector4>(
+                [&vertices](uint32_t index_start, uint32_t index_end)
+                {
+                    Vector4 bounds = Vector4(numeric_limits<float>::max(), numeric_limits<float>::max(), numeric_limits<float>::lowest(), numeric_limits<float>::lowest());
+                    for (uint32_t i = index_start; i < index_end; i++)
+                    {
+                        const RHI_Vertex_PosTexNorTan& vertex = vertices[i];
 
-                // compare and store the minimum and maximum z coordinates
-                if (vertex.pos[2] < min_z) min_z = vertex.pos[2];
-                if (vertex.pos[2] > max_z) max_z = vertex.pos[2];
-            }
+                        bounds.x = min(bounds.x, vertex.pos[0]);
+                        bounds.y = min(bounds.y, vertex.pos[2]);
+                        bounds.z = max(bounds.z, vertex.pos[0]);
+                        bounds.w = max(bounds.w, vertex.pos[2]);
+                    }
+                    return bounds;
+                },
+                [](const Vector4& a, const Vector4& b)
+                {
+                    return Vector4(min(a.x, b.x), min(a.y, b.y), max(a.z, b.z), max(a.w, b.w));
+                },
+                Vector4(numeric_limits<float>::max(), numeric_limits<float>::max(), numeric_limits<float>::lowest(), numeric_limits<float>::lowest()),
+                static_cast<uint32_t>(vertices.size()),
+                4096
+            );
+
+            float min_x = bounds.x;
+            float min_z = bounds.y;
+            float max_x = bounds.z;
+            float max_z = bounds.w;
 
             // calculate dimensions
             float terrain_width = max_x - min_x;
@@ -29,6 +29,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Components/AudioSource.h"
 #include "Components/AudioListener.h"
 #include "Components/Terrain.h"
+#include "Components/Renderable.h"
 #include "../IO/FileStream.h"
 #include "../Rendering/Renderer.h"
 //===================================
@@ -42,6 +43,16 @@ namespace Spartan
 {
     namespace
     {
+        // lets the world know that a member of a static batch changed (see Mesh::BatchStatic())
+        void notify_static_batch(Entity* entity)
+        {
+            const uint64_t batch_id = entity->GetStaticBatch();
+            if (batch_id != 0)
+            {
+                World::SetStaticBatchDirty(batch_id);
+            }
+        }
+
         // input is an entity, output is a clone of that entity (descendant entities are not cloned)
         shared_ptr<Entity> clone_entity(Entity* entity)
         {
@@ -96,11 +107,21 @@ namespace Spartan
 
     Entity::~Entity()
     {
+        // components can outlive their entity (when something else holds on to them), so make sure they stop ticking
+        for (shared_ptr<Component>& component : m_components)
+        {
+            if (component)
+            {
+                ComponentStore::Unregister(component.get());
+            }
+        }
+
         m_components.fill(nullptr);
     }
 
     void Entity::Initialize()
     {
+        lock_guard<mutex> lock(m_mutex_transform);
         UpdateTransform();
     }
 
@@ -131,18 +152,23 @@ namespace Spartan
         }
     }
 
-    void Entity::Tick()
+    void Entity::SetInWorld(const bool in_world)
     {
-        if (!m_is_active)
+        if (m_in_world.exchange(in_world) == in_world)
             return;
 
-        m_time_since_last_transform_sec += static_cast<float>(Timer::GetDeltaTimeSec());
-
         for (shared_ptr<Component>& component : m_components)
         {
-            if (component)
+            if (!component)
+                continue;
+
+            if (in_world)
+            {
+                ComponentStore::Register(component.get());
+            }
+            else
             {
-                component->OnTick();
+                ComponentStore::Unregister(component.get());
             }
         }
     }
@@ -229,7 +255,7 @@ namespace Spartan
                 }
             }
 
-            UpdateTransform();
+            MarkTransformDirty(true);
         }
 
         // COMPONENTS
@@ -335,6 +361,7 @@ namespace Spartan
                 if (id == component->GetObjectId())
                 {
                     component->OnRemove();
+                    ComponentStore::Unregister(component.get());
                     component = nullptr;
                     break;
                 }
@@ -349,36 +376,78 @@ namespace Spartan
         // compute local transform
         m_matrix_local = Matrix(m_position_local, m_rotation_local, m_scale_local);
 
-        // compute world transform
-        if (!m_parent.expired())
+        // compute world transform (reading the parent's matrix resolves the parent first, if needed)
+        if (shared_ptr<Entity> parent = m_parent.lock())
         {
-            m_matrix = m_matrix_local * m_parent.lock()->GetMatrix();
+            m_matrix = m_matrix_local * parent->GetMatrix();
         }
         else
         {
             m_matrix = m_matrix_local;
         }
 
-        // update children
-        for (Entity* child : m_children)
-        {
-            child->UpdateTransform();
-        }
+        // decompose once, so that the getters are just loads
+        m_matrix.Decompose(m_scale, m_rotation, m_position);
 
         // update directions
         {
             // z
-            m_forward  = GetRotation() * Vector3::Forward;
+            m_forward  = m_rotation * Vector3::Forward;
             m_backward = -m_forward;
             // y
-            m_up       = GetRotation() * Vector3::Up;
+            m_up       = m_rotation * Vector3::Up;
             m_down     = -m_up;
             // x
-            m_right    = GetRotation() * Vector3::Right;
+            m_right    = m_rotation * Vector3::Right;
             m_left     = -m_right;
         }
 
-        m_time_since_last_transform_sec = 0.0f;
+        m_time_last_transform_sec = Timer::GetTimeSec();
+        m_transform_dirty.store(false, memory_order_release);
+
+        // the batch which draws this entity has to check whether it still can
+        notify_static_batch(this);
+    }
+
+    void Entity::SetActive(const bool active)
+    {
+        if (m_is_active == active)
+            return;
+
+        m_is_active = active;
+
+        // static batches of the entity and its descendants have to check whether they can still draw them
+        vector<Entity*> entities = { this };
+        GetDescendants(&entities);
+        for (Entity* entity : entities)
+        {
+            notify_static_batch(entity);
+        }
+    }
+
+    void Entity::ResolveTransformLocked()
+    {
+        lock_guard<mutex> lock(m_mutex_transform);
+
+        // another thread might have resolved it while this one was waiting
+        if (!m_transform_dirty.load(memory_order_relaxed))
+            return;
+
+        UpdateTransform();
+    }
+
+    void Entity::MarkTransformDirty(const bool force)
+    {
+        // descendants of a dirty entity are always dirty, so there is no need to go any deeper
+        if (m_transform_dirty && !force)
+            return;
+
+        m_transform_dirty.store(true, memory_order_release);
+
+        for (Entity* child : m_children)
+        {
+            child->MarkTransformDirty();
+        }
     }
 
     void Entity::SetPosition(const Vector3& position)
@@ -395,7 +464,7 @@ namespace Spartan
             return;
 
         m_position_local = position;
-        UpdateTransform();
+        MarkTransformDirty();
     }
 
     void Entity::SetRotation(const Quaternion& rotation)
@@ -412,7 +481,7 @@ namespace Spartan
             return;
 
         m_rotation_local = rotation;
-        UpdateTransform();
+        MarkTransformDirty();
     }
 
     void Entity::SetScale(const Vector3& scale)
@@ -435,7 +504,7 @@ namespace Spartan
         m_scale_local.y = (m_scale_local.y == 0.0f) ? Helper::SMALL_FLOAT : m_scale_local.y;
         m_scale_local.z = (m_scale_local.z == 0.0f) ? Helper::SMALL_FLOAT : m_scale_local.z;
 
-        UpdateTransform();
+        MarkTransformDirty();
     }
 
     void Entity::Translate(const Vector3& delta)
@@ -503,8 +572,8 @@ namespace Spartan
             {
                 for (Entity* child : m_children)
                 {
-                    child->m_parent = m_parent; // directly setting parent
-                    child->UpdateTransform();   // update transform if needed
+                    child->m_parent = m_parent;       // directly setting parent
+                    child->MarkTransformDirty(true); // update transform if needed
                 }
         
                 m_children.clear();
@@ -524,12 +593,11 @@ namespace Spartan
             new_parent->AddChild(this);
         }
 
-        if ((parent && !new_parent) || (!parent && new_parent))
-        {
-            UpdateTransform();
-        }
-
         m_parent = new_parent_in;
+
+        // the new parent may have a different transform (and be dirty itself), so force this subtree to resolve again
+        MarkTransformDirty(true);
+        World::SetTransformHierarchyDirty();
     }
 
     void Entity::AddChild(Entity* child)
@@ -545,6 +613,7 @@ namespace Spartan
         if (!(find(m_children.begin(), m_children.end(), child) != m_children.end()))
         {
             m_children.emplace_back(child);
+            World::SetTransformHierarchyDirty();
         }
     }
 
@@ -560,6 +629,7 @@ namespace Spartan
 
         // remove the child
         m_children.erase(remove_if(m_children.begin(), m_children.end(), [child](Entity* vec_transform) { return vec_transform->GetObjectId() == child->GetObjectId(); }), m_children.end());
+        World::SetTransformHierarchyDirty();
 
         // remove the child's parent
         if (update_child_with_null_parent)
@@ -576,6 +646,7 @@ namespace Spartan
         lock_guard lock(m_mutex_children);
         m_children.clear();
         m_children.shrink_to_fit();
+        World::SetTransformHierarchyDirty();
 
         const unordered_map<uint64_t, shared_ptr<Entity>>& entities = World::GetAllEntities();
         for (auto it : entities)
@@ -589,6 +660,7 @@ namespace Spartan
             {
                 // welcome home son
                 m_children.emplace_back(possible_child.get());
+                possible_child->MarkTransformDirty(true);
 
                 // make the child do the same thing all over, essentially resolving the entire hierarchy
                 possible_child->AcquireChildren();
@@ -645,7 +717,7 @@ namespace Spartan
     bool Entity::IsMoving() const
     {
         // an entity very rarely moves only for one frame, so we consider it moving if it has moved in the last 2 seconds
-        return m_time_since_last_transform_sec <= 2.0f;
+        return Timer::GetTimeSec() - m_time_last_transform_sec <= 2.0;
     }
 
     Matrix Entity::GetParentTransformMatrix() const
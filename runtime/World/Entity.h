@@ -26,6 +26,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <array>
 #include <mutex>
 #include "World.h"
+#include "ComponentStore.h"
 #include "Components/Component.h"
 #include "../Math/Quaternion.h"
 #include "../Math/Matrix.h"
@@ -48,7 +49,11 @@ namespace Spartan
         // core
         void OnStart(); // runs once, before the simulation ends
         void OnStop();  // runs once, after the simulation ends
-        void Tick();    // runs every frame
+
+        // the world adds the entity's components to the component store (and therefore to ticking and World::ForEach)
+        // when the entity enters it, and takes them out when the entity leaves it
+        void SetInWorld(const bool in_world);
+        bool IsInWorld() const { return m_in_world; }
 
         // io
         void Serialize(FileStream* stream);
@@ -56,7 +61,12 @@ namespace Spartan
 
         // active
         bool IsActive() const;
-        void SetActive(const bool active) { m_is_active = active; }
+        bool IsActiveSelf() const         { return m_is_active; } // ignores the parents
+        void SetActive(const bool active);
+
+        // the static batch which draws this entity, 0 if none (see Renderable::SetStaticBatch())
+        void SetStaticBatch(const uint64_t batch_id) { m_static_batch_id.store(batch_id, std::memory_order_relaxed); }
+        uint64_t GetStaticBatch() const              { return m_static_batch_id.load(std::memory_order_relaxed); }
 
         // adds a component of type T
         template <class T>
@@ -68,15 +78,19 @@ namespace Spartan
             if (std::shared_ptr<T> component = GetComponent<T>())
                 return component;
 
-            // create a new component
-            std::shared_ptr<T> component = std::make_shared<T>(this);
+            // create a new component, the pool keeps components of the same type close together in memory
+            std::shared_ptr<T> component = std::allocate_shared<T>(ComponentPoolAllocator<T>(), this);
 
             // save new component
             m_components[static_cast<uint32_t>(type)] = std::static_pointer_cast<Component>(component);
 
-            // initialize component
+            // initialize component, it's only visible to the store (and therefore World::ForEach) once initialized
             component->SetType(type);
             component->OnInitialize();
+            if (m_in_world)
+            {
+                ComponentStore::Register(component.get());
+            }
 
             World::Resolve();
 
@@ -94,12 +108,25 @@ namespace Spartan
             return std::static_pointer_cast<T>(m_components[static_cast<uint32_t>(component_type)]);
         }
 
+        // returns a component of type T without touching the reference count, use this in hot loops
+        template <class T>
+        T* GetComponentRaw() const
+        {
+            const ComponentType component_type = Component::TypeToEnum<T>();
+            return static_cast<T*>(m_components[static_cast<uint32_t>(component_type)].get());
+        }
+
         // removes a component
         template <class T>
         void RemoveComponent()
         {
             const ComponentType component_type = Component::TypeToEnum<T>();
-            m_components[static_cast<uint32_t>(component_type)] = nullptr;
+            std::shared_ptr<Component>& component = m_components[static_cast<uint32_t>(component_type)];
+            if (component)
+            {
+                ComponentStore::Unregister(component.get());
+                component = nullptr;
+            }
 
             World::Resolve();
         }
@@ -108,21 +135,21 @@ namespace Spartan
         const auto& GetAllComponents() const { return m_components; }
 
         //= POSITION ======================================================================
-        Math::Vector3 GetPosition()             const { return m_matrix.GetTranslation(); }
+        Math::Vector3 GetPosition()             const { ResolveTransform(); return m_position; }
         const Math::Vector3& GetPositionLocal() const { return m_position_local; }
         void SetPosition(const Math::Vector3& position);
         void SetPositionLocal(const Math::Vector3& position);
         //=================================================================================
 
         //= ROTATION ======================================================================
-        Math::Quaternion GetRotation()             const { return m_matrix.GetRotation(); }
+        Math::Quaternion GetRotation()             const { ResolveTransform(); return m_rotation; }
         const Math::Quaternion& GetRotationLocal() const { return m_rotation_local; }
         void SetRotation(const Math::Quaternion& rotation);
         void SetRotationLocal(const Math::Quaternion& rotation);
         //=================================================================================
 
         //= SCALE ================================================================
-        Math::Vector3 GetScale()             const { return m_matrix.GetScale(); }
+        Math::Vector3 GetScale()             const { ResolveTransform(); return m_scale; }
         const Math::Vector3& GetScaleLocal() const { return m_scale_local; }
         void SetScale(const Math::Vector3& scale);
         void SetScaleLocal(const Math::Vector3& scale);
@@ -133,14 +160,14 @@ namespace Spartan
         void Rotate(const Math::Quaternion& delta);
         //=========================================
 
-        //= DIRECTIONS ================================================
-        const Math::Vector3& GetUp() const       { return m_up; }
-        const Math::Vector3& GetDown() const     { return m_down; }
-        const Math::Vector3& GetForward() const  { return m_forward; }
-        const Math::Vector3& GetBackward() const { return m_backward; }
-        const Math::Vector3& GetRight() const    { return m_right; }
-        const Math::Vector3& GetLeft() const     { return m_left; }
-        //=============================================================
+        //= DIRECTIONS ===================================================================
+        Math::Vector3 GetUp() const       { ResolveTransform(); return m_up; }
+        Math::Vector3 GetDown() const     { ResolveTransform(); return m_down; }
+        Math::Vector3 GetForward() const  { ResolveTransform(); return m_forward; }
+        Math::Vector3 GetBackward() const { ResolveTransform(); return m_backward; }
+        Math::Vector3 GetRight() const    { ResolveTransform(); return m_right; }
+        Math::Vector3 GetLeft() const     { ResolveTransform(); return m_left; }
+        //================================================================================
 
         //= HIERARCHY ===================================================================================
         void SetParent(std::weak_ptr<Entity> new_parent);
@@ -160,17 +187,29 @@ namespace Spartan
         std::vector<Entity*>& GetChildren()       { return m_children; }
         //===============================================================================================
 
-        const Math::Matrix& GetMatrix() const              { return m_matrix; }
-        const Math::Matrix& GetLocalMatrix() const         { return m_matrix_local; }
+        Math::Matrix GetMatrix() const                     { ResolveTransform(); return m_matrix; }
+        Math::Matrix GetLocalMatrix() const                { ResolveTransform(); return m_matrix_local; }
         const Math::Matrix& GetMatrixPrevious() const      { return m_matrix_previous; }
         void SetMatrixPrevious(const Math::Matrix& matrix) { m_matrix_previous = matrix; }
         bool IsMoving() const;
 
+        // transform changes only mark the entity (and its descendants) as dirty, the world transform is computed
+        // the first time it's read or, for everything else, during the world's once per frame resolve
+        // reads can come from many threads at once (culling, recording), so the lazy computation happens under a per-entity lock,
+        // and the world transform is returned by value, a reference would be rewritten under the reader by the next resolve,
+        // setters are not thread safe, the task graph keeps them (the stages that write Transforms) apart from the readers
+        void ResolveTransform() const { if (m_transform_dirty.load(std::memory_order_acquire)) const_cast<Entity*>(this)->ResolveTransformLocked(); }
+        bool IsTransformDirty() const { return m_transform_dirty.load(std::memory_order_acquire); }
+
     private:
-        std::atomic<bool> m_is_active = true;
+        std::atomic<bool> m_is_active           = true;
+        std::atomic<bool> m_in_world            = false;
+        std::atomic<uint64_t> m_static_batch_id = 0;
         std::array<std::shared_ptr<Component>, 13> m_components;
 
         void UpdateTransform();
+        void ResolveTransformLocked();
+        void MarkTransformDirty(bool force = false);
         Math::Matrix GetParentTransformMatrix() const;
 
         // local
@@ -178,11 +217,15 @@ namespace Spartan
         Math::Quaternion m_rotation_local = Math::Quaternion::Identity;
         Math::Vector3 m_scale_local       = Math::Vector3::One;
 
-        Math::Matrix m_matrix          = Math::Matrix::Identity;
-        Math::Matrix m_matrix_previous = Math::Matrix::Identity;
-        Math::Matrix m_matrix_local    = Math::Matrix::Identity;
+        Math::Matrix m_matrix               = Math::Matrix::Identity;
+        Math::Matrix m_matrix_previous      = Math::Matrix::Identity;
+        Math::Matrix m_matrix_local         = Math::Matrix::Identity;
+        std::atomic<bool> m_transform_dirty = true;
 
         // computed during UpdateTransform() and cached for performance
+        Math::Vector3 m_position    = Math::Vector3::Zero;
+        Math::Quaternion m_rotation = Math::Quaternion::Identity;
+        Math::Vector3 m_scale       = Math::Vector3::One;
         Math::Vector3 m_forward  = Math::Vector3::Zero;
         Math::Vector3 m_backward = Math::Vector3::Zero;
         Math::Vector3 m_up       = Math::Vector3::Zero;
@@ -196,6 +239,7 @@ namespace Spartan
         // misc
         std::mutex m_mutex_children;
         std::mutex m_mutex_parent;
-        float m_time_since_last_transform_sec = 0.0f;
+        std::mutex m_mutex_transform;
+        double m_time_last_transform_sec = 0.0;
     };
 }
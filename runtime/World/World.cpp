@@ -30,6 +30,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Components/AudioSource.h"
 #include "Components/PhysicsBody.h"
 #include "Components/Terrain.h"
+#include "Components/Renderable.h"
 #include "../Resource/ResourceCache.h"
 #include "../IO/FileStream.h"
 #include "../Profiling/Profiler.h"
@@ -54,6 +55,206 @@ namespace Spartan
         bool resolve            = false;
         bool was_in_editor_mode = false;
 
+        // flattened transform hierarchy, every root's subtree is contiguous and parents come before their children
+        vector<Entity*> transform_order;
+        vector<uint32_t> transform_subtree_offsets; // where each root's subtree starts, plus the end
+        atomic<bool> transform_hierarchy_dirty = true;
+
+        // static batches (see Mesh::BatchStatic()) whose members reported a change, they are checked on the next tick
+        mutex static_batches_dirty_mutex;
+        unordered_set<uint64_t> static_batches_dirty;
+
+        void flatten_subtree(Entity* entity)
+        {
+            transform_order.emplace_back(entity);
+
+            for (Entity* child : entity->GetChildren())
+            {
+                flatten_subtree(child);
+            }
+        }
+
+        void resolve_transforms()
+        {
+            // the loading thread parents entities (which grows the child lists) without the entity access mutex,
+            // so the hierarchy is only walked once it's done, until then the transforms resolve lazily when read
+            if (ProgressTracker::IsLoading())
+                return;
+
+            if (transform_hierarchy_dirty.exchange(false))
+            {
+                transform_order.clear();
+                transform_subtree_offsets.clear();
+
+                for (auto& it : entities)
+                {
+                    if (!it.second->HasParent())
+                    {
+                        transform_subtree_offsets.emplace_back(static_cast<uint32_t>(transform_order.size()));
+                        flatten_subtree(it.second.get());
+                    }
+                }
+
+                transform_subtree_offsets.emplace_back(static_cast<uint32_t>(transform_order.size()));
+            }
+
+            // subtrees are independent of each other, so they can be resolved in parallel
+            // within a subtree, parents are visited first so each entity is computed exactly once
+            const uint32_t subtree_count = static_cast<uint32_t>(transform_subtree_offsets.size()) - 1;
+            ThreadPool::ParallelLoop([](uint32_t subtree_start, uint32_t subtree_end)
+            {
+                for (uint32_t i = transform_subtree_offsets[subtree_start]; i < transform_subtree_offsets[subtree_end]; i++)
+                {
+                    transform_order[i]->ResolveTransform();
+                }
+            }, subtree_count, 32);
+        }
+
+        // expects entity_access_mutex to be held
+        void remove_entity(Entity* entity_to_remove)
+        {
+            // Remove the entity and all of its children
+            {
+                // Get the root entity and its descendants
+                std::vector<Entity*> entities_to_remove;
+                entities_to_remove.push_back(entity_to_remove);        // Add the root entity
+                entity_to_remove->GetDescendants(&entities_to_remove); // Get descendants 
+
+                // Create a set containing the object IDs of entities to remove
+                std::set<uint64_t> ids_to_remove;
+                for (Entity* entity : entities_to_remove) {
+                    ids_to_remove.insert(entity->GetObjectId());
+                    entity->SetInWorld(false); // something else might still hold on to it, but it no longer ticks
+                }
+
+                // a removed member breaks its batch, a removed batch hands the members which stay back to the renderer
+                for (Entity* entity : entities_to_remove)
+                {
+                    Renderable* renderable = entity->GetComponentRaw<Renderable>();
+                    if (!renderable)
+                        continue;
+
+                    if (renderable->GetStaticBatch() != 0)
+                    {
+                        World::SetStaticBatchDirty(renderable->GetStaticBatch());
+                    }
+
+                    for (const RenderableSubmesh& submesh : renderable->GetSubmeshes())
+                    {
+                        auto it = entities.find(submesh.entity_id);
+                        if (it == entities.end() || ids_to_remove.count(submesh.entity_id) > 0)
+                            continue;
+
+                        if (Renderable* renderable_member = it->second->GetComponentRaw<Renderable>())
+                        {
+                            renderable_member->SetStaticBatch(0);
+                        }
+                    }
+                }
+
+                // Remove entities using a single loop
+                for (auto it = entities.begin(); it != entities.end(); )
+                {
+                    if (ids_to_remove.count(it->first) > 0)
+                    {
+                        it = entities.erase(it);
+                        transform_hierarchy_dirty = true;
+                    }
+                    else
+                    {
+                        ++it;
+                    }
+                }
+
+                // If there was a parent, update it
+                if (std::shared_ptr<Entity> parent = entity_to_remove->GetParent())
+                {
+                    parent->AcquireChildren();
+                }
+            }
+
+            resolve = true;
+        }
+
+        // a static batch draws its members in their place (see Mesh::BatchStatic()), so once one of them is removed, deactivated or moved,
+        // the batch is dissolved and the remaining members are drawn individually again, only the batches whose members reported a change are checked
+        void validate_static_batches()
+        {
+            unordered_set<uint64_t> batch_ids;
+            {
+                lock_guard<mutex> lock(static_batches_dirty_mutex);
+                batch_ids.swap(static_batches_dirty);
+            }
+
+            auto is_same_transform = [](const Matrix& a, const Matrix& b)
+            {
+                for (uint32_t i = 0; i < 16; i++)
+                {
+                    if (!Helper::Equals(a.Data()[i], b.Data()[i], 0.0001f))
+                        return false;
+                }
+
+                return true;
+            };
+
+            for (const uint64_t batch_id : batch_ids)
+            {
+                auto it_batch = entities.find(batch_id);
+                if (it_batch == entities.end())
+                    continue;
+
+                // an inactive batch (usually along with its members) is checked again once it's reactivated
+                shared_ptr<Entity> batch = it_batch->second;
+                Renderable* renderable   = batch->GetComponentRaw<Renderable>();
+                if (!renderable || !batch->IsActive())
+                    continue;
+
+                const Matrix batch_inverse = batch->GetMatrix().Inverted();
+                bool is_stale              = false;
+                for (const RenderableSubmesh& submesh : renderable->GetSubmeshes())
+                {
+                    if (submesh.entity_id == 0)
+                        continue;
+
+                    auto it = entities.find(submesh.entity_id);
+                    if (it == entities.end() || !it->second->IsActive() || !is_same_transform(it->second->GetMatrix() * batch_inverse, submesh.transform))
+                    {
+                        is_stale = true;
+                        break;
+                    }
+                }
+
+                if (is_stale)
+                {
+                    SP_LOG_INFO("Dissolving static batch \"%s\" since one of its members changed", batch->GetObjectName().c_str());
+                    remove_entity(batch.get());
+                }
+            }
+        }
+
+        // the members of static batches which were loaded from a file learn which batch draws them
+        void link_static_batches()
+        {
+            for (auto& [id, entity] : entities)
+            {
+                Renderable* renderable = entity->GetComponentRaw<Renderable>();
+                if (!renderable)
+                    continue;
+
+                for (const RenderableSubmesh& submesh : renderable->GetSubmeshes())
+                {
+                    auto it = entities.find(submesh.entity_id);
+                    if (it == entities.end())
+                        continue;
+
+                    if (Renderable* renderable_member = it->second->GetComponentRaw<Renderable>())
+                    {
+                        renderable_member->SetStaticBatch(id);
+                    }
+                }
+            }
+        }
+
         // default worlds resources
         shared_ptr<Entity> m_default_terrain             = nullptr;
         shared_ptr<Entity> m_default_physics_body_camera = nullptr;
@@ -176,7 +377,7 @@ namespace Spartan
             // start
             if (started)
             {
-                for (auto it : entities)
+                for (auto& it : entities)
                 {
                     it.second->OnStart();
                 }
@@ -185,19 +386,43 @@ namespace Spartan
             // stop
             if (stopped)
             {
-                for (auto it : entities)
+                for (auto& it : entities)
                 {
                     it.second->OnStop();
                 }
             }
 
-            // tick
-            for (auto it : entities)
+            // tick components, one type at a time, straight from the dense arrays of the component store
+            // the store only holds components of entities in the world, so this visits the same set as walking the entities,
+            // and within an entity the types still tick in enum order, only the interleaving across entities differs, which the
+            // entity map never defined in the first place
             {
-                it.second->Tick();
+                ComponentStore::BeginIteration();
+
+                for (uint32_t type = 0; type < static_cast<uint32_t>(ComponentType::Max); type++)
+                {
+                    // a component is free to remove itself (or others) while ticking, which leaves a null behind (see BeginIteration()),
+                    // components added while ticking start ticking next frame, and the index is re-read since adding can reallocate the array
+                    const vector<Component*>& components = ComponentStore::GetComponents(static_cast<ComponentType>(type));
+                    const size_t count                   = components.size();
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        Component* component = components[i];
+                        if (component && component->GetEntity()->IsActiveSelf())
+                        {
+                            component->OnTick();
+                        }
+                    }
+                }
+
+                ComponentStore::EndIteration();
             }
         }
 
+        // resolve whatever transforms are still dirty after the components had their say
+        resolve_transforms();
+        validate_static_batches();
+
         // notify renderer
         if (resolve && !ProgressTracker::IsLoading())
         {
@@ -316,6 +541,11 @@ namespace Spartan
             ProgressTracker::GetProgress(ProgressType::World).JobDone();
         }
 
+        {
+            lock_guard<mutex> lock(entity_access_mutex);
+            link_static_batches();
+        }
+
         // report time
         SP_LOG_INFO("World \"%s\" has been loaded. Duration %.2f ms", file_path.c_str(), timer.GetElapsedTimeMs());
 
@@ -355,13 +585,26 @@ namespace Spartan
         resolve = true;
     }
 
+    void World::SetTransformHierarchyDirty()
+    {
+        transform_hierarchy_dirty = true;
+    }
+
+    void World::SetStaticBatchDirty(const uint64_t batch_id)
+    {
+        lock_guard<mutex> lock(static_batches_dirty_mutex);
+        static_batches_dirty.insert(batch_id);
+    }
+
     shared_ptr<Entity> World::CreateEntity()
     {
         lock_guard lock(entity_access_mutex);
 
         shared_ptr<Entity> entity = make_shared<Entity>();
         entity->Initialize();
+        entity->SetInWorld(true);
         entities[entity->GetObjectId()] = entity;
+        transform_hierarchy_dirty       = true;
 
         return entity;
     }
@@ -377,41 +620,7 @@ namespace Spartan
         SP_ASSERT_MSG(entity_to_remove != nullptr, "Entity is null");
 
         lock_guard<mutex> lock(entity_access_mutex);
-
-        // Remove the entity and all of its children
-        {
-            // Get the root entity and its descendants
-            std::vector<Entity*> entities_to_remove;
-            entities_to_remove.push_back(entity_to_remove);        // Add the root entity
-            entity_to_remove->GetDescendants(&entities_to_remove); // Get descendants 
-
-            // Create a set containing the object IDs of entities to remove
-            std::set<uint64_t> ids_to_remove;
-            for (Entity* entity : entities_to_remove) {
-                ids_to_remove.insert(entity->GetObjectId());
-            }
-
-            // Remove entities using a single loop
-            for (auto it = entities.begin(); it != entities.end(); )
-            {
-                if (ids_to_remove.count(it->first) > 0)
-                {
-                    it = entities.erase(it);
-                }
-                else
-                {
-                    ++it;
-                }
-            }
-
-            // If there was a parent, update it
-            if (std::shared_ptr<Entity> parent = entity_to_remove->GetParent())
-            {
-                parent->AcquireChildren();
-            }
-        }
-
-        resolve = true;
+        remove_entity(entity_to_remove);
     }
 
     vector<shared_ptr<Entity>> World::GetRootEntities()
@@ -452,8 +661,27 @@ namespace Spartan
         // fire event
         SP_FIRE_EVENT(EventType::WorldClear);
 
-        // clear
-        entities.clear();
+        // detach the entities under the lock so that a tick can't be walking them (or the flattened hierarchy which points to them),
+        // they are destroyed once it's released, since their components are free to call back into the world on the way out
+        unordered_map<uint64_t, shared_ptr<Entity>> entities_cleared;
+        {
+            lock_guard<mutex> lock(entity_access_mutex);
+
+            for (auto& it : entities)
+            {
+                it.second->SetInWorld(false);
+            }
+            entities_cleared.swap(entities);
+
+            transform_order.clear();
+            transform_subtree_offsets.clear();
+            transform_hierarchy_dirty = true;
+        }
+        entities_cleared.clear();
+        {
+            lock_guard<mutex> lock(static_batches_dirty_mutex);
+            static_batches_dirty.clear();
+        }
         name.clear();
         file_path.clear();
 
@@ -1062,6 +1290,9 @@ namespace Spartan
                     physics_body->SetMass(0.0f); // static
                 }
             }
+
+            // merge the static pieces which share a material into fewer draws
+            mesh->BatchStatic();
         }
 
         // 3d model - sponza curtains
@@ -1154,6 +1385,9 @@ namespace Spartan
                     physics_body->SetMass(0.0f); // static
                 }
             }
+
+            // merge the static pieces which share a material into fewer draws
+            mesh->BatchStatic();
         }
 
         if (shared_ptr<Mesh> mesh = ResourceCache::Load<Mesh>("project\\models\\Bistro_v5_2\\BistroInterior.fbx"))
@@ -1193,6 +1427,9 @@ namespace Spartan
                     physics_body->SetMass(0.0f); // static
                 }
             }
+
+            // merge the static pieces which share a material into fewer draws
+            mesh->BatchStatic();
         }
     }
 
@@ -23,6 +23,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //= INCLUDES ===============
 #include "Definitions.h"
+#include "ComponentStore.h"
 #include "../Math/Vector3.h"
 //==========================
 
@@ -61,9 +62,40 @@ namespace Spartan
         static const std::shared_ptr<Entity>& GetEntityById(uint64_t id);
         static const std::unordered_map<uint64_t, std::shared_ptr<Entity>>& GetAllEntities();
 
+        // calls function(entity, t, ts...) for every entity in the world that has all of the given components, inactive entities included
+        // - the first type drives the iteration, so put the rarest component first
+        // - the function must not add or remove components
+        template<class T, class... Ts, class Function>
+        static void ForEach(Function&& function)
+        {
+            std::lock_guard<std::recursive_mutex> lock(ComponentStore::GetMutex());
+
+            const std::vector<Component*>& components = ComponentStore::GetComponents(Component::TypeToEnum<T>());
+            for (Component* component_base : components)
+            {
+                // removed while the components are ticking, see ComponentStore::BeginIteration()
+                if (!component_base)
+                    continue;
+
+                T* component = static_cast<T*>(component_base);
+                auto* entity = component->GetEntity();
+
+                if constexpr (sizeof...(Ts) == 0)
+                {
+                    function(entity, component);
+                }
+                else if (((entity->template GetComponentRaw<Ts>() != nullptr) && ...))
+                {
+                    function(entity, component, entity->template GetComponentRaw<Ts>()...);
+                }
+            }
+        }
+
         // misc
         static void New();
         static void Resolve();
+        static void SetTransformHierarchyDirty(); // parenting changed, the flattened transform hierarchy has to be rebuilt
+        static void SetStaticBatchDirty(uint64_t batch_id); // a member of the batch moved, was deactivated or removed (see Mesh::BatchStatic())
         static void LoadDefaultWorld(DefaultWorld default_world);
         static const std::string GetName();
         static const std::string& GetFilePath();
@@ -0,0 +1,122 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+//= INCLUDES ===========
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+//======================
+
+// a minimal test and benchmark harness, the runtime has no dependency that provides one
+// - SP_TEST bodies run every time the executable runs, a failed SP_CHECK marks the test as failed but lets it continue
+// - SP_BENCHMARK bodies only run when the executable is started with -benchmark, they report through Test::Report()
+namespace Spartan::Test
+{
+    using Function = void(*)();
+
+    struct Case
+    {
+        const char* name = nullptr;
+        Function function = nullptr;
+        bool is_benchmark = false;
+    };
+
+    inline std::vector<Case>& GetCases()
+    {
+        static std::vector<Case> cases;
+        return cases;
+    }
+
+    inline uint32_t& GetFailureCount()
+    {
+        static uint32_t failure_count = 0;
+        return failure_count;
+    }
+
+    struct Registrar
+    {
+        Registrar(const char* name, Function function, const bool is_benchmark)
+        {
+            GetCases().push_back({ name, function, is_benchmark });
+        }
+    };
+
+    inline void Fail(const char* file, const int line, const char* expression)
+    {
+        printf("    failed: %s (%s:%d)\n", expression, file, line);
+        GetFailureCount()++;
+    }
+
+    // keeps the compiler from optimizing away a result that is otherwise unused
+    template<typename T>
+    inline void Keep(const T& value)
+    {
+        static volatile uint8_t sink = 0;
+        const uint8_t* bytes         = reinterpret_cast<const uint8_t*>(&value);
+        uint8_t hash                 = 0;
+        for (size_t i = 0; i < sizeof(T); i++)
+        {
+            hash ^= bytes[i];
+        }
+        sink = sink ^ hash;
+    }
+
+    // runs function(iteration) the given number of times and returns the average nanoseconds per call
+    template<typename F>
+    inline double Measure(const uint32_t iterations, F&& function)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            function(i);
+        }
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+        return elapsed.count() / static_cast<double>(iterations);
+    }
+
+    inline void Report(const char* label, const double value, const char* unit)
+    {
+        printf("    %-48s %12.3f %s\n", label, value, unit);
+    }
+}
+
+#define SP_TEST_REGISTER(name, is_benchmark)                                                                  \
+    static void name();                                                                                       \
+    static const Spartan::Test::Registrar registrar_##name(#name, &name, is_benchmark);                       \
+    static void name()
+
+#define SP_TEST(name)      SP_TEST_REGISTER(name, false)
+#define SP_BENCHMARK(name) SP_TEST_REGISTER(name, true)
+
+#define SP_CHECK(expression)                                                                                  \
+    {                                                                                                         \
+        if (!(expression))                                                                                    \
+        {                                                                                                     \
+            Spartan::Test::Fail(__FILE__, __LINE__, #expression);                                             \
+        }                                                                                                     \
+    }
+
+#define SP_CHECK_NEAR(a, b, epsilon) SP_CHECK(std::fabs(static_cast<double>(a) - static_cast<double>(b)) <= static_cast<double>(epsilon))
@@ -0,0 +1,184 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES ===========================
+#include "Test.h"
+#include "Rendering/DynamicInstancing.h"
+#include <random>
+//======================================
+
+//= NAMESPACES ==========
+using namespace std;
+using namespace Spartan;
+//=======================
+
+// the grouping of dynamic instancing, which renderables are drawn together and which are left to be drawn one by one
+namespace
+{
+    InstancingCandidate create_candidate(const uint64_t material_id, const uint32_t index_offset)
+    {
+        InstancingCandidate candidate;
+        candidate.material_id      = material_id;
+        candidate.vertex_buffer_id = 10;
+        candidate.index_buffer_id  = 20;
+        candidate.index_offset     = index_offset;
+        candidate.index_count      = 300;
+        candidate.vertex_offset    = 0;
+
+        return candidate;
+    }
+
+    // appends count copies, with renderable indices following the ones already in there
+    void add(vector<InstancingCandidate>& candidates, const InstancingCandidate& candidate, const uint32_t count)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            InstancingCandidate& copy = candidates.emplace_back(candidate);
+            copy.renderable_index     = static_cast<uint32_t>(candidates.size() - 1);
+        }
+    }
+
+    uint32_t get_grouped_count(const vector<InstancingGroup>& groups)
+    {
+        uint32_t count = 0;
+        for (const InstancingGroup& group : groups)
+        {
+            count += group.candidate_count;
+        }
+
+        return count;
+    }
+}
+
+SP_TEST(dynamic_instancing_key)
+{
+    // every member of the key splits a group, even when all the others match
+    const InstancingCandidate base = create_candidate(1, 0);
+    vector<InstancingCandidate> variants(7, base);
+    variants[1].material_id++;
+    variants[2].vertex_buffer_id++;
+    variants[3].index_buffer_id++;
+    variants[4].index_offset++; // another lod of the same mesh
+    variants[5].index_count++;
+    variants[6].vertex_offset++;
+
+    vector<InstancingCandidate> candidates;
+    for (const InstancingCandidate& variant : variants)
+    {
+        add(candidates, variant, DynamicInstancing::batch_size_min);
+    }
+
+    vector<InstancingGroup> groups;
+    DynamicInstancing::Group(candidates, 1, 1000, groups);
+    SP_CHECK(groups.size() == variants.size());
+    for (const InstancingGroup& group : groups)
+    {
+        SP_CHECK(group.candidate_count == DynamicInstancing::batch_size_min);
+
+        // the members share the key and nothing outside of the group has it
+        const InstancingCandidate& first = candidates[group.candidate_start];
+        for (uint32_t i = 0; i < static_cast<uint32_t>(candidates.size()); i++)
+        {
+            const bool is_member = i >= group.candidate_start && i < group.candidate_start + group.candidate_count;
+            SP_CHECK((candidates[i].key() == first.key()) == is_member);
+        }
+    }
+
+    // the renderable index isn't part of the key
+    InstancingCandidate other = base;
+    other.renderable_index    = 99;
+    SP_CHECK(other.key() == base.key());
+}
+
+SP_TEST(dynamic_instancing_threshold)
+{
+    const uint32_t below = DynamicInstancing::batch_size_min - 1;
+
+    // one short of the threshold, every renderable is drawn on its own
+    vector<InstancingCandidate> candidates;
+    add(candidates, create_candidate(1, 0), below);
+    vector<InstancingGroup> groups;
+    DynamicInstancing::Group(candidates, 1, 1000, groups);
+    SP_CHECK(groups.empty());
+
+    // reaching it makes a group of all of them
+    add(candidates, create_candidate(1, 0), 1);
+    DynamicInstancing::Group(candidates, 1, 1000, groups);
+    SP_CHECK(groups.size() == 1 && groups[0].candidate_start == 0 && groups[0].candidate_count == DynamicInstancing::batch_size_min);
+
+    // a mix, only the keys with enough copies are grouped, the rest fall back to single draws
+    candidates.clear();
+    add(candidates, create_candidate(1, 0), 10);
+    add(candidates, create_candidate(2, 0), below);
+    add(candidates, create_candidate(3, 0), 1);
+    add(candidates, create_candidate(4, 0), DynamicInstancing::batch_size_min);
+    DynamicInstancing::Group(candidates, 1, 1000, groups);
+    SP_CHECK(groups.size() == 2);
+    SP_CHECK(get_grouped_count(groups) == 10 + DynamicInstancing::batch_size_min);
+    for (const InstancingGroup& group : groups)
+    {
+        const uint64_t material_id = candidates[group.candidate_start].material_id;
+        SP_CHECK(material_id == 1 || material_id == 4);
+    }
+}
+
+SP_TEST(dynamic_instancing_order_and_capacity)
+{
+    // interleaved keys, like renderables sorted front-to-back
+    mt19937 engine(1234);
+    uniform_int_distribution<uint64_t> material(0, 7);
+    vector<InstancingCandidate> candidates;
+    for (uint32_t i = 0; i < 500; i++)
+    {
+        add(candidates, create_candidate(material(engine), 0), 1);
+    }
+
+    vector<InstancingGroup> groups;
+    DynamicInstancing::Group(candidates, 1, 1000, groups);
+    SP_CHECK(groups.size() == 8 && get_grouped_count(groups) == 500);
+
+    // the groups don't overlap and within each the members keep the order they came in
+    uint32_t candidate_end = 0;
+    for (const InstancingGroup& group : groups)
+    {
+        SP_CHECK(group.candidate_start >= candidate_end);
+        candidate_end = group.candidate_start + group.candidate_count;
+
+        for (uint32_t i = group.candidate_start + 1; i < candidate_end; i++)
+        {
+            SP_CHECK(candidates[i].renderable_index > candidates[i - 1].renderable_index);
+        }
+    }
+
+    // a group which doesn't fit in what's left of the instance buffer is drawn one by one, smaller ones after it can still fit
+    candidates.clear();
+    add(candidates, create_candidate(1, 0), 6);
+    add(candidates, create_candidate(2, 0), 20);
+    add(candidates, create_candidate(3, 0), 5);
+    DynamicInstancing::Group(candidates, 1, 1 + 6 + 10, groups);
+    SP_CHECK(groups.size() == 2);
+    SP_CHECK(candidates[groups[0].candidate_start].material_id == 1 && groups[0].candidate_count == 6);
+    SP_CHECK(candidates[groups[1].candidate_start].material_id == 3 && groups[1].candidate_count == 5);
+
+    // the instances already in use count against the capacity
+    DynamicInstancing::Group(candidates, 1 + 10, 1 + 6 + 10, groups);
+    SP_CHECK(groups.size() == 1 && groups[0].candidate_count == 6);
+}
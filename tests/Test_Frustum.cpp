@@ -0,0 +1,130 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES =============
+#include "Test.h"
+#include "Math/Frustum.h"
+#include <random>
+//========================
+
+//= NAMESPACES ===============
+using namespace std;
+using namespace Spartan;
+using namespace Spartan::Math;
+//============================
+
+// Frustum::AreVisible() is checked box by box against the scalar Frustum::IsVisible(), which is the reference
+namespace
+{
+    const float far_plane = 1000.0f;
+
+    Frustum create_frustum()
+    {
+        const Matrix view       = Matrix::CreateLookAtLH(Vector3(0.0f, 5.0f, -20.0f), Vector3(10.0f, 0.0f, 50.0f), Vector3::Up);
+        const Matrix projection = Matrix::CreatePerspectiveFieldOfViewLH(1.2f, 16.0f / 9.0f, 0.1f, far_plane);
+
+        return Frustum(view, projection, far_plane);
+    }
+
+    // boxes scattered around the camera, far enough that a good share of them ends up outside
+    // of the frustum, behind the near plane or past the far plane
+    BoundingBoxesSoa create_boxes(const uint32_t count)
+    {
+        mt19937 engine(1234);
+        uniform_real_distribution<float> position(-far_plane * 1.2f, far_plane * 1.2f);
+        uniform_real_distribution<float> size(0.1f, 20.0f);
+
+        BoundingBoxesSoa boxes;
+        boxes.Resize(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            boxes.Set(i, Vector3(position(engine), position(engine) * 0.1f, position(engine)), Vector3(size(engine), size(engine), size(engine)));
+        }
+
+        return boxes;
+    }
+
+    Vector3 get_center(const BoundingBoxesSoa& boxes, const uint32_t i) { return Vector3(boxes.center_x[i], boxes.center_y[i], boxes.center_z[i]); }
+    Vector3 get_extent(const BoundingBoxesSoa& boxes, const uint32_t i) { return Vector3(boxes.extent_x[i], boxes.extent_y[i], boxes.extent_z[i]); }
+}
+
+SP_TEST(frustum_are_visible_matches_is_visible)
+{
+    const Frustum frustum        = create_frustum();
+    const BoundingBoxesSoa boxes = create_boxes(10'000);
+    vector<uint8_t> visible(boxes.GetCount(), 2);
+
+    for (const bool ignore_depth : { false, true })
+    {
+        // an unaligned range so that both the 8 wide batches and the scalar tail are exercised
+        const uint32_t start = 3;
+        const uint32_t end   = boxes.GetCount() - 5;
+        fill(visible.begin(), visible.end(), uint8_t(2));
+        frustum.AreVisible(boxes, start, end, visible.data(), ignore_depth);
+
+        uint32_t visible_count = 0;
+        uint32_t mismatches    = 0;
+        for (uint32_t i = 0; i < boxes.GetCount(); i++)
+        {
+            if (i < start || i >= end)
+            {
+                SP_CHECK(visible[i] == 2); // outside of the range, must be left untouched
+                continue;
+            }
+
+            const uint8_t expected = frustum.IsVisible(get_center(boxes, i), get_extent(boxes, i), ignore_depth) ? 1 : 0;
+            mismatches            += visible[i] != expected ? 1 : 0;
+            visible_count         += expected;
+        }
+
+        SP_CHECK(mismatches == 0);
+
+        // the scene has to actually test something, neither everything nor nothing can be visible
+        SP_CHECK(visible_count > 0 && visible_count < end - start);
+    }
+}
+
+SP_BENCHMARK(frustum_100k_boxes)
+{
+    const uint32_t iterations    = 200;
+    const Frustum frustum        = create_frustum();
+    const BoundingBoxesSoa boxes = create_boxes(100'000);
+    vector<uint8_t> visible(boxes.GetCount());
+
+    const double ns_scalar = Test::Measure(iterations, [&](uint32_t)
+    {
+        for (uint32_t i = 0; i < boxes.GetCount(); i++)
+        {
+            visible[i] = frustum.IsVisible(get_center(boxes, i), get_extent(boxes, i)) ? 1 : 0;
+        }
+    });
+    Test::Keep(visible[boxes.GetCount() / 2]);
+
+    const double ns_soa = Test::Measure(iterations, [&](uint32_t)
+    {
+        frustum.AreVisible(boxes, 0, boxes.GetCount(), visible.data());
+    });
+    Test::Keep(visible[boxes.GetCount() / 2]);
+
+    Test::Report("IsVisible, 100k boxes", ns_scalar / 1'000'000.0, "ms");
+    Test::Report("AreVisible, 100k boxes", ns_soa / 1'000'000.0, "ms");
+    Test::Report("speedup", ns_scalar / ns_soa, "x");
+}
@@ -0,0 +1,268 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES ===========================
+#include "Test.h"
+#include "Rendering/IndirectDraws.h"
+#include "Rendering/Renderer_Definitions.h"
+#include "Rendering/Mesh.h"
+#include "Math/Frustum.h"
+#include <random>
+//======================================
+
+//= NAMESPACES ===============
+using namespace std;
+using namespace Spartan;
+using namespace Spartan::Math;
+//============================
+
+// the cpu side of gpu driven rendering, how renderables are grouped into buckets, where each bucket's commands go, how meshlets are
+// expanded into draw objects and how many of those the cpu expects the gpu to find visible, the gpu counts are checked against that
+namespace
+{
+    // the buckets only compare the buffers, they are never dereferenced, so any distinct addresses will do
+    uint8_t buffer_storage[64];
+    RHI_Buffer* get_buffer(const uint32_t index) { return reinterpret_cast<RHI_Buffer*>(&buffer_storage[index]); }
+
+    Frustum create_frustum()
+    {
+        const Matrix view       = Matrix::CreateLookAtLH(Vector3::Zero, Vector3::Forward, Vector3::Up);
+        const Matrix projection = Matrix::CreatePerspectiveFieldOfViewLH(1.2f, 16.0f / 9.0f, 0.1f, 1000.0f);
+
+        return Frustum(view, projection, 1000.0f);
+    }
+
+    Sb_DrawObject create_draw_object(const Matrix& transform)
+    {
+        Sb_DrawObject draw_object             = {};
+        draw_object.transform                 = transform;
+        draw_object.transform_previous        = transform;
+        draw_object.vertex_offset             = 7;
+        draw_object.material_index            = 3;
+        draw_object.bucket_index              = 2;
+        draw_object.command_offset            = 40;
+        draw_object.cone_cutoff               = 1.0f;
+        draw_object.visibility_index_previous = numeric_limits<uint32_t>::max();
+
+        return draw_object;
+    }
+
+    // meshlets of a unit sphere, each faces away from its center
+    vector<Meshlet> create_meshlets(const uint32_t count, mt19937& engine)
+    {
+        uniform_real_distribution<float> direction(-1.0f, 1.0f);
+
+        vector<Meshlet> meshlets(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            Meshlet& meshlet     = meshlets[i];
+            const Vector3 normal = Vector3(direction(engine), direction(engine), direction(engine)).Normalized();
+            meshlet.index_offset = i * 372;
+            meshlet.index_count  = 372;
+            meshlet.center       = normal;
+            meshlet.radius       = 0.2f;
+            meshlet.cone_apex    = normal * 0.5f;
+            meshlet.cone_axis    = normal; // the average normal of the faces, with the apex behind them, like meshoptimizer
+            meshlet.cone_cutoff  = 0.5f;
+        }
+
+        return meshlets;
+    }
+}
+
+SP_TEST(indirect_draws_buckets)
+{
+    vector<IndirectDrawBucket> buckets;
+    const uint32_t bucket_count_max = 4;
+
+    // the same geometry and cull mode share a bucket, any difference in them splits it
+    const uint32_t bucket_a = IndirectDraws::GetBucketIndex(buckets, get_buffer(0), get_buffer(1), RHI_CullMode::Back, bucket_count_max);
+    SP_CHECK(bucket_a == 0);
+    SP_CHECK(IndirectDraws::GetBucketIndex(buckets, get_buffer(0), get_buffer(1), RHI_CullMode::Back, bucket_count_max) == bucket_a);
+    SP_CHECK(IndirectDraws::GetBucketIndex(buckets, get_buffer(0), get_buffer(1), RHI_CullMode::None, bucket_count_max) == 1);
+    SP_CHECK(IndirectDraws::GetBucketIndex(buckets, get_buffer(0), get_buffer(2), RHI_CullMode::Back, bucket_count_max) == 2);
+    SP_CHECK(IndirectDraws::GetBucketIndex(buckets, get_buffer(3), get_buffer(1), RHI_CullMode::Back, bucket_count_max) == 3);
+    SP_CHECK(buckets.size() == bucket_count_max);
+    SP_CHECK(buckets[1].cull_mode == RHI_CullMode::None && buckets[2].index_buffer == get_buffer(2) && buckets[3].vertex_buffer == get_buffer(3));
+
+    // once all the buckets are in use new geometry is rejected, but the existing buckets are still found
+    SP_CHECK(IndirectDraws::GetBucketIndex(buckets, get_buffer(4), get_buffer(5), RHI_CullMode::Back, bucket_count_max) == IndirectDraws::bucket_invalid);
+    SP_CHECK(IndirectDraws::GetBucketIndex(buckets, get_buffer(0), get_buffer(1), RHI_CullMode::None, bucket_count_max) == 1);
+    SP_CHECK(buckets.size() == bucket_count_max);
+}
+
+SP_TEST(indirect_draws_command_offsets)
+{
+    mt19937 engine(1234);
+    uniform_int_distribution<uint32_t> geometry(0, 9);
+    uniform_int_distribution<uint32_t> object_count(1, 64);
+
+    // renderables in random order, counted into their buckets the way the renderer does it
+    vector<IndirectDrawBucket> buckets;
+    uint32_t object_total = 0;
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        const uint32_t buffer       = geometry(engine);
+        const RHI_CullMode cull     = i % 3 == 0 ? RHI_CullMode::None : RHI_CullMode::Back;
+        const uint32_t bucket_index = IndirectDraws::GetBucketIndex(buckets, get_buffer(buffer), get_buffer(buffer + 10), cull, renderer_max_draw_buckets);
+        SP_CHECK(bucket_index != IndirectDraws::bucket_invalid);
+
+        const uint32_t count                = object_count(engine);
+        buckets[bucket_index].object_count += count;
+        object_total                       += count;
+    }
+    SP_CHECK(buckets.size() == 20);
+
+    // the ranges follow each other in bucket order, without gaps or overlaps
+    SP_CHECK(IndirectDraws::AssignCommandOffsets(buckets) == object_total);
+    uint32_t command_offset = 0;
+    for (const IndirectDrawBucket& bucket : buckets)
+    {
+        SP_CHECK(bucket.command_offset == command_offset);
+        command_offset += bucket.object_count;
+    }
+    SP_CHECK(command_offset == object_total);
+
+    vector<IndirectDrawBucket> buckets_empty;
+    SP_CHECK(IndirectDraws::AssignCommandOffsets(buckets_empty) == 0);
+}
+
+SP_TEST(indirect_draws_meshlet_packing)
+{
+    mt19937 engine(1234);
+    const vector<Meshlet> meshlets   = create_meshlets(16, engine);
+    const Matrix transform           = Matrix::CreateScale(2.0f) * Matrix::CreateTranslation(Vector3(0.0f, 0.0f, 10.0f));
+    const Frustum frustum            = create_frustum();
+    const uint32_t index_offset_mesh = 1000;
+
+    Sb_DrawObject draw_object             = create_draw_object(transform);
+    draw_object.visibility_index_previous = 100;
+
+    for (const bool cull_cones : { false, true })
+    {
+        vector<Sb_DrawObject> draw_objects(1); // something already in there, the meshlets are appended after it
+        IndirectDraws::AppendMeshlets(draw_object, meshlets, index_offset_mesh, 2.0f, cull_cones, frustum, Vector3::Zero, draw_objects);
+        SP_CHECK(draw_objects.size() == meshlets.size() + 1);
+
+        for (uint32_t i = 0; i < static_cast<uint32_t>(meshlets.size()); i++)
+        {
+            const Meshlet& meshlet     = meshlets[i];
+            const Sb_DrawObject& drawn = draw_objects[i + 1];
+
+            // world space bounds, the index range of the meshlet within the mesh
+            SP_CHECK((drawn.box_center - meshlet.center * transform).Length() < 1e-4f);
+            SP_CHECK(drawn.box_extent == Vector3(meshlet.radius * 2.0f));
+            SP_CHECK(drawn.index_offset == index_offset_mesh + meshlet.index_offset);
+            SP_CHECK(drawn.index_count == meshlet.index_count);
+
+            // the rest is inherited from the renderable
+            SP_CHECK(drawn.transform == transform && drawn.transform_previous == transform);
+            SP_CHECK(drawn.vertex_offset == 7 && drawn.material_index == 3 && drawn.bucket_index == 2 && drawn.command_offset == 40);
+
+            // last frame's results are one per meshlet, in the same order
+            SP_CHECK(drawn.visibility_index_previous == 100 + i);
+
+            // without cones, a zero axis and a cutoff of 1 never cull
+            if (cull_cones)
+            {
+                SP_CHECK((drawn.cone_apex - meshlet.cone_apex * transform).Length() < 1e-4f);
+                SP_CHECK_NEAR(drawn.cone_axis.Length(), 1.0f, 1e-4f);
+                SP_CHECK(drawn.cone_cutoff == meshlet.cone_cutoff);
+            }
+            else
+            {
+                SP_CHECK(drawn.cone_axis == Vector3::Zero && drawn.cone_cutoff == 1.0f);
+            }
+        }
+    }
+
+    // without last frame's results, none of the meshlets has any
+    draw_object.visibility_index_previous = numeric_limits<uint32_t>::max();
+    vector<Sb_DrawObject> draw_objects;
+    IndirectDraws::AppendMeshlets(draw_object, meshlets, index_offset_mesh, 2.0f, true, frustum, Vector3::Zero, draw_objects);
+    for (const Sb_DrawObject& drawn : draw_objects)
+    {
+        SP_CHECK(drawn.visibility_index_previous == numeric_limits<uint32_t>::max());
+    }
+}
+
+SP_TEST(indirect_draws_visible_count)
+{
+    mt19937 engine(4321);
+    uniform_real_distribution<float> position(-200.0f, 200.0f);
+    uniform_int_distribution<uint32_t> bucket(0, 15);
+    const Frustum frustum = create_frustum();
+
+    // spheres of meshlets all around the camera, so that some are outside of the frustum and some are seen from the inside
+    vector<Sb_DrawObject> draw_objects;
+    uint32_t visible_count_cpu = 0;
+    for (uint32_t i = 0; i < 200; i++)
+    {
+        const Matrix transform    = Matrix::CreateTranslation(Vector3(position(engine), position(engine) * 0.2f, position(engine)));
+        Sb_DrawObject draw_object = create_draw_object(transform);
+        draw_object.bucket_index  = bucket(engine);
+
+        const vector<Meshlet> meshlets = create_meshlets(32, engine);
+        const size_t first             = draw_objects.size();
+        const uint32_t visible_count   = IndirectDraws::AppendMeshlets(draw_object, meshlets, 0, 1.0f, true, frustum, Vector3::Zero, draw_objects);
+        visible_count_cpu             += visible_count;
+
+        // the returned count is the number of appended draw objects which pass the culling tests
+        uint32_t visible_count_expected = 0;
+        for (size_t j = first; j < draw_objects.size(); j++)
+        {
+            visible_count_expected += IndirectDraws::IsVisible(draw_objects[j], frustum, Vector3::Zero) ? 1 : 0;
+        }
+        SP_CHECK(visible_count == visible_count_expected);
+    }
+    SP_CHECK(visible_count_cpu > 0 && visible_count_cpu < draw_objects.size());
+
+    // a meshlet facing the camera is visible, the same meshlet facing away isn't, and neither is one behind the camera
+    Sb_DrawObject facing      = create_draw_object(Matrix::Identity);
+    facing.box_center         = Vector3(0.0f, 0.0f, 10.0f);
+    facing.box_extent         = Vector3::One;
+    facing.cone_apex          = facing.box_center;
+    facing.cone_axis          = Vector3::Backward; // the faces point at the camera
+    facing.cone_cutoff        = 0.5f;
+    Sb_DrawObject facing_away = facing;
+    facing_away.cone_axis     = Vector3::Forward;
+    Sb_DrawObject behind      = facing;
+    behind.box_center         = Vector3(0.0f, 0.0f, -10.0f);
+    SP_CHECK(IndirectDraws::IsVisible(facing, frustum, Vector3::Zero));
+    SP_CHECK(!IndirectDraws::IsVisible(facing_away, frustum, Vector3::Zero));
+    SP_CHECK(!IndirectDraws::IsVisible(behind, frustum, Vector3::Zero));
+
+    // the culling pass increments the count of each visible object's bucket, in the region of its phase, what's read back is their sum
+    vector<uint32_t> counts(renderer_max_draw_buckets * renderer_culling_phase_count, 0);
+    for (uint32_t i = 0; i < static_cast<uint32_t>(draw_objects.size()); i++)
+    {
+        if (IndirectDraws::IsVisible(draw_objects[i], frustum, Vector3::Zero))
+        {
+            const uint32_t phase = i % renderer_culling_phase_count;
+            counts[phase * renderer_max_draw_buckets + draw_objects[i].bucket_index]++;
+        }
+    }
+    SP_CHECK(IndirectDraws::GetVisibleCount(counts.data(), static_cast<uint32_t>(counts.size())) == visible_count_cpu);
+
+    // a single object the gpu disagrees on shows up as a mismatch
+    counts[renderer_max_draw_buckets + 5]++;
+    SP_CHECK(IndirectDraws::GetVisibleCount(counts.data(), static_cast<uint32_t>(counts.size())) == visible_count_cpu + 1);
+}
@@ -0,0 +1,182 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES ======================
+#include "Test.h"
+#include "Rendering/LightClusters.h"
+#include <algorithm>
+#include <random>
+//=================================
+
+//= NAMESPACES ===============
+using namespace std;
+using namespace Spartan;
+using namespace Spartan::Math;
+//============================
+
+// points are sampled inside every light and looked up the way the shader does it, the cluster a point lands in has to list the light,
+// missing one means a pixel goes unlit, which is why the assignment has to be conservative
+namespace
+{
+    const float near_plane   = 0.1f;
+    const float far_plane    = 500.0f;
+    const float projection_y = 1.0f / tan(0.5f); // a vertical fov of 1 radian
+    const float projection_x = projection_y / (16.0f / 9.0f);
+
+    vector<LightClusterSphere> create_lights(const uint32_t count)
+    {
+        mt19937 engine(1234);
+        uniform_real_distribution<float> depth(0.0f, 1.0f);
+        uniform_real_distribution<float> ndc(-1.2f, 1.2f);
+        uniform_real_distribution<float> radius(0.2f, 4.0f);
+
+        vector<LightClusterSphere> lights(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            // denser near the camera, like the slices, and a little past the edges of the screen
+            const float z    = near_plane + pow(depth(engine), 2.0f) * 200.0f;
+            lights[i].center = Vector3(ndc(engine) * z / projection_x, ndc(engine) * z / projection_y, z);
+            lights[i].radius = radius(engine);
+            lights[i].index  = count - 1 - i; // not the position in the list, so that the two can't be mixed up
+        }
+
+        return lights;
+    }
+
+    bool cluster_contains(const vector<uint32_t>& data, const uint32_t cluster, const uint32_t light_index)
+    {
+        const uint32_t offset = data[cluster * 2 + 0];
+        const uint32_t count  = data[cluster * 2 + 1];
+        const uint32_t* first = &data[LightClusters::cluster_count * 2 + offset];
+
+        return find(first, first + count, light_index) != first + count;
+    }
+}
+
+SP_TEST(light_clusters_conservative)
+{
+    const vector<LightClusterSphere> lights = create_lights(128);
+    vector<uint32_t> data;
+    SP_CHECK(LightClusters::Build(lights, projection_x, projection_y, near_plane, far_plane, data) == 0);
+    SP_CHECK(data.size() >= LightClusters::cluster_count * 2 && data.size() <= LightClusters::data_count);
+
+    mt19937 engine(4321);
+    uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    uint32_t samples = 0;
+    uint32_t misses  = 0;
+    for (const LightClusterSphere& light : lights)
+    {
+        for (uint32_t i = 0; i < 512; i++)
+        {
+            // uniform in the sphere, the ones off screen or outside the depth range can't be looked up
+            Vector3 offset;
+            do
+            {
+                offset = Vector3(unit(engine), unit(engine), unit(engine));
+            } while (offset.LengthSquared() > 1.0f);
+
+            const Vector3 point = light.center + offset * light.radius;
+            const float uv_x    = (point.x * projection_x / point.z) * 0.5f + 0.5f;
+            const float uv_y    = 0.5f - (point.y * projection_y / point.z) * 0.5f;
+            if (point.z < near_plane || point.z > far_plane || uv_x < 0.0f || uv_x > 1.0f || uv_y < 0.0f || uv_y > 1.0f)
+                continue;
+
+            samples++;
+            misses += cluster_contains(data, LightClusters::GetClusterIndex(uv_x, uv_y, point.z, near_plane, far_plane), light.index) ? 0 : 1;
+        }
+    }
+
+    printf("    %u samples, %u misses\n", samples, misses);
+    SP_CHECK(samples > 10'000);
+    SP_CHECK(misses == 0);
+}
+
+SP_TEST(light_clusters_layout)
+{
+    const vector<LightClusterSphere> lights = create_lights(128);
+    vector<uint32_t> data;
+    LightClusters::Build(lights, projection_x, projection_y, near_plane, far_plane, data);
+
+    // where every light is in the input, the lists have to keep that order
+    vector<uint32_t> order(lights.size());
+    for (uint32_t i = 0; i < lights.size(); i++)
+    {
+        order[lights[i].index] = i;
+    }
+
+    // the lists are packed back to back, in cluster order
+    uint32_t offset_expected = 0;
+    uint32_t out_of_order    = 0;
+    for (uint32_t cluster = 0; cluster < LightClusters::cluster_count; cluster++)
+    {
+        const uint32_t offset = data[cluster * 2 + 0];
+        const uint32_t count  = data[cluster * 2 + 1];
+        SP_CHECK(offset == offset_expected);
+        offset_expected += count;
+
+        for (uint32_t i = 1; i < count; i++)
+        {
+            const uint32_t* list = &data[LightClusters::cluster_count * 2 + offset];
+            out_of_order        += order[list[i - 1]] < order[list[i]] ? 0 : 1;
+        }
+    }
+    SP_CHECK(out_of_order == 0);
+    SP_CHECK(data.size() == LightClusters::cluster_count * 2 + offset_expected);
+
+    // no lights, empty lists
+    LightClusters::Build({}, projection_x, projection_y, near_plane, far_plane, data);
+    SP_CHECK(data.size() == LightClusters::cluster_count * 2);
+    SP_CHECK(all_of(data.begin(), data.end(), [](uint32_t value) { return value == 0; }));
+}
+
+SP_TEST(light_clusters_overflow)
+{
+    // lights which enclose the whole frustum touch every cluster, more of them than the shared index budget can hold
+    const uint32_t light_count = 20;
+    vector<LightClusterSphere> lights(light_count);
+    for (uint32_t i = 0; i < light_count; i++)
+    {
+        lights[i].center = Vector3(0.0f, 0.0f, far_plane * 0.5f);
+        lights[i].radius = far_plane * 2.0f;
+        lights[i].index  = i;
+    }
+
+    vector<uint32_t> data;
+    const uint32_t dropped = LightClusters::Build(lights, projection_x, projection_y, near_plane, far_plane, data);
+    SP_CHECK(dropped == light_count * LightClusters::cluster_count - LightClusters::index_count);
+    SP_CHECK(data.size() == LightClusters::data_count);
+
+    // the clusters are filled in order until the budget runs out, and whatever a cluster keeps is the first lights
+    uint32_t kept = 0;
+    for (uint32_t cluster = 0; cluster < LightClusters::cluster_count; cluster++)
+    {
+        const uint32_t count = data[cluster * 2 + 1];
+        SP_CHECK(count <= light_count);
+        kept += count;
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            SP_CHECK(data[LightClusters::cluster_count * 2 + data[cluster * 2 + 0] + i] == i);
+        }
+    }
+    SP_CHECK(kept + dropped == light_count * LightClusters::cluster_count);
+    SP_CHECK(data[1] == light_count && data[(LightClusters::cluster_count - 1) * 2 + 1] == 0);
+}
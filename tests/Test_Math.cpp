@@ -0,0 +1,347 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES =====================
+#include "Test.h"
+#include "Math/Matrix.h"
+#include "Math/Quaternion.h"
+#include "Math/BoundingBox.h"
+#include <random>
+//================================
+
+//= NAMESPACES ===============
+using namespace std;
+using namespace Spartan;
+using namespace Spartan::Math;
+//============================
+
+// the simd backend (see MathSimd.h) is checked against, and timed next to, plain scalar
+// versions of the same operations, written out here so that they are unaffected by the backend
+namespace
+{
+    const char* get_backend_name()
+    {
+    #if defined(SP_MATH_SSE)
+        return "sse";
+    #elif defined(SP_MATH_NEON)
+        return "neon";
+    #else
+        return "scalar";
+    #endif
+    }
+
+    Matrix reference_multiply(const Matrix& a, const Matrix& b)
+    {
+        float result[4][4];
+        const float lhs[4][4] = { { a.m00, a.m01, a.m02, a.m03 }, { a.m10, a.m11, a.m12, a.m13 }, { a.m20, a.m21, a.m22, a.m23 }, { a.m30, a.m31, a.m32, a.m33 } };
+        const float rhs[4][4] = { { b.m00, b.m01, b.m02, b.m03 }, { b.m10, b.m11, b.m12, b.m13 }, { b.m20, b.m21, b.m22, b.m23 }, { b.m30, b.m31, b.m32, b.m33 } };
+        for (uint32_t row = 0; row < 4; row++)
+        {
+            for (uint32_t column = 0; column < 4; column++)
+            {
+                result[row][column] = lhs[row][0] * rhs[0][column] + lhs[row][1] * rhs[1][column] + lhs[row][2] * rhs[2][column] + lhs[row][3] * rhs[3][column];
+            }
+        }
+
+        return Matrix(
+            result[0][0], result[0][1], result[0][2], result[0][3],
+            result[1][0], result[1][1], result[1][2], result[1][3],
+            result[2][0], result[2][1], result[2][2], result[2][3],
+            result[3][0], result[3][1], result[3][2], result[3][3]
+        );
+    }
+
+    Vector4 reference_transform(const Matrix& m, const Vector4& v)
+    {
+        return Vector4(
+            v.x * m.m00 + v.y * m.m10 + v.z * m.m20 + v.w * m.m30,
+            v.x * m.m01 + v.y * m.m11 + v.z * m.m21 + v.w * m.m31,
+            v.x * m.m02 + v.y * m.m12 + v.z * m.m22 + v.w * m.m32,
+            v.x * m.m03 + v.y * m.m13 + v.z * m.m23 + v.w * m.m33
+        );
+    }
+
+    // cofactors over 2x2 sub-determinants, the inverse of the transpose is the transposed inverse, so the memory layout doesn't matter
+    Matrix reference_inverse(const Matrix& matrix)
+    {
+        const float* m = matrix.Data();
+        const float s0 = m[0] * m[5]  - m[4]  * m[1];
+        const float s1 = m[0] * m[6]  - m[4]  * m[2];
+        const float s2 = m[0] * m[7]  - m[4]  * m[3];
+        const float s3 = m[1] * m[6]  - m[5]  * m[2];
+        const float s4 = m[1] * m[7]  - m[5]  * m[3];
+        const float s5 = m[2] * m[7]  - m[6]  * m[3];
+        const float c5 = m[10] * m[15] - m[14] * m[11];
+        const float c4 = m[9]  * m[15] - m[13] * m[11];
+        const float c3 = m[9]  * m[14] - m[13] * m[10];
+        const float c2 = m[8]  * m[15] - m[12] * m[11];
+        const float c1 = m[8]  * m[14] - m[12] * m[10];
+        const float c0 = m[8]  * m[13] - m[12] * m[9];
+
+        const float det_inv = 1.0f / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+
+        Matrix result;
+        float* out = &result.m00;
+        out[0]     = ( m[5]  * c5 - m[6]  * c4 + m[7]  * c3) * det_inv;
+        out[1]     = (-m[1]  * c5 + m[2]  * c4 - m[3]  * c3) * det_inv;
+        out[2]     = ( m[13] * s5 - m[14] * s4 + m[15] * s3) * det_inv;
+        out[3]     = (-m[9]  * s5 + m[10] * s4 - m[11] * s3) * det_inv;
+        out[4]     = (-m[4]  * c5 + m[6]  * c2 - m[7]  * c1) * det_inv;
+        out[5]     = ( m[0]  * c5 - m[2]  * c2 + m[3]  * c1) * det_inv;
+        out[6]     = (-m[12] * s5 + m[14] * s2 - m[15] * s1) * det_inv;
+        out[7]     = ( m[8]  * s5 - m[10] * s2 + m[11] * s1) * det_inv;
+        out[8]     = ( m[4]  * c4 - m[5]  * c2 + m[7]  * c0) * det_inv;
+        out[9]     = (-m[0]  * c4 + m[1]  * c2 - m[3]  * c0) * det_inv;
+        out[10]    = ( m[12] * s4 - m[13] * s2 + m[15] * s0) * det_inv;
+        out[11]    = (-m[8]  * s4 + m[9]  * s2 - m[11] * s0) * det_inv;
+        out[12]    = (-m[4]  * c3 + m[5]  * c1 - m[6]  * c0) * det_inv;
+        out[13]    = ( m[0]  * c3 - m[1]  * c1 + m[2]  * c0) * det_inv;
+        out[14]    = (-m[12] * s3 + m[13] * s1 - m[14] * s0) * det_inv;
+        out[15]    = ( m[8]  * s3 - m[9]  * s1 + m[10] * s0) * det_inv;
+
+        return result;
+    }
+
+    BoundingBox reference_transform(const Matrix& m, const BoundingBox& box)
+    {
+        const Vector3 c      = box.GetCenter();
+        const Vector3 e      = box.GetExtents();
+        const Vector4 center = reference_transform(m, Vector4(c.x, c.y, c.z, 1.0f));
+        const Vector3 extent = Vector3(
+            fabs(m.m00) * e.x + fabs(m.m10) * e.y + fabs(m.m20) * e.z,
+            fabs(m.m01) * e.x + fabs(m.m11) * e.y + fabs(m.m21) * e.z,
+            fabs(m.m02) * e.x + fabs(m.m12) * e.y + fabs(m.m22) * e.z
+        );
+        const Vector3 center_new = Vector3(center.x, center.y, center.z) / center.w;
+
+        return BoundingBox(center_new - extent, center_new + extent);
+    }
+
+    Quaternion reference_multiply(const Quaternion& a, const Quaternion& b)
+    {
+        return Quaternion(
+            a.x * b.w + b.x * a.w + (a.y * b.z - a.z * b.y),
+            a.y * b.w + b.y * a.w + (a.z * b.x - a.x * b.z),
+            a.z * b.w + b.z * a.w + (a.x * b.y - a.y * b.x),
+            a.w * b.w - (a.x * b.x + a.y * b.y + a.z * b.z)
+        );
+    }
+
+    Vector3 reference_rotate(const Quaternion& q, const Vector3& v)
+    {
+        const Vector3 axis(q.x, q.y, q.z);
+        const Vector3 cross1 = axis.Cross(v);
+        const Vector3 cross2 = axis.Cross(cross1);
+        return v + 2.0f * (cross1 * q.w + cross2);
+    }
+
+    struct Random
+    {
+        mt19937 engine = mt19937(1234);
+
+        float Float(const float min, const float max) { return uniform_real_distribution<float>(min, max)(engine); }
+        Vector3 Vector(const float range)             { return Vector3(Float(-range, range), Float(-range, range), Float(-range, range)); }
+        Quaternion Rotation()                         { return Quaternion::FromEulerAngles(Float(-180.0f, 180.0f), Float(-180.0f, 180.0f), Float(-180.0f, 180.0f)); }
+        Matrix Transform()                            { return Matrix(Vector(100.0f), Rotation(), Vector3(Float(0.5f, 2.0f), Float(0.5f, 2.0f), Float(0.5f, 2.0f))); }
+    };
+
+    bool is_near(const Matrix& a, const Matrix& b, const float epsilon)
+    {
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            if (fabs(a.Data()[i] - b.Data()[i]) > epsilon * max(1.0f, fabs(b.Data()[i])))
+                return false;
+        }
+
+        return true;
+    }
+
+    bool is_near(const Vector3& a, const Vector3& b, const float epsilon)
+    {
+        return fabs(a.x - b.x) <= epsilon && fabs(a.y - b.y) <= epsilon && fabs(a.z - b.z) <= epsilon;
+    }
+}
+
+SP_TEST(math_matrix_multiply_matches_scalar)
+{
+    Random random;
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        const Matrix a = random.Transform();
+        const Matrix b = random.Transform();
+        SP_CHECK(is_near(a * b, reference_multiply(a, b), 1e-5f));
+    }
+}
+
+SP_TEST(math_matrix_inverse_is_inverse)
+{
+    Random random;
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        const Matrix m = random.Transform();
+        SP_CHECK(is_near(m * m.Inverted(), Matrix::Identity, 1e-4f));
+        SP_CHECK(is_near(m.Inverted(), reference_inverse(m), 1e-4f));
+    }
+}
+
+SP_TEST(math_matrix_transform_matches_scalar)
+{
+    Random random;
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        const Matrix m    = random.Transform();
+        const Vector3 p   = random.Vector(10.0f);
+        const Vector4 r   = reference_transform(m, Vector4(p.x, p.y, p.z, 1.0f));
+        const Vector4 r4  = m * Vector4(p.x, p.y, p.z, 1.0f);
+        SP_CHECK(is_near(m * p, Vector3(r.x, r.y, r.z) / r.w, 1e-3f));
+        SP_CHECK(is_near(Vector3(r4.x, r4.y, r4.z), Vector3(r.x, r.y, r.z), 1e-3f));
+        SP_CHECK_NEAR(r4.w, r.w, 1e-5f);
+    }
+}
+
+SP_TEST(math_quaternion_matches_scalar)
+{
+    Random random;
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        const Quaternion a = random.Rotation();
+        const Quaternion b = random.Rotation();
+        const Quaternion c = a * b;
+        const Quaternion r = reference_multiply(a, b);
+        SP_CHECK_NEAR(c.x, r.x, 1e-5f);
+        SP_CHECK_NEAR(c.y, r.y, 1e-5f);
+        SP_CHECK_NEAR(c.z, r.z, 1e-5f);
+        SP_CHECK_NEAR(c.w, r.w, 1e-5f);
+
+        const Vector3 v = random.Vector(10.0f);
+        SP_CHECK(is_near(a * v, reference_rotate(a, v), 1e-4f));
+    }
+}
+
+SP_TEST(math_bounding_box_transform_contains_corners)
+{
+    Random random;
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        const Vector3 center = random.Vector(10.0f);
+        const Vector3 extent = Vector3(random.Float(0.1f, 5.0f), random.Float(0.1f, 5.0f), random.Float(0.1f, 5.0f));
+        const BoundingBox box(center - extent, center + extent);
+        const Matrix m                = random.Transform();
+        const BoundingBox transformed = box.Transform(m);
+
+        for (uint32_t corner = 0; corner < 8; corner++)
+        {
+            const Vector3 local(
+                corner & 1 ? box.GetMax().x : box.GetMin().x,
+                corner & 2 ? box.GetMax().y : box.GetMin().y,
+                corner & 4 ? box.GetMax().z : box.GetMin().z
+            );
+            const Vector3 world = m * local;
+            const float epsilon = 1e-3f;
+            SP_CHECK(world.x >= transformed.GetMin().x - epsilon && world.x <= transformed.GetMax().x + epsilon);
+            SP_CHECK(world.y >= transformed.GetMin().y - epsilon && world.y <= transformed.GetMax().y + epsilon);
+            SP_CHECK(world.z >= transformed.GetMin().z - epsilon && world.z <= transformed.GetMax().z + epsilon);
+        }
+
+        const BoundingBox reference = reference_transform(m, box);
+        SP_CHECK(is_near(transformed.GetMin(), reference.GetMin(), 1e-3f) && is_near(transformed.GetMax(), reference.GetMax(), 1e-3f));
+    }
+}
+
+// every benchmark chains its results so that no call can be skipped or hoisted out of the loop,
+// the inputs are rigid transforms and rotations so that the chains stay finite
+SP_BENCHMARK(math_ns_per_op)
+{
+    const uint32_t iterations = 10'000'000;
+    Random random;
+    const Matrix transform = Matrix(Vector3(1.0f, 2.0f, 3.0f), random.Rotation(), Vector3::One);
+    const Quaternion rotation = random.Rotation();
+    char label[64];
+
+    printf("    backend: %s\n", get_backend_name());
+
+    {
+        Matrix m = transform;
+        snprintf(label, sizeof(label), "matrix multiply (%s)", get_backend_name());
+        Test::Report(label, Test::Measure(iterations, [&](uint32_t) { m = m * transform; }), "ns/op");
+        Test::Keep(m);
+
+        m = transform;
+        Test::Report("matrix multiply (scalar reference)", Test::Measure(iterations, [&](uint32_t) { m = reference_multiply(m, transform); }), "ns/op");
+        Test::Keep(m);
+    }
+
+    {
+        Matrix m = transform;
+        snprintf(label, sizeof(label), "matrix inverse (%s)", get_backend_name());
+        Test::Report(label, Test::Measure(iterations, [&](uint32_t) { m = m.Inverted(); }), "ns/op");
+        Test::Keep(m);
+
+        m = transform;
+        Test::Report("matrix inverse (scalar reference)", Test::Measure(iterations, [&](uint32_t) { m = reference_inverse(m); }), "ns/op");
+        Test::Keep(m);
+    }
+
+    {
+        Vector3 v = Vector3(1.0f, 2.0f, 3.0f);
+        // the vector transforms are scalar on every backend, see MathSimd.h
+        Test::Report("matrix * vector3", Test::Measure(iterations, [&](uint32_t) { v = transform * v; v *= 0.5f; }), "ns/op");
+        Test::Keep(v);
+
+        Vector4 v4 = Vector4(1.0f, 2.0f, 3.0f, 1.0f);
+        Test::Report("matrix * vector4", Test::Measure(iterations, [&](uint32_t) { v4 = transform * v4; v4.w = 1.0f; v4 = v4 * 0.5f; }), "ns/op");
+        Test::Keep(v4);
+
+        v4 = Vector4(1.0f, 2.0f, 3.0f, 1.0f);
+        Test::Report("matrix * vector4 (scalar reference)", Test::Measure(iterations, [&](uint32_t) { v4 = reference_transform(transform, v4); v4.w = 1.0f; v4 = v4 * 0.5f; }), "ns/op");
+        Test::Keep(v4);
+    }
+
+    {
+        Quaternion q = rotation;
+        snprintf(label, sizeof(label), "quaternion multiply (%s)", get_backend_name());
+        Test::Report(label, Test::Measure(iterations, [&](uint32_t) { q = q * rotation; }), "ns/op");
+        Test::Keep(q);
+
+        q = rotation;
+        Test::Report("quaternion multiply (scalar reference)", Test::Measure(iterations, [&](uint32_t) { q = reference_multiply(q, rotation); }), "ns/op");
+        Test::Keep(q);
+
+        Vector3 v = Vector3(1.0f, 2.0f, 3.0f);
+        snprintf(label, sizeof(label), "quaternion * vector3 (%s)", get_backend_name());
+        Test::Report(label, Test::Measure(iterations, [&](uint32_t) { v = rotation * v; }), "ns/op");
+        Test::Keep(v);
+
+        v = Vector3(1.0f, 2.0f, 3.0f);
+        Test::Report("quaternion * vector3 (scalar reference)", Test::Measure(iterations, [&](uint32_t) { v = reference_rotate(rotation, v); }), "ns/op");
+        Test::Keep(v);
+    }
+
+    {
+        BoundingBox box(Vector3(-1.0f, -1.0f, -1.0f), Vector3(1.0f, 1.0f, 1.0f));
+        Test::Report("bounding box transform", Test::Measure(iterations, [&](uint32_t) { box = box.Transform(transform); box = BoundingBox(box.GetMin() * 0.5f, box.GetMax() * 0.5f); }), "ns/op");
+        Test::Keep(box);
+
+        box = BoundingBox(Vector3(-1.0f, -1.0f, -1.0f), Vector3(1.0f, 1.0f, 1.0f));
+        Test::Report("bounding box transform (scalar reference)", Test::Measure(iterations, [&](uint32_t) { box = reference_transform(transform, box); box = BoundingBox(box.GetMin() * 0.5f, box.GetMax() * 0.5f); }), "ns/op");
+        Test::Keep(box);
+    }
+}
@@ -0,0 +1,281 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES ==================
+#include "Test.h"
+#include "Rendering/Mesh.h"
+#include "Rendering/Geometry.h"
+#include "IO/FileStream.h"
+#include "ThreadPool.h"
+#include <filesystem>
+#include <cstring>
+#include <fstream>
+//=============================
+
+//= NAMESPACES ===============
+using namespace std;
+using namespace Spartan;
+using namespace Spartan::Math;
+//============================
+
+// the v2 format (chunked meshoptimizer codecs) is round-tripped lossless and quantized, v1 files (raw geometry) still load,
+// and a truncated or corrupt file fails to load without leaving any geometry behind
+namespace
+{
+    // next to the executable, resource paths are relative to the working directory
+    string get_file_path(const char* name)
+    {
+        return name;
+    }
+
+    // the foreign file a mesh was imported from, it's saved with the geometry and has to exist to be set
+    const string& get_resource_path()
+    {
+        static const string file_path = get_file_path("spartan_test.obj");
+        if (!filesystem::exists(file_path))
+        {
+            ofstream(file_path).put('\n');
+        }
+
+        return file_path;
+    }
+
+    void create_geometry(Mesh& mesh, const int resolution)
+    {
+        vector<RHI_Vertex_PosTexNorTan> vertices;
+        vector<uint32_t> indices;
+        Geometry::CreateSphere(&vertices, &indices, 2.0f, resolution, resolution);
+
+        mesh.SetResourceFilePath(get_resource_path());
+        mesh.AddIndices(indices);
+        mesh.AddVertices(vertices);
+    }
+
+    void save_v1(Mesh& mesh, const string& file_path)
+    {
+        FileStream file(file_path, FileStream_Write);
+        file.Write(mesh.GetResourceFilePath());
+        file.Write(mesh.GetIndices());
+        file.Write(mesh.GetVertices());
+        file.Close();
+    }
+
+    vector<char> read_bytes(const string& file_path)
+    {
+        ifstream file(file_path, ios::binary);
+        return vector<char>(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    }
+
+    void write_bytes(const string& file_path, const vector<char>& bytes, const size_t size)
+    {
+        ofstream file(file_path, ios::binary | ios::trunc);
+        file.write(bytes.data(), size);
+    }
+
+    // the index codec is free to rotate the indices of a triangle, the winding and the order of the triangles are kept
+    bool triangles_match(const vector<uint32_t>& a, const vector<uint32_t>& b)
+    {
+        if (a.size() != b.size())
+            return false;
+
+        for (size_t i = 0; i < a.size(); i += 3)
+        {
+            bool match = false;
+            for (size_t rotation = 0; rotation < 3; rotation++)
+            {
+                match = match || (a[i] == b[i + rotation] && a[i + 1] == b[i + (rotation + 1) % 3] && a[i + 2] == b[i + (rotation + 2) % 3]);
+            }
+
+            if (!match)
+                return false;
+        }
+
+        return true;
+    }
+
+    // tolerance is relative, every float keeps its own exponent
+    bool vertices_match(const vector<RHI_Vertex_PosTexNorTan>& a, const vector<RHI_Vertex_PosTexNorTan>& b, const float tolerance)
+    {
+        if (a.size() != b.size())
+            return false;
+
+        const uint32_t float_count = static_cast<uint32_t>(a.size() * sizeof(RHI_Vertex_PosTexNorTan) / sizeof(float));
+        const float* floats_a      = &a[0].pos[0];
+        const float* floats_b      = &b[0].pos[0];
+        for (uint32_t i = 0; i < float_count; i++)
+        {
+            if (fabs(floats_a[i] - floats_b[i]) > fabs(floats_a[i]) * tolerance)
+                return false;
+        }
+
+        return true;
+    }
+}
+
+SP_TEST(mesh_file_round_trip)
+{
+    Mesh mesh;
+    create_geometry(mesh, 128);
+
+    // v2, lossless
+    {
+        const string file_path = get_file_path("spartan_test_lossless.model");
+        SP_CHECK(mesh.SaveToFile(file_path));
+
+        Mesh loaded;
+        SP_CHECK(loaded.LoadGeometryFromFile(file_path));
+        SP_CHECK(!loaded.GetResourceFilePath().empty() && loaded.GetResourceFilePath() == mesh.GetResourceFilePath());
+        SP_CHECK(triangles_match(loaded.GetIndices(), mesh.GetIndices()));
+        SP_CHECK(vertices_match(loaded.GetVertices(), mesh.GetVertices(), 0.0f));
+
+        filesystem::remove(file_path);
+    }
+
+    // v2, quantized
+    {
+        const string file_path = get_file_path("spartan_test_quantized.model");
+        mesh.SetFlags(mesh.GetFlags() | static_cast<uint32_t>(MeshFlags::SaveQuantized));
+        SP_CHECK(mesh.SaveToFile(file_path));
+        mesh.SetFlags(mesh.GetFlags() & ~static_cast<uint32_t>(MeshFlags::SaveQuantized));
+
+        Mesh loaded;
+        SP_CHECK(loaded.LoadGeometryFromFile(file_path));
+        SP_CHECK(triangles_match(loaded.GetIndices(), mesh.GetIndices()));
+        SP_CHECK(vertices_match(loaded.GetVertices(), mesh.GetVertices(), 1.0f / 16384.0f));
+
+        filesystem::remove(file_path);
+    }
+
+    // v1
+    {
+        const string file_path = get_file_path("spartan_test_v1.model");
+        save_v1(mesh, file_path);
+
+        Mesh loaded;
+        SP_CHECK(loaded.LoadGeometryFromFile(file_path));
+        SP_CHECK(loaded.GetResourceFilePath() == mesh.GetResourceFilePath());
+        SP_CHECK(loaded.GetIndices() == mesh.GetIndices());
+        SP_CHECK(vertices_match(loaded.GetVertices(), mesh.GetVertices(), 0.0f));
+
+        filesystem::remove(file_path);
+    }
+}
+
+SP_TEST(mesh_file_corrupt)
+{
+    Mesh mesh;
+    create_geometry(mesh, 128);
+
+    const string file_path = get_file_path("spartan_test_corrupt.model");
+    SP_CHECK(mesh.SaveToFile(file_path));
+    const vector<char> bytes = read_bytes(file_path);
+
+    // loading into a mesh which already has geometry, so that a failure can't pass by leaving the old geometry untouched
+    auto load_fails = [&file_path, &mesh]()
+    {
+        Mesh loaded;
+        create_geometry(loaded, 8);
+        const bool result = loaded.LoadGeometryFromFile(file_path);
+        return !result && loaded.GetIndexCount() == 0 && loaded.GetVertexCount() == 0;
+    };
+
+    // truncated in the middle of the last vertex chunk, and right after the header
+    write_bytes(file_path, bytes, bytes.size() - 100);
+    SP_CHECK(load_fails());
+    write_bytes(file_path, bytes, 64);
+    SP_CHECK(load_fails());
+
+    // the header byte of the first index chunk, which follows the magic, the version, the resource path, the counts, the quantization flag and the chunk size
+    {
+        const size_t offset = (4 + strlen("spartan_mesh")) + 4 + (4 + mesh.GetResourceFilePath().size()) + 4 + 4 + 1 + 4;
+        vector<char> bytes_corrupt = bytes;
+        bytes_corrupt[offset]      = static_cast<char>(0xff);
+        write_bytes(file_path, bytes_corrupt, bytes_corrupt.size());
+        SP_CHECK(load_fails());
+    }
+
+    // indices which decode fine but point past the vertices
+    {
+        Mesh mesh_out_of_range;
+        create_geometry(mesh_out_of_range, 8);
+        mesh_out_of_range.GetIndices()[5] = mesh_out_of_range.GetVertexCount();
+        SP_CHECK(mesh_out_of_range.SaveToFile(file_path));
+        SP_CHECK(load_fails());
+    }
+
+    // and the untouched file still loads
+    write_bytes(file_path, bytes, bytes.size());
+    Mesh loaded;
+    SP_CHECK(loaded.LoadGeometryFromFile(file_path));
+    SP_CHECK(triangles_match(loaded.GetIndices(), mesh.GetIndices()));
+
+    filesystem::remove(file_path);
+}
+
+SP_BENCHMARK(mesh_file_load_v1_vs_v2)
+{
+    // the chunks of a v2 file are decoded in parallel
+    ThreadPool::Initialize();
+    printf("    worker threads: %u\n", ThreadPool::GetThreadCount());
+
+    const uint32_t iterations = 20;
+
+    Mesh mesh;
+    create_geometry(mesh, 1024);
+    printf("    %u vertices, %u indices\n", mesh.GetVertexCount(), mesh.GetIndexCount());
+
+    const string file_path_v1 = get_file_path("spartan_benchmark_v1.model");
+    const string file_path_v2 = get_file_path("spartan_benchmark_v2.model");
+    const string file_path_q  = get_file_path("spartan_benchmark_quantized.model");
+    save_v1(mesh, file_path_v1);
+    mesh.SaveToFile(file_path_v2);
+    mesh.SetFlags(mesh.GetFlags() | static_cast<uint32_t>(MeshFlags::SaveQuantized));
+    mesh.SaveToFile(file_path_q);
+
+    auto measure = [iterations](const string& file_path)
+    {
+        Mesh loaded;
+        const double ns = Test::Measure(iterations, [&](uint32_t)
+        {
+            loaded.LoadGeometryFromFile(file_path);
+        });
+        Test::Keep(loaded.GetVertexCount());
+
+        return ns;
+    };
+
+    const double ns_v1 = measure(file_path_v1);
+    const double ns_v2 = measure(file_path_v2);
+    const double ns_q  = measure(file_path_q);
+
+    Test::Report("v1 size", static_cast<double>(filesystem::file_size(file_path_v1)) / (1024.0 * 1024.0), "MB");
+    Test::Report("v2 size", static_cast<double>(filesystem::file_size(file_path_v2)) / (1024.0 * 1024.0), "MB");
+    Test::Report("v2 quantized size", static_cast<double>(filesystem::file_size(file_path_q)) / (1024.0 * 1024.0), "MB");
+    Test::Report("v1 load", ns_v1 / 1'000'000.0, "ms");
+    Test::Report("v2 load", ns_v2 / 1'000'000.0, "ms");
+    Test::Report("v2 quantized load", ns_q / 1'000'000.0, "ms");
+
+    filesystem::remove(file_path_v1);
+    filesystem::remove(file_path_v2);
+    filesystem::remove(file_path_q);
+
+    ThreadPool::Shutdown();
+}
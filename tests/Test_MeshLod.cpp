@@ -0,0 +1,142 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES ===========================
+#include "Test.h"
+#include "Rendering/Mesh.h"
+#include "Rendering/Geometry.h"
+#include "World/Components/Renderable.h"
+//======================================
+
+//= NAMESPACES ===============
+using namespace std;
+using namespace Spartan;
+using namespace Spartan::Math;
+//============================
+
+// a known sphere goes through the same steps as ModelImporter's mesh processing, the lod chain is computed,
+// appended after the original indices and added to a mesh which already holds another model's geometry
+namespace
+{
+    const float sphere_radius = 2.0f;
+
+    struct ImportedGeometry
+    {
+        uint32_t index_offset     = 0;
+        uint32_t index_count_lod0 = 0;
+        vector<RenderableLod> lods;
+    };
+
+    ImportedGeometry import_geometry(Mesh& mesh, vector<uint32_t> indices, const vector<RHI_Vertex_PosTexNorTan>& vertices)
+    {
+        ImportedGeometry geometry;
+        geometry.index_count_lod0 = static_cast<uint32_t>(indices.size());
+
+        for (MeshLod& lod : Mesh::ComputeLods(indices, vertices))
+        {
+            RenderableLod& renderable_lod = geometry.lods.emplace_back();
+            renderable_lod.index_offset   = static_cast<uint32_t>(indices.size());
+            renderable_lod.index_count    = static_cast<uint32_t>(lod.indices.size());
+            renderable_lod.error          = lod.error;
+
+            indices.insert(indices.end(), lod.indices.begin(), lod.indices.end());
+        }
+
+        uint32_t vertex_offset = 0;
+        mesh.AddIndices(indices, &geometry.index_offset);
+        mesh.AddVertices(vertices, &vertex_offset);
+
+        for (RenderableLod& lod : geometry.lods)
+        {
+            lod.index_offset += geometry.index_offset;
+        }
+
+        return geometry;
+    }
+
+    // the distance of a triangle's centroid from the sphere's surface, a simplified sphere caves in, so this grows with the error
+    float get_centroid_deviation(const vector<RHI_Vertex_PosTexNorTan>& vertices, const uint32_t* triangle)
+    {
+        Vector3 centroid = Vector3::Zero;
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            const float* position = vertices[triangle[i]].pos;
+            centroid             += Vector3(position[0], position[1], position[2]) / 3.0f;
+        }
+
+        return fabs(sphere_radius - centroid.Length());
+    }
+}
+
+SP_TEST(mesh_lod_chain)
+{
+    vector<RHI_Vertex_PosTexNorTan> vertices;
+    vector<uint32_t> indices;
+    Geometry::CreateSphere(&vertices, &indices, sphere_radius, 128, 128);
+    SP_CHECK(indices.size() >= mesh_lod_index_min);
+
+    // something already lives in the mesh, so the offsets have to be carried over
+    Mesh mesh;
+    {
+        vector<RHI_Vertex_PosTexNorTan> cube_vertices;
+        vector<uint32_t> cube_indices;
+        Geometry::CreateCube(&cube_vertices, &cube_indices);
+        import_geometry(mesh, cube_indices, cube_vertices);
+    }
+
+    const ImportedGeometry geometry = import_geometry(mesh, indices, vertices);
+    SP_CHECK(geometry.index_offset != 0);
+    SP_CHECK(geometry.lods.size() == mesh_lod_count - 1);
+
+    const vector<uint32_t>& mesh_indices = mesh.GetIndices();
+    const float extent                   = sphere_radius * 2.0f;
+    uint32_t index_end                   = geometry.index_offset + geometry.index_count_lod0;
+    uint32_t index_count_previous        = geometry.index_count_lod0;
+    for (const RenderableLod& lod : geometry.lods)
+    {
+        // contiguous, every level starts where the previous one ends and the chain ends with the mesh
+        SP_CHECK(lod.index_offset == index_end);
+        SP_CHECK(lod.index_count % 3 == 0);
+        index_end = lod.index_offset + lod.index_count;
+
+        // about half of the previous level
+        const float ratio = static_cast<float>(lod.index_count) / static_cast<float>(index_count_previous);
+        SP_CHECK_NEAR(ratio, mesh_lod_index_ratio, 0.1f);
+        index_count_previous = lod.index_count;
+
+        // within the error bound, both as reported by the simplifier and as measured on the surface
+        SP_CHECK(lod.error >= 0.0f && lod.error <= mesh_lod_error_max);
+        float deviation_max = 0.0f;
+        for (uint32_t i = lod.index_offset; i < lod.index_offset + lod.index_count; i += 3)
+        {
+            SP_CHECK(mesh_indices[i + 0] < vertices.size() && mesh_indices[i + 1] < vertices.size() && mesh_indices[i + 2] < vertices.size());
+            deviation_max = max(deviation_max, get_centroid_deviation(vertices, &mesh_indices[i]));
+        }
+        SP_CHECK(deviation_max <= mesh_lod_error_max * extent);
+    }
+    SP_CHECK(index_end == mesh.GetIndexCount());
+
+    // geometry below the threshold isn't simplified at all
+    vector<RHI_Vertex_PosTexNorTan> cube_vertices;
+    vector<uint32_t> cube_indices;
+    Geometry::CreateCube(&cube_vertices, &cube_indices);
+    SP_CHECK(Mesh::ComputeLods(cube_indices, cube_vertices).empty());
+}
@@ -0,0 +1,212 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES ==========================
+#include "Test.h"
+#include "Rendering/OcclusionBuffer.h"
+#include "Math/Vector4.h"
+#include <random>
+//=====================================
+
+//= NAMESPACES ===============
+using namespace std;
+using namespace Spartan;
+using namespace Spartan::Math;
+//============================
+
+// a wall faces the camera, which looks straight at it, so the truth is simple: a box is hidden if it's entirely behind the wall
+// and its screen rectangle is within the wall's, boxes reported as hidden are checked against that, the rasterizer's avx path
+// is checked against its scalar one
+namespace
+{
+    const float near_plane = 0.1f;
+    const float wall_z     = 40.0f;
+    const Vector3 wall_min = Vector3(-12.0f, -6.0f, wall_z);
+    const Vector3 wall_max = Vector3(12.0f, 6.0f, wall_z);
+
+    Matrix create_view_projection()
+    {
+        const float aspect_ratio = static_cast<float>(OcclusionBuffer::width) / static_cast<float>(OcclusionBuffer::height);
+        const Matrix view        = Matrix::CreateLookAtLH(Vector3::Zero, Vector3::Forward, Vector3::Up);
+        const Matrix projection  = Matrix::CreatePerspectiveFieldOfViewLH(1.0f, aspect_ratio, near_plane, 1000.0f);
+
+        return view * projection;
+    }
+
+    // the wall and a few tilted slabs, so that the rasterizer sees more than axis aligned edges
+    void create_occluders(vector<Vector3>* vertices, vector<uint32_t>* indices, vector<Matrix>* transforms)
+    {
+        *vertices =
+        {
+            Vector3(wall_min.x, wall_min.y, wall_z), Vector3(wall_min.x, wall_max.y, wall_z),
+            Vector3(wall_max.x, wall_max.y, wall_z), Vector3(wall_max.x, wall_min.y, wall_z)
+        };
+        *indices = { 0, 1, 2, 0, 2, 3 };
+
+        transforms->push_back(Matrix::Identity);
+        mt19937 engine(4321);
+        uniform_real_distribution<float> angle(-0.8f, 0.8f);
+        uniform_real_distribution<float> offset(-30.0f, 30.0f);
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            const Quaternion rotation = Quaternion::FromYawPitchRoll(angle(engine), angle(engine), angle(engine));
+            transforms->push_back(Matrix(Vector3(offset(engine), offset(engine) * 0.5f, 60.0f + offset(engine)), rotation, Vector3(0.3f, 0.3f, 1.0f)));
+        }
+    }
+
+    vector<BoundingBox> create_boxes(const uint32_t count)
+    {
+        mt19937 engine(1234);
+        uniform_real_distribution<float> position_x(-35.0f, 35.0f);
+        uniform_real_distribution<float> position_y(-17.0f, 17.0f);
+        uniform_real_distribution<float> position_z(5.0f, 120.0f);
+        uniform_real_distribution<float> size(0.05f, 4.0f);
+
+        vector<BoundingBox> boxes(count);
+        for (BoundingBox& box : boxes)
+        {
+            const Vector3 center = Vector3(position_x(engine), position_y(engine), position_z(engine));
+            const Vector3 extent = Vector3(size(engine), size(engine), size(engine)) * 0.5f;
+            box                  = BoundingBox(center - extent, center + extent);
+        }
+
+        return boxes;
+    }
+
+    // x, y in pixels, the same mapping as the occlusion buffer
+    Vector3 project(const Matrix& view_projection, const Vector3& position)
+    {
+        const Vector4 clip = view_projection * Vector4(position, 1.0f);
+        return Vector3(
+            (clip.x / clip.w * 0.5f + 0.5f) * static_cast<float>(OcclusionBuffer::width),
+            (0.5f - clip.y / clip.w * 0.5f) * static_cast<float>(OcclusionBuffer::height),
+            clip.w
+        );
+    }
+
+    // margin in pixels, coverage is sampled at pixel centers so a box can overhang the wall by less than a pixel and still be hidden
+    bool is_behind_wall(const Matrix& view_projection, const BoundingBox& box, const float margin)
+    {
+        if (box.GetMin().z < wall_z)
+            return false;
+
+        const Vector3 wall_top_left     = project(view_projection, Vector3(wall_min.x, wall_max.y, wall_z));
+        const Vector3 wall_bottom_right = project(view_projection, Vector3(wall_max.x, wall_min.y, wall_z));
+        for (uint32_t i = 0; i < 8; i++)
+        {
+            const Vector3 corner = project(view_projection, Vector3(
+                (i & 1) ? box.GetMax().x : box.GetMin().x,
+                (i & 2) ? box.GetMax().y : box.GetMin().y,
+                (i & 4) ? box.GetMax().z : box.GetMin().z
+            ));
+
+            if (corner.x < wall_top_left.x - margin || corner.x > wall_bottom_right.x + margin ||
+                corner.y < wall_top_left.y - margin || corner.y > wall_bottom_right.y + margin)
+                return false;
+        }
+
+        return true;
+    }
+}
+
+SP_TEST(occlusion_buffer_no_false_occlusion)
+{
+    const Matrix view_projection = create_view_projection();
+    vector<Vector3> vertices;
+    vector<uint32_t> indices;
+    vector<Matrix> transforms;
+    create_occluders(&vertices, &indices, &transforms);
+
+    // only the wall, so that the truth is known
+    OcclusionBuffer buffer;
+    buffer.Begin(view_projection, near_plane);
+    buffer.AddOccluder(Matrix::Identity, &vertices, &indices);
+    buffer.Rasterize();
+    SP_CHECK(buffer.GetTriangleCount() == 2);
+
+    const vector<BoundingBox> boxes = create_boxes(20'000);
+    uint32_t false_occlusions       = 0;
+    uint32_t hidden                 = 0;
+    uint32_t hidden_reported        = 0;
+    for (const BoundingBox& box : boxes)
+    {
+        const bool visible = buffer.IsVisible(box);
+        false_occlusions  += (!visible && !is_behind_wall(view_projection, box, 1.0f)) ? 1 : 0;
+
+        // boxes well within the wall's rectangle have to be culled, or the buffer is of no use
+        if (is_behind_wall(view_projection, box, -1.0f))
+        {
+            hidden++;
+            hidden_reported += visible ? 0 : 1;
+        }
+    }
+
+    printf("    %u boxes fully behind the wall, %u of them culled, %u false occlusions\n", hidden, hidden_reported, false_occlusions);
+    SP_CHECK(false_occlusions == 0);
+    SP_CHECK(hidden > 1000);
+    SP_CHECK(hidden_reported == hidden);
+
+    // without occluders everything is visible
+    buffer.Begin(view_projection, near_plane);
+    SP_CHECK(buffer.IsVisible(boxes[0]));
+}
+
+SP_TEST(occlusion_buffer_simd_matches_scalar)
+{
+    const Matrix view_projection = create_view_projection();
+    vector<Vector3> vertices;
+    vector<uint32_t> indices;
+    vector<Matrix> transforms;
+    create_occluders(&vertices, &indices, &transforms);
+
+    OcclusionBuffer buffers[2];
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        buffers[i].SetSimd(i == 1);
+        buffers[i].Begin(view_projection, near_plane);
+        for (const Matrix& transform : transforms)
+        {
+            buffers[i].AddOccluder(transform, &vertices, &indices);
+        }
+        buffers[i].Rasterize();
+    }
+
+    const vector<float>& depth_scalar = buffers[0].GetDepth();
+    const vector<float>& depth_simd   = buffers[1].GetDepth();
+    uint32_t covered                  = 0;
+    uint32_t mismatches               = 0;
+    for (size_t i = 0; i < depth_scalar.size(); i++)
+    {
+        covered    += depth_scalar[i] > 0.0f ? 1 : 0;
+        mismatches += fabs(depth_scalar[i] - depth_simd[i]) > depth_scalar[i] * 1e-5f ? 1 : 0;
+    }
+
+    SP_CHECK(covered > 0);
+    SP_CHECK(mismatches == 0);
+
+    // and so do the answers
+    uint32_t answer_mismatches = 0;
+    for (const BoundingBox& box : create_boxes(20'000))
+    {
+        answer_mismatches += buffers[0].IsVisible(box) != buffers[1].IsVisible(box) ? 1 : 0;
+    }
+    SP_CHECK(answer_mismatches == 0);
+}
@@ -0,0 +1,281 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES ================
+#include "Test.h"
+#include "RangeAllocator.h"
+#include <map>
+#include <random>
+//===========================
+
+//= NAMESPACES ===============
+using namespace std;
+using namespace Spartan;
+//============================
+
+// the allocator is checked against a plain map of the live allocations, which is the reference for what may and may not overlap
+namespace
+{
+    bool overlaps(const uint64_t offset_a, const uint64_t size_a, const uint64_t offset_b, const uint64_t size_b)
+    {
+        return offset_a < offset_b + size_b && offset_b < offset_a + size_a;
+    }
+
+    bool overlaps_any(const map<uint64_t, uint64_t>& allocations, const uint64_t offset, const uint64_t size)
+    {
+        for (const auto& [offset_allocation, size_allocation] : allocations)
+        {
+            if (overlaps(offset, size, offset_allocation, size_allocation))
+                return true;
+        }
+
+        return false;
+    }
+
+    // allocates and frees at random, the allocator has to stay consistent with the reference throughout
+    void churn(RangeAllocator& allocator, map<uint64_t, uint64_t>& allocations, mt19937& engine, const uint32_t size_min, const uint32_t size_max, const uint32_t operation_count)
+    {
+        uniform_int_distribution<uint32_t> size(size_min, size_max);
+        uniform_int_distribution<uint32_t> coin(0, 2);
+
+        for (uint32_t i = 0; i < operation_count; i++)
+        {
+            if (coin(engine) != 0 || allocations.empty())
+            {
+                const uint64_t size_allocation = size(engine);
+                const uint64_t offset          = allocator.Allocate(size_allocation);
+                if (offset == RangeAllocator::offset_invalid)
+                    continue;
+
+                SP_CHECK(offset + size_allocation <= allocator.GetCapacity());
+                SP_CHECK(!overlaps_any(allocations, offset, size_allocation));
+                allocations[offset] = size_allocation;
+            }
+            else
+            {
+                auto it = allocations.begin();
+                advance(it, uniform_int_distribution<size_t>(0, allocations.size() - 1)(engine));
+                allocator.Free(it->first);
+                allocations.erase(it);
+            }
+        }
+    }
+
+    // frees every n-th allocation, so that there are holes to fill regardless of how full the churn left the allocator
+    void punch_holes(RangeAllocator& allocator, map<uint64_t, uint64_t>& allocations, const uint32_t n)
+    {
+        uint32_t i = 0;
+        for (auto it = allocations.begin(); it != allocations.end();)
+        {
+            if (i++ % n == 0)
+            {
+                allocator.Free(it->first);
+                it = allocations.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    uint64_t get_allocated_size(const map<uint64_t, uint64_t>& allocations)
+    {
+        uint64_t size = 0;
+        for (const auto& [offset, size_allocation] : allocations)
+        {
+            size += size_allocation;
+        }
+
+        return size;
+    }
+
+    // every move goes into space which is free at the time it's made and never overlaps its own source
+    void defragment(RangeAllocator& allocator, map<uint64_t, uint64_t>& allocations)
+    {
+        for (const RangeAllocatorMove& move : allocator.Defragment())
+        {
+            auto it = allocations.find(move.offset_source);
+            SP_CHECK(it != allocations.end() && it->second == move.size);
+            SP_CHECK(move.offset_destination < move.offset_source);
+            SP_CHECK(!overlaps(move.offset_source, move.size, move.offset_destination, move.size));
+
+            allocations.erase(move.offset_source);
+            SP_CHECK(!overlaps_any(allocations, move.offset_destination, move.size));
+            allocations[move.offset_destination] = move.size;
+        }
+
+        SP_CHECK(allocator.GetAllocationCount() == allocations.size());
+        SP_CHECK(allocator.GetAllocatedSize() == get_allocated_size(allocations));
+    }
+}
+
+SP_TEST(range_allocator_best_fit)
+{
+    // [a 10][b 30][c 10][d 20][e 10][15 free]
+    RangeAllocator allocator(95);
+    const uint64_t a = allocator.Allocate(10);
+    const uint64_t b = allocator.Allocate(30);
+    const uint64_t c = allocator.Allocate(10);
+    const uint64_t d = allocator.Allocate(20);
+    const uint64_t e = allocator.Allocate(10);
+    SP_CHECK(a == 0 && b == 10 && c == 40 && d == 50 && e == 70);
+
+    // holes of 30, 20 and 15, an 18 goes into the 20, not the first one large enough
+    allocator.Free(b);
+    allocator.Free(d);
+    SP_CHECK(allocator.GetFreeRangeCount() == 3);
+    SP_CHECK(allocator.Allocate(18) == d);
+    SP_CHECK(allocator.Allocate(25) == b);
+    SP_CHECK(allocator.Allocate(15) == 80);
+
+    // what's left are remainders of 5 and 2
+    SP_CHECK(allocator.GetFreeRangeLargest() == 5);
+    SP_CHECK(allocator.Allocate(6) == RangeAllocator::offset_invalid);
+    SP_CHECK(allocator.Allocate(5) == b + 25);
+}
+
+SP_TEST(range_allocator_coalescing)
+{
+    RangeAllocator allocator(40);
+    const uint64_t a = allocator.Allocate(10);
+    const uint64_t b = allocator.Allocate(10);
+    const uint64_t c = allocator.Allocate(10);
+    const uint64_t d = allocator.Allocate(10);
+    SP_CHECK(allocator.GetFreeRangeCount() == 0);
+
+    // no free neighbours
+    allocator.Free(b);
+    SP_CHECK(allocator.GetFreeRangeCount() == 1);
+
+    // merges with the range which precedes
+    allocator.Free(c);
+    SP_CHECK(allocator.GetFreeRangeCount() == 1);
+    SP_CHECK(allocator.GetFreeRangeLargest() == 20);
+
+    // merges with the range which follows
+    allocator.Free(a);
+    SP_CHECK(allocator.GetFreeRangeCount() == 1);
+    SP_CHECK(allocator.GetFreeRangeLargest() == 30);
+
+    // both sides at once
+    const uint64_t e = allocator.Allocate(10);
+    const uint64_t f = allocator.Allocate(10);
+    const uint64_t g = allocator.Allocate(10);
+    SP_CHECK(e == 0 && f == 10 && g == 20);
+    allocator.Free(e);
+    allocator.Free(g);
+    SP_CHECK(allocator.GetFreeRangeCount() == 2);
+    allocator.Free(f);
+    SP_CHECK(allocator.GetFreeRangeCount() == 1);
+    SP_CHECK(allocator.GetFreeRangeLargest() == 30);
+    SP_CHECK(allocator.GetFragmentation() == 0.0f);
+
+    // and back to the full capacity
+    allocator.Free(d);
+    SP_CHECK(allocator.GetFreeRangeCount() == 1);
+    SP_CHECK(allocator.GetFreeRangeLargest() == allocator.GetCapacity());
+    SP_CHECK(allocator.GetAllocatedSize() == 0 && allocator.GetAllocationCount() == 0);
+}
+
+SP_TEST(range_allocator_full)
+{
+    RangeAllocator allocator(64);
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        SP_CHECK(allocator.Allocate(8) == i * 8);
+    }
+
+    SP_CHECK(allocator.GetAllocatedSize() == allocator.GetCapacity());
+    SP_CHECK(allocator.GetFreeRangeCount() == 0);
+    SP_CHECK(allocator.GetFreeRangeLargest() == 0);
+    SP_CHECK(allocator.GetFragmentation() == 0.0f);
+    SP_CHECK(allocator.Allocate(1) == RangeAllocator::offset_invalid);
+
+    // one freed range is reusable, but not by something larger
+    allocator.Free(24);
+    SP_CHECK(allocator.Allocate(9) == RangeAllocator::offset_invalid);
+    SP_CHECK(allocator.Allocate(8) == 24);
+
+    // an allocator without capacity never hands anything out
+    RangeAllocator allocator_empty;
+    SP_CHECK(allocator_empty.Allocate(1) == RangeAllocator::offset_invalid);
+}
+
+SP_TEST(range_allocator_defragment)
+{
+    mt19937 engine(1234);
+
+    // allocations of one size always fit into the holes they leave, so the free space ends up in one piece, at the end
+    {
+        RangeAllocator allocator(4096);
+        map<uint64_t, uint64_t> allocations;
+        churn(allocator, allocations, engine, 16, 16, 2000);
+        punch_holes(allocator, allocations, 3);
+        SP_CHECK(allocator.GetFreeRangeCount() > 1);
+
+        defragment(allocator, allocations);
+        SP_CHECK(allocator.GetFreeRangeCount() == 1);
+        SP_CHECK(allocator.GetFragmentation() == 0.0f);
+        SP_CHECK(allocator.GetFreeRangeLargest() == allocator.GetCapacity() - allocator.GetAllocatedSize());
+        SP_CHECK(allocations.empty() || allocations.rbegin()->first + allocations.rbegin()->second == allocator.GetAllocatedSize());
+    }
+
+    // mixed sizes, an allocation only moves into a hole which can hold it, and compaction may stop before the free space is in one piece
+    {
+        RangeAllocator allocator(1 << 16);
+        map<uint64_t, uint64_t> allocations;
+        churn(allocator, allocations, engine, 1, 512, 4000);
+        punch_holes(allocator, allocations, 3);
+
+        const float fragmentation = allocator.GetFragmentation();
+        SP_CHECK(fragmentation > 0.0f);
+        defragment(allocator, allocations);
+        SP_CHECK(allocator.GetFragmentation() < fragmentation);
+
+        // and it keeps working afterwards
+        churn(allocator, allocations, engine, 1, 512, 1000);
+        defragment(allocator, allocations);
+    }
+
+    // a bounded number of moves per call, repeated calls converge
+    {
+        RangeAllocator allocator(4096);
+        map<uint64_t, uint64_t> allocations;
+        churn(allocator, allocations, engine, 32, 32, 1000);
+        punch_holes(allocator, allocations, 2);
+
+        SP_CHECK(allocator.Defragment(0).empty());
+        uint32_t call_count = 0;
+        while (allocator.GetFreeRangeCount() > 1 && call_count++ < 1000)
+        {
+            const vector<RangeAllocatorMove> moves = allocator.Defragment(4);
+            SP_CHECK(!moves.empty() && moves.size() <= 4);
+            for (const RangeAllocatorMove& move : moves)
+            {
+                allocations.erase(move.offset_source);
+                SP_CHECK(!overlaps_any(allocations, move.offset_destination, move.size));
+                allocations[move.offset_destination] = move.size;
+            }
+        }
+        SP_CHECK(allocator.GetFreeRangeCount() == 1);
+    }
+}
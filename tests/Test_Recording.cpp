@@ -0,0 +1,214 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES =========================
+#include "Test.h"
+#include "Engine.h"
+#include "ThreadPool.h"
+#include "Stopwatch.h"
+#include "Rendering/Renderer.h"
+#include "Rendering/Renderer_Buffers.h"
+#include "Rendering/Mesh.h"
+#include "RHI/RHI_Device.h"
+#include "RHI/RHI_CommandList.h"
+#include "RHI/RHI_PipelineState.h"
+#include "RHI/RHI_Shader.h"
+#include <random>
+#include <thread>
+//====================================
+
+//= NAMESPACES ===============
+using namespace std;
+using namespace Spartan;
+using namespace Spartan::Math;
+//============================
+
+// parallel command list recording through RHI_CommandList::RecordParallel(), the way parallel_recording::record() in Renderer_Passes.cpp
+// drives it for the g-buffer: contiguous ranges of a sorted draw list, one secondary command list per job, it needs a gpu like the editor
+namespace
+{
+    const uint32_t draw_count    = 50'000;
+    const uint32_t job_count_max = 32; // same as parallel_recording
+
+    struct Draw
+    {
+        Mesh* mesh             = nullptr;
+        RHI_Shader* shader_v   = nullptr;
+        RHI_CullMode cull_mode = RHI_CullMode::Back;
+        Matrix transform;
+    };
+
+    // the g-buffer vertex shader which matches the mesh's vertex layout, see get_vertex_shader() in Renderer_Passes.cpp
+    RHI_Shader* get_vertex_shader(const Mesh* mesh)
+    {
+        switch (mesh->GetVertexType())
+        {
+            case RHI_Vertex_Type::PosUvNorTanPacked:     return Renderer::GetShader(Renderer_Shader::gbuffer_packed_v).get();
+            case RHI_Vertex_Type::PosUvNorTanPackedHalf: return Renderer::GetShader(Renderer_Shader::gbuffer_packed_half_v).get();
+            default:                                     return Renderer::GetShader(Renderer_Shader::gbuffer_v).get();
+        }
+    }
+
+    // sorted by mesh, like the renderer's opaque renderables are sorted by geometry
+    vector<Draw> create_scene()
+    {
+        const MeshType mesh_types[] = { MeshType::Cube, MeshType::Quad, MeshType::Sphere, MeshType::Cylinder, MeshType::Cone };
+        const uint32_t mesh_count   = static_cast<uint32_t>(size(mesh_types));
+
+        mt19937 engine(1234);
+        uniform_real_distribution<float> position(-500.0f, 500.0f);
+
+        vector<Draw> draws(draw_count);
+        for (uint32_t i = 0; i < draw_count; i++)
+        {
+            Draw& draw     = draws[i];
+            draw.mesh      = Renderer::GetStandardMesh(mesh_types[i * mesh_count / draw_count]).get();
+            draw.shader_v  = get_vertex_shader(draw.mesh);
+            draw.cull_mode = (i / 997) % 2 == 0 ? RHI_CullMode::Back : RHI_CullMode::None;
+            draw.transform = Matrix::CreateTranslation(Vector3(position(engine), position(engine), position(engine)));
+        }
+
+        return draws;
+    }
+
+    RHI_PipelineState create_pipeline_state()
+    {
+        RHI_PipelineState pso;
+        pso.name                             = "recording_benchmark";
+        pso.shaders[RHI_Shader_Type::Vertex] = Renderer::GetShader(Renderer_Shader::gbuffer_v).get();
+        pso.shaders[RHI_Shader_Type::Pixel]  = Renderer::GetShader(Renderer_Shader::gbuffer_p).get();
+        pso.blend_state                      = Renderer::GetBlendState(Renderer_BlendState::Off).get();
+        pso.rasterizer_state                 = Renderer::GetRasterizerState(Renderer_RasterizerState::Solid).get();
+        pso.depth_stencil_state              = Renderer::GetDepthStencilState(Renderer_DepthStencilState::Read).get();
+        pso.resolution_scale                 = true;
+        pso.render_target_color_textures[0]  = Renderer::GetRenderTarget(Renderer_RenderTarget::gbuffer_color).get();
+        pso.render_target_color_textures[1]  = Renderer::GetRenderTarget(Renderer_RenderTarget::gbuffer_normal).get();
+        pso.render_target_color_textures[2]  = Renderer::GetRenderTarget(Renderer_RenderTarget::gbuffer_material).get();
+        pso.render_target_color_textures[3]  = Renderer::GetRenderTarget(Renderer_RenderTarget::gbuffer_velocity).get();
+        pso.render_target_depth_texture      = Renderer::GetRenderTarget(Renderer_RenderTarget::gbuffer_depth).get();
+        pso.clear_color[0]                   = Color::standard_transparent;
+        pso.clear_color[1]                   = Color::standard_transparent;
+        pso.clear_color[2]                   = Color::standard_transparent;
+        pso.clear_color[3]                   = Color::standard_transparent;
+
+        return pso;
+    }
+
+    // same as the g-buffer pass, each job toggles its own copy of the pipeline state and writes its own pass constants
+    void record_range(RHI_CommandList* cmd_list, const RHI_PipelineState& pso, const vector<Draw>& draws, const uint32_t start, const uint32_t end)
+    {
+        RHI_PipelineState pso_job = pso;
+        Pcb_Pass pcb_pass;
+
+        for (uint32_t i = start; i < end; i++)
+        {
+            const Draw& draw = draws[i];
+
+            if (pso_job.shaders[RHI_Shader_Type::Vertex] != draw.shader_v)
+            {
+                pso_job.shaders[RHI_Shader_Type::Vertex] = draw.shader_v;
+                cmd_list->SetPipelineState(pso_job);
+            }
+            cmd_list->SetCullMode(draw.cull_mode);
+
+            cmd_list->SetBufferVertex(draw.mesh->GetVertexBuffer());
+            cmd_list->SetBufferIndex(draw.mesh->GetIndexBuffer());
+
+            pcb_pass.transform = draw.transform;
+            pcb_pass.set_transform_previous(draw.transform);
+            cmd_list->PushConstants(pcb_pass);
+
+            cmd_list->DrawIndexed(draw.mesh->GetIndexCount(), draw.mesh->GetIndexBufferOffset(), draw.mesh->GetVertexBufferOffset());
+        }
+    }
+
+    // returns the milliseconds it took to record, submitting and waiting for the gpu isn't part of it
+    float record(RHI_PipelineState& pso, const vector<Draw>& draws, const uint32_t job_count)
+    {
+        const uint32_t item_count = static_cast<uint32_t>(draws.size());
+        RHI_CommandList* cmd_list = RHI_Device::CmdImmediateBegin(RHI_Queue_Type::Graphics);
+
+        Stopwatch stopwatch;
+        cmd_list->RecordParallel(pso, job_count, [&](RHI_CommandList* cmd_list_job, const uint32_t job_index)
+        {
+            record_range(cmd_list_job, pso, draws, item_count * job_index / job_count, item_count * (job_index + 1) / job_count);
+        });
+        const float ms = stopwatch.GetElapsedTimeMs();
+
+        RHI_Device::CmdImmediateSubmit(cmd_list);
+
+        return ms;
+    }
+
+    bool wait_for_shaders(const vector<Renderer_Shader>& shaders)
+    {
+        for (const Renderer_Shader type : shaders)
+        {
+            RHI_Shader* shader = Renderer::GetShader(type).get();
+            while (shader->GetCompilationState() == RHI_ShaderCompilationState::Idle || shader->GetCompilationState() == RHI_ShaderCompilationState::Compiling)
+            {
+                this_thread::sleep_for(chrono::milliseconds(16));
+            }
+
+            if (!shader->IsCompiled())
+                return false;
+        }
+
+        return true;
+    }
+}
+
+SP_BENCHMARK(recording_50k_draws_by_job_count)
+{
+    Engine::Initialize({});
+
+    // the g-buffer shaders compile asynchronously
+    const bool compiled = wait_for_shaders({ Renderer_Shader::gbuffer_v, Renderer_Shader::gbuffer_packed_v, Renderer_Shader::gbuffer_packed_half_v, Renderer_Shader::gbuffer_p });
+    SP_CHECK(compiled);
+    if (compiled)
+    {
+        const vector<Draw> draws  = create_scene();
+        RHI_PipelineState pso     = create_pipeline_state();
+        const uint32_t iterations = 20;
+        char label[64];
+
+        printf("    worker threads: %u\n", ThreadPool::GetThreadCount());
+
+        float ms_serial = 0.0f;
+        for (uint32_t job_count = 1; job_count <= job_count_max; job_count *= 2)
+        {
+            record(pso, draws, job_count); // warm up, pipelines are created and the secondary command lists are allocated
+
+            float ms = 0.0f;
+            for (uint32_t i = 0; i < iterations; i++)
+            {
+                ms += record(pso, draws, job_count);
+            }
+            ms /= static_cast<float>(iterations);
+
+            ms_serial = job_count == 1 ? ms : ms_serial;
+            snprintf(label, sizeof(label), "%2u jobs (%.2fx)", job_count, ms_serial / ms);
+            Test::Report(label, ms, "ms");
+        }
+    }
+
+    Engine::Shutdown();
+}
@@ -0,0 +1,207 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES =================
+#include "Test.h"
+#include "RHI/RHI_StateTracker.h"
+//============================
+
+//= NAMESPACES =====
+using namespace std;
+using namespace Spartan;
+//==================
+
+// a mock backend which records a command only when the tracker says it changes the state, like RHI_CommandList does,
+// the tests count what reached the "api" and what was elided
+namespace
+{
+    struct MockBackend
+    {
+        RHI_StateTracker state;
+        uint32_t recorded = 0;
+        uint32_t elided   = 0;
+
+        void count(const bool is_recorded) { is_recorded ? recorded++ : elided++; }
+
+        void SetPipeline(const void* pipeline, const void* layout)                  { count(state.SetPipeline(pipeline, layout)); }
+        void SetCullMode(const RHI_CullMode cull_mode)                              { count(state.SetCullMode(cull_mode)); }
+        void SetVertexBuffer(const uint32_t binding, const uint64_t id)             { count(state.SetVertexBuffer(binding, id)); }
+        void SetIndexBuffer(const uint64_t id)                                      { count(state.SetIndexBuffer(id)); }
+        void SetViewport(const float width, const float height)                     { count(state.SetViewport(0.0f, 0.0f, width, height, 0.0f, 1.0f)); }
+        void SetScissor(const float right, const float bottom)                      { count(state.SetScissor(0.0f, 0.0f, right, bottom)); }
+        void PushConstants(const uint32_t value)                                    { count(state.PushConstants(0, sizeof(value), &value)); }
+        void SetDescriptorSet(const uint32_t set, const void* descriptor_set, const uint32_t* offsets = nullptr, const uint32_t offset_count = 0)
+        {
+            count(state.SetDescriptorSet(set, descriptor_set, offsets, offset_count));
+        }
+
+        // what RHI_CommandList::RecordParallel() does once the secondary command lists have been executed
+        void ExecuteSecondaries() { state.Invalidate(); }
+
+        void ResetCounts() { recorded = 0; elided = 0; }
+    };
+
+    // stand-ins for api handles, only their addresses matter
+    const uint8_t pipeline_a = 0, pipeline_b = 0, pipeline_c = 0;
+    const uint8_t layout_a = 0, layout_b = 0;
+    const uint8_t descriptor_set_a = 0, descriptor_set_b = 0;
+}
+
+SP_TEST(state_tracker_elides_redundant_commands)
+{
+    MockBackend backend;
+
+    // the first time everything is recorded
+    backend.SetPipeline(&pipeline_a, &layout_a);
+    backend.SetCullMode(RHI_CullMode::Back);
+    backend.SetViewport(1920.0f, 1080.0f);
+    backend.SetScissor(1920.0f, 1080.0f);
+    backend.SetVertexBuffer(0, 1);
+    backend.SetVertexBuffer(1, 2);
+    backend.SetIndexBuffer(3);
+    backend.SetDescriptorSet(0, &descriptor_set_a);
+    backend.PushConstants(7);
+    SP_CHECK(backend.recorded == 9 && backend.elided == 0);
+
+    // the same state again is all elided
+    backend.ResetCounts();
+    backend.SetPipeline(&pipeline_a, &layout_a);
+    backend.SetCullMode(RHI_CullMode::Back);
+    backend.SetViewport(1920.0f, 1080.0f);
+    backend.SetScissor(1920.0f, 1080.0f);
+    backend.SetVertexBuffer(0, 1);
+    backend.SetVertexBuffer(1, 2);
+    backend.SetIndexBuffer(3);
+    backend.SetDescriptorSet(0, &descriptor_set_a);
+    backend.PushConstants(7);
+    SP_CHECK(backend.recorded == 0 && backend.elided == 9);
+
+    // only what changes is recorded
+    backend.ResetCounts();
+    backend.SetCullMode(RHI_CullMode::None);
+    backend.SetVertexBuffer(0, 4);
+    backend.SetVertexBuffer(1, 2);
+    backend.SetIndexBuffer(3);
+    backend.PushConstants(8);
+    SP_CHECK(backend.recorded == 3 && backend.elided == 2);
+
+    // a vertex buffer binding isn't confused with another
+    backend.ResetCounts();
+    backend.SetVertexBuffer(1, 4);
+    SP_CHECK(backend.recorded == 1);
+}
+
+SP_TEST(state_tracker_dynamic_offsets_are_part_of_the_descriptor_state)
+{
+    MockBackend backend;
+    backend.SetPipeline(&pipeline_a, &layout_a);
+
+    const uint32_t offsets_a[2] = { 0, 256 };
+    const uint32_t offsets_b[2] = { 0, 512 };
+
+    backend.ResetCounts();
+    backend.SetDescriptorSet(0, &descriptor_set_a, offsets_a, 2);
+    backend.SetDescriptorSet(0, &descriptor_set_a, offsets_a, 2);
+    backend.SetDescriptorSet(0, &descriptor_set_a, offsets_b, 2);
+    backend.SetDescriptorSet(0, &descriptor_set_a, offsets_b, 1);
+    backend.SetDescriptorSet(1, &descriptor_set_a, offsets_b, 1);
+    backend.SetDescriptorSet(0, &descriptor_set_b, offsets_b, 1);
+    SP_CHECK(backend.recorded == 5 && backend.elided == 1);
+
+    // a null set is never elided, it can't be known to be bound
+    backend.ResetCounts();
+    backend.SetDescriptorSet(2, nullptr);
+    backend.SetDescriptorSet(2, nullptr);
+    SP_CHECK(backend.recorded == 2 && backend.elided == 0);
+}
+
+SP_TEST(state_tracker_pipeline_layout_change_resets_descriptors_and_push_constants)
+{
+    MockBackend backend;
+    backend.SetPipeline(&pipeline_a, &layout_a);
+    backend.SetDescriptorSet(0, &descriptor_set_a);
+    backend.SetDescriptorSet(1, &descriptor_set_b);
+    backend.PushConstants(7);
+
+    // another pipeline with the same layout keeps the descriptors and push constants
+    backend.ResetCounts();
+    backend.SetPipeline(&pipeline_b, &layout_a);
+    backend.SetDescriptorSet(0, &descriptor_set_a);
+    backend.SetDescriptorSet(1, &descriptor_set_b);
+    backend.PushConstants(7);
+    SP_CHECK(backend.recorded == 1 && backend.elided == 3);
+
+    // a pipeline with a different layout disturbs them, so they have to be recorded again
+    backend.ResetCounts();
+    backend.SetPipeline(&pipeline_c, &layout_b);
+    backend.SetDescriptorSet(0, &descriptor_set_a);
+    backend.SetDescriptorSet(1, &descriptor_set_b);
+    backend.PushConstants(7);
+    SP_CHECK(backend.recorded == 4 && backend.elided == 0);
+
+    // going back to the first layout, even with a pipeline that was bound before
+    backend.ResetCounts();
+    backend.SetPipeline(&pipeline_a, &layout_a);
+    backend.SetDescriptorSet(0, &descriptor_set_a);
+    backend.PushConstants(7);
+    SP_CHECK(backend.recorded == 3 && backend.elided == 0);
+
+    // state which doesn't depend on the layout survives it
+    backend.SetIndexBuffer(3);
+    backend.SetCullMode(RHI_CullMode::Back);
+    backend.ResetCounts();
+    backend.SetPipeline(&pipeline_c, &layout_b);
+    backend.SetIndexBuffer(3);
+    backend.SetCullMode(RHI_CullMode::Back);
+    SP_CHECK(backend.recorded == 1 && backend.elided == 2);
+}
+
+SP_TEST(state_tracker_invalidate_after_secondary_execution)
+{
+    MockBackend backend;
+    backend.SetPipeline(&pipeline_a, &layout_a);
+    backend.SetCullMode(RHI_CullMode::Back);
+    backend.SetViewport(1920.0f, 1080.0f);
+    backend.SetScissor(1920.0f, 1080.0f);
+    backend.SetVertexBuffer(0, 1);
+    backend.SetIndexBuffer(3);
+    backend.SetDescriptorSet(0, &descriptor_set_a);
+    backend.PushConstants(7);
+
+    // the secondaries leave the primary's state undefined, so nothing may be elided afterwards
+    backend.ExecuteSecondaries();
+    backend.ResetCounts();
+    backend.SetPipeline(&pipeline_a, &layout_a);
+    backend.SetCullMode(RHI_CullMode::Back);
+    backend.SetViewport(1920.0f, 1080.0f);
+    backend.SetScissor(1920.0f, 1080.0f);
+    backend.SetVertexBuffer(0, 1);
+    backend.SetIndexBuffer(3);
+    backend.SetDescriptorSet(0, &descriptor_set_a);
+    backend.PushConstants(7);
+    SP_CHECK(backend.recorded == 8 && backend.elided == 0);
+
+    // and from then on, tracking resumes
+    backend.ResetCounts();
+    backend.SetPipeline(&pipeline_a, &layout_a);
+    backend.PushConstants(7);
+    SP_CHECK(backend.recorded == 0 && backend.elided == 2);
+}
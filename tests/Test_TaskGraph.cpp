@@ -0,0 +1,82 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES ==========
+#include "Test.h"
+#include "TaskGraph.h"
+#include "ThreadPool.h"
+#include <thread>
+//=====================
+
+//= NAMESPACES =====
+using namespace std;
+using namespace Spartan;
+//==================
+
+// a graph shaped like the engine's frame, every stage records when it ran so that the ordering the resources imply can be checked
+namespace
+{
+    struct Record
+    {
+        atomic<uint32_t> order = 0;
+        thread::id thread_id;
+    };
+
+    void add_stage(TaskGraph& graph, const char* name, TaskGraphResource reads, TaskGraphResource writes, bool main_thread, atomic<uint32_t>& counter, Record& record)
+    {
+        graph.AddStage(name, reads, writes, main_thread, [&counter, &record]()
+        {
+            this_thread::sleep_for(chrono::microseconds(200)); // long enough for the stages to overlap
+            record.thread_id = this_thread::get_id();
+            record.order     = ++counter;
+        });
+    }
+}
+
+SP_TEST(task_graph_order)
+{
+    ThreadPool::Initialize();
+
+    for (uint32_t iteration = 0; iteration < 200; iteration++)
+    {
+        // destroyed at the end of every iteration, right after executing, the pool tasks it queued must not outlive it
+        TaskGraph graph;
+        atomic<uint32_t> counter = 0;
+        Record input, physics, audio, world, render;
+        add_stage(graph, "input",   TaskGraphResource::None,  TaskGraphResource::Input,                                 true,  counter, input);
+        add_stage(graph, "physics", TaskGraphResource::None,  TaskGraphResource::Physics | TaskGraphResource::Transforms, false, counter, physics);
+        add_stage(graph, "audio",   TaskGraphResource::None,  TaskGraphResource::Audio,                                 false, counter, audio);
+        add_stage(graph, "world",   TaskGraphResource::Input, TaskGraphResource::World | TaskGraphResource::Transforms,   false, counter, world);
+        add_stage(graph, "render",  TaskGraphResource::World | TaskGraphResource::Transforms, TaskGraphResource::Gpu,   true,  counter, render);
+        graph.Execute();
+
+        // every stage ran once, after the stages it conflicts with
+        SP_CHECK(counter == 5);
+        SP_CHECK(input.order < world.order && physics.order < world.order);
+        SP_CHECK(world.order < render.order);
+
+        // main thread stages ran on the calling thread
+        SP_CHECK(input.thread_id == this_thread::get_id() && render.thread_id == this_thread::get_id());
+        SP_CHECK(graph.GetStages()[0].ran_on_main_thread && graph.GetStages()[4].ran_on_main_thread);
+    }
+
+    ThreadPool::Shutdown();
+}
@@ -0,0 +1,210 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES ==============
+#include "Test.h"
+#include "Rendering/Mesh.h"
+#include <random>
+#include <cstring>
+//=========================
+
+//= NAMESPACES ===============
+using namespace std;
+using namespace Spartan;
+using namespace Spartan::Math;
+//============================
+
+// random vertices are packed by Mesh::PackVertex() and decoded the way the shaders do it (see decode_octahedral() in common_vertex_processing.hlsl),
+// the decoded attributes are compared against the originals
+namespace
+{
+    // 16 bit octahedral encoding, the worst case is well below this
+    const float direction_error_max = 0.0001f; // in radians
+
+    struct Errors
+    {
+        float position = 0.0f;
+        float uv       = 0.0f;
+        float normal   = 0.0f;
+        float tangent  = 0.0f;
+    };
+
+    vector<RHI_Vertex_PosTexNorTan> create_vertices(const uint32_t count, const float extent, const float extent_uv)
+    {
+        mt19937 engine(1234);
+        uniform_real_distribution<float> position(-extent, extent);
+        uniform_real_distribution<float> uv(-extent_uv, extent_uv);
+        uniform_real_distribution<float> direction(-1.0f, 1.0f);
+
+        auto random_direction = [&]()
+        {
+            Vector3 v;
+            do
+            {
+                v = Vector3(direction(engine), direction(engine), direction(engine));
+            } while (v.LengthSquared() < 0.01f || v.LengthSquared() > 1.0f);
+
+            return v.Normalized();
+        };
+
+        vector<RHI_Vertex_PosTexNorTan> vertices(count);
+        for (RHI_Vertex_PosTexNorTan& vertex : vertices)
+        {
+            vertex = RHI_Vertex_PosTexNorTan(Vector3(position(engine), position(engine), position(engine)), Vector2(uv(engine), uv(engine)), random_direction(), random_direction());
+        }
+
+        // the corners of the bounds, where the rounding is the coarsest
+        vertices[0].pos[0] = vertices[0].pos[1] = vertices[0].pos[2] = extent;
+        vertices[0].tex[0] = vertices[0].tex[1] = -extent_uv;
+
+        return vertices;
+    }
+
+    float decode_half(const uint16_t half)
+    {
+        const uint32_t sign     = (half & 0x8000u) << 16;
+        const uint32_t exponent = (half >> 10) & 0x1fu;
+        const uint32_t mantissa = half & 0x3ffu;
+
+        float value = 0.0f;
+        if (exponent == 0)
+        {
+            value = ldexp(static_cast<float>(mantissa), -24); // subnormal
+        }
+        else
+        {
+            value = ldexp(static_cast<float>(mantissa | 0x400u), static_cast<int>(exponent) - 25);
+        }
+
+        uint32_t bits = 0;
+        memcpy(&bits, &value, sizeof(bits));
+        bits |= sign;
+        memcpy(&value, &bits, sizeof(bits));
+
+        return value;
+    }
+
+    Vector3 decode_octahedral(const int16_t* encoded)
+    {
+        Vector3 n = Vector3(max(encoded[0] / 32767.0f, -1.0f), max(encoded[1] / 32767.0f, -1.0f), 0.0f);
+        n.z       = 1.0f - fabs(n.x) - fabs(n.y);
+        float t   = max(-n.z, 0.0f);
+        n.x      += n.x >= 0.0f ? -t : t;
+        n.y      += n.y >= 0.0f ? -t : t;
+
+        return n.Normalized();
+    }
+
+    // acos() of the dot product is too imprecise for such small angles
+    float get_angle(const float* a, const Vector3& b)
+    {
+        const Vector3 v = Vector3(a[0], a[1], a[2]);
+        return atan2(v.Cross(b).Length(), v.Dot(b));
+    }
+
+    template<typename T>
+    void accumulate_attribute_errors(const RHI_Vertex_PosTexNorTan& vertex, const T& packed, Errors* errors)
+    {
+        errors->uv      = max(errors->uv, max(fabs(decode_half(packed.tex[0]) - vertex.tex[0]), fabs(decode_half(packed.tex[1]) - vertex.tex[1])));
+        errors->normal  = max(errors->normal, get_angle(vertex.nor, decode_octahedral(&packed.nor_tan[0])));
+        errors->tangent = max(errors->tangent, get_angle(vertex.tan, decode_octahedral(&packed.nor_tan[2])));
+    }
+
+    Errors pack(const vector<RHI_Vertex_PosTexNorTan>& vertices, const RHI_Vertex_Type type)
+    {
+        Errors errors;
+        for (const RHI_Vertex_PosTexNorTan& vertex : vertices)
+        {
+            if (type == RHI_Vertex_Type::PosUvNorTanPackedHalf)
+            {
+                RHI_Vertex_PosTexNorTanPackedHalf packed;
+                Mesh::PackVertex(vertex, &packed);
+                for (uint32_t i = 0; i < 3; i++)
+                {
+                    errors.position = max(errors.position, fabs(decode_half(packed.pos[i]) - vertex.pos[i]));
+                }
+                SP_CHECK(decode_half(packed.pos[3]) == 1.0f);
+                accumulate_attribute_errors(vertex, packed, &errors);
+            }
+            else
+            {
+                RHI_Vertex_PosTexNorTanPacked packed;
+                Mesh::PackVertex(vertex, &packed);
+                for (uint32_t i = 0; i < 3; i++)
+                {
+                    errors.position = max(errors.position, fabs(packed.pos[i] - vertex.pos[i]));
+                }
+                accumulate_attribute_errors(vertex, packed, &errors);
+            }
+        }
+
+        return errors;
+    }
+
+    void report(const char* label, const Errors& errors)
+    {
+        printf("    %s: position %.6f, uv %.6f, normal %.6f rad, tangent %.6f rad\n", label, errors.position, errors.uv, errors.normal, errors.tangent);
+    }
+}
+
+SP_TEST(vertex_packing_errors)
+{
+    const uint32_t count = 100'000;
+
+    // small geometry, half precision positions
+    {
+        const vector<RHI_Vertex_PosTexNorTan> vertices = create_vertices(count, 2.0f, 2.0f);
+        SP_CHECK(Mesh::GetPackedVertexType(vertices) == RHI_Vertex_Type::PosUvNorTanPackedHalf);
+
+        const Errors errors = pack(vertices, RHI_Vertex_Type::PosUvNorTanPackedHalf);
+        report("half", errors);
+        SP_CHECK(errors.position <= mesh_packed_position_error_max);
+        SP_CHECK(errors.uv <= mesh_packed_uv_error_max);
+        SP_CHECK(errors.normal <= direction_error_max);
+        SP_CHECK(errors.tangent <= direction_error_max);
+    }
+
+    // large geometry, the positions would round too much so they stay float
+    {
+        const vector<RHI_Vertex_PosTexNorTan> vertices = create_vertices(count, 100.0f, 2.0f);
+        SP_CHECK(Mesh::GetPackedVertexType(vertices) == RHI_Vertex_Type::PosUvNorTanPacked);
+
+        const Errors errors = pack(vertices, RHI_Vertex_Type::PosUvNorTanPacked);
+        report("float", errors);
+        SP_CHECK(errors.position == 0.0f);
+        SP_CHECK(errors.uv <= mesh_packed_uv_error_max);
+        SP_CHECK(errors.normal <= direction_error_max);
+        SP_CHECK(errors.tangent <= direction_error_max);
+
+        // and had they been halved, they would be out of bounds, so the choice isn't overly conservative
+        SP_CHECK(pack(vertices, RHI_Vertex_Type::PosUvNorTanPackedHalf).position > mesh_packed_position_error_max);
+    }
+
+    // the threshold, the largest coordinate for which a half is within the bound
+    {
+        const float extent_half = mesh_packed_position_error_max * 2048.0f;
+        SP_CHECK(Mesh::GetPackedVertexType(create_vertices(16, extent_half, 1.0f)) == RHI_Vertex_Type::PosUvNorTanPackedHalf);
+        SP_CHECK(Mesh::GetPackedVertexType(create_vertices(16, extent_half * 1.01f, 1.0f)) == RHI_Vertex_Type::PosUvNorTanPacked);
+    }
+
+    // tiling uvs don't fit a half, so the full layout is kept
+    SP_CHECK(Mesh::GetPackedVertexType(create_vertices(count, 1.0f, 8.0f)) == RHI_Vertex_Type::PosUvNorTan);
+}
@@ -0,0 +1,75 @@
+/*
+Copyright(c) 2016-2024 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES ===========
+#include "Test.h"
+#include <string>
+//======================
+
+//= NAMESPACES =====
+using namespace std;
+//==================
+
+// runs every test, and every benchmark when -benchmark is passed, an optional
+// name filter runs only the cases whose name contains it, returns non-zero on failure
+int main(int argc, char** argv)
+{
+    bool run_benchmarks = false;
+    string filter;
+    for (int i = 1; i < argc; i++)
+    {
+        const string argument = argv[i];
+        if (argument == "-benchmark")
+        {
+            run_benchmarks = true;
+        }
+        else
+        {
+            filter = argument;
+        }
+    }
+
+    uint32_t run_count    = 0;
+    uint32_t failed_count = 0;
+    for (const Spartan::Test::Case& test_case : Spartan::Test::GetCases())
+    {
+        if (test_case.is_benchmark && !run_benchmarks)
+            continue;
+
+        if (!filter.empty() && string(test_case.name).find(filter) == string::npos)
+            continue;
+
+        printf("%s %s\n", test_case.is_benchmark ? "[benchmark]" : "[test]", test_case.name);
+
+        const uint32_t failures_before = Spartan::Test::GetFailureCount();
+        test_case.function();
+        run_count++;
+
+        if (Spartan::Test::GetFailureCount() != failures_before)
+        {
+            failed_count++;
+        }
+    }
+
+    printf("%u ran, %u failed\n", run_count, failed_count);
+
+    return failed_count == 0 ? 0 : 1;
+}